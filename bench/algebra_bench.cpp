@@ -0,0 +1,372 @@
+#include "analysis.h"
+#include "solver.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+// Every heap allocation of the process goes through here, so a phase can be charged with the
+// allocations it makes. The whole set of replaceable operators is covered, so every form of new
+// is counted and every form of delete frees with the matching allocator.
+static std::atomic<uint64_t> g_Allocations{ 0 };
+static std::atomic<uint64_t> g_AllocatedBytes{ 0 };
+
+static void* CountedAlloc(size_t size, size_t alignment) noexcept {
+    g_Allocations.fetch_add(1, std::memory_order_relaxed);
+    g_AllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    size = std::max<size_t>(size, 1);
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+        return std::malloc(size);
+    }
+    // aligned_alloc wants a size that is a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+static void* CountedNew(size_t size, size_t alignment) {
+    if (void* p = CountedAlloc(size, alignment)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size) {
+    return CountedNew(size, 0);
+}
+
+void* operator new[](size_t size) {
+    return CountedNew(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return CountedNew(size, size_t(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return CountedNew(size, size_t(alignment));
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size, size_t(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return CountedAlloc(size, size_t(alignment));
+}
+
+// malloc and aligned_alloc both release with free
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, size_t, std::align_val_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {
+    std::free(p);
+}
+
+struct GeneratorOptions {
+    size_t Terms = 8;          // terms on the left side
+    size_t Depth = 2;          // parentheses around every term
+    double CallDensity = 0.25; // chance that a constant is written as a function call
+    uint32_t Degree = 4;       // highest power of x, the first term always has it
+};
+
+// Random polynomial equations that stay valid whatever the options, the same seed always gives
+// the same equations
+class EquationGenerator {
+  public:
+    EquationGenerator(uint64_t seed, const GeneratorOptions& options)
+        : m_Random(seed), m_Options(options) {}
+
+    std::string Next() {
+        std::string equation;
+        for (size_t i = 0; i < m_Options.Terms; i++) {
+            if (i > 0) {
+                equation += Chance(0.5) ? " + " : " - ";
+            }
+            const uint32_t power = i == 0 ? m_Options.Degree : Uniform(0, m_Options.Degree);
+            equation += Term(power);
+        }
+        equation += " = ";
+        equation += Constant();
+        return equation;
+    }
+
+  private:
+    bool Chance(double probability) {
+        return std::uniform_real_distribution<double>(0.0, 1.0)(m_Random) < probability;
+    }
+    uint32_t Uniform(uint32_t lo, uint32_t hi) {
+        return std::uniform_int_distribution<uint32_t>(lo, hi)(m_Random);
+    }
+
+    // A value from 1 to 9, possibly behind a call that computes it exactly
+    std::string Constant() {
+        const uint32_t k = Uniform(1, 9);
+        if (!Chance(m_Options.CallDensity)) {
+            return std::to_string(k);
+        }
+        switch (Uniform(0, 3)) {
+            case 0: return "sqrt(" + std::to_string(k * k) + ")";
+            case 1: return "abs(-" + std::to_string(k) + ")";
+            case 2: return "floor(" + std::to_string(k) + ".5)";
+            default: return std::to_string(k) + " * cos(0)";
+        }
+    }
+
+    std::string Term(uint32_t power) {
+        std::string term = Constant();
+        if (power > 0) {
+            term += Chance(0.5) ? " * x" : "x";
+            if (power > 1) {
+                term += "^" + std::to_string(power);
+            }
+        }
+        for (size_t i = 0; i < m_Options.Depth; i++) {
+            switch (Uniform(0, 2)) {
+                case 0: term = "(" + term + ")"; break;
+                case 1: term = "-(-" + term + ")"; break;
+                default: term = "(" + term + " + 0)"; break;
+            }
+        }
+        return term;
+    }
+
+    std::mt19937_64 m_Random;
+    GeneratorOptions m_Options;
+};
+
+struct PhaseResult {
+    double NsPerOp = 0.0;
+    double AllocationsPerOp = 0.0;
+    double BytesPerOp = 0.0;      // heap
+    double ArenaBytesPerOp = 0.0; // bump allocated in the solve arena
+};
+
+// Runs op(i) over all i once to warm up, then repeat more times. The time is the fastest pass,
+// the allocations are averaged over all timed passes. op returns the arena bytes it used.
+template <typename Op>
+static PhaseResult Measure(size_t count, size_t repeat, Op&& op) {
+    for (size_t i = 0; i < count; i++) {
+        op(i);
+    }
+
+    PhaseResult result;
+    double best = 0.0;
+    uint64_t arenaBytes = 0;
+    const uint64_t allocations = g_Allocations.load(std::memory_order_relaxed);
+    const uint64_t bytes = g_AllocatedBytes.load(std::memory_order_relaxed);
+    for (size_t r = 0; r < repeat; r++) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++) {
+            arenaBytes += op(i);
+        }
+        const std::chrono::duration<double, std::nano> elapsed =
+            std::chrono::steady_clock::now() - start;
+        best = r == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+
+    const double ops = double(count * repeat);
+    const uint64_t allocated = g_Allocations.load(std::memory_order_relaxed) - allocations;
+    const uint64_t allocatedBytes = g_AllocatedBytes.load(std::memory_order_relaxed) - bytes;
+    result.NsPerOp = best / double(count);
+    result.AllocationsPerOp = double(allocated) / ops;
+    result.BytesPerOp = double(allocatedBytes) / ops;
+    result.ArenaBytesPerOp = double(arenaBytes) / ops;
+    return result;
+}
+
+static void PrintUsage() {
+    std::cerr << "Usage: algebra_bench [--seed <n>] [--count <n>] [--repeat <n>] [--terms <n>]\n"
+                 "                     [--depth <n>] [--calls <probability>] [--degree <n>]\n";
+}
+
+static void PrintPhase(const char* name, const PhaseResult& phase, bool last) {
+    std::printf("    \"%s\": { \"ns_per_op\": %.1f, \"allocs_per_op\": %.3f, "
+                "\"bytes_per_op\": %.1f, \"arena_bytes_per_op\": %.1f }%s\n",
+        name, phase.NsPerOp, phase.AllocationsPerOp, phase.BytesPerOp, phase.ArenaBytesPerOp,
+        last ? "" : ",");
+}
+
+int main(int argc, char** argv) {
+    GeneratorOptions options;
+    uint64_t seed = 1;
+    size_t count = 10000;
+    size_t repeat = 5;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+        if (std::strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--count") == 0 && hasValue) {
+            count = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--repeat") == 0 && hasValue) {
+            repeat = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--terms") == 0 && hasValue) {
+            options.Terms = std::max<size_t>(1, std::strtoul(argv[++i], nullptr, 10));
+        } else if (std::strcmp(argv[i], "--depth") == 0 && hasValue) {
+            options.Depth = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--calls") == 0 && hasValue) {
+            options.CallDensity = std::strtod(argv[++i], nullptr);
+        } else if (std::strcmp(argv[i], "--degree") == 0 && hasValue) {
+            options.Degree = std::min<uint32_t>(MAX_DEGREE, std::strtoul(argv[++i], nullptr, 10));
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    EquationGenerator generator(seed, options);
+    std::vector<std::string> equations(count);
+    for (std::string& equation : equations) {
+        equation = generator.Next();
+    }
+
+    // The later phases start from the output of the earlier ones, kept in an arena of their own.
+    // Parsing folds constants as in Solve().
+    ArenaAllocator keep;
+    std::vector<const Ast*> trees(count);
+    std::vector<std::vector<double>> polynomials(count);
+    for (size_t i = 0; i < count; i++) {
+        Tokenizer* tokenizer = keep.alloc<Tokenizer>(equations[i]);
+        Parser* parser = keep.alloc<Parser>(*tokenizer, &keep);
+        parser->SetFoldConstants(true);
+        const auto ast = parser->ParseEquation();
+        if (!ast) {
+            std::cerr << "Error: generated an invalid equation: " << equations[i] << "\n";
+            return 1;
+        }
+        trees[i] = *ast;
+
+        Analyzer analyzer(&keep);
+        const AnalyzeResult poly = analyzer.Analyze(**ast);
+        if (!poly) {
+            std::cerr << "Error: generated an invalid equation: " << equations[i] << "\n";
+            return 1;
+        }
+        const auto coefficients = analyzer.Coefficients(*poly);
+        polynomials[i].assign(coefficients.begin(), coefficients.end());
+    }
+
+    ArenaAllocator arena;
+    Solutions solutions;
+    volatile size_t sink = 0; // keeps the tokenizer loop from being optimized out
+
+    const PhaseResult tokenize = Measure(count, repeat, [&](size_t i) -> size_t {
+        Tokenizer tokenizer(equations[i]);
+        size_t tokens = 0;
+        while (tokenizer.Next()->Type != TokenType::END_OF_FILE) {
+            tokens++;
+        }
+        sink = sink + tokens;
+        return 0;
+    });
+
+    // The parser drives the tokenizer, so this includes tokenizing
+    const PhaseResult parse = Measure(count, repeat, [&](size_t i) -> size_t {
+        arena.Reset();
+        Tokenizer tokenizer(equations[i]);
+        Parser parser(tokenizer, &arena);
+        parser.SetFoldConstants(true);
+        sink = sink + (*parser.ParseEquation())->Nodes.size();
+        return arena.BytesUsed();
+    });
+
+    const PhaseResult analyze = Measure(count, repeat, [&](size_t i) -> size_t {
+        arena.Reset();
+        Analyzer analyzer(&arena);
+        sink = sink + analyzer.Analyze(*trees[i])->Degree;
+        return arena.BytesUsed();
+    });
+
+    const PhaseResult roots = Measure(count, repeat, [&](size_t i) -> size_t {
+        arena.Reset();
+        solutions.Values.clear();
+        solutions.IsInfinite = false;
+        solutions.IsNone = false;
+        FindRoots(polynomials[i], &arena, solutions);
+        return arena.BytesUsed();
+    });
+
+    // Everything together, through the public entry point
+    const PhaseResult solve = Measure(count, repeat, [&](size_t i) -> size_t {
+        sink = sink + Solve(equations[i], solutions).has_value();
+        return 0;
+    });
+
+    size_t bytes = 0;
+    for (const std::string& equation : equations) {
+        bytes += equation.size();
+    }
+
+    std::printf("{\n");
+    std::printf("  \"seed\": %llu,\n", static_cast<unsigned long long>(seed));
+    std::printf("  \"equations\": %zu,\n", count);
+    std::printf("  \"repeat\": %zu,\n", repeat);
+    std::printf("  \"mean_length\": %.1f,\n", double(bytes) / double(count));
+    std::printf("  \"generator\": { \"terms\": %zu, \"depth\": %zu, \"call_density\": %g, "
+                "\"degree\": %u },\n",
+        options.Terms, options.Depth, options.CallDensity, options.Degree);
+    std::printf("  \"phases\": {\n");
+    PrintPhase("tokenize", tokenize, false);
+    PrintPhase("parse", parse, false);
+    PrintPhase("analyze", analyze, false);
+    PrintPhase("roots", roots, false);
+    PrintPhase("solve", solve, true);
+    std::printf("  }\n");
+    std::printf("}\n");
+    return 0;
+}
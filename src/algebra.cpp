@@ -0,0 +1,136 @@
+#include "algebra.h"
+#include "context.h"
+#include <new>
+#include <vector>
+
+struct AlgebraContext {
+    SolveContext Context;
+    NumericOptions Numeric;
+    SolveLimits Limits;
+    Solutions Result;
+    std::optional<SolveError> Error;
+};
+
+struct AlgebraEquation {
+    CompiledEquation Equation;
+};
+
+static int Finish(AlgebraContext* context, const std::expected<void, SolveError>& result) {
+    if (!result) {
+        context->Result.Values.clear();
+        context->Error = result.error();
+        return -1;
+    }
+    context->Error.reset();
+    return 0;
+}
+
+// Exceptions can't cross the C interface, they become the error of context
+template <typename F>
+static int Guard(AlgebraContext* context, F&& solve) {
+    try {
+        return Finish(context, solve());
+    } catch (const std::bad_alloc&) {
+        return Finish(context, std::unexpected(SolveError{ ErrorCode::OutOfMemory, 0 }));
+    } catch (...) {
+        return Finish(context, std::unexpected(SolveError{ ErrorCode::InternalError, 0 }));
+    }
+}
+
+int AlgebraAbiVersion(void) {
+    return ALGEBRA_ABI_VERSION;
+}
+
+AlgebraContext* AlgebraCreateContext(void) {
+    try {
+        return new AlgebraContext();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void AlgebraDestroyContext(AlgebraContext* context) {
+    delete context;
+}
+
+void AlgebraSetNumericRange(AlgebraContext* context, double lo, double hi, size_t samples) {
+    context->Numeric.Lo = lo;
+    context->Numeric.Hi = hi;
+    context->Numeric.Samples = samples;
+}
+
+void AlgebraSetLimits(AlgebraContext* context, size_t maxInputBytes, size_t maxTokens,
+    size_t maxNodes, size_t maxDepth, size_t maxArenaBytes, uint64_t timeoutMicroseconds) {
+    context->Limits.MaxInputBytes = maxInputBytes;
+    context->Limits.MaxTokens = maxTokens;
+    context->Limits.MaxNodes = maxNodes;
+    context->Limits.MaxDepth = maxDepth;
+    context->Limits.MaxArenaBytes = maxArenaBytes;
+    context->Limits.Timeout = std::chrono::microseconds(timeoutMicroseconds);
+}
+
+int AlgebraSolve(AlgebraContext* context, const char* equation, size_t length) {
+    return Guard(context, [&] {
+        return context->Context.Solve(
+            { equation, length }, context->Result, context->Numeric, context->Limits);
+    });
+}
+
+AlgebraEquation* AlgebraCompile(AlgebraContext* context, const char* equation, size_t length,
+    const char* const* params, size_t paramCount) {
+    AlgebraEquation* result = nullptr;
+    Guard(context, [&]() -> std::expected<void, SolveError> {
+        std::vector<std::string_view> names(params, params + paramCount);
+        auto compiled = Compile({ equation, length }, names);
+        if (!compiled) {
+            return std::unexpected(compiled.error());
+        }
+        result = new AlgebraEquation{ std::move(*compiled) };
+        return {};
+    });
+    return result;
+}
+
+void AlgebraDestroyEquation(AlgebraEquation* equation) {
+    delete equation;
+}
+
+int AlgebraSolveCompiled(AlgebraContext* context, const AlgebraEquation* equation,
+    const double* params, size_t paramCount) {
+    return Guard(context, [&] {
+        return context->Context.Solve(
+            equation->Equation, { params, paramCount }, context->Result, context->Limits);
+    });
+}
+
+size_t AlgebraRootCount(const AlgebraContext* context) {
+    return context->Result.Values.size();
+}
+
+const double* AlgebraRoots(const AlgebraContext* context) {
+    return context->Result.Values.data();
+}
+
+int AlgebraIsInfinite(const AlgebraContext* context) {
+    return !context->Error && context->Result.IsInfinite;
+}
+
+int AlgebraIsNone(const AlgebraContext* context) {
+    return !context->Error && context->Result.IsNone;
+}
+
+const char* AlgebraErrorName(const AlgebraContext* context) {
+    return context->Error ? ErrorCodeName(context->Error->Code) : "";
+}
+
+const char* AlgebraErrorMessage(const AlgebraContext* context) {
+    return context->Error ? ErrorMessage(context->Error->Code) : "";
+}
+
+const char* AlgebraErrorCategory(const AlgebraContext* context) {
+    return context->Error ? ErrorCategory(context->Error->Code) : "";
+}
+
+size_t AlgebraErrorOffset(const AlgebraContext* context) {
+    return context->Error ? context->Error->Offset : 0;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// C interface of the algebra_core library. Everything goes through opaque handles, so the layout
+// of the C++ types can change without breaking callers. A context holds the scratch memory, the
+// last result and the last error, each thread needs its own. Compiled equations can be shared
+// between threads. Strings are passed with their length and need no terminator.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(ALGEBRA_SHARED)
+    #ifdef ALGEBRA_BUILDING
+        #define ALGEBRA_API __declspec(dllexport)
+    #else
+        #define ALGEBRA_API __declspec(dllimport)
+    #endif
+#elif defined(__GNUC__)
+    #define ALGEBRA_API __attribute__((visibility("default")))
+#else
+    #define ALGEBRA_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Raised when a function is removed or changes its meaning, adding functions keeps it
+#define ALGEBRA_ABI_VERSION 1
+
+typedef struct AlgebraContext AlgebraContext;
+typedef struct AlgebraEquation AlgebraEquation;
+
+// ALGEBRA_ABI_VERSION of the library that is actually loaded
+ALGEBRA_API int AlgebraAbiVersion(void);
+
+// NULL when out of memory
+ALGEBRA_API AlgebraContext* AlgebraCreateContext(void);
+ALGEBRA_API void AlgebraDestroyContext(AlgebraContext* context);
+
+// Interval and sample count of the numeric fallback, [-100, 100] and 65536 by default
+ALGEBRA_API void AlgebraSetNumericRange(
+    AlgebraContext* context, double lo, double hi, size_t samples);
+
+// Caps on every later solve with context, 0 is no limit. Crossing one is an error of the "limit"
+// category, e.g. "Timeout".
+ALGEBRA_API void AlgebraSetLimits(AlgebraContext* context, size_t maxInputBytes, size_t maxTokens,
+    size_t maxNodes, size_t maxDepth, size_t maxArenaBytes, uint64_t timeoutMicroseconds);
+
+// 0 when solved, the roots are then read with the functions below. -1 on an error in the
+// equation, see AlgebraErrorName(), or "OutOfMemory" and "InternalError" from the library.
+ALGEBRA_API int AlgebraSolve(AlgebraContext* context, const char* equation, size_t length);
+
+// An equation with named parameters left open, NULL on an error (reported by context, out of
+// memory included). params holds paramCount names, the values are given in the same order.
+ALGEBRA_API AlgebraEquation* AlgebraCompile(AlgebraContext* context, const char* equation,
+    size_t length, const char* const* params, size_t paramCount);
+ALGEBRA_API void AlgebraDestroyEquation(AlgebraEquation* equation);
+
+// As AlgebraSolve()
+ALGEBRA_API int AlgebraSolveCompiled(AlgebraContext* context, const AlgebraEquation* equation,
+    const double* params, size_t paramCount);
+
+// The result of the last successful solve. The roots stay valid until the next solve with the
+// same context.
+ALGEBRA_API size_t AlgebraRootCount(const AlgebraContext* context);
+ALGEBRA_API const double* AlgebraRoots(const AlgebraContext* context);
+ALGEBRA_API int AlgebraIsInfinite(const AlgebraContext* context); // every x is a root
+ALGEBRA_API int AlgebraIsNone(const AlgebraContext* context);     // no real root
+
+// The last error, "" and 0 after a success. The name is the stable way to tell errors apart,
+// e.g. "DivisionByZero". The strings are static.
+ALGEBRA_API const char* AlgebraErrorName(const AlgebraContext* context);
+ALGEBRA_API const char* AlgebraErrorMessage(const AlgebraContext* context);
+ALGEBRA_API const char* AlgebraErrorCategory(const AlgebraContext* context);
+ALGEBRA_API size_t AlgebraErrorOffset(const AlgebraContext* context); // in bytes
+
+#ifdef __cplusplus
+}
+#endif
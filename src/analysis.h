@@ -0,0 +1,274 @@
+#pragma once
+
+#include "numeric.h"
+#include "parser.h"
+#include "polynomial.h"
+#include "solver.h"
+#include "stats.h"
+
+// The solving pipeline shared by Solve() and SolveStatic(). It is all constexpr, at run time the
+// arena holds the tree and the scratch arrays, during constant evaluation the arena is nullptr.
+
+// Dense polynomial in the Analyzer's coefficient pool, coefficient i multiplies x^i. Results are
+// trimmed, so Degree 0 means the value does not depend on the variable.
+struct Polynomial {
+    uint32_t Offset = 0;
+    uint32_t Degree = 0;
+};
+
+using AnalyzeResult = std::expected<Polynomial, SolveError>;
+
+constexpr std::unexpected<SolveError> AnalysisError(ErrorCode code, size_t offset) {
+    return std::unexpected(SolveError{ code, offset });
+}
+
+// Reduces a tree to the polynomial lhs - rhs, or a plain expression to its polynomial. The
+// coefficients of every node are appended to one pool and referenced by offset, since the pool
+// moves when it grows.
+class Analyzer {
+  public:
+    constexpr explicit Analyzer(ArenaAllocator* arena)
+        : m_Pool(arena), m_Values(arena), m_Scratch(arena) {}
+
+    // Every node is counted against the arena and time limits of budget
+    constexpr void SetBudget(SolveBudget* budget) { m_Budget = budget; }
+
+    // One forward scan over the nodes, post-order guarantees the operands are already analyzed
+    constexpr AnalyzeResult Analyze(const Ast& ast) {
+        m_Values.resize(ast.Nodes.size());
+
+        for (size_t i = 0; i < ast.Nodes.size(); i++) {
+            const Node& node = ast.Nodes[i];
+            Polynomial result;
+            if (m_Budget) {
+                if (const std::optional<ErrorCode> code = m_Budget->Check()) {
+                    return AnalysisError(*code, node.Offset);
+                }
+            }
+
+            switch (node.Tag) {
+                case NodeTag::Number: result = Constant(ast.Literals[node.Lhs]); break;
+                case NodeTag::Variable:
+                    result = New(1);
+                    m_Pool[result.Offset + 1] = 1.0;
+                    break;
+                case NodeTag::Parameter: result = Constant(0.0); break; // only parsed by Compile()
+                case NodeTag::Neg: {
+                    const Polynomial operand = m_Values[node.Lhs];
+                    result = New(operand.Degree);
+                    for (uint32_t k = 0; k <= operand.Degree; k++) {
+                        m_Pool[result.Offset + k] = -m_Pool[operand.Offset + k];
+                    }
+                    break;
+                }
+                case NodeTag::Add: result = Combine(m_Values[node.Lhs], m_Values[node.Rhs], 1.0); break;
+                case NodeTag::Sub: result = Combine(m_Values[node.Lhs], m_Values[node.Rhs], -1.0); break;
+                case NodeTag::Mul: {
+                    const Polynomial left = m_Values[node.Lhs];
+                    const Polynomial right = m_Values[node.Rhs];
+                    if (left.Degree + right.Degree > MAX_DEGREE) {
+                        return AnalysisError(ErrorCode::DegreeTooHigh, node.RhsOffset);
+                    }
+                    result = Multiply(left, right);
+                    break;
+                }
+                case NodeTag::Div: {
+                    const Polynomial divisor = m_Values[node.Rhs];
+                    if (divisor.Degree != 0) {
+                        return AnalysisError(ErrorCode::DivisionByVariable, node.RhsOffset);
+                    } else if (m_Pool[divisor.Offset] == 0) {
+                        return AnalysisError(ErrorCode::DivisionByZero, node.RhsOffset);
+                    }
+                    const Polynomial dividend = m_Values[node.Lhs];
+                    result = New(dividend.Degree);
+                    for (uint32_t k = 0; k <= dividend.Degree; k++) {
+                        m_Pool[result.Offset + k] = m_Pool[dividend.Offset + k] / m_Pool[divisor.Offset];
+                    }
+                    break;
+                }
+                case NodeTag::Pow: {
+                    AnalyzeResult power = Power(node, m_Values[node.Lhs], m_Values[node.Rhs]);
+                    if (!power) {
+                        return power;
+                    }
+                    result = *power;
+                    break;
+                }
+                case NodeTag::Call: {
+                    const Polynomial arg = m_Values[node.Lhs];
+                    if (arg.Degree != 0) {
+                        return AnalysisError(ErrorCode::VariableInFunction, node.Offset);
+                    }
+                    const auto value = ApplyFunction(node.Fn, m_Pool[arg.Offset]);
+                    if (!value) {
+                        return AnalysisError(value.error(), node.Offset);
+                    }
+                    result = Constant(*value);
+                    break;
+                }
+            }
+            m_Values[i] = result;
+        }
+
+        if (ast.Rhs == NO_NODE) { // a plain expression
+            return m_Values[ast.Lhs];
+        }
+        return Combine(m_Values[ast.Lhs], m_Values[ast.Rhs], -1.0);
+    }
+
+    constexpr std::span<const double> Coefficients(Polynomial poly) const {
+        return { m_Pool.data() + poly.Offset, poly.Degree + 1 };
+    }
+
+  private:
+    // Zero filled, may move the pool
+    constexpr Polynomial New(uint32_t degree) {
+        const Polynomial poly{ uint32_t(m_Pool.size()), degree };
+        m_Pool.resize(m_Pool.size() + degree + 1);
+        return poly;
+    }
+
+    constexpr Polynomial Constant(double value) {
+        const Polynomial poly = New(0);
+        m_Pool[poly.Offset] = value;
+        return poly;
+    }
+
+    // Lowers the degree past coefficients that cancelled out
+    constexpr Polynomial Trim(Polynomial poly) const {
+        while (poly.Degree > 0 && m_Pool[poly.Offset + poly.Degree] == 0.0) {
+            poly.Degree--;
+        }
+        return poly;
+    }
+
+    // left + sign * right
+    constexpr Polynomial Combine(Polynomial left, Polynomial right, double sign) {
+        const Polynomial result = New(std::max(left.Degree, right.Degree));
+        for (uint32_t k = 0; k <= result.Degree; k++) {
+            const double l = k <= left.Degree ? m_Pool[left.Offset + k] : 0.0;
+            const double r = k <= right.Degree ? m_Pool[right.Offset + k] : 0.0;
+            m_Pool[result.Offset + k] = sign > 0 ? l + r : l - r;
+        }
+        return Trim(result);
+    }
+
+    constexpr Polynomial Multiply(Polynomial left, Polynomial right) {
+        const Polynomial result = New(left.Degree + right.Degree);
+        m_Scratch.resize(MultiplyScratchSize(left.Degree + 1, right.Degree + 1));
+        MultiplyPolynomials(m_Pool.data() + left.Offset, left.Degree + 1,
+            m_Pool.data() + right.Offset, right.Degree + 1, m_Pool.data() + result.Offset,
+            m_Scratch.data());
+        return Trim(result);
+    }
+
+    constexpr AnalyzeResult Power(const Node& node, Polynomial base, Polynomial exp) {
+        if (exp.Degree != 0) {
+            return AnalysisError(ErrorCode::ExponentContainsVariable, node.RhsOffset);
+        }
+        const double exponentValue = m_Pool[exp.Offset];
+
+        if (MathAbs(exponentValue) < EPS) { // x^0
+            return Constant(1.0);
+        } else if (MathAbs(exponentValue - 1.0) < EPS) { // x^1
+            return base;
+        } else if (base.Degree == 0) { // constant^exponent
+            return Constant(ConstantPower(m_Pool[base.Offset], exponentValue));
+        }
+
+        // A variable base needs a whole exponent, expanded by repeated squaring
+        const double rounded = MathFloor(exponentValue + 0.5);
+        if (rounded < 0 || !(MathAbs(exponentValue - rounded) < EPS)) { // NaN fails too
+            return AnalysisError(ErrorCode::InvalidExponent, node.Offset);
+        } else if (rounded * base.Degree > MAX_DEGREE) {
+            return AnalysisError(ErrorCode::DegreeTooHigh, node.Offset);
+        }
+
+        auto remaining = uint32_t(rounded);
+        Polynomial square = base;
+        Polynomial result;
+        bool first = true;
+        while (true) {
+            // The products of high degrees take a while, one node can use up the time limit
+            if (m_Budget && square.Degree >= KARATSUBA_THRESHOLD) {
+                if (const std::optional<ErrorCode> code = m_Budget->CheckNow()) {
+                    return AnalysisError(*code, node.Offset);
+                }
+            }
+            if (remaining & 1) {
+                result = first ? square : Multiply(result, square);
+                first = false;
+            }
+            remaining >>= 1;
+            if (remaining == 0) {
+                return result;
+            }
+            square = Multiply(square, square);
+        }
+    }
+
+    ArenaVector<double> m_Pool;
+    ArenaVector<Polynomial> m_Values; // per node
+    ArenaVector<double> m_Scratch;    // for the Karatsuba products
+    SolveBudget* m_Budget = nullptr;
+};
+
+// Parses the equation and reduces it to lhs - rhs, analyzer.Coefficients() gives the result. The
+// passes stop at the limits of budget when there is one.
+constexpr AnalyzeResult AnalyzeEquation(std::string_view equation, ArenaAllocator* arena,
+    Analyzer& analyzer, SolveBudget* budget = nullptr) {
+    Tokenizer tokenizer(equation);
+    Parser parser(tokenizer, arena);
+    parser.SetFoldConstants(true);
+    tokenizer.SetBudget(budget);
+    parser.SetBudget(budget);
+    analyzer.SetBudget(budget);
+    const auto eq = MeasurePhase(StatsPhase::Parse, [&] { return parser.ParseEquation(); });
+    if (!eq) {
+        return std::unexpected(eq.error());
+    }
+    if !consteval {
+        RecordParse(parser.TokenCount(), (*eq)->Nodes.size());
+    }
+    const AnalyzeResult poly =
+        MeasurePhase(StatsPhase::Analyze, [&] { return analyzer.Analyze(**eq); });
+    if !consteval {
+        // The passes only look at the arena and the clock now and then
+        if (budget && poly) {
+            if (const std::optional<ErrorCode> code = budget->CheckNow()) {
+                return AnalysisError(*code, equation.size());
+            }
+        }
+    }
+    return poly;
+}
+
+constexpr std::expected<void, SolveError> SolveEquation(std::string_view equation,
+    ArenaAllocator* arena, Solutions& solutions, SolveBudget* budget = nullptr) {
+    solutions.Values.clear();
+    solutions.IsInfinite = false;
+    solutions.IsNone = false;
+
+    Analyzer analyzer(arena);
+    const AnalyzeResult poly = AnalyzeEquation(equation, arena, analyzer, budget);
+    if (!poly) {
+        return std::unexpected(poly.error());
+    }
+
+    const std::span<const double> coefficients = analyzer.Coefficients(*poly);
+    const std::optional<ErrorCode> code = MeasurePhase(
+        StatsPhase::Roots, [&] { return FindRoots(coefficients, arena, solutions, budget); });
+    if (code) {
+        return AnalysisError(*code, equation.size());
+    }
+    if !consteval {
+        // Above degree 2 the roots are only as good as the rounded coefficients, a multiple root
+        // taken from a ring of them can be a ring of roots in the equation as written
+        if (poly->Degree > 2 && !ResidualsVanish(equation, solutions.Values)) {
+            solutions.Values.clear();
+            solutions.IsNone = false;
+            return AnalysisError(ErrorCode::IllConditioned, equation.size());
+        }
+    }
+    return {};
+}
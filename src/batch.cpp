@@ -0,0 +1,198 @@
+#include "batch.h"
+#include "binary_format.h"
+#include "mapped_file.h"
+#include "output_writer.h"
+#include "result_cache.h"
+#include "solver.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <iostream>
+
+constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+// Cuts the input into ranges of roughly CHUNK_SIZE bytes that always end on a line break
+static std::vector<std::string_view> SplitChunks(std::string_view input) {
+    std::vector<std::string_view> chunks;
+    chunks.reserve(input.size() / CHUNK_SIZE + 1);
+
+    while (!input.empty()) {
+        size_t end = input.size();
+        if (end > CHUNK_SIZE) {
+            const size_t newline = input.find('\n', CHUNK_SIZE);
+            end = newline == std::string_view::npos ? input.size() : newline + 1;
+        }
+        chunks.push_back(input.substr(0, end));
+        input.remove_prefix(end);
+    }
+
+    return chunks;
+}
+
+// Same for length-prefixed records, the chunks end after a record. Returns false if the input
+// ends inside a record, offset is then where that record starts.
+static bool SplitRecordChunks(
+    std::string_view input, std::vector<std::string_view>& chunks, size_t& offset) {
+    const char* const begin = input.data();
+    const char* chunkStart = begin;
+    std::string_view record;
+
+    while (NextRecord(input, record)) {
+        if (size_t(input.data() - chunkStart) >= CHUNK_SIZE) {
+            chunks.emplace_back(chunkStart, input.data());
+            chunkStart = input.data();
+        }
+    }
+    if (input.data() > chunkStart) {
+        chunks.emplace_back(chunkStart, input.data());
+    }
+
+    offset = size_t(input.data() - begin);
+    return input.empty();
+}
+
+static void AppendSolutions(
+    const Solutions& solutions, const FormatOptions& format, std::string& out) {
+    if (solutions.IsNone) {
+        out += "No solution";
+    } else if (solutions.IsInfinite) {
+        out += "Infinite solutions";
+    } else {
+        for (size_t i = 0; i < solutions.Values.size(); i++) {
+            if (i > 0) {
+                out += ' ';
+            }
+            out += FormatDouble(solutions.Values[i], format);
+        }
+    }
+    out += '\n';
+}
+
+static void AppendError(const SolveError& error, std::string& out) {
+    out += "Error: ";
+    out += ErrorMessage(error.Code);
+    out += " (column ";
+    out += std::to_string(error.Offset + 1);
+    out += ")\n";
+}
+
+void AppendResult(const std::expected<void, SolveError>& result, const Solutions& solutions,
+    const FormatOptions& format, std::string& out) {
+    if (result) {
+        AppendSolutions(solutions, format, out);
+    } else {
+        AppendError(result.error(), out);
+    }
+}
+
+// Splits the next equation off the front of chunk, false once it is empty
+static bool NextEquation(std::string_view& chunk, InputFormat format, std::string_view& equation) {
+    if (format == InputFormat::Records) {
+        return NextRecord(chunk, equation);
+    }
+    if (chunk.empty()) {
+        return false;
+    }
+
+    const size_t end = chunk.find('\n');
+    equation = chunk.substr(0, end);
+    chunk.remove_prefix(end == std::string_view::npos ? chunk.size() : end + 1);
+    if (!equation.empty() && equation.back() == '\r') {
+        equation.remove_suffix(1);
+    }
+    return true;
+}
+
+static void SolveChunk(std::string_view chunk, const BatchOptions& options,
+    const NumericOptions& numeric, ResultCache* cache, std::string& out) {
+    out.reserve(chunk.size());
+    Solutions solutions;
+    const bool text = options.Output == OutputFormat::Text;
+
+    std::string_view equation;
+    while (NextEquation(chunk, options.Input, equation)) {
+        if (equation.find_first_not_of(" \t") == std::string_view::npos) {
+            // Keep the results aligned with the equations
+            if (text) {
+                out += '\n';
+            } else {
+                AppendBlankRecord(out);
+            }
+            continue;
+        }
+
+        const auto result = cache ? cache->Solve(equation, solutions, numeric, options.Limits)
+                                  : Solve(equation, solutions, numeric, options.Limits);
+        if (text) {
+            AppendResult(result, solutions, options.Format, out);
+        } else {
+            AppendResultRecord(result, solutions, out);
+        }
+    }
+}
+
+int RunBatch(const BatchOptions& options) {
+    MappedFile input;
+    if (!input.Open(options.InputPath)) {
+        std::cerr << "Error: cannot read " << options.InputPath << "\n";
+        return 1;
+    }
+
+    OutputWriter writer;
+    if (!writer.Open(options.OutputPath)) {
+        std::cerr << "Error: cannot write " << options.OutputPath << "\n";
+        return 1;
+    }
+
+    std::vector<std::string_view> chunks;
+    if (options.Input == InputFormat::Records) {
+        size_t offset = 0;
+        if (!SplitRecordChunks(input.View(), chunks, offset)) {
+            std::cerr << "Error: truncated record at byte " << offset << "\n";
+            return 1;
+        }
+    } else {
+        chunks = SplitChunks(input.View());
+    }
+    NumericOptions numeric = options.Numeric;
+    numeric.Pool = nullptr;
+
+    std::unique_ptr<ResultCache> cache;
+    if (options.CacheBytes > 0) {
+        cache = std::make_unique<ResultCache>(options.CacheBytes);
+    }
+
+    // Columns are regrouped from the result records of every chunk as they arrive in order
+    ColumnsWriter columns(writer);
+    const bool toColumns = options.Output == OutputFormat::Columns;
+
+    ThreadPool pool(options.Threads);
+    pool.RunOrdered(
+        chunks.size(),
+        [&](size_t i, std::string& out) {
+            SolveChunk(chunks[i], options, numeric, cache.get(), out);
+        },
+        [&](std::string& out) {
+            if (toColumns) {
+                columns.Write(out);
+            } else {
+                writer.Write(out);
+            }
+        });
+    if (toColumns) {
+        columns.Finish();
+    }
+
+    if (cache) {
+        const ResultCacheStats stats = cache->Stats();
+        std::cerr << "Cache: " << stats.TextHits << " text hits, " << stats.PolynomialHits
+                  << " polynomial hits, " << stats.Misses << " misses, " << stats.Evictions
+                  << " evictions, " << stats.Entries << " entries in " << stats.Bytes
+                  << " bytes\n";
+    }
+
+    if (!writer.Flush()) {
+        std::cerr << "Error: failed writing output\n";
+        return 1;
+    }
+    return 0;
+}
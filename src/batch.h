@@ -0,0 +1,38 @@
+#pragma once
+
+#include "solver.h"
+#include "utils.h"
+#include <cstdint>
+#include <string>
+
+enum class InputFormat : uint8_t {
+    Text,    // one equation per line
+    Records, // length-prefixed records, see binary_format.h
+};
+
+enum class OutputFormat : uint8_t {
+    Text,    // one result per line
+    Records, // a ResultRecord and the roots per equation
+    Columns, // all roots in one array, followed by the per-equation columns
+};
+
+struct BatchOptions {
+    std::string InputPath;  // "-" reads stdin
+    std::string OutputPath; // empty writes to stdout
+    size_t Threads = 0;     // 0 = hardware concurrency
+    NumericOptions Numeric; // the lines are already spread over threads, Pool is not used
+    SolveLimits Limits;     // per equation
+    size_t CacheBytes = 0;  // memory for a ResultCache shared by the threads, 0 = no cache
+    FormatOptions Format;   // for OutputFormat::Text
+    InputFormat Input = InputFormat::Text;
+    OutputFormat Output = OutputFormat::Text;
+};
+
+// Solves one equation per input line or record and writes one result per equation, in input order.
+// With a cache, its hit and miss counts are reported on stderr at the end.
+int RunBatch(const BatchOptions& options);
+
+// Appends the output line of one equation: the roots, "No solution", "Infinite solutions" or the
+// error
+void AppendResult(const std::expected<void, SolveError>& result, const Solutions& solutions,
+    const FormatOptions& format, std::string& out);
@@ -0,0 +1,120 @@
+#include "binary_format.h"
+#include <algorithm>
+#include <cstring>
+
+bool NextRecord(std::string_view& input, std::string_view& record) {
+    uint32_t length;
+    if (input.size() < sizeof(length)) {
+        return false;
+    }
+    std::memcpy(&length, input.data(), sizeof(length));
+    length = LittleEndian(length);
+    if (length > input.size() - sizeof(length)) {
+        return false;
+    }
+
+    record = input.substr(sizeof(length), length);
+    input.remove_prefix(sizeof(length) + length);
+    return true;
+}
+
+static void AppendRecord(const ResultRecord& record, std::string& out) {
+    const ResultRecord little = { LittleEndian(record.RootCount), record.Flags, record.ErrorCode, 0,
+        LittleEndian(record.ErrorOffset), 0 };
+    out.append(reinterpret_cast<const char*>(&little), sizeof(little));
+}
+
+void AppendResultRecord(
+    const std::expected<void, SolveError>& result, const Solutions& solutions, std::string& out) {
+    ResultRecord record{};
+    if (!result) {
+        record.Flags = RESULT_ERROR;
+        record.ErrorCode = uint8_t(result.error().Code);
+        record.ErrorOffset = uint32_t(std::min<size_t>(result.error().Offset, UINT32_MAX));
+    } else if (solutions.IsNone) {
+        record.Flags = RESULT_NONE;
+    } else if (solutions.IsInfinite) {
+        record.Flags = RESULT_INFINITE;
+    } else {
+        record.RootCount = uint32_t(solutions.Values.size());
+    }
+    AppendRecord(record, out);
+
+    if constexpr (std::endian::native == std::endian::little) {
+        out.append(reinterpret_cast<const char*>(solutions.Values.data()),
+            record.RootCount * sizeof(double));
+    } else {
+        for (size_t i = 0; i < record.RootCount; i++) {
+            const double value = LittleEndian(solutions.Values[i]);
+            out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+    }
+}
+
+void AppendBlankRecord(std::string& out) {
+    ResultRecord record{};
+    record.Flags = RESULT_BLANK;
+    AppendRecord(record, out);
+}
+
+void ColumnsWriter::Write(std::string_view records) {
+    while (records.size() >= sizeof(ResultRecord)) {
+        ResultRecord record;
+        std::memcpy(&record, records.data(), sizeof(record));
+        records.remove_prefix(sizeof(record));
+
+        // The roots are little-endian already, they are copied as they are
+        const uint32_t count = LittleEndian(record.RootCount);
+        m_Writer.Write(records.substr(0, count * sizeof(double)));
+        records.remove_prefix(count * sizeof(double));
+        m_Bytes += count * sizeof(double);
+
+        m_RootIndex.push_back(m_RootIndex.back() + count);
+        m_Flags.push_back(record.Flags);
+        m_ErrorCodes.push_back(record.ErrorCode);
+        m_ErrorOffsets.push_back(LittleEndian(record.ErrorOffset));
+    }
+}
+
+template <typename T>
+void ColumnsWriter::WriteColumn(const std::vector<T>& column) {
+    if constexpr (std::endian::native == std::endian::little) {
+        m_Writer.Write({ reinterpret_cast<const char*>(column.data()), column.size() * sizeof(T) });
+    } else {
+        for (T value : column) {
+            value = LittleEndian(value);
+            m_Writer.Write({ reinterpret_cast<const char*>(&value), sizeof(value) });
+        }
+    }
+    m_Bytes += column.size() * sizeof(T);
+
+    constexpr char zeros[8] = {};
+    const size_t padding = (8 - m_Bytes % 8) % 8;
+    m_Writer.Write({ zeros, padding });
+    m_Bytes += padding;
+}
+
+void ColumnsWriter::Finish() {
+    ColumnsTrailer trailer{};
+    trailer.EquationCount = m_Flags.size();
+    trailer.RootCount = m_RootIndex.back();
+    trailer.RootsOffset = 0;
+    trailer.RootIndexOffset = m_Bytes;
+    WriteColumn(m_RootIndex);
+    trailer.FlagsOffset = m_Bytes;
+    WriteColumn(m_Flags);
+    trailer.ErrorCodesOffset = m_Bytes;
+    WriteColumn(m_ErrorCodes);
+    trailer.ErrorOffsetsOffset = m_Bytes;
+    WriteColumn(m_ErrorOffsets);
+    trailer.Version = COLUMNS_VERSION;
+    std::memcpy(trailer.Magic, COLUMNS_MAGIC, sizeof(trailer.Magic));
+
+    for (uint64_t* field : { &trailer.EquationCount, &trailer.RootCount, &trailer.RootsOffset,
+             &trailer.RootIndexOffset, &trailer.FlagsOffset, &trailer.ErrorCodesOffset,
+             &trailer.ErrorOffsetsOffset }) {
+        *field = LittleEndian(*field);
+    }
+    trailer.Version = LittleEndian(trailer.Version);
+    m_Writer.Write({ reinterpret_cast<const char*>(&trailer), sizeof(trailer) });
+}
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "output_writer.h"
+#include "solver.h"
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+// Binary formats for programs that exchange equations and roots without printing or parsing
+// numbers. All integers and doubles are little-endian whatever the host.
+//
+// Input records: a uint32_t byte count followed by that many bytes of equation text.
+//
+// Result records: a ResultRecord followed by RootCount doubles, one record per input equation, in
+// input order.
+//
+// Columns: the roots of all equations as one array, for readers that map the file instead of
+// reading it. The small per-equation columns follow the roots and the file ends with a
+// ColumnsTrailer that gives their offsets:
+//
+//     double   Roots[RootCount]                at RootsOffset (0)
+//     uint64_t RootIndex[EquationCount + 1]    at RootIndexOffset, equation i owns the roots
+//                                              [RootIndex[i], RootIndex[i + 1])
+//     uint8_t  Flags[EquationCount]            at FlagsOffset, RESULT_* bits
+//     uint8_t  ErrorCodes[EquationCount]       at ErrorCodesOffset
+//     uint32_t ErrorOffsets[EquationCount]     at ErrorOffsetsOffset
+//     ColumnsTrailer                           the last 64 bytes
+//
+// Every section starts on a multiple of 8 bytes.
+
+// Bits of ResultRecord::Flags
+inline constexpr uint8_t RESULT_NONE = 1 << 0;
+inline constexpr uint8_t RESULT_INFINITE = 1 << 1;
+inline constexpr uint8_t RESULT_ERROR = 1 << 2;
+inline constexpr uint8_t RESULT_BLANK = 1 << 3; // the equation was empty or only whitespace
+
+struct ResultRecord {
+    uint32_t RootCount;
+    uint8_t Flags;
+    uint8_t ErrorCode;    // an ErrorCode, 0 without RESULT_ERROR
+    uint16_t Reserved;    // 0
+    uint32_t ErrorOffset; // byte offset into the equation, 0 without RESULT_ERROR
+    uint32_t Padding;     // 0, keeps the roots after the record 8 byte aligned
+};
+static_assert(sizeof(ResultRecord) == 16);
+
+inline constexpr char COLUMNS_MAGIC[4] = { 'A', 'L', 'G', 'C' };
+inline constexpr uint32_t COLUMNS_VERSION = 1;
+
+struct ColumnsTrailer {
+    uint64_t EquationCount;
+    uint64_t RootCount;
+    uint64_t RootsOffset;
+    uint64_t RootIndexOffset;
+    uint64_t FlagsOffset;
+    uint64_t ErrorCodesOffset;
+    uint64_t ErrorOffsetsOffset;
+    uint32_t Version;
+    char Magic[4];
+};
+static_assert(sizeof(ColumnsTrailer) == 64);
+
+template <typename T>
+constexpr T LittleEndian(T value) { // also converts back, the swap is its own inverse
+    if constexpr (std::endian::native == std::endian::big) {
+        if constexpr (std::is_floating_point_v<T>) {
+            return std::bit_cast<T>(std::byteswap(std::bit_cast<uint64_t>(value)));
+        } else {
+            return std::byteswap(value);
+        }
+    }
+    return value;
+}
+
+// Splits the next input record off the front of input. Returns false at the end of the input and
+// when the input ends inside a record, in which case input is left at that record.
+bool NextRecord(std::string_view& input, std::string_view& record);
+
+// Appends the result record of one equation
+void AppendResultRecord(
+    const std::expected<void, SolveError>& result, const Solutions& solutions, std::string& out);
+void AppendBlankRecord(std::string& out);
+
+// Turns a stream of result records into the column layout. The roots go out as they come, the
+// per-equation columns (14 bytes an equation) are kept until Finish().
+class ColumnsWriter {
+  public:
+    explicit ColumnsWriter(OutputWriter& writer) : m_Writer(writer) { m_RootIndex.push_back(0); }
+
+    // records holds whole result records, as written by AppendResultRecord()
+    void Write(std::string_view records);
+    void Finish();
+
+  private:
+    template <typename T>
+    void WriteColumn(const std::vector<T>& column);
+
+    OutputWriter& m_Writer;
+    uint64_t m_Bytes = 0;
+    std::vector<uint64_t> m_RootIndex;
+    std::vector<uint8_t> m_Flags;
+    std::vector<uint8_t> m_ErrorCodes;
+    std::vector<uint32_t> m_ErrorOffsets;
+};
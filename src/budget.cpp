@@ -0,0 +1,59 @@
+#include "budget.h"
+#include <charconv>
+
+SolveBudget::SolveBudget(const SolveLimits& limits, const ArenaAllocator* arena)
+    : m_Limits(limits), m_Arena(arena) {
+    if (limits.Timeout.count() > 0) {
+        m_Deadline = std::chrono::steady_clock::now() + limits.Timeout;
+    }
+}
+
+std::optional<ErrorCode> SolveBudget::CheckNow() const {
+    if (m_Limits.MaxArenaBytes && m_Arena->BytesUsed() > m_Limits.MaxArenaBytes) {
+        return ErrorCode::ArenaTooLarge;
+    } else if (PastDeadline()) {
+        return ErrorCode::Timeout;
+    }
+    return std::nullopt;
+}
+
+bool SolveBudget::PastDeadline() const {
+    return m_Limits.Timeout.count() > 0 && std::chrono::steady_clock::now() > m_Deadline;
+}
+
+bool ParseLimits(std::string_view spec, SolveLimits& limits) {
+    while (!spec.empty()) {
+        const size_t comma = std::min(spec.find(','), spec.size());
+        const std::string_view item = spec.substr(0, comma);
+        spec.remove_prefix(std::min(comma + 1, spec.size()));
+
+        const size_t equal = item.find('=');
+        if (equal == std::string_view::npos) {
+            return false;
+        }
+        const std::string_view name = item.substr(0, equal);
+        const std::string_view text = item.substr(equal + 1);
+        size_t value = 0;
+        const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc{} || result.ptr != text.data() + text.size()) {
+            return false;
+        }
+
+        if (name == "bytes") {
+            limits.MaxInputBytes = value;
+        } else if (name == "tokens") {
+            limits.MaxTokens = value;
+        } else if (name == "nodes") {
+            limits.MaxNodes = value;
+        } else if (name == "depth") {
+            limits.MaxDepth = value;
+        } else if (name == "arena") {
+            limits.MaxArenaBytes = value;
+        } else if (name == "us") {
+            limits.Timeout = std::chrono::microseconds(value);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "solver.h"
+#include "utils.h"
+#include <chrono>
+#include <optional>
+#include <string_view>
+
+// The limits of one solve while it runs, the time counts from construction. Tokenizer, Parser and
+// Analyzer count their tokens, nodes and depth against Limits() themselves and call Check() for
+// every token or node, which only looks at the arena and the clock every CHECK_INTERVAL calls.
+class SolveBudget {
+  public:
+    SolveBudget(const SolveLimits& limits, const ArenaAllocator* arena);
+
+    const SolveLimits& Limits() const { return m_Limits; }
+
+    std::optional<ErrorCode> Check() {
+        if (++m_Calls < CHECK_INTERVAL) {
+            return std::nullopt;
+        }
+        m_Calls = 0;
+        return CheckNow();
+    }
+
+    // ArenaTooLarge or Timeout once the solve is past either limit
+    std::optional<ErrorCode> CheckNow() const;
+
+    // The clock only, other threads can ask too
+    bool PastDeadline() const;
+
+  private:
+    static constexpr uint32_t CHECK_INTERVAL = 64;
+
+    SolveLimits m_Limits;
+    const ArenaAllocator* m_Arena;
+    std::chrono::steady_clock::time_point m_Deadline;
+    uint32_t m_Calls = 0;
+};
+
+// Reads limits given as "<name>=<value>,...", the names are bytes, tokens, nodes, depth, arena
+// and us, the timeout in microseconds
+bool ParseLimits(std::string_view spec, SolveLimits& limits);
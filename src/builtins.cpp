@@ -0,0 +1,14 @@
+#include "builtins.h"
+#include "simd.h"
+#include <limits>
+
+void ApplyFunctionArray(FunctionType fn, const double* in, double* out, size_t n, MathTier tier) {
+    if (tier != MathTier::Exact) {
+        FunctionArray(fn, in, out, n, tier == MathTier::Fast);
+        return;
+    }
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+    for (size_t i = 0; i < n; i++) {
+        out[i] = ApplyFunction(fn, in[i]).value_or(NaN);
+    }
+}
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "error.h"
+#include "static_math.h"
+#include "utils.h"
+#include <array>
+#include <expected>
+#include <numbers>
+#include <string_view>
+
+enum class FunctionType : uint8_t { Sin, Cos, Tan, Asin, Acos, Atan, Log, Ln, Sqrt, Floor, Ceil, Abs };
+
+enum class BuiltinKind : uint8_t { Function, Constant };
+
+struct Builtin {
+    std::string_view Name;
+    BuiltinKind Kind;
+    FunctionType Fn; // Function only
+    double Value;    // Constant only
+};
+
+inline constexpr Builtin Builtins[] = {
+    {   "sin", BuiltinKind::Function,   FunctionType::Sin,                0.0 },
+    {   "cos", BuiltinKind::Function,   FunctionType::Cos,                0.0 },
+    {   "tan", BuiltinKind::Function,   FunctionType::Tan,                0.0 },
+    {  "asin", BuiltinKind::Function,  FunctionType::Asin,                0.0 },
+    {  "acos", BuiltinKind::Function,  FunctionType::Acos,                0.0 },
+    {  "atan", BuiltinKind::Function,  FunctionType::Atan,                0.0 },
+    {   "log", BuiltinKind::Function,   FunctionType::Log,                0.0 },
+    {    "ln", BuiltinKind::Function,    FunctionType::Ln,                0.0 },
+    {  "sqrt", BuiltinKind::Function,  FunctionType::Sqrt,                0.0 },
+    { "floor", BuiltinKind::Function, FunctionType::Floor,                0.0 },
+    {  "ceil", BuiltinKind::Function,  FunctionType::Ceil,                0.0 },
+    {   "abs", BuiltinKind::Function,   FunctionType::Abs,                0.0 },
+    {    "pi", BuiltinKind::Constant,   FunctionType::Sin,  std::numbers::pi },
+    {     "e", BuiltinKind::Constant,   FunctionType::Sin,   std::numbers::e },
+    {   "phi", BuiltinKind::Constant,   FunctionType::Sin, std::numbers::phi },
+};
+
+constexpr uint32_t HASH_BITS = 5;
+constexpr size_t HASH_TABLE_SIZE = size_t(1) << HASH_BITS;
+
+// FNV-1a, the slot comes from the top bits since the low bits barely mix
+constexpr uint32_t HashSlot(std::string_view name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name) {
+        hash = (hash ^ uint8_t(c)) * 16777619u;
+    }
+    return hash >> (32 - HASH_BITS);
+}
+
+struct PerfectHash {
+    uint32_t Seed;
+    std::array<uint8_t, HASH_TABLE_SIZE> Slots; // index into Builtins + 1, 0 when empty
+};
+
+// Tries seeds until no two builtins land in the same slot
+consteval PerfectHash BuildPerfectHash() {
+    for (uint32_t seed = 0;; seed++) {
+        PerfectHash table{ seed, {} };
+        bool collision = false;
+        for (size_t i = 0; i < std::size(Builtins) && !collision; i++) {
+            uint8_t& slot = table.Slots[HashSlot(Builtins[i].Name, seed)];
+            collision = slot != 0;
+            slot = uint8_t(i + 1);
+        }
+        if (!collision) {
+            return table;
+        }
+    }
+}
+
+inline constexpr PerfectHash BuiltinHash = BuildPerfectHash();
+
+// Looks up a built-in function or constant through the perfect hash, nullptr if the name is not one
+constexpr const Builtin* FindBuiltin(std::string_view name) {
+    const uint8_t slot = BuiltinHash.Slots[HashSlot(name, BuiltinHash.Seed)];
+    if (slot != 0 && Builtins[slot - 1].Name == name) {
+        return &Builtins[slot - 1];
+    }
+    return nullptr;
+}
+
+// Evaluates a built-in function, trigonometry works in degrees
+constexpr std::expected<double, ErrorCode> ApplyFunction(FunctionType fn, double n) {
+    switch (fn) {
+        case FunctionType::Sin: return MathSinDeg(n);
+        case FunctionType::Cos: return MathCosDeg(n);
+        case FunctionType::Tan:
+            if (MathAbs(MathCosDeg(n)) < EPS) {
+                return std::unexpected(ErrorCode::TanUndefined);
+            }
+            return MathTanDeg(n);
+        case FunctionType::Asin:
+            if (n < -1.0 || n > 1.0) {
+                return std::unexpected(ErrorCode::AsinDomain);
+            }
+            return MathAsinDeg(n);
+        case FunctionType::Acos:
+            if (n < -1.0 || n > 1.0) {
+                return std::unexpected(ErrorCode::AcosDomain);
+            }
+            return MathAcosDeg(n);
+        case FunctionType::Atan: return MathAtanDeg(n);
+        case FunctionType::Log:
+            if (n <= 0) {
+                return std::unexpected(ErrorCode::LogDomain);
+            }
+            return MathLog10(n);
+        case FunctionType::Ln:
+            if (n <= 0) {
+                return std::unexpected(ErrorCode::LogDomain);
+            }
+            return MathLog(n);
+        case FunctionType::Sqrt:
+            if (n < 0) {
+                return std::unexpected(ErrorCode::SqrtDomain);
+            }
+            return MathSqrt(n);
+        case FunctionType::Floor: return MathFloor(n);
+        case FunctionType::Ceil: return MathCeil(n);
+        case FunctionType::Abs: return MathAbs(n);
+        default: return std::unexpected(ErrorCode::UnknownFunction);
+    }
+}
+
+// base^exponent for constants, as the analysis reduces it: exponents within EPS of 0, 1 and 2 are
+// taken as exact
+constexpr double ConstantPower(double base, double exponent) {
+    if (MathAbs(exponent) < EPS) {
+        return 1.0;
+    } else if (MathAbs(exponent - 1.0) < EPS) {
+        return base;
+    } else if (MathAbs(exponent - 2.0) < EPS) {
+        return base * base;
+    }
+    return MathPow(base, exponent);
+}
+
+// How ApplyFunctionArray() trades accuracy for speed. Exact gives the bits of ApplyFunction(), one
+// C library call per value. Accurate and Fast run polynomial kernels in SIMD lanes with the
+// trigonometry reduced exactly in degrees, Accurate is within a few ulps of the true result and
+// Fast within about 3e-9 relative. Sqrt, floor, ceil and abs are exact in every tier.
+enum class MathTier : uint8_t { Exact, Accurate, Fast };
+
+// Array version for bulk evaluation, values outside the domain become NaN
+void ApplyFunctionArray(
+    FunctionType fn, const double* in, double* out, size_t n, MathTier tier = MathTier::Accurate);
@@ -0,0 +1,310 @@
+#include "compile.h"
+#include "analysis.h"
+#include "context.h"
+#include <cmath>
+#include <optional>
+
+namespace {
+
+// Polynomial whose coefficients are registers of the program being built, Coeffs[i] multiplies
+// x^i. Coefficients above Coeffs.back() are known to be zero.
+struct SymbolicPolynomial {
+    std::vector<uint32_t> Coeffs;
+
+    uint32_t Degree() const { return uint32_t(Coeffs.size() - 1); }
+};
+
+using LowerResult = std::expected<SymbolicPolynomial, SolveError>;
+
+class Lowering {
+  public:
+    explicit Lowering(uint32_t paramCount) : m_Builder(paramCount), m_Zero(m_Builder.Constant(0.0)) {}
+
+    // One forward scan over the post-order nodes, returns lhs - rhs
+    LowerResult LowerEquation(const Ast& ast) {
+        std::vector<SymbolicPolynomial> values(ast.Nodes.size());
+
+        for (size_t i = 0; i < ast.Nodes.size(); i++) {
+            LowerResult result = LowerNode(ast, ast.Nodes[i], values);
+            if (!result) {
+                return result;
+            }
+            values[i] = std::move(*result);
+        }
+
+        return Combine(OpCode::Sub, values[ast.Lhs], values[ast.Rhs], 0);
+    }
+
+    Program Finish(const SymbolicPolynomial& poly) { return m_Builder.Finish(poly.Coeffs); }
+
+  private:
+    SymbolicPolynomial Constant(uint32_t reg) { return { { reg } }; }
+
+    // Lowers the degree past coefficients that folded to zero
+    SymbolicPolynomial Trim(SymbolicPolynomial poly) const {
+        while (poly.Degree() > 0 && m_Builder.IsConstant(poly.Coeffs.back(), 0.0)) {
+            poly.Coeffs.pop_back();
+        }
+        return poly;
+    }
+
+    LowerResult Combine(
+        OpCode op, const SymbolicPolynomial& left, const SymbolicPolynomial& right, size_t offset) {
+        SymbolicPolynomial result;
+        result.Coeffs.resize(std::max(left.Coeffs.size(), right.Coeffs.size()));
+        for (size_t i = 0; i < result.Coeffs.size(); i++) {
+            const uint32_t l = i < left.Coeffs.size() ? left.Coeffs[i] : m_Zero;
+            const uint32_t r = i < right.Coeffs.size() ? right.Coeffs[i] : m_Zero;
+            auto reg = m_Builder.Binary(op, l, r, offset);
+            if (!reg) {
+                return std::unexpected(reg.error());
+            }
+            result.Coeffs[i] = *reg;
+        }
+        return Trim(std::move(result));
+    }
+
+    // Schoolbook, every coefficient is its own chain of instructions
+    LowerResult Multiply(const SymbolicPolynomial& left, const SymbolicPolynomial& right, size_t offset) {
+        if (left.Degree() + right.Degree() > MAX_DEGREE) {
+            return std::unexpected(SolveError{ ErrorCode::DegreeTooHigh, offset });
+        }
+
+        SymbolicPolynomial result;
+        result.Coeffs.assign(left.Coeffs.size() + right.Coeffs.size() - 1, m_Zero);
+        for (size_t i = left.Coeffs.size(); i-- > 0;) {
+            for (size_t j = 0; j < right.Coeffs.size(); j++) {
+                auto term = m_Builder.Binary(OpCode::Mul, left.Coeffs[i], right.Coeffs[j], offset);
+                if (!term) {
+                    return std::unexpected(term.error());
+                }
+                auto sum = m_Builder.Binary(OpCode::Add, result.Coeffs[i + j], *term, offset);
+                if (!sum) {
+                    return std::unexpected(sum.error());
+                }
+                result.Coeffs[i + j] = *sum;
+            }
+        }
+        return Trim(std::move(result));
+    }
+
+    LowerResult Divide(const SymbolicPolynomial& left, const SymbolicPolynomial& right, size_t offset) {
+        if (right.Degree() != 0) {
+            return std::unexpected(SolveError{ ErrorCode::DivisionByVariable, offset });
+        }
+
+        SymbolicPolynomial result = left;
+        for (uint32_t& coeff : result.Coeffs) {
+            auto reg = m_Builder.Binary(OpCode::Div, coeff, right.Coeffs[0], offset);
+            if (!reg) {
+                return std::unexpected(reg.error());
+            }
+            coeff = *reg;
+        }
+        return result;
+    }
+
+    LowerResult Power(
+        const Node& node, const SymbolicPolynomial& base, const SymbolicPolynomial& exp) {
+        if (exp.Degree() != 0) {
+            return std::unexpected(
+                SolveError{ ErrorCode::ExponentContainsVariable, node.RhsOffset });
+        }
+
+        if (base.Degree() == 0) { // constant^exponent
+            auto reg = m_Builder.Binary(OpCode::Pow, base.Coeffs[0], exp.Coeffs[0], node.Offset);
+            if (!reg) {
+                return std::unexpected(reg.error());
+            }
+            return Constant(*reg);
+        }
+
+        // The shape of the polynomial can't depend on a parameter
+        const std::optional<double> exponent = m_Builder.ConstantValue(exp.Coeffs[0]);
+        if (!exponent) {
+            return std::unexpected(SolveError{ ErrorCode::ParametricExponent, node.Offset });
+        }
+
+        const double rounded = std::floor(*exponent + 0.5);
+        if (rounded < 0 || !(std::abs(*exponent - rounded) < EPS)) { // NaN fails too
+            return std::unexpected(SolveError{ ErrorCode::InvalidExponent, node.Offset });
+        } else if (rounded * base.Degree() > MAX_DEGREE) {
+            return std::unexpected(SolveError{ ErrorCode::DegreeTooHigh, node.Offset });
+        } else if (rounded == 0) { // x^0
+            return Constant(m_Builder.Constant(1.0));
+        }
+
+        // Repeated squaring
+        auto remaining = uint32_t(rounded);
+        SymbolicPolynomial square = base;
+        std::optional<SymbolicPolynomial> result;
+        while (true) {
+            if (remaining & 1) {
+                LowerResult product = result ? Multiply(*result, square, node.Offset) : square;
+                if (!product) {
+                    return product;
+                }
+                result = std::move(*product);
+            }
+            remaining >>= 1;
+            if (remaining == 0) {
+                return std::move(*result);
+            }
+            LowerResult squared = Multiply(square, square, node.Offset);
+            if (!squared) {
+                return squared;
+            }
+            square = std::move(*squared);
+        }
+    }
+
+    LowerResult LowerNode(
+        const Ast& ast, const Node& node, const std::vector<SymbolicPolynomial>& values) {
+        switch (node.Tag) {
+            case NodeTag::Number: return Constant(m_Builder.Constant(ast.Literals[node.Lhs]));
+            case NodeTag::Variable:
+                return SymbolicPolynomial{ { m_Zero, m_Builder.Constant(1.0) } };
+            case NodeTag::Parameter: return Constant(m_Builder.Param(node.Lhs));
+            case NodeTag::Neg: {
+                SymbolicPolynomial result = values[node.Lhs];
+                for (uint32_t& coeff : result.Coeffs) {
+                    coeff = m_Builder.Neg(coeff);
+                }
+                return result;
+            }
+            case NodeTag::Add: return Combine(OpCode::Add, values[node.Lhs], values[node.Rhs], 0);
+            case NodeTag::Sub: return Combine(OpCode::Sub, values[node.Lhs], values[node.Rhs], 0);
+            case NodeTag::Mul:
+                return Multiply(values[node.Lhs], values[node.Rhs], node.RhsOffset);
+            case NodeTag::Div:
+                return Divide(values[node.Lhs], values[node.Rhs], node.RhsOffset);
+            case NodeTag::Pow: return Power(node, values[node.Lhs], values[node.Rhs]);
+            case NodeTag::Call: {
+                const SymbolicPolynomial& arg = values[node.Lhs];
+                if (arg.Degree() != 0) {
+                    return std::unexpected(SolveError{ ErrorCode::VariableInFunction, node.Offset });
+                }
+                auto reg = m_Builder.Call(node.Fn, arg.Coeffs[0], node.Offset);
+                if (!reg) {
+                    return std::unexpected(reg.error());
+                }
+                return Constant(*reg);
+            }
+        }
+        return std::unexpected(SolveError{ ErrorCode::UnexpectedToken, node.Offset });
+    }
+
+    ProgramBuilder m_Builder;
+    const uint32_t m_Zero;
+};
+
+// Same scan as Lowering, but every node is a single value of the variable
+static std::expected<Program, SolveError> LowerScalar(const Ast& ast) {
+    ProgramBuilder builder(0);
+    std::vector<uint32_t> regs(ast.Nodes.size());
+
+    for (size_t i = 0; i < ast.Nodes.size(); i++) {
+        const Node& node = ast.Nodes[i];
+        std::expected<uint32_t, SolveError> reg;
+
+        switch (node.Tag) {
+            case NodeTag::Number: reg = builder.Constant(ast.Literals[node.Lhs]); break;
+            case NodeTag::Variable: reg = builder.Var(); break;
+            case NodeTag::Parameter: reg = builder.Param(node.Lhs); break;
+            case NodeTag::Neg: reg = builder.Neg(regs[node.Lhs]); break;
+            case NodeTag::Add: reg = builder.Binary(OpCode::Add, regs[node.Lhs], regs[node.Rhs], 0); break;
+            case NodeTag::Sub: reg = builder.Binary(OpCode::Sub, regs[node.Lhs], regs[node.Rhs], 0); break;
+            case NodeTag::Mul:
+                reg = builder.Binary(
+                    OpCode::Mul, regs[node.Lhs], regs[node.Rhs], node.RhsOffset);
+                break;
+            case NodeTag::Div:
+                reg = builder.Binary(
+                    OpCode::Div, regs[node.Lhs], regs[node.Rhs], node.RhsOffset);
+                break;
+            case NodeTag::Pow:
+                reg = builder.Binary(OpCode::Pow, regs[node.Lhs], regs[node.Rhs], node.Offset);
+                break;
+            case NodeTag::Call: reg = builder.Call(node.Fn, regs[node.Lhs], node.Offset); break;
+        }
+
+        if (!reg) {
+            return std::unexpected(reg.error());
+        }
+        regs[i] = *reg;
+    }
+
+    uint32_t output = regs[ast.Lhs];
+    if (ast.Rhs != NO_NODE) { // an equation gives lhs - rhs
+        auto difference = builder.Binary(OpCode::Sub, output, regs[ast.Rhs], 0);
+        if (!difference) {
+            return std::unexpected(difference.error());
+        }
+        output = *difference;
+    }
+    return builder.Finish({ &output, 1 });
+}
+
+}
+
+std::expected<Program, SolveError> CompileExpression(
+    std::string_view expression, std::string_view variable) {
+    ArenaAllocator arena;
+
+    Tokenizer tokenizer(expression);
+    Parser parser(tokenizer, &arena);
+    parser.SetVariable(variable);
+    const auto expr = parser.ParseExpression();
+    if (!expr) {
+        return std::unexpected(expr.error());
+    }
+
+    return LowerScalar(**expr);
+}
+
+std::expected<Program, SolveError> CompileResidual(std::string_view equation) {
+    ArenaAllocator arena;
+
+    Tokenizer tokenizer(equation);
+    Parser parser(tokenizer, &arena);
+    const auto eq = parser.ParseEquation();
+    if (!eq) {
+        return std::unexpected(eq.error());
+    }
+
+    return LowerScalar(**eq);
+}
+
+std::expected<CompiledEquation, SolveError> Compile(
+    std::string_view equation, std::span<const std::string_view> params) {
+    ArenaAllocator arena;
+
+    Tokenizer tokenizer(equation);
+    Parser parser(tokenizer, &arena, params);
+    const auto eq = parser.ParseEquation();
+    if (!eq) {
+        return std::unexpected(eq.error());
+    }
+
+    Lowering lowering(uint32_t(params.size()));
+    const LowerResult poly = lowering.LowerEquation(**eq);
+    if (!poly) {
+        return std::unexpected(poly.error());
+    }
+
+    return CompiledEquation{ lowering.Finish(*poly) };
+}
+
+std::expected<Solutions, SolveError> Solve(
+    const CompiledEquation& equation, std::span<const double> params) {
+    Solutions solutions;
+    if (auto result = Solve(equation, params, solutions); !result) {
+        return std::unexpected(result.error());
+    }
+    return solutions;
+}
+
+std::expected<void, SolveError> Solve(
+    const CompiledEquation& equation, std::span<const double> params, Solutions& solutions) {
+    return ThreadContext().Solve(equation, params, solutions);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "jit.h"
+#include "program.h"
+#include "solver.h"
+#include <string_view>
+
+// An equation parsed once, with named parameters left open. Solving it only runs the
+// coefficient program, the tokenizer and parser are not involved anymore.
+struct CompiledEquation {
+    Program Coefficients;  // Outputs[i] holds the x^i coefficient of lhs - rhs
+    mutable JitTier Jit{}; // runs Coefficients natively once the equation is solved often
+};
+
+std::expected<CompiledEquation, SolveError> Compile(
+    std::string_view equation, std::span<const std::string_view> params);
+
+// Compiles a plain expression of the variable into a program with one output, e.g. for
+// evaluating it over many values of the variable
+std::expected<Program, SolveError> CompileExpression(
+    std::string_view expression, std::string_view variable);
+
+// Compiles lhs - rhs of an equation into a program with one output, whatever the form of the
+// equation, e.g. for finding its roots numerically
+std::expected<Program, SolveError> CompileResidual(std::string_view equation);
+
+// params must line up with the names given to Compile()
+std::expected<Solutions, SolveError> Solve(
+    const CompiledEquation& equation, std::span<const double> params);
+std::expected<void, SolveError> Solve(
+    const CompiledEquation& equation, std::span<const double> params, Solutions& solutions);
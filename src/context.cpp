@@ -0,0 +1,73 @@
+#include "context.h"
+#include "analysis.h"
+#include "numeric.h"
+#include "stats.h"
+
+std::expected<void, SolveError> SolveContext::Solve(std::string_view equation,
+    Solutions& solutions, const NumericOptions& numeric, const SolveLimits& limits) {
+    m_Arena.Reset();
+
+    std::optional<SolveBudget> budget;
+    if (limits.Any()) {
+        budget.emplace(limits, &m_Arena);
+    }
+    auto result = SolveEquation(equation, &m_Arena, solutions, budget ? &*budget : nullptr);
+    if (!result && HasNumericFallback(result.error().Code)) {
+        result = MeasurePhase(StatsPhase::Numeric, [&] {
+            return SolveNumeric(equation, numeric, solutions, budget ? &*budget : nullptr);
+        });
+    }
+
+    if (StatsEnabled()) {
+        RecordSolve(m_Arena.BytesUsed(), m_Arena.BytesReserved());
+        if (!result) {
+            RecordError(result.error().Code);
+        }
+    }
+    m_LastError = result ? std::nullopt : std::optional(result.error());
+    return result;
+}
+
+std::expected<void, SolveError> SolveContext::Solve(const CompiledEquation& equation,
+    std::span<const double> params, Solutions& solutions, const SolveLimits& limits) {
+    solutions.Values.clear();
+    solutions.IsInfinite = false;
+    solutions.IsNone = false;
+
+    const Program& program = equation.Coefficients;
+    if (params.size() != program.ParamCount) {
+        m_LastError = SolveError{ ErrorCode::ParameterCount, 0 };
+        return std::unexpected(*m_LastError);
+    }
+
+    m_Registers.resize(program.Code.size());
+    const JitCode* native = equation.Jit.Touch(program);
+    const auto result = native ? native->Execute(params, 0.0, m_Registers)
+                               : Execute(program, params, 0.0, m_Registers);
+    if (!result) {
+        m_LastError = result.error();
+        return result;
+    }
+
+    m_Coefficients.clear();
+    for (uint32_t reg : program.Outputs) {
+        m_Coefficients.push_back(m_Registers[reg]);
+    }
+    m_Arena.Reset(); // root finding scratch above degree 2
+    std::optional<SolveBudget> budget;
+    if (limits.Any()) {
+        budget.emplace(limits, &m_Arena);
+    }
+    if (const std::optional<ErrorCode> code =
+            FindRoots(m_Coefficients, &m_Arena, solutions, budget ? &*budget : nullptr)) {
+        m_LastError = SolveError{ *code, 0 };
+        return std::unexpected(*m_LastError);
+    }
+    m_LastError.reset();
+    return {};
+}
+
+SolveContext& ThreadContext() {
+    thread_local SolveContext context;
+    return context;
+}
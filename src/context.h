@@ -0,0 +1,36 @@
+#pragma once
+
+#include "compile.h"
+#include "solver.h"
+#include "utils.h"
+#include <optional>
+
+// Everything a solve writes besides its result: the arena, the buffers of compiled equations and
+// the last error. Threads that each own a context share no mutable state, apart from the stats,
+// which are counted per thread anyway. The free Solve() functions use ThreadContext().
+class SolveContext {
+  public:
+    SolveContext() = default;
+
+    SolveContext(const SolveContext&) = delete;
+    SolveContext& operator=(const SolveContext&) = delete;
+
+    std::expected<void, SolveError> Solve(std::string_view equation, Solutions& solutions,
+        const NumericOptions& numeric = {}, const SolveLimits& limits = {});
+
+    // params must line up with the names given to Compile(), root finding stops at the time limit
+    std::expected<void, SolveError> Solve(const CompiledEquation& equation,
+        std::span<const double> params, Solutions& solutions, const SolveLimits& limits = {});
+
+    // Set by a failed solve, cleared by a successful one
+    const std::optional<SolveError>& LastError() const { return m_LastError; }
+
+  private:
+    ArenaAllocator m_Arena;
+    std::vector<double> m_Registers;
+    std::vector<double> m_Coefficients;
+    std::optional<SolveError> m_LastError;
+};
+
+// One context per thread, created on first use
+SolveContext& ThreadContext();
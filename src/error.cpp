@@ -0,0 +1,96 @@
+#include "error.h"
+
+const char* ErrorMessage(ErrorCode code) {
+    switch (code) {
+        case ErrorCode::InvalidSymbol: return "Invalid symbol";
+        case ErrorCode::MultipleDots: return "Multiple dots in a number";
+        case ErrorCode::InvalidNumber: return "Invalid number format";
+        case ErrorCode::ExpectedPrimary: return "Expected primary";
+        case ErrorCode::UnexpectedToken: return "Unexpected token in primary";
+        case ErrorCode::ExpectedEqual: return "Expected '='";
+        case ErrorCode::ExpectedRParen: return "Expected ')'";
+        case ErrorCode::TrailingInput: return "Unexpected token after equation";
+        case ErrorCode::UnknownFunction: return "No function with this name";
+        case ErrorCode::MoreThanOneVariable: return "More than 1 variable";
+        case ErrorCode::ParameterCount: return "Wrong number of parameter values";
+        case ErrorCode::DegreeTooHigh: return "Polynomial degree above 1024";
+        case ErrorCode::DivisionByVariable: return "Division by variable expression";
+        case ErrorCode::DivisionByZero: return "Division by zero";
+        case ErrorCode::VariableInFunction: return "Variable expression in function";
+        case ErrorCode::ExponentContainsVariable: return "Exponent contains variable";
+        case ErrorCode::InvalidExponent:
+            return "Exponent of a variable expression must be a whole number >= 0";
+        case ErrorCode::ParametricExponent:
+            return "Exponent of a variable expression depends on a parameter";
+        case ErrorCode::NotLinear: return "Equation is not linear in its variables";
+        case ErrorCode::IllConditioned: return "Roots lost in the rounding of the polynomial";
+        case ErrorCode::TanUndefined: return "Tan undefined (cos(x) = 0)";
+        case ErrorCode::AsinDomain: return "Asin domain is [-1, 1]";
+        case ErrorCode::AcosDomain: return "Acos domain is [-1, 1]";
+        case ErrorCode::LogDomain: return "Logarithm of non-positive number";
+        case ErrorCode::SqrtDomain: return "Square root of negative number";
+        case ErrorCode::InputTooLong: return "Equation longer than the input limit";
+        case ErrorCode::TooManyTokens: return "More tokens than the limit";
+        case ErrorCode::TooManyNodes: return "Expression tree larger than the limit";
+        case ErrorCode::NestingTooDeep: return "Nesting deeper than the limit";
+        case ErrorCode::ArenaTooLarge: return "Solve memory above the limit";
+        case ErrorCode::Timeout: return "Solve took longer than the time limit";
+        case ErrorCode::OutOfMemory: return "Out of memory";
+        case ErrorCode::InternalError: return "Internal error";
+        default: return "Unknown error";
+    }
+}
+
+const char* ErrorCodeName(ErrorCode code) {
+    switch (code) {
+        case ErrorCode::InvalidSymbol: return "InvalidSymbol";
+        case ErrorCode::MultipleDots: return "MultipleDots";
+        case ErrorCode::InvalidNumber: return "InvalidNumber";
+        case ErrorCode::ExpectedPrimary: return "ExpectedPrimary";
+        case ErrorCode::UnexpectedToken: return "UnexpectedToken";
+        case ErrorCode::ExpectedEqual: return "ExpectedEqual";
+        case ErrorCode::ExpectedRParen: return "ExpectedRParen";
+        case ErrorCode::TrailingInput: return "TrailingInput";
+        case ErrorCode::UnknownFunction: return "UnknownFunction";
+        case ErrorCode::MoreThanOneVariable: return "MoreThanOneVariable";
+        case ErrorCode::ParameterCount: return "ParameterCount";
+        case ErrorCode::DegreeTooHigh: return "DegreeTooHigh";
+        case ErrorCode::DivisionByVariable: return "DivisionByVariable";
+        case ErrorCode::DivisionByZero: return "DivisionByZero";
+        case ErrorCode::VariableInFunction: return "VariableInFunction";
+        case ErrorCode::ExponentContainsVariable: return "ExponentContainsVariable";
+        case ErrorCode::InvalidExponent: return "InvalidExponent";
+        case ErrorCode::ParametricExponent: return "ParametricExponent";
+        case ErrorCode::NotLinear: return "NotLinear";
+        case ErrorCode::IllConditioned: return "IllConditioned";
+        case ErrorCode::TanUndefined: return "TanUndefined";
+        case ErrorCode::AsinDomain: return "AsinDomain";
+        case ErrorCode::AcosDomain: return "AcosDomain";
+        case ErrorCode::LogDomain: return "LogDomain";
+        case ErrorCode::SqrtDomain: return "SqrtDomain";
+        case ErrorCode::InputTooLong: return "InputTooLong";
+        case ErrorCode::TooManyTokens: return "TooManyTokens";
+        case ErrorCode::TooManyNodes: return "TooManyNodes";
+        case ErrorCode::NestingTooDeep: return "NestingTooDeep";
+        case ErrorCode::ArenaTooLarge: return "ArenaTooLarge";
+        case ErrorCode::Timeout: return "Timeout";
+        case ErrorCode::OutOfMemory: return "OutOfMemory";
+        case ErrorCode::InternalError: return "InternalError";
+        default: return "Unknown";
+    }
+}
+
+const char* ErrorCategory(ErrorCode code) {
+    if (code < ErrorCode::ExpectedPrimary) {
+        return "tokenizer";
+    } else if (code < ErrorCode::DegreeTooHigh) {
+        return "parser";
+    } else if (code < ErrorCode::TanUndefined) {
+        return "analysis";
+    } else if (code < ErrorCode::InputTooLong) {
+        return "domain";
+    } else if (code < ErrorCode::InternalError) {
+        return "limit";
+    }
+    return "internal";
+}
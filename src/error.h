@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+enum class ErrorCode : uint8_t {
+    // Tokenizer
+    InvalidSymbol,
+    MultipleDots,
+    InvalidNumber,
+
+    // Parser
+    ExpectedPrimary,
+    UnexpectedToken,
+    ExpectedEqual,
+    ExpectedRParen,
+    TrailingInput,
+    UnknownFunction,
+    MoreThanOneVariable,
+    ParameterCount,
+
+    // Analysis
+    DegreeTooHigh,
+    DivisionByVariable,
+    DivisionByZero,
+    VariableInFunction,
+    ExponentContainsVariable,
+    InvalidExponent,
+    ParametricExponent,
+    NotLinear,
+    IllConditioned,
+    TanUndefined,
+    AsinDomain,
+    AcosDomain,
+    LogDomain,
+    SqrtDomain,
+
+    // Limits, see SolveLimits
+    InputTooLong,
+    TooManyTokens,
+    TooManyNodes,
+    NestingTooDeep,
+    ArenaTooLarge,
+    Timeout,
+    OutOfMemory, // the heap, only reported by the C interface
+
+    // C interface, an exception other than std::bad_alloc
+    InternalError,
+
+    ERROR_CODE_NB
+};
+
+struct SolveError {
+    ErrorCode Code;
+    size_t Offset; // byte offset into the equation text
+};
+
+// Static string, never allocates
+const char* ErrorMessage(ErrorCode code);
+
+// The enumerator as written, e.g. "DivisionByZero"
+const char* ErrorCodeName(ErrorCode code);
+
+// "tokenizer", "parser", "analysis" or "domain", the pass that reports the error, "limit" or
+// "internal"
+const char* ErrorCategory(ErrorCode code);
+
+// The solve was cut short, the equation itself may be fine
+constexpr bool IsLimitError(ErrorCode code) {
+    return code >= ErrorCode::InputTooLong && code < ErrorCode::InternalError;
+}
@@ -0,0 +1,533 @@
+#include "jit.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#if ALGEBRA_JIT && defined(__linux__) && defined(__x86_64__)
+    #include <sys/mman.h>
+    #include <unistd.h>
+    #define HAS_JIT 1
+#endif
+
+#ifdef HAS_JIT
+
+namespace {
+
+// General purpose registers by their encoding. The entry keeps params in r12, the register file
+// in rbx and the error pointer in r13, all three survive calls.
+constexpr uint8_t RBX = 3;
+constexpr uint8_t R12 = 12;
+constexpr uint8_t R13 = 13;
+
+constexpr uint8_t XMM_COUNT = 15;    // allocated, xmm15 is scratch
+constexpr uint8_t SCRATCH_XMM = 15;
+constexpr uint8_t NO_XMM = UINT8_MAX;
+constexpr uint32_t NO_VALUE = UINT32_MAX;
+
+// The pool after the code starts with two 16 byte masks, then the program constants
+constexpr uint32_t SIGN_MASK = 0;
+constexpr uint32_t ABS_MASK = 16;
+constexpr uint32_t POOL_CONSTANTS = 32;
+
+// Where an SSE instruction reads its second operand
+struct Operand {
+    enum class Kind : uint8_t { Xmm, Memory, Pool };
+
+    Kind Type;
+    uint8_t Reg;   // Xmm: the register, Memory: the base register
+    uint32_t Disp; // Memory: displacement, Pool: byte offset into the pool
+};
+
+constexpr Operand Xmm(uint8_t reg) {
+    return { Operand::Kind::Xmm, reg, 0 };
+}
+
+class Assembler {
+  public:
+    std::vector<uint8_t> Code;
+
+    void Bytes(std::initializer_list<uint8_t> bytes) { Code.insert(Code.end(), bytes); }
+
+    void U32(uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            Code.push_back(uint8_t(value >> (8 * i)));
+        }
+    }
+
+    void U64(uint64_t value) {
+        U32(uint32_t(value));
+        U32(uint32_t(value >> 32));
+    }
+
+    // [prefix] [REX] 0F opcode... with xmm reg in ModRM.reg, trailing immediate bytes excluded
+    void Sse(uint8_t prefix, std::initializer_list<uint8_t> opcode, uint8_t reg, const Operand& rm) {
+        if (prefix) {
+            Code.push_back(prefix);
+        }
+        const uint8_t base = rm.Type == Operand::Kind::Pool ? 0 : rm.Reg;
+        const uint8_t rex = (reg >= 8 ? 0x4 : 0) | (base >= 8 ? 0x1 : 0);
+        if (rex) {
+            Code.push_back(0x40 | rex);
+        }
+        Code.push_back(0x0F);
+        Code.insert(Code.end(), opcode);
+
+        switch (rm.Type) {
+            case Operand::Kind::Xmm: Code.push_back(0xC0 | (reg & 7) << 3 | (rm.Reg & 7)); break;
+            case Operand::Kind::Memory:
+                Code.push_back(0x80 | (reg & 7) << 3 | (rm.Reg & 7)); // [base + disp32]
+                if ((rm.Reg & 7) == 4) {
+                    Code.push_back(0x24); // r12 needs a SIB byte
+                }
+                U32(rm.Disp);
+                break;
+            case Operand::Kind::Pool:
+                Code.push_back(0x05 | (reg & 7) << 3); // [rip + disp32]
+                m_PoolFixups.push_back({ uint32_t(Code.size()), rm.Disp });
+                U32(0);
+                break;
+        }
+    }
+
+    // jcc rel32 to a label placed later
+    void Jump(uint8_t condition, size_t label) {
+        Bytes({ 0x0F, uint8_t(0x80 | condition) });
+        m_LabelFixups.push_back({ uint32_t(Code.size()), uint32_t(label) });
+        U32(0);
+    }
+
+    void JumpAlways(size_t label) {
+        Code.push_back(0xE9);
+        m_LabelFixups.push_back({ uint32_t(Code.size()), uint32_t(label) });
+        U32(0);
+    }
+
+    size_t NewLabel() {
+        m_Labels.push_back(0);
+        return m_Labels.size() - 1;
+    }
+
+    void Place(size_t label) { m_Labels[label] = uint32_t(Code.size()); }
+
+    // Patches the jumps, and the pool references for a pool placed at poolStart
+    void Resolve(uint32_t poolStart) {
+        for (const Fixup& fixup : m_LabelFixups) {
+            Patch(fixup.At, m_Labels[fixup.Target] - (fixup.At + 4));
+        }
+        for (const Fixup& fixup : m_PoolFixups) {
+            Patch(fixup.At, poolStart + fixup.Target - (fixup.At + 4));
+        }
+    }
+
+  private:
+    struct Fixup {
+        uint32_t At; // of the rel32
+        uint32_t Target;
+    };
+
+    void Patch(uint32_t at, uint32_t value) {
+        for (int i = 0; i < 4; i++) {
+            Code[at + i] = uint8_t(value >> (8 * i));
+        }
+    }
+
+    std::vector<uint32_t> m_Labels;
+    std::vector<Fixup> m_LabelFixups;
+    std::vector<Fixup> m_PoolFixups;
+};
+
+// Condition codes of jcc
+constexpr uint8_t CC_E = 0x4;
+constexpr uint8_t CC_NE = 0x5;
+constexpr uint8_t CC_A = 0x7;
+
+// Failing Call instructions store their ErrorCode from here
+double CallFunction(double n, uint32_t fn, uint32_t* error) {
+    const auto value = ApplyFunction(FunctionType(fn), n);
+    if (!value) {
+        *error = uint32_t(value.error());
+        return 0.0;
+    }
+    return *value;
+}
+
+// One pass over the program, allocating the xmm registers as it goes. Every value has a home in
+// memory it can be read from when it isn't in a register: constants in the pool, parameters in
+// the params array, the rest in its slot of the register file once it had to be stored.
+class CodeGenerator {
+  public:
+    explicit CodeGenerator(const Program& program)
+        : m_Program(program), m_LastUse(program.Code.size(), NO_VALUE),
+          m_Xmm(program.Code.size(), NO_XMM), m_Stored(program.Code.size(), false) {
+        m_Held.fill(NO_VALUE);
+        for (size_t i = 0; i < program.Code.size(); i++) {
+            const Instruction& ins = program.Code[i];
+            if (ReadsLhs(ins.Op)) {
+                m_LastUse[ins.Lhs] = uint32_t(i);
+            }
+            if (ReadsRhs(ins.Op)) {
+                m_LastUse[ins.Rhs] = uint32_t(i);
+            }
+        }
+        for (uint32_t output : program.Outputs) {
+            m_LastUse[output] = uint32_t(program.Code.size());
+        }
+    }
+
+    // The code of the entry function, the pool goes at PoolStart(code.size())
+    std::vector<uint8_t> Generate() {
+        // push rbx, r12, r13 leave the stack 16 byte aligned for the calls
+        m_Asm.Bytes({ 0x53, 0x41, 0x54, 0x41, 0x55 });
+        m_Asm.Bytes({ 0x48, 0x89, 0xF3 }); // mov rbx, rsi
+        m_Asm.Bytes({ 0x49, 0x89, 0xFC }); // mov r12, rdi
+        m_Asm.Bytes({ 0x49, 0x89, 0xD5 }); // mov r13, rdx
+        const size_t done = m_Asm.NewLabel();
+
+        // x arrives in xmm0, which is allocated like the others
+        for (uint32_t i = 0; i < m_Program.Code.size(); i++) {
+            if (m_Program.Code[i].Op == OpCode::Var) {
+                m_Asm.Sse(0xF2, { 0x11 }, 0, Slot(i));
+                m_Stored[i] = true;
+            }
+        }
+
+        for (uint32_t i = 0; i < m_Program.Code.size(); i++) {
+            const Instruction& ins = m_Program.Code[i];
+            switch (ins.Op) {
+                case OpCode::Const:
+                case OpCode::Param:
+                case OpCode::Var: break; // read from their homes
+                case OpCode::Add:
+                case OpCode::Sub:
+                case OpCode::Mul:
+                case OpCode::Div: Binary(i, ins); break;
+                case OpCode::Neg: m_Asm.Sse(0x66, { 0x57 }, Unary(i, ins), Pool(SIGN_MASK)); break;
+                case OpCode::Pow: CallOut(i, ins); break;
+                case OpCode::Call: Function(i, ins); break;
+            }
+            if (m_LastUse[i] == NO_VALUE && m_Xmm[i] != NO_XMM) { // never read
+                Free(i);
+            }
+        }
+
+        // The outputs go to their registers
+        for (uint32_t output : m_Program.Outputs) {
+            if (m_Xmm[output] != NO_XMM) {
+                m_Asm.Sse(0xF2, { 0x11 }, m_Xmm[output], Slot(output));
+            } else if (!m_Stored[output]) {
+                m_Asm.Sse(0xF2, { 0x10 }, SCRATCH_XMM, Home(output));
+                m_Asm.Sse(0xF2, { 0x11 }, SCRATCH_XMM, Slot(output));
+            }
+        }
+        m_Asm.Code.push_back(0xB8); // mov eax, NO_FAILURE
+        m_Asm.U32(UINT32_MAX);
+
+        m_Asm.Place(done);
+        m_Asm.Bytes({ 0x41, 0x5D, 0x41, 0x5C, 0x5B, 0xC3 }); // pop r13, r12, rbx; ret
+
+        for (const Failure& failure : m_Failures) {
+            m_Asm.Place(failure.Label);
+            if (failure.Code != ErrorCode::ERROR_CODE_NB) { // calls store their own
+                m_Asm.Bytes({ 0x41, 0xC7, 0x45, 0x00 }); // mov dword [r13], code
+                m_Asm.U32(uint32_t(failure.Code));
+            }
+            m_Asm.Code.push_back(0xB8); // mov eax, instruction
+            m_Asm.U32(failure.Instruction);
+            m_Asm.JumpAlways(done);
+        }
+
+        m_Asm.Resolve(PoolStart(m_Asm.Code.size()));
+        return std::move(m_Asm.Code);
+    }
+
+    static uint32_t PoolStart(size_t codeSize) { return uint32_t((codeSize + 15) / 16 * 16); }
+
+  private:
+    struct Failure {
+        size_t Label;
+        uint32_t Instruction;
+        ErrorCode Code; // ERROR_CODE_NB when the callee stored it
+    };
+
+    static bool ReadsLhs(OpCode op) {
+        return op != OpCode::Const && op != OpCode::Param && op != OpCode::Var;
+    }
+    static bool ReadsRhs(OpCode op) {
+        return ReadsLhs(op) && op != OpCode::Neg && op != OpCode::Call;
+    }
+
+    static Operand Pool(uint32_t offset) { return { Operand::Kind::Pool, 0, offset }; }
+    static Operand Slot(uint32_t value) { return { Operand::Kind::Memory, RBX, value * 8 }; }
+
+    Operand Home(uint32_t value) const {
+        const Instruction& ins = m_Program.Code[value];
+        if (ins.Op == OpCode::Const) {
+            return Pool(POOL_CONSTANTS + ins.Lhs * 8);
+        } else if (ins.Op == OpCode::Param) {
+            return { Operand::Kind::Memory, R12, ins.Lhs * 8 };
+        }
+        return Slot(value);
+    }
+
+    bool HasHome(uint32_t value) const {
+        const OpCode op = m_Program.Code[value].Op;
+        return op == OpCode::Const || op == OpCode::Param || m_Stored[value];
+    }
+
+    Operand Where(uint32_t value) const {
+        return m_Xmm[value] != NO_XMM ? Xmm(m_Xmm[value]) : Home(value);
+    }
+
+    void Store(uint32_t value) {
+        if (!HasHome(value)) {
+            m_Asm.Sse(0xF2, { 0x11 }, m_Xmm[value], Slot(value));
+            m_Stored[value] = true;
+        }
+    }
+
+    void Free(uint32_t value) {
+        m_Held[m_Xmm[value]] = NO_VALUE;
+        m_Xmm[value] = NO_XMM;
+    }
+
+    // A free register, or the one whose value is needed last, except those of keep
+    uint8_t Allocate(uint32_t keepA, uint32_t keepB) {
+        uint8_t victim = NO_XMM;
+        for (uint8_t reg = 0; reg < XMM_COUNT; reg++) {
+            const uint32_t value = m_Held[reg];
+            if (value == NO_VALUE) {
+                return reg;
+            } else if (value != keepA && value != keepB &&
+                       (victim == NO_XMM || m_LastUse[value] > m_LastUse[m_Held[victim]])) {
+                victim = reg;
+            }
+        }
+        const uint32_t value = m_Held[victim];
+        Store(value);
+        Free(value);
+        return victim;
+    }
+
+    // A register holding a copy of value that instruction i may overwrite with its result
+    uint8_t Destination(uint32_t i, uint32_t value, uint32_t keep) {
+        uint8_t reg = m_Xmm[value];
+        if (reg != NO_XMM && m_LastUse[value] == i) {
+            Free(value); // the last read is this one, its register can be reused
+        } else {
+            const Operand source = Where(value);
+            reg = Allocate(value, keep);
+            if (source.Type == Operand::Kind::Xmm) {
+                m_Asm.Sse(0x66, { 0x28 }, reg, source); // movapd
+            } else {
+                m_Asm.Sse(0xF2, { 0x10 }, reg, source); // movsd
+            }
+        }
+        m_Held[reg] = i;
+        m_Xmm[i] = reg;
+        return reg;
+    }
+
+    void Release(uint32_t i, uint32_t value) {
+        if (m_LastUse[value] == i && m_Xmm[value] != NO_XMM && m_Held[m_Xmm[value]] == value) {
+            Free(value);
+        }
+    }
+
+    void Fail(uint8_t condition, uint32_t i, ErrorCode code) {
+        const size_t label = m_Asm.NewLabel();
+        m_Asm.Jump(condition, label);
+        m_Failures.push_back({ label, i, code });
+    }
+
+    void Binary(uint32_t i, const Instruction& ins) {
+        uint32_t lhs = ins.Lhs;
+        uint32_t rhs = ins.Rhs;
+        const bool commutative = ins.Op == OpCode::Add || ins.Op == OpCode::Mul;
+        if (commutative && m_LastUse[rhs] == i && m_Xmm[rhs] != NO_XMM &&
+            !(m_LastUse[lhs] == i && m_Xmm[lhs] != NO_XMM)) {
+            std::swap(lhs, rhs); // reuse the register of the operand that dies here
+        }
+
+        if (ins.Op == OpCode::Div) { // before the registers change, rhs == 0 fails
+            m_Asm.Sse(0x66, { 0x57 }, SCRATCH_XMM, Xmm(SCRATCH_XMM)); // xorpd
+            m_Asm.Sse(0x66, { 0x2E }, SCRATCH_XMM, Where(rhs));       // ucomisd
+            m_Asm.Bytes({ 0x7A, 0x06 });                              // jp past the je, NaN
+            Fail(CC_E, i, ErrorCode::DivisionByZero);
+        }
+
+        // When lhs == rhs dies here, its register is both the destination and the operand
+        const uint8_t sameReg = lhs == rhs ? m_Xmm[lhs] : NO_XMM;
+        const uint8_t dst = Destination(i, lhs, rhs);
+        const Operand operand = lhs == rhs && sameReg != NO_XMM ? Xmm(sameReg) : Where(rhs);
+
+        uint8_t opcode = 0;
+        switch (ins.Op) {
+            case OpCode::Add: opcode = 0x58; break;
+            case OpCode::Sub: opcode = 0x5C; break;
+            case OpCode::Mul: opcode = 0x59; break;
+            default: opcode = 0x5E; break;
+        }
+        m_Asm.Sse(0xF2, { opcode }, dst, operand);
+        Release(i, rhs);
+    }
+
+    // Copies the operand into the result's register for an in-place operation
+    uint8_t Unary(uint32_t i, const Instruction& ins) { return Destination(i, ins.Lhs, NO_VALUE); }
+
+    void Function(uint32_t i, const Instruction& ins) {
+        switch (ins.Fn) {
+            case FunctionType::Abs: m_Asm.Sse(0x66, { 0x54 }, Unary(i, ins), Pool(ABS_MASK)); return;
+            case FunctionType::Sqrt: {
+                // 0 > n fails, NaN sets CF and goes through like in ApplyFunction()
+                m_Asm.Sse(0x66, { 0x57 }, SCRATCH_XMM, Xmm(SCRATCH_XMM));
+                m_Asm.Sse(0x66, { 0x2E }, SCRATCH_XMM, Where(ins.Lhs));
+                Fail(CC_A, i, ErrorCode::SqrtDomain);
+                const uint8_t reg = Unary(i, ins);
+                m_Asm.Sse(0xF2, { 0x51 }, reg, Xmm(reg));
+                return;
+            }
+            case FunctionType::Floor:
+            case FunctionType::Ceil:
+                if (__builtin_cpu_supports("sse4.1")) {
+                    const uint8_t reg = Unary(i, ins);
+                    m_Asm.Sse(0x66, { 0x3A, 0x0B }, reg, Xmm(reg)); // roundsd, no inexact
+                    m_Asm.Code.push_back(ins.Fn == FunctionType::Floor ? 0x09 : 0x0A);
+                    return;
+                }
+                break;
+            default: break;
+        }
+        CallOut(i, ins);
+    }
+
+    // Pow and the functions that call out, every xmm register is lost in the call
+    void CallOut(uint32_t i, const Instruction& ins) {
+        for (uint8_t reg = 0; reg < XMM_COUNT; reg++) {
+            const uint32_t value = m_Held[reg];
+            if (value != NO_VALUE) {
+                Store(value);
+                Free(value);
+            }
+        }
+
+        uint64_t target = 0;
+        m_Asm.Sse(0xF2, { 0x10 }, 0, Home(ins.Lhs)); // movsd xmm0
+        if (ins.Op == OpCode::Pow) {
+            m_Asm.Sse(0xF2, { 0x10 }, 1, Home(ins.Rhs)); // movsd xmm1
+            target = reinterpret_cast<uint64_t>(static_cast<double (*)(double, double)>(std::pow));
+        } else {
+            m_Asm.Code.push_back(0xBF); // mov edi, fn
+            m_Asm.U32(uint32_t(ins.Fn));
+            m_Asm.Bytes({ 0x4C, 0x89, 0xEE }); // mov rsi, r13
+            target = reinterpret_cast<uint64_t>(&CallFunction);
+        }
+        m_Asm.Bytes({ 0x48, 0xB8 }); // mov rax, target
+        m_Asm.U64(target);
+        m_Asm.Bytes({ 0xFF, 0xD0 }); // call rax
+
+        if (ins.Op == OpCode::Call) {
+            m_Asm.Bytes({ 0x41, 0x83, 0x7D, 0x00, 0x00 }); // cmp dword [r13], 0
+            Fail(CC_NE, i, ErrorCode::ERROR_CODE_NB);
+        }
+        m_Held[0] = i;
+        m_Xmm[i] = 0;
+    }
+
+    const Program& m_Program;
+    Assembler m_Asm;
+    std::vector<uint32_t> m_LastUse; // instruction that reads the value last, Code.size() for outputs
+    std::vector<uint8_t> m_Xmm;      // register of every value, NO_XMM when it is only in its home
+    std::vector<bool> m_Stored;      // in its register file slot
+    std::array<uint32_t, XMM_COUNT> m_Held; // value in every register
+    std::vector<Failure> m_Failures;
+};
+
+} // namespace
+
+std::unique_ptr<JitCode> JitCode::Compile(const Program& program) {
+    const std::vector<uint8_t> code = CodeGenerator(program).Generate();
+    const uint32_t poolStart = CodeGenerator::PoolStart(code.size());
+
+    std::vector<uint64_t> pool = { 0x8000000000000000ull, 0, 0x7FFFFFFFFFFFFFFFull, 0 };
+    for (double value : program.Constants) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        pool.push_back(bits);
+    }
+
+    const size_t page = size_t(sysconf(_SC_PAGESIZE));
+    const size_t size = (poolStart + pool.size() * 8 + page - 1) / page * page;
+    void* pages = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pages == MAP_FAILED) {
+        return nullptr;
+    }
+    std::memcpy(pages, code.data(), code.size());
+    std::memcpy(static_cast<char*>(pages) + poolStart, pool.data(), pool.size() * 8);
+    if (mprotect(pages, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(pages, size);
+        return nullptr;
+    }
+
+    std::vector<uint32_t> offsets;
+    for (const Instruction& ins : program.Code) {
+        offsets.push_back(ins.Offset);
+    }
+    return std::unique_ptr<JitCode>(new JitCode(pages, size, std::move(offsets)));
+}
+
+JitCode::JitCode(void* pages, size_t size, std::vector<uint32_t> offsets)
+    : m_Pages(pages), m_Size(size), m_Entry(reinterpret_cast<Entry>(pages)),
+      m_Offsets(std::move(offsets)) {}
+
+JitCode::~JitCode() {
+    munmap(m_Pages, m_Size);
+}
+
+#else
+
+std::unique_ptr<JitCode> JitCode::Compile(const Program&) {
+    return nullptr;
+}
+
+JitCode::JitCode(void* pages, size_t size, std::vector<uint32_t> offsets)
+    : m_Pages(pages), m_Size(size), m_Entry(nullptr), m_Offsets(std::move(offsets)) {}
+
+JitCode::~JitCode() = default;
+
+#endif
+
+std::expected<void, SolveError> JitCode::Execute(
+    std::span<const double> params, double x, std::span<double> registers) const {
+    uint32_t error = 0;
+    const uint32_t failed = m_Entry(params.data(), registers.data(), &error, x);
+    if (failed != NO_FAILURE) {
+        return std::unexpected(SolveError{ ErrorCode(error), m_Offsets[failed] });
+    }
+    return {};
+}
+
+JitTier& JitTier::operator=(const JitTier&) {
+    m_Evaluations.store(0, std::memory_order_relaxed);
+    m_Code.store(nullptr, std::memory_order_relaxed);
+    m_Owned.reset();
+    return *this;
+}
+
+const JitCode* JitTier::Touch(const Program& program) {
+    if (const JitCode* code = m_Code.load(std::memory_order_acquire)) {
+        return code;
+    }
+#ifdef HAS_JIT
+    // Past the threshold the code is being compiled or couldn't be
+    if (m_Evaluations.load(std::memory_order_relaxed) < JIT_THRESHOLD &&
+        m_Evaluations.fetch_add(1, std::memory_order_relaxed) + 1 == JIT_THRESHOLD) {
+        m_Owned = JitCode::Compile(program);
+        m_Code.store(m_Owned.get(), std::memory_order_release);
+        return m_Owned.get();
+    }
+#else
+    (void)program;
+#endif
+    return nullptr;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "program.h"
+#include <atomic>
+#include <memory>
+
+// Native code for programs, x86-64 Linux only. Built unless ALGEBRA_JIT is defined to 0, without
+// it JitCode::Compile() always fails and the programs stay interpreted.
+#ifndef ALGEBRA_JIT
+    #define ALGEBRA_JIT 1
+#endif
+
+// Evaluations of a program before it gets compiled, compiling costs about as much as a hundred
+// interpreted runs of a typical coefficient program
+constexpr uint32_t JIT_THRESHOLD = 64;
+
+// A program lowered to straight-line SSE2 code in executable pages. Values stay in xmm registers
+// and are only stored to the register file when a call needs the registers or they run out. Abs,
+// Sqrt, Floor and Ceil are inlined, the other functions and Pow call libm.
+class JitCode {
+  public:
+    // nullptr on platforms without the JIT and when the pages can't be mapped
+    static std::unique_ptr<JitCode> Compile(const Program& program);
+
+    ~JitCode();
+
+    JitCode(const JitCode&) = delete;
+    JitCode& operator=(const JitCode&) = delete;
+
+    // Same contract as Execute(program, ...), except that only the registers of the outputs are
+    // written for sure
+    std::expected<void, SolveError> Execute(
+        std::span<const double> params, double x, std::span<double> registers) const;
+
+  private:
+    // Returns the index of the failing instruction with its ErrorCode in *error, or NO_FAILURE
+    using Entry = uint32_t (*)(const double* params, double* registers, uint32_t* error, double x);
+    static constexpr uint32_t NO_FAILURE = UINT32_MAX;
+
+    JitCode(void* pages, size_t size, std::vector<uint32_t> offsets);
+
+    void* m_Pages;
+    size_t m_Size;
+    Entry m_Entry;
+    std::vector<uint32_t> m_Offsets; // source offset of every instruction, for the errors
+};
+
+// Counts the evaluations of a program and compiles it on the JIT_THRESHOLD-th. Other threads keep
+// interpreting while that happens. A copy starts counting from zero.
+class JitTier {
+  public:
+    JitTier() = default;
+    JitTier(const JitTier&) {}
+    JitTier& operator=(const JitTier&);
+
+    // The native code of program once it is hot, nullptr before and when it can't be compiled.
+    // program has to be the same on every call.
+    const JitCode* Touch(const Program& program);
+
+  private:
+    std::atomic<uint32_t> m_Evaluations{ 0 };
+    std::atomic<const JitCode*> m_Code{ nullptr };
+    std::unique_ptr<JitCode> m_Owned; // written once, by the thread that compiles
+};
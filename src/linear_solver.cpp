@@ -0,0 +1,396 @@
+#include "linear_solver.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+constexpr size_t PANEL_WIDTH = 64;    // columns factored together by the dense LU
+constexpr size_t ROWS_PER_TASK = 64;  // rows of the trailing update in one pool task
+constexpr size_t COLUMN_TILE = 512;   // columns of U streamed per pass, so they stay in cache
+constexpr size_t MIN_SPARSE_SIZE = 64;
+constexpr size_t SPARSE_DENSITY = 16; // sparse LU is tried below 1/16 nonzeros
+constexpr size_t SPARSE_FILL = 8;     // and abandoned above 1/8 nonzeros in L + U
+constexpr size_t SPARSE_WORK = 16;    // or above 1/16 of the dense multiply-adds
+
+// The sparse LU keeps the diagonal as pivot while it is at least this fraction of the largest
+// candidate, which preserves the structure better than always taking the largest
+constexpr double DIAGONAL_PREFERENCE = 0.1;
+
+// Runs body(i) for i in [0, count), on the pool when there is more than one
+static void ParallelFor(ThreadPool& pool, size_t count, const std::function<void(size_t)>& body) {
+    if (count == 1 || pool.Size() == 1) {
+        for (size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+    pool.RunAll(count, body);
+}
+
+// Row-major n x n matrix factored in place into P a = L U, L has a unit diagonal. Row j was
+// swapped with row Pivots[j] at step j.
+struct DenseLU {
+    size_t Size = 0;
+    std::vector<double> Data;
+    std::vector<size_t> Pivots;
+
+    double* Row(size_t i) { return Data.data() + i * Size; }
+    const double* Row(size_t i) const { return Data.data() + i * Size; }
+};
+
+// Unblocked factorization of columns [k0, k0 + width) over all rows below k0
+static bool FactorPanel(DenseLU& lu, size_t k0, size_t width, double tolerance) {
+    const size_t n = lu.Size;
+    const size_t end = k0 + width;
+
+    for (size_t j = k0; j < end; j++) {
+        size_t pivot = j;
+        for (size_t i = j + 1; i < n; i++) {
+            if (std::abs(lu.Row(i)[j]) > std::abs(lu.Row(pivot)[j])) {
+                pivot = i;
+            }
+        }
+        if (!(std::abs(lu.Row(pivot)[j]) > tolerance)) {
+            return false;
+        }
+
+        lu.Pivots[j] = pivot;
+        if (pivot != j) {
+            std::swap_ranges(lu.Row(j), lu.Row(j) + n, lu.Row(pivot));
+        }
+
+        const double* top = lu.Row(j);
+        for (size_t i = j + 1; i < n; i++) {
+            double* row = lu.Row(i);
+            const double l = row[j] /= top[j];
+            for (size_t c = j + 1; c < end; c++) {
+                row[c] -= l * top[c];
+            }
+        }
+    }
+    return true;
+}
+
+// Right-looking blocked LU: factor a panel, solve for the block row of U right of it, then
+// subtract L21 U12 from the trailing matrix. The last step holds nearly all the work and is
+// split into row blocks on the pool.
+static bool FactorDense(DenseLU& lu, double tolerance, ThreadPool& pool) {
+    const size_t n = lu.Size;
+    lu.Pivots.resize(n);
+
+    for (size_t k0 = 0; k0 < n; k0 += PANEL_WIDTH) {
+        const size_t width = std::min(PANEL_WIDTH, n - k0);
+        const size_t end = k0 + width;
+        if (!FactorPanel(lu, k0, width, tolerance)) {
+            return false;
+        }
+        if (end == n) {
+            break;
+        }
+
+        // U12 = L11^-1 A12, by column tiles
+        const size_t tiles = (n - end + COLUMN_TILE - 1) / COLUMN_TILE;
+        ParallelFor(pool, tiles, [&](size_t t) {
+            const size_t c0 = end + t * COLUMN_TILE;
+            const size_t c1 = std::min(c0 + COLUMN_TILE, n);
+            for (size_t r = k0 + 1; r < end; r++) {
+                double* row = lu.Row(r);
+                for (size_t q = k0; q < r; q++) {
+                    const double l = row[q];
+                    const double* u = lu.Row(q);
+                    for (size_t c = c0; c < c1; c++) {
+                        row[c] -= l * u[c];
+                    }
+                }
+            }
+        });
+
+        // A22 -= L21 U12
+        const size_t tasks = (n - end + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+        ParallelFor(pool, tasks, [&](size_t t) {
+            const size_t r0 = end + t * ROWS_PER_TASK;
+            const size_t r1 = std::min(r0 + ROWS_PER_TASK, n);
+            for (size_t c0 = end; c0 < n; c0 += COLUMN_TILE) {
+                const size_t c1 = std::min(c0 + COLUMN_TILE, n);
+                for (size_t r = r0; r < r1; r++) {
+                    double* row = lu.Row(r);
+                    for (size_t q = k0; q < end; q++) {
+                        const double l = row[q];
+                        if (l == 0.0) {
+                            continue;
+                        }
+                        const double* u = lu.Row(q);
+                        for (size_t c = c0; c < c1; c++) {
+                            row[c] -= l * u[c];
+                        }
+                    }
+                }
+            }
+        });
+    }
+    return true;
+}
+
+static void SolveDense(const DenseLU& lu, std::span<const double> b, std::span<double> x) {
+    const size_t n = lu.Size;
+    std::copy(b.begin(), b.end(), x.begin());
+    for (size_t j = 0; j < n; j++) {
+        std::swap(x[j], x[lu.Pivots[j]]);
+    }
+    for (size_t i = 0; i < n; i++) {
+        const double* row = lu.Row(i);
+        double sum = x[i];
+        for (size_t j = 0; j < i; j++) {
+            sum -= row[j] * x[j];
+        }
+        x[i] = sum;
+    }
+    for (size_t i = n; i-- > 0;) {
+        const double* row = lu.Row(i);
+        double sum = x[i];
+        for (size_t j = i + 1; j < n; j++) {
+            sum -= row[j] * x[j];
+        }
+        x[i] = sum / row[i];
+    }
+}
+
+// Compressed sparse columns
+struct SparseColumns {
+    std::vector<size_t> Start;
+    std::vector<uint32_t> Rows;
+    std::vector<double> Values;
+};
+
+static SparseColumns Transpose(const SparseMatrix& a) {
+    const size_t n = a.Size;
+    SparseColumns t;
+    t.Start.assign(n + 1, 0);
+    t.Rows.resize(a.Columns.size());
+    t.Values.resize(a.Columns.size());
+
+    for (uint32_t column : a.Columns) {
+        t.Start[column + 1]++;
+    }
+    for (size_t j = 0; j < n; j++) {
+        t.Start[j + 1] += t.Start[j];
+    }
+    std::vector<size_t> next(t.Start.begin(), t.Start.end() - 1);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t p = a.RowStart[i]; p < a.RowStart[i + 1]; p++) {
+            const size_t q = next[a.Columns[p]]++;
+            t.Rows[q] = uint32_t(i);
+            t.Values[q] = a.Values[p];
+        }
+    }
+    return t;
+}
+
+// Left-looking sparse LU (Gilbert-Peierls): column k of L and U comes from solving with the
+// columns of L found so far, only touching the rows reachable from the nonzeros of column k.
+// Rows are pivoted as they go, RowStep[i] is the step where row i became the pivot.
+class SparseLU {
+  public:
+    enum class Status : uint8_t { Factored, Singular, TooDense };
+
+    Status Factor(
+        const SparseColumns& a, size_t n, double tolerance, size_t maxFill, size_t maxWork) {
+        m_Size = n;
+        m_RowStep.assign(n, NOT_PIVOTAL);
+        m_L = {};
+        m_U = {};
+        m_L.Start.reserve(n + 1);
+        m_U.Start.reserve(n + 1);
+
+        std::vector<double> x(n, 0.0);
+        std::vector<uint32_t> reach(n);
+        m_Marks.assign(n, 0);
+        m_Stack.resize(n);
+        m_Positions.resize(n);
+        size_t work = 0;
+
+        for (size_t k = 0; k < n; k++) {
+            m_L.Start.push_back(m_L.Rows.size());
+            m_U.Start.push_back(m_U.Rows.size());
+
+            // x = L \ a(:, k) over the reachable rows, reach[top..n) in topological order
+            const size_t top = Reach(a, k, uint32_t(k + 1), reach);
+            work += n - top;
+            for (size_t p = a.Start[k]; p < a.Start[k + 1]; p++) {
+                x[a.Rows[p]] = a.Values[p];
+            }
+            for (size_t p = top; p < n; p++) {
+                const uint32_t row = reach[p];
+                const uint32_t step = m_RowStep[row];
+                if (step == NOT_PIVOTAL) {
+                    continue;
+                }
+                const double value = x[row]; // L has a unit diagonal, stored first
+                for (size_t q = m_L.Start[step] + 1; q < m_L.Start[step + 1]; q++) {
+                    x[m_L.Rows[q]] -= m_L.Values[q] * value;
+                }
+                work += m_L.Start[step + 1] - m_L.Start[step];
+            }
+
+            // Rows already pivotal give U, the others are pivot candidates
+            uint32_t pivot = NOT_PIVOTAL;
+            double largest = -1.0;
+            for (size_t p = top; p < n; p++) {
+                const uint32_t row = reach[p];
+                if (m_RowStep[row] == NOT_PIVOTAL) {
+                    if (std::abs(x[row]) > largest) {
+                        largest = std::abs(x[row]);
+                        pivot = row;
+                    }
+                } else {
+                    m_U.Rows.push_back(m_RowStep[row]);
+                    m_U.Values.push_back(x[row]);
+                }
+            }
+            if (pivot == NOT_PIVOTAL || !(largest > tolerance)) {
+                return Status::Singular;
+            }
+            if (m_RowStep[k] == NOT_PIVOTAL && std::abs(x[k]) >= DIAGONAL_PREFERENCE * largest) {
+                pivot = uint32_t(k);
+            }
+
+            const double value = x[pivot];
+            m_U.Rows.push_back(uint32_t(k));
+            m_U.Values.push_back(value);
+            m_RowStep[pivot] = uint32_t(k);
+            m_L.Rows.push_back(pivot);
+            m_L.Values.push_back(1.0);
+            for (size_t p = top; p < n; p++) {
+                const uint32_t row = reach[p];
+                if (m_RowStep[row] == NOT_PIVOTAL) {
+                    m_L.Rows.push_back(row);
+                    m_L.Values.push_back(x[row] / value);
+                }
+                x[row] = 0.0;
+            }
+
+            if (m_L.Rows.size() + m_U.Rows.size() > maxFill || work > maxWork) {
+                return Status::TooDense;
+            }
+        }
+        m_L.Start.push_back(m_L.Rows.size());
+        m_U.Start.push_back(m_U.Rows.size());
+
+        // L rows in pivot order from now on
+        for (uint32_t& row : m_L.Rows) {
+            row = m_RowStep[row];
+        }
+        return Status::Factored;
+    }
+
+    void Solve(std::span<const double> b, std::span<double> x) const {
+        for (size_t i = 0; i < m_Size; i++) {
+            x[m_RowStep[i]] = b[i];
+        }
+        for (size_t j = 0; j < m_Size; j++) {
+            for (size_t p = m_L.Start[j] + 1; p < m_L.Start[j + 1]; p++) {
+                x[m_L.Rows[p]] -= m_L.Values[p] * x[j];
+            }
+        }
+        for (size_t j = m_Size; j-- > 0;) {
+            const size_t last = m_U.Start[j + 1] - 1; // the diagonal
+            x[j] /= m_U.Values[last];
+            for (size_t p = m_U.Start[j]; p < last; p++) {
+                x[m_U.Rows[p]] -= m_U.Values[p] * x[j];
+            }
+        }
+    }
+
+  private:
+    static constexpr uint32_t NOT_PIVOTAL = UINT32_MAX;
+
+    // Rows reachable from the nonzeros of a(:, k) in the graph of L, in topological order in
+    // reach[top..n). Iterative depth-first search, marks are stamped with mark instead of cleared.
+    size_t Reach(const SparseColumns& a, size_t k, uint32_t mark, std::vector<uint32_t>& reach) {
+        size_t top = m_Size;
+        for (size_t p = a.Start[k]; p < a.Start[k + 1]; p++) {
+            if (m_Marks[a.Rows[p]] == mark) {
+                continue;
+            }
+
+            size_t head = 0;
+            m_Stack[0] = a.Rows[p];
+            while (true) {
+                const uint32_t row = m_Stack[head];
+                const uint32_t step = m_RowStep[row];
+                if (m_Marks[row] != mark) {
+                    m_Marks[row] = mark;
+                    m_Positions[head] = step == NOT_PIVOTAL ? 0 : m_L.Start[step] + 1;
+                }
+
+                bool done = true;
+                const size_t end = step == NOT_PIVOTAL ? 0 : m_L.Start[step + 1];
+                for (size_t q = m_Positions[head]; q < end; q++) {
+                    const uint32_t next = m_L.Rows[q];
+                    if (m_Marks[next] != mark) {
+                        m_Positions[head] = q + 1;
+                        m_Stack[++head] = next;
+                        done = false;
+                        break;
+                    }
+                }
+                if (done) {
+                    reach[--top] = row;
+                    if (head == 0) {
+                        break;
+                    }
+                    head--;
+                }
+            }
+        }
+        return top;
+    }
+
+    size_t m_Size = 0;
+    SparseColumns m_L; // unit diagonal first in every column
+    SparseColumns m_U; // diagonal last in every column
+    std::vector<uint32_t> m_RowStep;
+    std::vector<uint32_t> m_Marks;
+    std::vector<uint32_t> m_Stack;
+    std::vector<size_t> m_Positions;
+};
+
+LinearSolveResult SolveLinearSystem(
+    const SparseMatrix& a, std::span<const double> b, std::span<double> x, ThreadPool& pool) {
+    const size_t n = a.Size;
+    if (n == 0) {
+        return LinearSolveResult::Solved;
+    }
+
+    // Pivots this small relative to the largest entry are rounding noise
+    double largest = 0.0;
+    for (double value : a.Values) {
+        largest = std::max(largest, std::abs(value));
+    }
+    const double tolerance = double(n) * std::numeric_limits<double>::epsilon() * largest;
+
+    if (n >= MIN_SPARSE_SIZE && a.Values.size() <= n * n / SPARSE_DENSITY) {
+        SparseLU lu;
+        const size_t maxWork = n * n / SPARSE_WORK * n;
+        switch (lu.Factor(Transpose(a), n, tolerance, n * n / SPARSE_FILL, maxWork)) {
+            case SparseLU::Status::Factored: lu.Solve(b, x); return LinearSolveResult::Solved;
+            case SparseLU::Status::Singular: return LinearSolveResult::Singular;
+            case SparseLU::Status::TooDense: break;
+        }
+    }
+
+    DenseLU lu;
+    lu.Size = n;
+    lu.Data.assign(n * n, 0.0);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t p = a.RowStart[i]; p < a.RowStart[i + 1]; p++) {
+            lu.Row(i)[a.Columns[p]] = a.Values[p];
+        }
+    }
+    if (!FactorDense(lu, tolerance, pool)) {
+        return LinearSolveResult::Singular;
+    }
+    SolveDense(lu, b, x);
+    return LinearSolveResult::Solved;
+}
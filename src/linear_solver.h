@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+class ThreadPool;
+
+// Square matrix in compressed sparse rows, the columns of a row are sorted and unique
+struct SparseMatrix {
+    size_t Size = 0;
+    std::vector<size_t> RowStart{ 0 }; // row i is [RowStart[i], RowStart[i + 1])
+    std::vector<uint32_t> Columns;
+    std::vector<double> Values;
+};
+
+enum class LinearSolveResult : uint8_t { Solved, Singular };
+
+// Solves a x = b by LU factorization with partial pivoting. A sparse matrix is first factored
+// with a sparse left-looking LU, which gives up once its fill-in or work grows past a fraction of
+// the dense cost. Otherwise a dense, cache-blocked LU runs, with the updates spread over pool.
+LinearSolveResult SolveLinearSystem(
+    const SparseMatrix& a, std::span<const double> b, std::span<double> x, ThreadPool& pool);
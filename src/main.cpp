@@ -1,27 +1,83 @@
+#include "batch.h"
+#include "budget.h"
+#include "numeric.h"
+#include "output_writer.h"
+#include "server.h"
 #include "solver.h"
-#include <iomanip>
+#include "stats.h"
+#include "system.h"
+#include "tabulate.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
-#include <sstream>
+#include <string>
 
-static std::string FormatDouble(double x, int precision = 6) {
-    std::ostringstream oss;
-    oss << std::fixed << std::setprecision(precision) << x;
+#if defined(__unix__) || defined(__APPLE__)
+    #include <unistd.h>
+    #define HAS_ISATTY 1
+#endif
 
-    std::string s = oss.str();
-    s.erase(s.find_last_not_of('0') + 1);
-    if (!s.empty() && s.back() == '.') {
-        s.pop_back();
-    }
+static void PrintUsage() {
+    std::cerr << "Usage: Algebra-Solver [--exit-on-error] [--interval <lo>:<hi>] [--threads <n>]\n"
+                 "       Algebra-Solver --batch <input|-> [-o <output>] [--threads <n>]\n"
+                 "                      [--interval <lo>:<hi>] [--cache <MiB>]\n"
+                 "                      [--input-format <text|records>]\n"
+                 "                      [--output-format <text|records|columns>]\n"
+                 "       Algebra-Solver --system <input|-> [-o <output>] [--threads <n>]\n"
+                 "       Algebra-Solver --serve <port|socket path> [--threads <n>]\n"
+                 "                      [--interval <lo>:<hi>] [--cache <MiB>]\n"
+                 "       Algebra-Solver --tabulate <var>=<start>:<stop>:<step> <expression>\n"
+                 "                      [-o <output>] [--threads <n>]\n"
+                 "                      [--math <exact|accurate|fast>]\n"
+                 "The REPL, --batch and --serve also take [--precision <digits|shortest>]\n"
+                 "[--keep-zeros] [--stats] [--metrics <path>] [--limits <name>=<n>,...]\n"
+                 "Limits: bytes, tokens, nodes, depth, arena (bytes), us (time per equation)\n";
+}
 
-    return s;
+// A whole decimal number in [min, max], without the sign or spaces strtoul lets through
+static bool ParseCount(const char* text, size_t min, size_t max, size_t& value) {
+    const char* end = text + std::strlen(text);
+    const auto result = std::from_chars(text, end, value);
+    return result.ec == std::errc{} && result.ptr == end && value >= min && value <= max;
 }
 
-int main() {
-    const std::string_view equation = "x = 3pi + e";
+// Piped input is answered in blocks, a terminal gets every answer as soon as it is ready
+static bool IsInteractive() {
+#ifdef HAS_ISATTY
+    return isatty(STDIN_FILENO);
+#else
+    return true;
+#endif
+}
+
+// --exit-on-error: the message stays on screen until a key is pressed
+[[noreturn]] static void Error(const std::string& msg) {
+    std::cerr << "Error: " << msg << "\n";
+    std::cin.get();
+    std::exit(1);
+}
 
+static int RunRepl(bool exitOnError, NumericOptions numeric, const SolveLimits& limits,
+    const FormatOptions& format, size_t threads) {
+    ThreadPool pool(threads); // for the numeric fallback
+    numeric.Pool = &pool;
+
+    OutputWriter writer;
+    writer.Open("-");
+    const bool interactive = IsInteractive();
+
+    Solutions solutions;
     std::string input;
+    std::string out;
     while (true) {
-        std::cout << "> ";
+        writer.Write("> ");
+        if (interactive) {
+            writer.Flush();
+        }
         if (!std::getline(std::cin, input)) {
             break;
         }
@@ -30,25 +86,190 @@ int main() {
             continue;
         }
 
-        std::istringstream is(input);
-        std::string cmd;
-        is >> cmd;
+        const size_t start = std::min(input.find_first_not_of(" \t"), input.size());
+        const std::string_view cmd =
+            std::string_view(input).substr(start, input.find_first_of(" \t", start) - start);
 
         if (cmd == "quit") {
             break;
+        } else if (cmd == "stats" && StatsEnabled()) {
+            writer.Flush();
+            WriteStats(Stats(), std::cout);
+            continue;
         }
 
-        const auto solutions = Solve(is.str());
-        if (solutions.IsNone) {
-            std::cout << "No solution\n";
+        const auto result = Solve(input, solutions, numeric, limits);
+        out.clear();
+        if (!result) {
+            const SolveError& error = result.error();
+            const std::string msg = std::string(ErrorMessage(error.Code)) + " (column " +
+                                    std::to_string(error.Offset + 1) + ")";
+            writer.Flush();
+            if (exitOnError) {
+                Error(msg);
+            }
+            std::cerr << "Error: " << msg << "\n";
+        } else if (solutions.IsNone) {
+            out += "No solution\n";
         } else if (solutions.IsInfinite) {
-            std::cout << "Infinite solutions\n";
+            out += "Infinite solutions\n";
         } else {
             for (double solution : solutions.Values) {
-                std::cout << FormatDouble(solution, 10) << "\n\n";
+                out += FormatDouble(solution, format);
+                out += "\n\n";
             }
         }
+        writer.Write(out);
     }
 
-    return 0;
+    return writer.Flush() ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    BatchOptions batch;
+    ServeOptions serve;
+    SystemOptions system;
+    TabulateOptions tabulate;
+    bool isBatch = false;
+    bool isServe = false;
+    bool isSystem = false;
+    bool isTabulate = false;
+    bool exitOnError = false;
+    bool printStats = false;
+    std::string metricsPath;
+    NumericOptions numeric;
+    SolveLimits limits;
+    FormatOptions format;
+    size_t threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        const bool hasValue = i + 1 < argc;
+
+        if (std::strcmp(argv[i], "--exit-on-error") == 0) {
+            exitOnError = true;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            printStats = true;
+        } else if (std::strcmp(argv[i], "--metrics") == 0 && hasValue) {
+            metricsPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--precision") == 0 && hasValue) {
+            if (std::strcmp(argv[++i], "shortest") == 0) {
+                format.Precision = FormatOptions::SHORTEST;
+            } else {
+                char* end = nullptr;
+                const long digits = std::strtol(argv[i], &end, 10);
+                if (*end != '\0' || end == argv[i] || digits < 0 || digits > MAX_FORMAT_PRECISION) {
+                    std::cerr << "Error: invalid precision " << argv[i] << "\n";
+                    return 1;
+                }
+                format.Precision = int(digits);
+            }
+        } else if (std::strcmp(argv[i], "--input-format") == 0 && hasValue) {
+            if (std::strcmp(argv[++i], "text") == 0) {
+                batch.Input = InputFormat::Text;
+            } else if (std::strcmp(argv[i], "records") == 0) {
+                batch.Input = InputFormat::Records;
+            } else {
+                std::cerr << "Error: invalid input format " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--output-format") == 0 && hasValue) {
+            if (std::strcmp(argv[++i], "text") == 0) {
+                batch.Output = OutputFormat::Text;
+            } else if (std::strcmp(argv[i], "records") == 0) {
+                batch.Output = OutputFormat::Records;
+            } else if (std::strcmp(argv[i], "columns") == 0) {
+                batch.Output = OutputFormat::Columns;
+            } else {
+                std::cerr << "Error: invalid output format " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--keep-zeros") == 0) {
+            format.TrimZeros = false;
+        } else if (std::strcmp(argv[i], "--batch") == 0 && hasValue) {
+            isBatch = true;
+            batch.InputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--serve") == 0 && hasValue) {
+            isServe = true;
+            serve.Address = argv[++i];
+        } else if (std::strcmp(argv[i], "--system") == 0 && hasValue) {
+            isSystem = true;
+            system.InputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--tabulate") == 0 && i + 2 < argc) {
+            isTabulate = true;
+            if (!ParseGridSpec(argv[++i], tabulate)) {
+                std::cerr << "Error: invalid grid " << argv[i] << "\n";
+                return 1;
+            }
+            tabulate.Expression = argv[++i];
+        } else if (std::strcmp(argv[i], "--math") == 0 && hasValue) {
+            if (!ParseMathTier(argv[++i], tabulate.Math)) {
+                std::cerr << "Error: invalid math tier " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--interval") == 0 && hasValue) {
+            if (!ParseInterval(argv[++i], numeric)) {
+                std::cerr << "Error: invalid interval " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--limits") == 0 && hasValue) {
+            if (!ParseLimits(argv[++i], limits)) {
+                std::cerr << "Error: invalid limits " << argv[i] << "\n";
+                return 1;
+            }
+        } else if (std::strcmp(argv[i], "--cache") == 0 && hasValue) {
+            size_t mebibytes = 0;
+            if (!ParseCount(argv[++i], 0, SIZE_MAX >> 20, mebibytes)) {
+                std::cerr << "Error: invalid cache size " << argv[i] << "\n";
+                return 1;
+            }
+            batch.CacheBytes = serve.CacheBytes = mebibytes << 20;
+        } else if (std::strcmp(argv[i], "-o") == 0 && hasValue) {
+            batch.OutputPath = system.OutputPath = tabulate.OutputPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+            if (!ParseCount(argv[++i], 1, MAX_THREADS, threads)) {
+                std::cerr << "Error: invalid thread count " << argv[i] << ", expected 1 to "
+                          << MAX_THREADS << "\n";
+                return 1;
+            }
+            batch.Threads = serve.Threads = system.Threads = tabulate.Threads = threads;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if ((printStats || !metricsPath.empty()) && !ALGEBRA_STATS) {
+        std::cerr << "Error: built without statistics (ALGEBRA_STATS=OFF)\n";
+        return 1;
+    }
+    SetStatsEnabled(printStats || !metricsPath.empty());
+
+    int status = 0;
+    if (isBatch) {
+        batch.Numeric = numeric;
+        batch.Limits = limits;
+        batch.Format = format;
+        status = RunBatch(batch);
+    } else if (isServe) {
+        serve.Numeric = numeric;
+        serve.Limits = limits;
+        serve.Format = format;
+        serve.MetricsPath = metricsPath;
+        status = RunServer(serve);
+    } else if (isSystem) {
+        status = RunSystem(system);
+    } else if (isTabulate) {
+        status = RunTabulate(tabulate);
+    } else {
+        status = RunRepl(exitOnError, numeric, limits, format, threads);
+    }
+
+    if (printStats) {
+        WriteStats(Stats(), std::cerr);
+    }
+    if (!metricsPath.empty() && !WritePrometheusFile(metricsPath)) {
+        std::cerr << "Error: cannot write " << metricsPath << "\n";
+        return 1;
+    }
+    return status;
 }
@@ -0,0 +1,77 @@
+#include "mapped_file.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+    #define HAS_MMAP 1
+#endif
+
+MappedFile::~MappedFile() {
+    Close();
+}
+
+void MappedFile::Close() {
+#ifdef HAS_MMAP
+    if (m_Mapped) {
+        munmap(const_cast<char*>(m_Data), m_Size);
+    }
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Mapped = false;
+    m_Buffer.clear();
+}
+
+bool MappedFile::ReadStream(std::FILE* file) {
+    char block[64 * 1024];
+    size_t read;
+    while ((read = std::fread(block, 1, sizeof(block), file)) > 0) {
+        m_Buffer.append(block, read);
+    }
+    if (std::ferror(file)) {
+        return false;
+    }
+
+    m_Data = m_Buffer.data();
+    m_Size = m_Buffer.size();
+    return true;
+}
+
+bool MappedFile::Open(const std::string& path) {
+    Close();
+
+    if (path == "-") {
+        return ReadStream(stdin);
+    }
+
+#ifdef HAS_MMAP
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info {};
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+        void* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, size_t(info.st_size), MADV_SEQUENTIAL);
+            close(fd);
+            m_Data = static_cast<const char*>(data);
+            m_Size = size_t(info.st_size);
+            m_Mapped = true;
+            return true;
+        }
+    }
+    close(fd);
+#endif
+
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    const bool ok = ReadStream(file);
+    std::fclose(file);
+    return ok;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// Read-only view of a whole file. Regular files are memory-mapped where the platform allows it,
+// anything else (pipes, stdin as "-") is read into an owned buffer.
+class MappedFile {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    std::string_view View() const { return { m_Data, m_Size }; }
+
+  private:
+    bool ReadStream(std::FILE* file);
+    void Close();
+
+    const char* m_Data = nullptr;
+    size_t m_Size = 0;
+    bool m_Mapped = false;
+    std::string m_Buffer;
+};
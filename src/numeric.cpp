@@ -0,0 +1,380 @@
+#include "numeric.h"
+#include "budget.h"
+#include "compile.h"
+#include "thread_pool.h"
+#include "utils.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <optional>
+
+constexpr size_t SAMPLES_PER_SLICE = 4096;
+constexpr int MAX_POLISH_STEPS = 128;
+
+// A polished point only counts as a root when |f| is this small relative to the bracket ends,
+// which rejects poles and jumps that also change sign. A sample counts as zero when |f| is this
+// small relative to its terms.
+constexpr double RESIDUAL_TOLERANCE = 1e-9;
+
+struct Sample {
+    double X;
+    Dual F;
+    double Size;    // sum of the sizes of the terms of f, what its rounding is relative to
+    bool Underflow; // a product, quotient or power went to zero from nonzero operands
+};
+
+// Roots found in one slice of the samples, and how many samples were finite or zero
+struct SliceResult {
+    std::vector<double> Roots;
+    size_t Finite = 0;
+    size_t Zero = 0;
+    bool ZeroRun = false;  // two neighbouring samples are exactly zero
+    bool TimedOut = false; // not scanned, the deadline had passed
+};
+
+bool HasNumericFallback(ErrorCode code) {
+    switch (code) {
+        case ErrorCode::DegreeTooHigh:
+        case ErrorCode::DivisionByVariable:
+        case ErrorCode::VariableInFunction:
+        case ErrorCode::ExponentContainsVariable:
+        case ErrorCode::InvalidExponent:
+        case ErrorCode::IllConditioned: return true;
+        default: return false;
+    }
+}
+
+// The registers hold the values of the run, the sizes are built on them: a sum is as large as
+// its terms together, a product as the product of its factors' sizes
+static Sample Evaluate(const Program& program, double x) {
+    thread_local std::vector<Dual> registers;
+    thread_local std::vector<double> sizes;
+    thread_local std::vector<uint8_t> underflows;
+    registers.resize(program.Code.size());
+    sizes.resize(program.Code.size());
+    underflows.resize(program.Code.size());
+    const Dual f = ExecuteDual(program, {}, x, registers);
+
+    for (size_t i = 0; i < program.Code.size(); i++) {
+        const Instruction& ins = program.Code[i];
+        const double value = registers[i].Value;
+        // A product, quotient or power that is zero although its operands aren't
+        auto vanished = [&] {
+            const double a = registers[ins.Lhs].Value;
+            const double b = registers[ins.Rhs].Value;
+            return value == 0.0 && a != 0.0 && b != 0.0 && std::isfinite(b);
+        };
+        switch (ins.Op) {
+            case OpCode::Const:
+            case OpCode::Param:
+            case OpCode::Var:
+                sizes[i] = std::abs(value);
+                underflows[i] = false;
+                break;
+            case OpCode::Add:
+            case OpCode::Sub:
+                sizes[i] = sizes[ins.Lhs] + sizes[ins.Rhs];
+                underflows[i] = underflows[ins.Lhs] || underflows[ins.Rhs];
+                break;
+            case OpCode::Mul:
+                sizes[i] = sizes[ins.Lhs] * sizes[ins.Rhs];
+                underflows[i] = underflows[ins.Lhs] || underflows[ins.Rhs] || vanished();
+                break;
+            case OpCode::Div:
+                sizes[i] = sizes[ins.Lhs] / std::abs(registers[ins.Rhs].Value);
+                underflows[i] = underflows[ins.Lhs] || underflows[ins.Rhs] || vanished();
+                break;
+            case OpCode::Pow: {
+                // A constant power e carries the rounding of its base a along, e |a|^(e - 1) times
+                const double base = registers[ins.Lhs].Value;
+                const double exponent = registers[ins.Rhs].Value;
+                const double carried =
+                    program.Code[ins.Rhs].Op == OpCode::Const && exponent >= 1.0
+                        ? exponent * sizes[ins.Lhs] * std::pow(std::abs(base), exponent - 1.0)
+                        : 0.0;
+                sizes[i] = std::abs(value) + (std::isfinite(carried) ? carried : 0.0);
+                underflows[i] = underflows[ins.Lhs] || underflows[ins.Rhs] || vanished();
+                break;
+            }
+            case OpCode::Neg:
+                sizes[i] = sizes[ins.Lhs];
+                underflows[i] = underflows[ins.Lhs];
+                break;
+            case OpCode::Call:
+                sizes[i] = std::abs(value);
+                underflows[i] = underflows[ins.Lhs];
+                break;
+        }
+    }
+
+    const uint32_t output = program.Outputs[0];
+    return { x, f, sizes[output], bool(underflows[output]) };
+}
+
+static bool IsFinite(const Sample& sample) {
+    return std::isfinite(sample.F.Value);
+}
+
+// What the residual at a point between a and b is measured against: the values at the ends, or
+// the terms at the point itself where f is lost in their rounding
+static double Scale(const Sample& a, const Sample& b, const Sample& at) {
+    return std::max({ std::abs(a.F.Value), std::abs(b.F.Value), at.Size });
+}
+
+// Newton steps kept inside the bracket, a step that leaves it or doesn't halve |f| is replaced by
+// bisection. a and b have values of opposite sign.
+static std::optional<double> Polish(const Program& program, const Sample& a, const Sample& b) {
+    double negative = a.F.Value < 0.0 ? a.X : b.X;
+    double positive = a.F.Value < 0.0 ? b.X : a.X;
+
+    Sample current = Evaluate(program, 0.5 * (a.X + b.X));
+    double previous = std::numeric_limits<double>::infinity();
+    for (int step = 0; step < MAX_POLISH_STEPS && current.F.Value != 0.0; step++) {
+        if (std::isnan(current.F.Value)) {
+            return std::nullopt; // a hole in the domain
+        }
+        (current.F.Value < 0.0 ? negative : positive) = current.X;
+
+        const double lo = std::min(negative, positive);
+        const double hi = std::max(negative, positive);
+        const double newton = current.X - current.F.Value / current.F.Derivative;
+        const bool useNewton =
+            newton > lo && newton < hi && std::abs(current.F.Value) <= 0.5 * previous;
+        const double next = useNewton ? newton : 0.5 * (lo + hi);
+        if (next == current.X || next <= lo || next >= hi) {
+            break; // no representable point left between the ends
+        }
+
+        previous = std::abs(current.F.Value);
+        current = Evaluate(program, next);
+    }
+
+    if (!IsFinite(current) ||
+        !(std::abs(current.F.Value) <= RESIDUAL_TOLERANCE * Scale(a, b, current))) {
+        return std::nullopt;
+    }
+    return current.X;
+}
+
+// a and b have values of the same sign but slopes of opposite sign. Bisects on the slope to find
+// the extremum, which either crosses zero (two roots) or touches it (one).
+static void SearchExtremum(
+    const Program& program, const Sample& a, const Sample& b, std::vector<double>& roots) {
+    Sample lo = a;
+    Sample hi = b;
+    Sample middle = a;
+    for (int step = 0; step < MAX_POLISH_STEPS; step++) {
+        const double x = 0.5 * (lo.X + hi.X);
+        if (x <= lo.X || x >= hi.X) {
+            break;
+        }
+        middle = Evaluate(program, x);
+        if (!std::isfinite(middle.F.Derivative)) {
+            return;
+        }
+        ((middle.F.Derivative < 0.0) == (a.F.Derivative < 0.0) ? lo : hi) = middle;
+    }
+
+    if (!IsFinite(middle)) {
+        return;
+    } else if (middle.F.Value == 0.0) {
+        roots.push_back(middle.X);
+    } else if ((middle.F.Value < 0.0) != (a.F.Value < 0.0)) {
+        if (const auto root = Polish(program, a, middle)) {
+            roots.push_back(*root);
+        }
+        if (const auto root = Polish(program, middle, b)) {
+            roots.push_back(*root);
+        }
+    } else if (std::abs(middle.F.Value) <= RESIDUAL_TOLERANCE * Scale(a, b, middle)) {
+        roots.push_back(middle.X);
+    }
+}
+
+// Zero only because a term underflowed, e.g. x^1025 near 0, says nothing about f
+static bool IsUnderflow(const Sample& sample) {
+    return sample.F.Value == 0.0 && sample.Underflow;
+}
+
+// Where f stops underflowing between a point inside a stretch of underflow and one outside it
+static double StretchEdge(const Program& program, double inside, double outside) {
+    for (int step = 0; step < MAX_POLISH_STEPS; step++) {
+        const double x = 0.5 * (inside + outside);
+        if (x == inside || x == outside) {
+            break;
+        }
+        (IsUnderflow(Evaluate(program, x)) ? inside : outside) = x;
+    }
+    return inside;
+}
+
+static void CountSample(const Sample& sample, SliceResult& result) {
+    if (!IsFinite(sample) || IsUnderflow(sample)) {
+        return;
+    }
+    result.Finite++;
+    if (std::abs(sample.F.Value) <= RESIDUAL_TOLERANCE * sample.Size) {
+        result.Zero++;
+    }
+    if (sample.F.Value == 0.0) {
+        result.Roots.push_back(sample.X);
+    }
+}
+
+// Samples first..last-1 and the brackets they start, the final slice also has the last sample
+static void ScanSlice(const Program& program, const NumericOptions& options, size_t first,
+    size_t last, SliceResult& result) {
+    const double step = (options.Hi - options.Lo) / double(options.Samples - 1);
+    // Computed from the index instead of accumulated, so the error doesn't grow
+    auto sampleAt = [&](size_t i) {
+        const double x = i + 1 == options.Samples ? options.Hi : options.Lo + double(i) * step;
+        return Evaluate(program, x);
+    };
+
+    // A stretch where f underflows to zero holds a root, taken at its middle. The slice the
+    // stretch starts in finds it, sampling on past its end if need be.
+    bool inStretch = false;
+    double stretchStart = 0.0;
+    auto endStretch = [&](const Sample& inside, const Sample& right) {
+        if (IsFinite(right)) {
+            result.Roots.push_back(0.5 * (stretchStart + StretchEdge(program, inside.X, right.X)));
+        }
+        inStretch = false;
+    };
+
+    Sample left = sampleAt(first);
+    for (size_t i = first; i < last; i++) {
+        CountSample(left, result);
+
+        const Sample right = sampleAt(i + 1);
+        if (IsUnderflow(right) && !IsUnderflow(left) && IsFinite(left)) {
+            stretchStart = StretchEdge(program, right.X, left.X);
+            inStretch = true;
+        } else if (inStretch && !IsUnderflow(right)) {
+            endStretch(left, right);
+        }
+        result.ZeroRun |= left.F.Value == 0.0 && right.F.Value == 0.0 && !IsUnderflow(left) &&
+                          !IsUnderflow(right);
+        if (IsFinite(left) && IsFinite(right) && left.F.Value != 0.0 && right.F.Value != 0.0) {
+            if ((left.F.Value < 0.0) != (right.F.Value < 0.0)) {
+                if (const auto root = Polish(program, left, right)) {
+                    result.Roots.push_back(*root);
+                }
+            } else if ((left.F.Derivative < 0.0) != (right.F.Derivative < 0.0) &&
+                       left.F.Derivative != 0.0 && right.F.Derivative != 0.0) {
+                SearchExtremum(program, left, right, result.Roots);
+            }
+        }
+        left = right;
+    }
+    if (last + 1 == options.Samples) {
+        CountSample(left, result);
+    }
+    for (size_t i = last + 1; inStretch && i < options.Samples; i++) {
+        const Sample right = sampleAt(i);
+        if (!IsUnderflow(right)) {
+            endStretch(left, right);
+        }
+        left = right;
+    }
+}
+
+std::expected<void, SolveError> SolveNumeric(std::string_view equation,
+    const NumericOptions& options, Solutions& solutions, const SolveBudget* budget) {
+    solutions.Values.clear();
+    solutions.IsInfinite = false;
+    solutions.IsNone = false;
+
+    const auto program = CompileResidual(equation);
+    if (!program) {
+        return std::unexpected(program.error());
+    }
+
+    NumericOptions scan = options;
+    scan.Samples = std::max<size_t>(scan.Samples, 2);
+    const size_t pairs = scan.Samples - 1;
+    const size_t slices = (pairs + SAMPLES_PER_SLICE - 1) / SAMPLES_PER_SLICE;
+    std::vector<SliceResult> results(slices);
+
+    auto runSlice = [&](size_t k) {
+        if (budget && budget->PastDeadline()) {
+            results[k].TimedOut = true;
+            return;
+        }
+        const size_t first = k * SAMPLES_PER_SLICE;
+        ScanSlice(*program, scan, first, std::min(first + SAMPLES_PER_SLICE, pairs), results[k]);
+    };
+    if (options.Pool && slices > 1) {
+        options.Pool->RunAll(slices, runSlice);
+    } else {
+        for (size_t k = 0; k < slices; k++) {
+            runSlice(k);
+        }
+    }
+
+    size_t finite = 0;
+    size_t zero = 0;
+    bool zeroRun = false;
+    for (const SliceResult& result : results) {
+        if (result.TimedOut) {
+            solutions.Values.clear();
+            return std::unexpected(SolveError{ ErrorCode::Timeout, equation.size() });
+        }
+        finite += result.Finite;
+        zero += result.Zero;
+        zeroRun |= result.ZeroRun;
+        solutions.Values.insert(solutions.Values.end(), result.Roots.begin(), result.Roots.end());
+    }
+
+    // Zero at every sample, e.g. sin(x)^2 + cos(x)^2 = 1, or on a whole stretch, e.g. abs(x) = x
+    if ((finite > 0 && zero == finite) || zeroRun) {
+        solutions.Values.clear();
+        solutions.IsInfinite = true;
+        return {};
+    }
+
+    // The same root can come from two neighbouring brackets
+    std::vector<double>& roots = solutions.Values;
+    for (double& root : roots) {
+        if (std::abs(root) < EPS) { // a root at 0 is approached from either side
+            root = 0.0;
+        }
+    }
+    std::sort(roots.begin(), roots.end());
+    roots.erase(std::unique(roots.begin(), roots.end(),
+                    [](double a, double b) {
+                        return b - a <= RESIDUAL_TOLERANCE * std::max(1.0, std::abs(a));
+                    }),
+        roots.end());
+    solutions.IsNone = roots.empty();
+    return {};
+}
+
+bool ResidualsVanish(std::string_view equation, std::span<const double> roots) {
+    const auto program = CompileResidual(equation);
+    if (!program) {
+        return true; // the polynomial form parsed, nothing to check against
+    }
+    // A value that overflows can't be checked either
+    return std::none_of(roots.begin(), roots.end(), [&](double x) {
+        const Sample sample = Evaluate(*program, x);
+        return std::abs(sample.F.Value) > RESIDUAL_TOLERANCE * sample.Size &&
+               std::isfinite(sample.Size);
+    });
+}
+
+static bool ParseBound(std::string_view text, double& value) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc{} && result.ptr == text.data() + text.size() &&
+           std::isfinite(value);
+}
+
+bool ParseInterval(std::string_view spec, NumericOptions& options) {
+    const size_t colon = spec.find(':');
+    if (colon == std::string_view::npos) {
+        return false;
+    }
+    return ParseBound(spec.substr(0, colon), options.Lo) &&
+           ParseBound(spec.substr(colon + 1), options.Hi) && options.Lo < options.Hi;
+}
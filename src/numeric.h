@@ -0,0 +1,24 @@
+#pragma once
+
+#include "solver.h"
+#include <string_view>
+
+class SolveBudget;
+
+// True for the analysis errors that only mean the equation has no polynomial form, or one whose
+// roots are lost in the rounding of its coefficients
+bool HasNumericFallback(ErrorCode code);
+
+// Whether lhs - rhs, as written rather than expanded, vanishes at each of the roots within the
+// rounding of its terms. Checks the roots found on the polynomial form.
+bool ResidualsVanish(std::string_view equation, std::span<const double> roots);
+
+// Finds the roots of lhs - rhs in [options.Lo, options.Hi]: the interval is sampled for sign
+// changes, with derivatives from dual numbers, and every bracket is polished with safeguarded
+// Newton steps. Roots where the curve only touches zero are found from sign changes of the
+// derivative. Past the deadline of budget the scan stops with a Timeout.
+std::expected<void, SolveError> SolveNumeric(std::string_view equation,
+    const NumericOptions& options, Solutions& solutions, const SolveBudget* budget = nullptr);
+
+// Reads an interval given as "<lo>:<hi>"
+bool ParseInterval(std::string_view spec, NumericOptions& options);
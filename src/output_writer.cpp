@@ -0,0 +1,55 @@
+#include "output_writer.h"
+#include <cstring>
+
+OutputWriter::OutputWriter(size_t bufferSize)
+    : m_File(stdout), m_Owned(false), m_Failed(false), m_Buffer(bufferSize), m_Used(0) {}
+
+OutputWriter::~OutputWriter() {
+    Flush();
+    if (m_Owned) {
+        std::fclose(m_File);
+    }
+}
+
+bool OutputWriter::Open(const std::string& path) {
+    Flush();
+    if (m_Owned) {
+        std::fclose(m_File);
+    }
+
+    m_File = stdout;
+    m_Owned = false;
+    if (!path.empty() && path != "-") {
+        m_File = std::fopen(path.c_str(), "wb");
+        if (!m_File) {
+            m_File = stdout;
+            return false;
+        }
+        m_Owned = true;
+    }
+
+    // We do our own buffering, don't copy everything a second time inside stdio
+    std::setvbuf(m_File, nullptr, _IONBF, 0);
+    return true;
+}
+
+void OutputWriter::Write(std::string_view data) {
+    if (data.size() > m_Buffer.size() - m_Used) {
+        Flush();
+        if (data.size() >= m_Buffer.size()) {
+            m_Failed |= std::fwrite(data.data(), 1, data.size(), m_File) != data.size();
+            return;
+        }
+    }
+
+    std::memcpy(m_Buffer.data() + m_Used, data.data(), data.size());
+    m_Used += data.size();
+}
+
+bool OutputWriter::Flush() {
+    if (m_Used > 0) {
+        m_Failed |= std::fwrite(m_Buffer.data(), 1, m_Used, m_File) != m_Used;
+        m_Used = 0;
+    }
+    return !m_Failed;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Block-buffered writer, output only reaches the file once a full buffer is pending.
+class OutputWriter {
+  public:
+    explicit OutputWriter(size_t bufferSize = 1024 * 1024);
+    ~OutputWriter();
+
+    OutputWriter(const OutputWriter&) = delete;
+    OutputWriter& operator=(const OutputWriter&) = delete;
+
+    bool Open(const std::string& path); // empty or "-" writes to stdout
+
+    void Write(std::string_view data);
+    bool Flush();
+
+  private:
+    std::FILE* m_File;
+    bool m_Owned;
+    bool m_Failed;
+    std::vector<char> m_Buffer;
+    size_t m_Used;
+};
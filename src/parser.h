@@ -1,93 +1,508 @@
 #pragma once
 
+#include "budget.h"
+#include "builtins.h"
 #include "tokenizer.h"
 #include "utils.h"
+#include <bit>
+#include <optional>
+#include <span>
 
-enum class BinaryOp {
-    Add = (int)TokenType::PLUS,
-    Sub = (int)TokenType::MINUS,
-    Mul = (int)TokenType::STAR,
-    Div = (int)TokenType::FSLASH,
-    Pow = (int)TokenType::CARET,
+enum class NodeTag : uint8_t {
+    Number,    // Lhs indexes Ast::Literals
+    Variable,  // Lhs is the id in the table given to SetVariableTable(), 0 otherwise
+    Parameter, // Lhs is the parameter index, see Compile()
+    Neg,       // Lhs is the operand
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Pow,
+    Call, // Fn applied to Lhs
 };
-enum class UnaryOp { None = -1, Neg = (int)TokenType::MINUS };
-enum class FunctionType { Sin, Cos, Tan, Asin, Acos, Atan, Log, Ln, Sqrt, Floor, Ceil, Abs };
-
-struct AdditiveExpression;
-struct FunctionCall;
-
-struct Primary {
-    explicit Primary(double d) : Value(d) {}
-    explicit Primary(const std::string& s) : Value(s) {}
-    explicit Primary(AdditiveExpression* e) : Value(e) {}
-    explicit Primary(FunctionCall* f) : Value(f) {}
-    std::variant<double, std::string, AdditiveExpression*, FunctionCall*> Value;
-};
-struct UnaryExpression {
-    UnaryExpression(UnaryOp o, Primary* p) : Op(o), Expr(p) {}
-    UnaryExpression(UnaryOp o, UnaryExpression* u) : Op(o), Expr(u) {}
-    UnaryOp Op;
-    std::variant<Primary*, UnaryExpression*> Expr;
-};
-struct PowerExpression {
-    explicit PowerExpression(UnaryExpression* u, PowerExpression* e = nullptr)
-        : Base(u), Exponent(e) {}
-    UnaryExpression* Base;
-    PowerExpression* Exponent;
-};
-struct MultiplicativeExpression {
-    explicit MultiplicativeExpression(PowerExpression* e) : Left(e) {}
-    PowerExpression* Left;
-    std::vector<std::pair<BinaryOp, PowerExpression*>> Right;
-};
-struct AdditiveExpression {
-    explicit AdditiveExpression(MultiplicativeExpression* e) : Left(e) {}
-    MultiplicativeExpression* Left;
-    std::vector<std::pair<BinaryOp, MultiplicativeExpression*>> Right;
-};
-struct FunctionCall {
-    FunctionCall(FunctionType t, AdditiveExpression* expr) : Fn(t), Argument(expr) {}
-    FunctionType Fn;
-    AdditiveExpression* Argument;
+
+struct Node {
+    NodeTag Tag;
+    FunctionType Fn; // Call only
+    uint32_t Lhs;
+    uint32_t Rhs;
+    uint32_t Offset;    // where the subexpression starts in the source, used for errors
+    uint32_t RhsOffset; // where Rhs starts here, for errors about it, Rhs may be shared
 };
-struct Equation {
-    Equation(AdditiveExpression* l, AdditiveExpression* r) : Lhs(l), Rhs(r) {}
-    AdditiveExpression* Lhs;
-    AdditiveExpression* Rhs;
+
+constexpr uint32_t NO_NODE = UINT32_MAX;
+
+// Nodes are stored in post-order: every child comes before its parents, so a pass over the tree is
+// a single forward scan where the results of the children are already known. Equal subexpressions
+// share one node, which makes the tree a DAG and lets a pass compute each of them once. A shared
+// node keeps the offsets of its first occurrence, which is also where a pass finds its errors
+// first.
+struct Ast {
+    constexpr explicit Ast(ArenaAllocator* arena) : Nodes(arena), Literals(arena) {}
+    ArenaVector<Node> Nodes;
+    ArenaVector<double> Literals;
+    uint32_t Lhs = NO_NODE;
+    uint32_t Rhs = NO_NODE; // NO_NODE for a plain expression
 };
 
+// Pulls tokens from the lexer one at a time, there is no token list and identifiers stay views
+// into the source. Everything is constexpr so SolveStatic() can parse at compile time, the arena
+// is nullptr then.
 class Parser {
   public:
-    Parser(const std::vector<Token>& tokens);
-    Equation* ParseEquation();
+    // Identifiers listed in params become Parameter nodes instead of the variable
+    constexpr Parser(Tokenizer& lexer, ArenaAllocator* allocator,
+        std::span<const std::string_view> params = {})
+        : m_Lexer(lexer), m_Current(TokenType::END_OF_FILE, 0), m_Ast(allocator), m_Error{},
+          m_Stack(allocator), m_NodeTable(allocator), m_Constants(allocator),
+          m_Identifiers(allocator), m_ParamCount(uint32_t(params.size())),
+          m_Variable(Interner::NO_ID) {
+        for (std::string_view param : params) {
+            m_Identifiers.Intern(param);
+        }
+    }
+
+    // The tree is owned by the parser, its storage by the arena
+    constexpr std::expected<Ast*, SolveError> ParseEquation() {
+        Start();
+
+        m_Ast.Lhs = ParseAdditiveExpression();
+        if (m_Ast.Lhs == NO_NODE || !Expect(TokenType::EQUAL, ErrorCode::ExpectedEqual)) {
+            return std::unexpected(m_Error);
+        }
+        m_Ast.Rhs = ParseAdditiveExpression();
+        if (m_Ast.Rhs == NO_NODE) {
+            return std::unexpected(m_Error);
+        }
+        if (!Match(TokenType::END_OF_FILE)) {
+            Fail(ErrorCode::TrailingInput);
+            return std::unexpected(m_Error);
+        }
+        return &m_Ast;
+    }
+
+    // No '=' side
+    constexpr std::expected<Ast*, SolveError> ParseExpression() {
+        Start();
+
+        m_Ast.Lhs = ParseAdditiveExpression();
+        if (m_Ast.Lhs == NO_NODE) {
+            return std::unexpected(m_Error);
+        }
+        if (!Match(TokenType::END_OF_FILE)) {
+            Fail(ErrorCode::TrailingInput);
+            return std::unexpected(m_Error);
+        }
+        return &m_Ast;
+    }
+
+    // Evaluates operations on constants while parsing, the way Analyzer would, so 2sin(30)x parses
+    // as 1 * x. Operations the analysis rejects, such as 1/0, are kept for it to report.
+    constexpr void SetFoldConstants(bool fold) { m_FoldConstants = fold; }
+
+    // Only this identifier is accepted as the variable
+    constexpr void SetVariable(std::string_view name) { m_Variable = m_Identifiers.Intern(name); }
+
+    // Accepts any number of variables, their ids come from variables, which can be shared by the
+    // parsers of several equations
+    constexpr void SetVariableTable(Interner* variables) { m_Variables = variables; }
+
+    // Every node and pending operator is counted against budget, give the tokenizer the same one
+    constexpr void SetBudget(SolveBudget* budget) { m_Budget = budget; }
+
+    // Tokens read by the last parse, END_OF_FILE included
+    constexpr size_t TokenCount() const { return m_TokenCount; }
+
+    // The variable the last parse settled on, empty without one or with a variable table. Points
+    // into the source.
+    constexpr std::string_view VariableName() const {
+        return m_Variable == Interner::NO_ID ? std::string_view() : m_Identifiers.Name(m_Variable);
+    }
 
   private:
-    Primary* ParsePrimary();
-    UnaryExpression* ParseUnaryExpression();
-    PowerExpression* ParsePowerExpression();
-    MultiplicativeExpression* ParseMultiplicativeExpression();
-    AdditiveExpression* ParseAdditiveExpression();
+    enum class FrameKind : uint8_t {
+        Neg,   // a unary minus waiting for its operand
+        Pow,   // Lhs ^ the power being parsed
+        Mul,   // Lhs * or / the power being parsed, Tag says which
+        Add,   // Lhs + or - the product being parsed, Tag says which
+        Paren, // inside parentheses
+        Call,  // inside the parentheses of a call of Fn
+    };
+
+    struct Frame {
+        FrameKind Kind;
+        NodeTag Tag;
+        FunctionType Fn;
+        uint32_t Lhs;
+        uint32_t Offset; // of the node the frame turns into
+        uint32_t Start;  // Paren and Call, where the operand holding the parentheses started
+    };
+
+    // Precedence climbing over an explicit stack, so nesting depth costs memory rather than native
+    // stack. It builds the same nodes in the same order as recursive descent over
+    //     additive := product (('+' | '-') product)*
+    //     product  := power (('*' | '/' | implicit) power)*
+    //     power    := unary ('^' power)?
+    //     unary    := ('+' | '-') unary | primary
+    //     primary  := number | identifier | identifier '(' additive ')' | '(' additive ')'
+    // would, including the offsets. Unary minus binds tighter than '^', -x^2 is (-x)^2.
+    constexpr uint32_t ParseAdditiveExpression() {
+        m_Stack.clear();
+
+        while (true) {
+            // One operand: its signs, then a primary. Parentheses start over inside them.
+            uint32_t start = uint32_t(m_Current.Offset);
+            while (Match(TokenType::PLUS, TokenType::MINUS)) {
+                const Token sign = Consume(); // unary + does nothing
+                if (sign.Type == TokenType::MINUS) {
+                    Push(FrameKind::Neg, NodeTag::Neg, NO_NODE, sign.Offset);
+                }
+            }
+
+            uint32_t expr = NO_NODE;
+            uint32_t exprOffset = start; // the offset the node of expr has, or would have unshared
+            if (Match(TokenType::END_OF_FILE)) {
+                return Fail(ErrorCode::ExpectedPrimary);
+            } else if (Match(TokenType::NUMBER)) {
+                const Token token = Consume();
+                expr = AddConstant(token.Number, token.Offset);
+                exprOffset = uint32_t(token.Offset);
+            } else if (Match(TokenType::IDENTIFIER)) {
+                const Token token = Consume();
+                const Builtin* builtin = FindBuiltin(token.Text);
+
+                if (Match(TokenType::LPAREN)) {
+                    if (!builtin || builtin->Kind != BuiltinKind::Function) {
+                        return FailAt(ErrorCode::UnknownFunction, token.Offset);
+                    }
+                    Advance();
+                    Push(FrameKind::Call, NodeTag::Call, NO_NODE, token.Offset, start, builtin->Fn);
+                    continue;
+                }
+
+                expr = ParseIdentifier(token, builtin);
+                if (expr == NO_NODE) {
+                    return NO_NODE;
+                }
+                exprOffset = uint32_t(token.Offset);
+            } else if (Match(TokenType::LPAREN)) {
+                Advance();
+                Push(FrameKind::Paren, NodeTag::Add, NO_NODE, 0, start);
+                continue;
+            } else {
+                return Fail(ErrorCode::UnexpectedToken);
+            }
+
+            // expr is a whole primary. Reduce what waited for it, then either push the operator
+            // after it and read the next operand, or close a group, which completes a primary of
+            // the enclosing expression.
+            while (true) {
+                while (Top(FrameKind::Neg)) {
+                    exprOffset = m_Stack.back().Offset;
+                    expr = Apply(NodeTag::Neg, exprOffset, expr);
+                    m_Stack.pop_back();
+                }
+
+                if (Match(TokenType::CARET)) { // right associative, reduced once the chain ends
+                    Advance();
+                    Push(FrameKind::Pow, NodeTag::Pow, expr, start);
+                    break;
+                }
+                while (Top(FrameKind::Pow)) {
+                    expr = Reduce(expr, exprOffset, start);
+                }
+
+                if (Top(FrameKind::Mul)) {
+                    expr = Reduce(expr, exprOffset, start);
+                }
+                if (Match(TokenType::STAR, TokenType::FSLASH, TokenType::NUMBER,
+                        TokenType::IDENTIFIER, TokenType::LPAREN)) {
+                    NodeTag tag = NodeTag::Mul; // implicit multiplication, eg. 3x
+                    if (Match(TokenType::STAR, TokenType::FSLASH)) {
+                        tag = Consume().Type == TokenType::STAR ? NodeTag::Mul : NodeTag::Div;
+                    }
+                    Push(FrameKind::Mul, tag, expr, start);
+                    break;
+                }
+
+                if (Top(FrameKind::Add)) {
+                    expr = Reduce(expr, exprOffset, start);
+                }
+                if (Match(TokenType::PLUS, TokenType::MINUS)) {
+                    const NodeTag tag =
+                        Consume().Type == TokenType::PLUS ? NodeTag::Add : NodeTag::Sub;
+                    Push(FrameKind::Add, tag, expr, start);
+                    break;
+                }
+
+                if (m_Stack.empty()) {
+                    return Materialize(expr);
+                }
+                const Frame group = m_Stack.back(); // Paren or Call
+                m_Stack.pop_back();
+                if (!Expect(TokenType::RPAREN, ErrorCode::ExpectedRParen)) {
+                    return NO_NODE;
+                }
+                if (group.Kind == FrameKind::Call) {
+                    expr = Apply(NodeTag::Call, group.Offset, expr, 0, 0, group.Fn);
+                    exprOffset = group.Offset;
+                } // parentheses only group, they don't need a node
+                start = group.Start;
+            }
+        }
+    }
+
+    constexpr uint32_t ParseIdentifier(const Token& token, const Builtin* builtin) {
+        const uint32_t id = m_Identifiers.Intern(token.Text);
+        if (id < m_ParamCount) {
+            return AddNode(NodeTag::Parameter, token.Offset, id);
+        } else if (builtin && builtin->Kind == BuiltinKind::Constant) {
+            return AddConstant(builtin->Value, token.Offset);
+        }
+
+        if (m_Variables) {
+            return AddNode(NodeTag::Variable, token.Offset, m_Variables->Intern(token.Text));
+        } else if (m_Variable == Interner::NO_ID) {
+            m_Variable = id;
+        } else if (m_Variable != id) {
+            return FailAt(ErrorCode::MoreThanOneVariable, token.Offset);
+        }
+        return AddNode(NodeTag::Variable, token.Offset);
+    }
+
+    constexpr void Push(FrameKind kind, NodeTag tag, uint32_t lhs, size_t offset,
+        uint32_t start = 0, FunctionType fn = FunctionType::Sin) {
+        m_Stack.push_back({ kind, tag, fn, lhs, uint32_t(offset), start });
+        if (m_Budget) {
+            const size_t limit = m_Budget->Limits().MaxDepth;
+            if (limit && m_Stack.size() > limit) {
+                Stop(ErrorCode::NestingTooDeep, m_Current.Offset); // the operand nested too deep
+            }
+        }
+    }
+
+    constexpr bool Top(FrameKind kind) const {
+        return !m_Stack.empty() && m_Stack.back().Kind == kind;
+    }
 
-    Token Consume() { return m_Tokens[m_Index++]; }
+    // Pops a binary operator frame with rhs as its right operand, the result starts where its left
+    // operand did
+    constexpr uint32_t Reduce(uint32_t rhs, uint32_t& rhsOffset, uint32_t& start) {
+        const Frame frame = m_Stack.back();
+        m_Stack.pop_back();
+        const uint32_t node = Apply(frame.Tag, frame.Offset, frame.Lhs, rhs, rhsOffset);
+        start = rhsOffset = frame.Offset;
+        return node;
+    }
+
+    // With folding, constants stay out of the tree as CONSTANT | index into m_Constants until an
+    // operation that can't be folded needs them as a node. Folded subtrees leave nothing behind.
+    static constexpr uint32_t CONSTANT = 1u << 31;
+
+    struct PendingConstant {
+        double Value;
+        uint32_t Offset;
+    };
+
+    constexpr uint32_t AddConstant(double value, size_t offset) {
+        if (!m_FoldConstants) {
+            return AddNumber(value, offset);
+        }
+        m_Constants.push_back({ value, uint32_t(offset) });
+        return CONSTANT | uint32_t(m_Constants.size() - 1);
+    }
+
+    constexpr uint32_t Materialize(uint32_t operand) {
+        if (!(operand & CONSTANT)) {
+            return operand;
+        }
+        const PendingConstant constant = m_Constants[operand & ~CONSTANT];
+        return AddNumber(constant.Value, constant.Offset);
+    }
+
+    // Builds an operation node, or folds it when the operands are constants
+    constexpr uint32_t Apply(NodeTag tag, size_t offset, uint32_t lhs, uint32_t rhs = 0,
+        uint32_t rhsOffset = 0, FunctionType fn = FunctionType::Sin) {
+        const bool unary = tag == NodeTag::Neg || tag == NodeTag::Call;
+        if ((lhs & CONSTANT) && (unary || (rhs & CONSTANT))) {
+            const double l = m_Constants[lhs & ~CONSTANT].Value;
+            const double r = unary ? 0.0 : m_Constants[rhs & ~CONSTANT].Value;
+            if (const std::optional<double> value = Fold(tag, fn, l, r)) {
+                return AddConstant(*value, offset);
+            }
+        }
+        lhs = Materialize(lhs);
+        rhs = unary ? rhs : Materialize(rhs);
+        return AddNode(tag, offset, lhs, rhs, fn, rhsOffset);
+    }
+
+    // The value Analyzer gives the operation on constants, nullopt where it reports an error
+    static constexpr std::optional<double> Fold(NodeTag tag, FunctionType fn, double l, double r) {
+        switch (tag) {
+            case NodeTag::Neg: return -l;
+            case NodeTag::Add: return l + r;
+            case NodeTag::Sub: return l - r;
+            case NodeTag::Mul: return l * r;
+            case NodeTag::Div: return r == 0 ? std::nullopt : std::optional(l / r);
+            case NodeTag::Pow: return ConstantPower(l, r);
+            case NodeTag::Call: {
+                const auto value = ApplyFunction(fn, l);
+                return value ? std::optional(*value) : std::nullopt;
+            }
+            default: return std::nullopt;
+        }
+    }
+
+    static constexpr size_t MIN_NODE_TABLE = 64; // slots of the hash-cons table, a power of two
+
+    // Appends the node, or returns the equal node added before
+    constexpr uint32_t AddNode(NodeTag tag, size_t offset, uint32_t lhs = 0, uint32_t rhs = 0,
+        FunctionType fn = FunctionType::Sin, uint32_t rhsOffset = 0) {
+        const Node node{ tag, fn, lhs, rhs, uint32_t(offset), rhsOffset };
+
+        // Keep the load factor under 1/2
+        if ((m_Ast.Nodes.size() + 1) * 2 > m_NodeTable.size()) {
+            GrowNodeTable();
+        }
+        const size_t slot = NodeSlot(node);
+        if (m_NodeTable[slot] == NO_NODE) {
+            m_NodeTable[slot] = uint32_t(m_Ast.Nodes.size());
+            m_Ast.Nodes.push_back(node);
+            if (m_Budget) {
+                ChargeNode(offset);
+            }
+        }
+        return m_NodeTable[slot];
+    }
+
+    constexpr uint32_t AddNumber(double value, size_t offset) {
+        m_Ast.Literals.push_back(value);
+        const uint32_t node = AddNode(NodeTag::Number, offset, uint32_t(m_Ast.Literals.size() - 1));
+        if (m_Ast.Nodes[node].Lhs != m_Ast.Literals.size() - 1) {
+            m_Ast.Literals.pop_back(); // the value had a node already
+        }
+        return node;
+    }
+
+    // Numbers are compared by the bits of their value, everything else by operands
+    constexpr uint64_t NodeKey(const Node& node) const {
+        if (node.Tag == NodeTag::Number) {
+            return std::bit_cast<uint64_t>(m_Ast.Literals[node.Lhs]);
+        }
+        return uint64_t(node.Lhs) << 32 | node.Rhs;
+    }
+
+    constexpr bool SameNode(const Node& a, const Node& b) const {
+        return a.Tag == b.Tag && a.Fn == b.Fn && NodeKey(a) == NodeKey(b);
+    }
+
+    // Slot holding a node equal to node, or the empty slot where it would go
+    constexpr size_t NodeSlot(const Node& node) const {
+        // Small whole numbers only have high bits set, they are folded down before mixing
+        uint64_t hash = NodeKey(node);
+        hash = (hash ^ hash >> 32 ^ (uint64_t(node.Tag) << 8 | uint64_t(node.Fn))) *
+               0x9E3779B97F4A7C15ull;
+        hash ^= hash >> 32;
+
+        const size_t mask = m_NodeTable.size() - 1;
+        size_t slot = size_t(hash) & mask;
+        while (m_NodeTable[slot] != NO_NODE && !SameNode(m_Ast.Nodes[m_NodeTable[slot]], node)) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    constexpr void GrowNodeTable() {
+        m_NodeTable.assign(std::max(MIN_NODE_TABLE, m_NodeTable.size() * 2), NO_NODE);
+        for (uint32_t i = 0; i < m_Ast.Nodes.size(); i++) {
+            m_NodeTable[NodeSlot(m_Ast.Nodes[i])] = i;
+        }
+    }
+
+    constexpr void Start() { // loads the first token
+        m_Ast.Nodes.clear();
+        m_Ast.Literals.clear();
+        // Starts small and doubles with the node count in AddNode, the source length says little
+        // about it: spaces, long literals and repeated subexpressions add no nodes
+        m_NodeTable.assign(MIN_NODE_TABLE, NO_NODE);
+        m_Constants.clear();
+        m_TokenCount = 0;
+        Advance();
+    }
+
+    constexpr void Advance() {
+        m_TokenCount++;
+        auto token = m_Lexer.Next();
+        if (token) {
+            m_Current = *token;
+        } else {
+            m_Error = token.error();
+            m_Current = Token(TokenType::INVALID, token.error().Offset);
+        }
+    }
+
+    constexpr Token Consume() {
+        const Token token = m_Current;
+        Advance();
+        return token;
+    }
 
     template <typename... Args>
-    bool Match(TokenType first, Args... rest) {
-        if (((m_Tokens[m_Index].Type == first) || ... || (m_Tokens[m_Index].Type == rest))) {
-            return true;
+    constexpr bool Match(TokenType first, Args... rest) const {
+        return ((m_Current.Type == first) || ... || (m_Current.Type == rest));
+    }
+
+    constexpr bool Expect(TokenType type, ErrorCode code) {
+        if (m_Current.Type != type) {
+            Fail(code);
+            return false;
+        }
+        Advance();
+        return true;
+    }
+
+    // Records the error, the Parse* functions then unwind by returning NO_NODE. A lexer error
+    // takes precedence, it is what made the parser stop.
+    constexpr uint32_t Fail(ErrorCode code) { return FailAt(code, m_Current.Offset); }
+    constexpr uint32_t FailAt(ErrorCode code, size_t offset) {
+        if (m_Current.Type != TokenType::INVALID) {
+            m_Error = { code, offset };
+        }
+        return NO_NODE;
+    }
+
+    // The node just added is still returned, the parse unwinds once it looks at the next token
+    void ChargeNode(size_t offset) {
+        const size_t limit = m_Budget->Limits().MaxNodes;
+        if (limit && m_Ast.Nodes.size() > limit) {
+            Stop(ErrorCode::TooManyNodes, offset);
+        } else if (const std::optional<ErrorCode> code = m_Budget->Check()) {
+            Stop(*code, offset);
         }
-        return false;
     }
 
-    Token Expect(TokenType type) {
-        if (m_Tokens[m_Index].Type != type) {
-            Error("Expected " + std::to_string(int(type)));
+    // Ends the parse on a limit the way a lexer error does: the current token becomes INVALID,
+    // which nothing matches, and the error is kept over the ones that follow from it
+    constexpr void Stop(ErrorCode code, size_t offset) {
+        if (m_Current.Type != TokenType::INVALID) {
+            m_Error = { code, offset };
+            m_Current = Token(TokenType::INVALID, offset);
         }
-        return Consume();
     }
 
-    const std::vector<Token>& m_Tokens;
-    size_t m_Index;
-    ArenaAllocator m_Allocator;
+    Tokenizer& m_Lexer;
+    Token m_Current;
+    Ast m_Ast;
+    SolveError m_Error;
+    ArenaVector<Frame> m_Stack; // operators and groups waiting for their operands
+    ArenaVector<uint32_t> m_NodeTable; // open addressing, node indices or NO_NODE
+    ArenaVector<PendingConstant> m_Constants;
+    bool m_FoldConstants = false;
 
-    std::string m_Variable;
+    Interner m_Identifiers; // parameters get the first ids, so id == parameter index
+    uint32_t m_ParamCount;
+    uint32_t m_Variable;
+    Interner* m_Variables = nullptr;
+    uint32_t m_TokenCount = 0;
+    SolveBudget* m_Budget = nullptr;
 };
@@ -0,0 +1,978 @@
+#pragma once
+
+#include "budget.h"
+#include "solver.h"
+#include "static_math.h"
+#include "utils.h"
+#include <algorithm>
+#include <complex>
+#include <limits>
+#include <numbers>
+#include <optional>
+#include <span>
+
+// Kernels on dense polynomials, coefficient i multiplies x^i. All constexpr for SolveStatic(),
+// scratch memory comes from the arena (nullptr during constant evaluation).
+
+constexpr uint32_t MAX_DEGREE = 1024;      // larger polynomials are a DegreeTooHigh error
+constexpr size_t KARATSUBA_THRESHOLD = 32; // shorter operands use the schoolbook product
+constexpr double KARATSUBA_SPREAD = 0x1p8; // largest over smallest coefficient it is used up to
+
+// out[k] = sum of a[i] b[k - i], out has na + nb - 1 entries. The terms are added from the
+// highest power of a down.
+constexpr void MultiplySchoolbook(
+    const double* a, size_t na, const double* b, size_t nb, double* out) {
+    for (size_t k = 0; k < na + nb - 1; k++) {
+        const size_t first = k < nb ? 0 : k - nb + 1;
+        const size_t last = k < na ? k : na - 1;
+        double sum = a[last] * b[k - last];
+        for (size_t i = last; i-- > first;) {
+            sum += a[i] * b[k - i];
+        }
+        out[k] = sum;
+    }
+}
+
+// Product of two polynomials with n coefficients each into out[0, 2n - 1), scratch needs 4n + 64
+// doubles. Three half size products instead of four: (a0 + a1)(b0 + b1) - a0 b0 - a1 b1 is the
+// middle term.
+constexpr void MultiplyKaratsuba(const double* a, const double* b, size_t n, double* out,
+    double* scratch) {
+    if (n < KARATSUBA_THRESHOLD) {
+        MultiplySchoolbook(a, n, b, n, out);
+        return;
+    }
+
+    const size_t m = n / 2; // low half, the high half has h >= m coefficients
+    const size_t h = n - m;
+    double* sumA = scratch;
+    double* sumB = scratch + h;
+    double* middle = scratch + 2 * h;
+    double* next = scratch + 4 * h;
+
+    MultiplyKaratsuba(a, b, m, out, next);                 // out[0, 2m - 1)
+    out[2 * m - 1] = 0.0;
+    MultiplyKaratsuba(a + m, b + m, h, out + 2 * m, next); // out[2m, 2n - 1)
+
+    for (size_t i = 0; i < h; i++) {
+        sumA[i] = a[m + i] + (i < m ? a[i] : 0.0);
+        sumB[i] = b[m + i] + (i < m ? b[i] : 0.0);
+    }
+    MultiplyKaratsuba(sumA, sumB, h, middle, next);
+
+    for (size_t i = 0; i < 2 * m - 1; i++) {
+        middle[i] -= out[i];
+    }
+    for (size_t i = 0; i < 2 * h - 1; i++) {
+        middle[i] -= out[2 * m + i];
+    }
+    for (size_t i = 0; i < 2 * h - 1; i++) {
+        out[m + i] += middle[i];
+    }
+}
+
+// Karatsuba's middle term cancels, which leaves each coefficient of the product only as accurate
+// as the largest ones near it. That is fine while all coefficients are of one size, otherwise the
+// small ones are lost, (x + 1)^100 came out with relative errors of 1e-9.
+constexpr bool KaratsubaAccurate(const double* a, size_t na) {
+    double smallest = std::numeric_limits<double>::infinity();
+    double largest = 0.0;
+    for (size_t i = 0; i < na; i++) {
+        smallest = std::min(smallest, MathAbs(a[i]));
+        largest = std::max(largest, MathAbs(a[i]));
+    }
+    return largest <= KARATSUBA_SPREAD * smallest;
+}
+
+constexpr size_t MultiplyScratchSize(size_t na, size_t nb) {
+    return 7 * std::min(na, nb) + 64;
+}
+
+// out[0, na + nb - 1) = a * b, scratch holds MultiplyScratchSize(na, nb) doubles. The longer
+// operand is cut into blocks as long as the shorter one, each block is a balanced Karatsuba
+// product when that keeps the accuracy.
+constexpr void MultiplyPolynomials(
+    const double* a, size_t na, const double* b, size_t nb, double* out, double* scratch) {
+    if (na < nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    if (nb < KARATSUBA_THRESHOLD || !KaratsubaAccurate(a, na) || !KaratsubaAccurate(b, nb)) {
+        MultiplySchoolbook(a, na, b, nb, out);
+        return;
+    }
+
+    double* block = scratch;
+    double* product = scratch + nb;
+    double* next = product + 2 * nb;
+
+    std::fill_n(out, na + nb - 1, 0.0);
+    for (size_t start = 0; start < na; start += nb) {
+        const size_t count = std::min(nb, na - start);
+        std::copy_n(a + start, count, block);
+        std::fill_n(block + count, nb - count, 0.0);
+
+        MultiplyKaratsuba(block, b, nb, product, next);
+        for (size_t i = 0; i < count + nb - 1; i++) {
+            out[start + i] += product[i];
+        }
+    }
+}
+
+using Complex = std::complex<double>;
+
+// Error-free transformations: a + b = s + error and a * b = p + error exactly. The product splits
+// the operands Dekker's way instead of using fma, which is not constexpr.
+constexpr double TwoSum(double a, double b, double& error) {
+    const double s = a + b;
+    const double bb = s - a;
+    error = (a - (s - bb)) + (b - bb);
+    return s;
+}
+
+constexpr double TwoProduct(double a, double b, double& error) {
+    constexpr double SPLITTER = 134217729.0; // 2^27 + 1
+    const double ca = SPLITTER * a;
+    const double ah = ca - (ca - a);
+    const double al = a - ah;
+    const double cb = SPLITTER * b;
+    const double bh = cb - (cb - b);
+    const double bl = b - bh;
+    const double p = a * b;
+    error = ((ah * bh - p) + ah * bl + al * bh) + al * bl;
+    return p;
+}
+
+// Horner's rule with the rounding error of every step recovered exactly and summed by a second
+// Horner pass, about as accurate as plain Horner with twice the precision. Needed for expanded
+// forms like (x + 1)^40, whose terms cancel badly away from the origin. coefficient(m) gives the
+// w^m coefficient as an unevaluated sum hi + lo, magnitude is sum |c_m| |w|^m.
+template <typename Coefficient>
+constexpr Complex CompensatedHorner(
+    size_t degree, Coefficient coefficient, Complex w, double& magnitude) {
+    const double wr = w.real();
+    const double wi = w.imag();
+    const double size = MathSqrt(std::norm(w));
+
+    double lo = 0.0;
+    double re = coefficient(degree, lo);
+    double im = 0.0;
+    double errorRe = lo;
+    double errorIm = 0.0;
+    magnitude = MathAbs(re);
+
+    for (size_t m = degree; m-- > 0;) {
+        const double hi = coefficient(m, lo);
+
+        double e1 = 0.0, e2 = 0.0, e3 = 0.0, e4 = 0.0, e5 = 0.0, e6 = 0.0, e7 = 0.0;
+        const double p1 = TwoProduct(re, wr, e1);
+        const double p2 = TwoProduct(im, wi, e2);
+        const double p3 = TwoProduct(re, wi, e3);
+        const double p4 = TwoProduct(im, wr, e4);
+        const double nextRe = TwoSum(TwoSum(p1, -p2, e5), hi, e7);
+        const double nextIm = TwoSum(p3, p4, e6);
+
+        const double nextErrorRe = errorRe * wr - errorIm * wi + (e1 - e2 + e5 + e7 + lo);
+        const double nextErrorIm = errorRe * wi + errorIm * wr + (e3 + e4 + e6);
+        re = nextRe;
+        im = nextIm;
+        errorRe = nextErrorRe;
+        errorIm = nextErrorIm;
+        magnitude = magnitude * size + MathAbs(hi);
+    }
+    return { re + errorRe, im + errorIm };
+}
+
+struct Evaluation {
+    Complex Value;
+    Complex Derivative;
+    double ErrorBound; // on |Value - exact value|
+    double Magnitude;  // sum |p_m| |w|^m
+    bool Compensated;  // plain Horner was down to its rounding
+};
+
+// p and p' at w, or for reversed the reversed polynomial sum of p[j] w^(n - j). Plain Horner is
+// enough while p(w) is well above its rounding error, close to a root the compensated version
+// takes over.
+constexpr Evaluation EvaluatePolynomial(
+    std::span<const double> p, Complex w, bool reversed, bool withDerivative = true) {
+    constexpr double ROUNDING = std::numeric_limits<double>::epsilon();
+    const size_t n = p.size() - 1;
+    const double gamma = 4.0 * double(n) * ROUNDING;
+    auto coeff = [&](size_t m) { return reversed ? p[n - m] : p[m]; };
+
+    const double size = MathSqrt(std::norm(w));
+    Complex value = coeff(n);
+    Complex derivative = 0.0;
+    double magnitude = MathAbs(coeff(n));
+    for (size_t m = n; m-- > 0;) {
+        derivative = derivative * w + value;
+        value = value * w + coeff(m);
+        magnitude = magnitude * size + MathAbs(coeff(m));
+    }
+    if (std::norm(value) > 64.0 * (gamma * magnitude) * (gamma * magnitude)) {
+        return { value, derivative, gamma * magnitude, magnitude, false };
+    }
+
+    value = CompensatedHorner(
+        n, [&](size_t m, double& lo) { lo = 0.0; return coeff(m); }, w, magnitude);
+    if (withDerivative) {
+        // m c_m is split exactly as well
+        double unused = 0.0;
+        derivative = CompensatedHorner(n - 1,
+            [&](size_t m, double& lo) { return TwoProduct(double(m + 1), coeff(m + 1), lo); }, w,
+            unused);
+    }
+    const double bound = ROUNDING * MathSqrt(std::norm(value)) + gamma * gamma * magnitude;
+    return { value, derivative, bound, magnitude, true };
+}
+
+// Sets ratio to p'(z) / p(z), false instead when p(z) is zero. Past the unit circle the reversed
+// polynomial is evaluated at 1 / z, so high degrees don't overflow. compensated tells whether z
+// is already within the rounding of plain Horner.
+constexpr bool LogDerivative(
+    std::span<const double> p, Complex z, Complex& ratio, bool& compensated) {
+    const size_t n = p.size() - 1;
+    const bool reversed = std::norm(z) > 1.0;
+    const Complex w = reversed ? 1.0 / z : z;
+
+    const Evaluation eval = EvaluatePolynomial(p, w, reversed);
+    compensated = eval.Compensated;
+    if (eval.Value == 0.0) {
+        return false;
+    }
+
+    // Reversed: q(w) = w^n p(z), so p'/p = w (n - w q'/q)
+    ratio = reversed ? w * (double(n) - w * eval.Derivative / eval.Value)
+                     : eval.Derivative / eval.Value;
+    return true;
+}
+
+// Radius of a disk around z[k] that contains a root, from the residual and the distances to the
+// other approximations. Disks that overlap hold a cluster of roots.
+constexpr double InclusionRadius(std::span<const double> p, std::span<const Complex> z, size_t k) {
+    const size_t n = p.size() - 1;
+    const bool reversed = std::norm(z[k]) > 1.0;
+    const Evaluation eval = EvaluatePolynomial(p, reversed ? 1.0 / z[k] : z[k], reversed, false);
+
+    // n |p(z_k)| / (|p_n| prod |z_k - z_j|), rescaled as it goes to stay in range. Reversed, the
+    // residual is |q(w)| |z|^n and each |z_k| is paired with one distance. The product is built
+    // from squares to save the square roots.
+    const double residual = n * (MathSqrt(std::norm(eval.Value)) + eval.ErrorBound) / MathAbs(p[n]);
+    const double zk2 = reversed ? std::norm(z[k]) : 1.0;
+    double product = zk2;
+    int scale = 0; // product is multiplied by 2^(64 scale)
+    for (size_t j = 0; j < z.size(); j++) {
+        if (j == k) {
+            continue;
+        }
+        const double distance2 = std::norm(z[k] - z[j]);
+        if (distance2 == 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        product *= zk2 / distance2;
+        if (product > 0x1p64) {
+            product *= 0x1p-64;
+            scale++;
+        } else if (product < 0x1p-64 && product != 0.0) {
+            product *= 0x1p64;
+            scale--;
+        }
+    }
+
+    double radius = residual * MathSqrt(product);
+    for (; scale > 1 && radius < std::numeric_limits<double>::infinity(); scale -= 2) {
+        radius *= 0x1p64;
+    }
+    for (; scale < -1; scale += 2) {
+        radius *= 0x1p-64;
+    }
+    return scale == 0 ? radius : radius * (scale > 0 ? 0x1p32 : 0x1p-32);
+}
+
+// Taylor coefficients q_{m-1} and q_m at w, q_j = p^(j)(w) / j!, of p or the reversed polynomial,
+// by Horner on C(i, m - 1) p_i and C(i, m) p_i. The binomials are walked down from C(n, .), which
+// stays below 2^1018 up to degree 1024.
+constexpr void TaylorCoefficients(std::span<const double> p, Complex w, bool reversed, size_t m,
+    Complex& lower, Complex& upper) {
+    const size_t n = p.size() - 1;
+    auto coeff = [&](size_t i) { return reversed ? p[n - i] : p[i]; };
+
+    double below = 1.0;
+    for (size_t i = 0; i < m - 1; i++) {
+        below *= double(n - i) / double(i + 1);
+    }
+    double at = below * (double(n - m + 1) / double(m));
+    lower = 0.0;
+    upper = 0.0;
+    for (size_t i = n; i >= m; i--) {
+        lower = lower * w + below * coeff(i);
+        upper = upper * w + at * coeff(i);
+        at *= double(i - m) / double(i);
+        below *= double(i - m + 1) / double(i);
+    }
+    lower = lower * w + below * coeff(m - 1);
+}
+
+// Logarithm of sum |p_i| s^i and its derivative in s, with s^n factored out past 1 so high
+// degrees don't overflow
+constexpr double LogMagnitude(std::span<const double> p, bool reversed, double s, double& slope) {
+    const size_t n = p.size() - 1;
+    auto coeff = [&](size_t i) { return MathAbs(reversed ? p[n - i] : p[i]); };
+    double sum = 0.0;
+    double derivative = 0.0;
+    if (s <= 1.0) {
+        for (size_t i = n + 1; i-- > 0;) {
+            derivative = derivative * s + sum;
+            sum = sum * s + coeff(i);
+        }
+        slope = derivative / sum;
+        return MathLog(sum);
+    }
+    // sum |p_i| s^(i - n), the derivative of the full sum is s^n times sum i |p_i| s^(i - n - 1)
+    for (size_t i = 0; i <= n; i++) {
+        sum = sum / s + coeff(i);
+        derivative = derivative / s + double(i) * coeff(i) / s;
+    }
+    slope = derivative / sum;
+    return MathLog(sum) + double(n) * MathLog(s);
+}
+
+// How far rounding of the coefficients can spread an m-fold root at c: the radius r where
+// |q_m| r^m reaches the rounding of p at distance r from c, by Newton on log r. Infinite when
+// the rounding grows as fast as r^m. Past the unit circle it is worked out on the reversed
+// polynomial at 1 / c and mapped back.
+constexpr double RoundingRadius(std::span<const double> p, Complex c, size_t m) {
+    constexpr int MAX_STEPS = 32;
+    constexpr double TOLERANCE = 1e-6;
+    const double logRounding =
+        MathLog(4.0 * double(p.size() - 1) * std::numeric_limits<double>::epsilon());
+    const bool reversed = std::norm(c) > 1.0;
+    const Complex w = reversed ? 1.0 / c : c;
+    const double size = MathSqrt(std::norm(w));
+
+    Complex lower;
+    Complex upper;
+    TaylorCoefficients(p, w, reversed, m, lower, upper);
+    // |q_m| without squaring it, the leading coefficient of (x + 1)^1024 is scaled to 2^-1024
+    const double larger = std::max(MathAbs(upper.real()), MathAbs(upper.imag()));
+    const double ratio = larger == 0.0 ? 0.0 : std::min(MathAbs(upper.real()),
+                                                        MathAbs(upper.imag())) / larger;
+    const double logLeading = MathLog(larger) + 0.5 * MathLog(1.0 + ratio * ratio);
+
+    // log r moves up to the root of m log r - log(rounding M(|w| + r) / |q_m|), which is concave
+    double slope = 0.0;
+    double logRadius =
+        (logRounding + LogMagnitude(p, reversed, size, slope) - logLeading) / double(m);
+    for (int step = 0; step < MAX_STEPS; step++) {
+        const double radius = MathPow(std::numbers::e, logRadius);
+        const double logMagnitude = LogMagnitude(p, reversed, size + radius, slope);
+        const double gap = double(m) * logRadius - (logRounding + logMagnitude - logLeading);
+        const double derivative = double(m) - radius * slope;
+        if (derivative <= 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        if (gap - gap != 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        logRadius -= gap / derivative;
+        if (MathAbs(gap / derivative) <= TOLERANCE) {
+            break;
+        }
+    }
+    const double radius = MathPow(std::numbers::e, logRadius);
+    return reversed ? radius * std::norm(c) : radius;
+}
+
+// Whether c is an m-fold root of a polynomial within rounding of p: the Taylor coefficients
+// q_0 .. q_{m-1} at c vanish within gamma of the same sums over |p_i| and |c|, by repeated
+// synthetic division. Past the unit circle the reversed polynomial is divided at 1 / c.
+constexpr bool MultipleWithinRounding(
+    std::span<const double> p, Complex c, size_t m, ArenaAllocator* arena) {
+    constexpr double ROUNDING = std::numeric_limits<double>::epsilon();
+    const size_t n = p.size() - 1;
+    const double gamma = 8.0 * double(n) * ROUNDING; // the division rounds as much again
+    const bool reversed = std::norm(c) > 1.0;
+    const Complex w = reversed ? 1.0 / c : c;
+    const double size = MathSqrt(std::norm(w));
+
+    ArenaVector<Complex> q(arena);
+    ArenaVector<double> bound(arena);
+    q.resize(n + 1);
+    bound.resize(n + 1);
+    for (size_t i = 0; i <= n; i++) {
+        q[i] = reversed ? p[n - i] : p[i];
+        bound[i] = MathAbs(q[i].real());
+    }
+    for (size_t j = 0; j < m; j++) {
+        for (size_t i = n; i-- > j;) {
+            q[i] += w * q[i + 1];
+            bound[i] += size * bound[i + 1];
+        }
+        if (std::norm(q[j]) > (gamma * bound[j]) * (gamma * bound[j])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Radius of a disk around the center c of the count approximations labelled k that contains as
+// many roots of every polynomial within rounding of the coefficients. The cluster is taken as one
+// point of that multiplicity: the residual over the distances to the other approximations, to the
+// power 1 / count.
+constexpr double ClusterRadius(std::span<const double> p, std::span<const Complex> z,
+    std::span<const uint32_t> label, uint32_t k, Complex c, size_t count) {
+    constexpr double ROUNDING = std::numeric_limits<double>::epsilon();
+    const size_t n = p.size() - 1;
+    const double gamma = 4.0 * double(n) * ROUNDING;
+    const bool reversed = std::norm(c) > 1.0;
+    const Evaluation eval = EvaluatePolynomial(p, reversed ? 1.0 / c : c, reversed, false);
+
+    // As in InclusionRadius, with one more |c| for each member when reversed
+    const double residual =
+        MathSqrt(std::norm(eval.Value)) + eval.ErrorBound + gamma * eval.Magnitude;
+    const double c2 = reversed ? std::norm(c) : 1.0;
+    double product = residual * residual / (p[n] * p[n]);
+    int scale = 0; // product is multiplied by 2^(64 scale)
+    for (size_t j = 0; j < z.size() + count; j++) {
+        if (j < z.size() && label[j] == k) {
+            continue;
+        }
+        const double distance2 = j < z.size() ? std::norm(c - z[j]) : 1.0;
+        if (distance2 == 0.0) {
+            return std::numeric_limits<double>::infinity();
+        }
+        product *= c2 / distance2;
+        if (product > 0x1p64) {
+            product *= 0x1p-64;
+            scale++;
+        } else if (product < 0x1p-64 && product != 0.0) {
+            product *= 0x1p64;
+            scale--;
+        }
+    }
+    const double exponent = 0.5 / double(count);
+    return n * MathPow(product, exponent) * MathPow(2.0, 64.0 * scale * exponent);
+}
+
+// Moves the center c of a cluster of m roots onto the root of p^(m-1) next to it, where an m-fold
+// root is a simple one. The Newton step on p^(m-1) is q_{m-1} / (m q_m). The center stays where
+// it is if the step overflows.
+constexpr Complex PolishCluster(std::span<const double> p, Complex c, size_t m) {
+    constexpr int MAX_STEPS = 16;
+    constexpr double STEP_TOLERANCE = 4 * std::numeric_limits<double>::epsilon();
+
+    for (int step = 0; step < MAX_STEPS; step++) {
+        Complex lower;
+        Complex upper;
+        TaylorCoefficients(p, c, false, m, lower, upper);
+        const Complex delta = lower / (double(m) * upper);
+        const double size = std::norm(delta);
+        if (size - size != 0.0) {
+            break;
+        }
+        c -= delta;
+        if (size <= STEP_TOLERANCE * STEP_TOLERANCE * std::norm(c)) {
+            break;
+        }
+    }
+    return c;
+}
+
+// Real roots of a polynomial of degree n >= 1 with p[0] != 0, appended in ascending order. All
+// complex roots are refined together by Aberth-Ehrlich iteration, then approximations whose
+// inclusion disks overlap are merged into one root (a multiple root shows up as a cluster), the
+// center of each cluster is polished for its multiplicity and the ones that are real within the
+// cluster's radius are kept. IllConditioned when rounding of the coefficients leaves it open
+// whether roots are real, the roots are then incomplete. Timeout once budget is past its deadline,
+// which is looked at once per sweep over the approximations.
+constexpr std::optional<ErrorCode> FindRootsAberth(std::span<const double> coefficients,
+    ArenaAllocator* arena, std::vector<double>& roots, const SolveBudget* budget = nullptr) {
+    constexpr int MAX_ITERATIONS = 500;
+    constexpr double STEP_TOLERANCE = 4 * std::numeric_limits<double>::epsilon();
+    constexpr double TIGHT = 1e-3; // |q_m| r^m below this share of the rounding holds a cluster
+    constexpr int COMPENSATED_STEPS = 32;
+    constexpr size_t COMPENSATED_WORK = 32 * 128 * 128; // coefficient passes, see below
+    const size_t n = coefficients.size() - 1;
+
+    // Scaled by a power of two, exactly, to bring the largest coefficient into (2^-64, 1]. The
+    // binomials of (x + 1)^1024 reach 1e306, their sum on the unit circle would overflow.
+    double largest = 0.0;
+    for (double c : coefficients) {
+        largest = std::max(largest, MathAbs(c));
+    }
+    double scale = 1.0;
+    for (; largest * scale > 1.0; scale *= 0x1p-64) {
+    }
+    for (; largest * scale <= 0x1p-64; scale *= 0x1p64) {
+    }
+    ArenaVector<double> scaled(arena);
+    scaled.resize(n + 1);
+    for (size_t i = 0; i <= n; i++) {
+        scaled[i] = coefficients[i] * scale;
+    }
+    const std::span<const double> p(scaled.data(), n + 1);
+
+    // The expansion of (x + 1)^1024 is one 1024-fold root within rounding, its approximations
+    // would only creep around the ring rounding spreads it into
+    const Complex mean = -p[n - 1] / (double(n) * p[n]);
+    if (n > 1 && RoundingRadius(p, mean, n) < std::numeric_limits<double>::infinity() &&
+        MultipleWithinRounding(p, mean, n, arena)) {
+        roots.push_back(PolishCluster(p, mean, n).real());
+        return std::nullopt;
+    }
+
+    ArenaVector<Complex> z(arena);
+    ArenaVector<uint8_t> converged(arena);
+    ArenaVector<uint8_t> refined(arena); // steps taken within the rounding of plain Horner
+    z.resize(n);
+    converged.resize(n);
+    refined.resize(n);
+
+    // Start on a circle whose radius is the geometric mean of the root sizes, off the real axis
+    const double radius = MathPow(MathAbs(p[0] / p[n]), 1.0 / double(n));
+    for (size_t k = 0; k < n; k++) {
+        const double angle = 360.0 * double(k) / double(n) + 90.0 / double(n) + 1.0;
+        z[k] = Complex(radius * MathCosDeg(angle), radius * MathSinDeg(angle));
+    }
+
+    // A compensated evaluation is a pass over the coefficients at several times the cost. Simple
+    // roots take one or two, the rings of multiple roots COMPENSATED_STEPS each, which is only
+    // affordable up to a total of COMPENSATED_WORK coefficients. Past that the roots are lost in
+    // the rounding as far as this iteration can tell.
+    size_t compensatedLeft = 2 * n + COMPENSATED_WORK / n;
+    for (int iteration = 0; iteration < MAX_ITERATIONS; iteration++) {
+        if (budget && budget->PastDeadline()) {
+            return ErrorCode::Timeout;
+        }
+        bool done = true;
+        for (size_t k = 0; k < n; k++) {
+            if (converged[k]) {
+                continue;
+            }
+
+            Complex ratio;
+            bool compensated = false;
+            if (!LogDerivative(p, z[k], ratio, compensated)) {
+                converged[k] = true;
+                continue;
+            }
+
+            // Sum of 1 / (z_k - z_j), as conj / norm since the library division also handles
+            // infinities and is much slower
+            double repulsionRe = 0.0;
+            double repulsionIm = 0.0;
+            for (size_t j = 0; j < n; j++) {
+                const double dr = z[k].real() - z[j].real();
+                const double di = z[k].imag() - z[j].imag();
+                const double norm = dr * dr + di * di;
+                if (j != k && norm != 0.0) {
+                    repulsionRe += dr / norm;
+                    repulsionIm -= di / norm;
+                }
+            }
+            const Complex repulsion(repulsionRe, repulsionIm);
+
+            const Complex denominator = ratio - repulsion;
+            const double size = std::norm(denominator);
+            if (size == 0.0 || size - size != 0.0) { // overflowed, the iteration can't go on
+                converged[k] = true;
+                continue;
+            }
+            const Complex step = std::conj(denominator) / size;
+            z[k] -= step;
+
+            // A simple root needs a step or two at compensated precision, a multiple root only
+            // creeps towards its center, which the clusters below find anyway
+            refined[k] += compensated;
+            if (compensated && compensatedLeft-- == 0) {
+                return ErrorCode::IllConditioned;
+            }
+            if (std::norm(step) <= STEP_TOLERANCE * STEP_TOLERANCE * std::norm(z[k]) ||
+                refined[k] == COMPENSATED_STEPS) {
+                converged[k] = true;
+            } else {
+                done = false;
+            }
+        }
+        if (done) {
+            break;
+        }
+    }
+
+    ArenaVector<double> radii(arena);
+    ArenaVector<uint32_t> cluster(arena); // union-find parent links
+    radii.resize(n);
+    cluster.resize(n);
+    for (size_t k = 0; k < n; k++) {
+        radii[k] = InclusionRadius(p, { z.data(), n }, k);
+        cluster[k] = uint32_t(k);
+    }
+
+    auto root = [&](std::span<uint32_t> links, uint32_t k) {
+        while (links[k] != k) {
+            k = links[k] = links[links[k]];
+        }
+        return k;
+    };
+    const std::span<uint32_t> clusters(cluster.data(), n);
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = i + 1; j < n; j++) {
+            const double reach = radii[i] + radii[j];
+            if (std::norm(z[i] - z[j]) <= reach * reach) {
+                cluster[root(clusters, uint32_t(i))] = root(clusters, uint32_t(j));
+            }
+        }
+    }
+
+    // The coefficients come out of the expansion rounded, which spreads an m-fold root into a
+    // ring of approximations too far apart for their disks to overlap. Clusters are merged again
+    // with disks that cover the rounding, as long as the merged cluster is one multiple root: its
+    // polished center is one within rounding and the cluster is no wider than rounding can
+    // spread it. A cluster already much tighter than that shows the coefficients are more
+    // accurate, it stays apart. Where rounding can spread m roots without bound nothing tells
+    // an m-fold root apart, the cluster is not taken as one.
+    auto multipleRoot = [&](Complex center, size_t m, double width) {
+        const double ring = RoundingRadius(p, center, m);
+        return width <= ring && ring < std::numeric_limits<double>::infinity() &&
+               MultipleWithinRounding(p, center, m, arena);
+    };
+    ArenaVector<uint32_t> label(arena);
+    ArenaVector<uint32_t> component(arena);
+    ArenaVector<Complex> centers(arena);
+    ArenaVector<uint32_t> counts(arena);
+    ArenaVector<double> spread(arena);
+    ArenaVector<double> reach(arena);
+    label.resize(n);
+    component.resize(n);
+    centers.resize(n);
+    counts.resize(n);
+    spread.resize(n);
+    reach.resize(n);
+    const std::span<uint32_t> components(component.data(), n);
+    auto measure = [&](std::span<uint32_t> groups) {
+        for (size_t k = 0; k < n; k++) {
+            label[k] = root(groups, uint32_t(k));
+            centers[k] = 0.0;
+            counts[k] = 0;
+            spread[k] = 0.0;
+        }
+        for (size_t k = 0; k < n; k++) {
+            centers[label[k]] += z[k];
+            counts[label[k]]++;
+        }
+        for (size_t k = 0; k < n; k++) {
+            if (counts[k] != 0) {
+                centers[k] /= double(counts[k]);
+            }
+            if (counts[k] > 1) {
+                centers[k] = PolishCluster(p, centers[k], counts[k]);
+            }
+        }
+        // A member counts as near as its disk reaches, one Aberth left behind can be far out
+        for (size_t k = 0; k < n; k++) {
+            const double distance = MathSqrt(std::norm(z[k] - centers[label[k]])) - radii[k];
+            spread[label[k]] = std::max(spread[label[k]], distance);
+        }
+    };
+
+    // A disk cluster wider than rounding can spread one root of its multiplicity holds several
+    // multiple roots whose rings touch. It is cut in two where its members are farthest apart
+    // until the parts fit.
+    ArenaVector<uint32_t> members(arena);
+    ArenaVector<uint32_t> parts(arena); // begin and end in members of the parts left to check
+    ArenaVector<double> far(arena);
+    ArenaVector<uint32_t> near(arena);
+    ArenaVector<uint8_t> side(arena);
+    ArenaVector<uint32_t> order(arena);
+    ArenaVector<uint32_t> fitted(arena); // the first member of the part each one fits in
+    members.resize(n);
+    fitted.resize(n);
+    far.resize(n);
+    near.resize(n);
+    side.resize(n);
+    order.resize(n);
+    auto meanOf = [&](uint32_t* begin, uint32_t* end) {
+        Complex sum = 0.0;
+        for (uint32_t* j = begin; j != end; j++) {
+            sum += z[*j];
+        }
+        return sum / double(end - begin);
+    };
+    auto farthestFrom = [&](uint32_t* begin, uint32_t* end, Complex c) {
+        return z[*std::max_element(begin, end, [&](uint32_t a, uint32_t b) {
+            return std::norm(z[a] - c) < std::norm(z[b] - c);
+        })];
+    };
+    // Cuts the parts left in parts until they fit, the members of each fitting part are linked
+    // to its first one in links
+    auto split = [&](std::span<uint32_t> links) {
+        while (!parts.empty()) {
+            uint32_t* end = members.data() + parts.back();
+            parts.pop_back();
+            uint32_t* begin = members.data() + parts.back();
+            parts.pop_back();
+            if (end - begin < 2) {
+                continue;
+            }
+
+            // An approximation that rounding can't move as far as another one is a root of its own
+            uint32_t* single = std::partition(begin, end, [&](uint32_t k) {
+                const double ring = std::max(radii[k], RoundingRadius(p, z[k], 1));
+                return std::any_of(begin, end, [&](uint32_t j) {
+                    return j != k && std::norm(z[j] - z[k]) <= ring * ring;
+                });
+            });
+            if (single != end) {
+                parts.push_back(uint32_t(begin - members.data()));
+                parts.push_back(uint32_t(single - members.data()));
+                continue;
+            }
+
+            const Complex center = PolishCluster(p, meanOf(begin, end), size_t(end - begin));
+            const double width = MathSqrt(std::norm(farthestFrom(begin, end, center) - center));
+            if (multipleRoot(center, size_t(end - begin), width)) {
+                for (uint32_t* j = begin; j != end; j++) {
+                    links[*j] = *begin;
+                }
+                continue;
+            }
+
+            // Cut at the longest edge of the part's minimum spanning tree, built from its first
+            // member in the order in members: far[j] is the squared distance to the tree, near[j]
+            // the member it is closest to
+            const size_t size = size_t(end - begin);
+            far[0] = 0.0;
+            for (size_t i = 1; i < size; i++) {
+                far[i] = std::norm(z[begin[i]] - z[begin[0]]);
+                near[i] = 0;
+            }
+            size_t cut = 0;
+            for (size_t added = 1; added < size; added++) {
+                size_t next = added;
+                for (size_t i = added + 1; i < size; i++) {
+                    next = far[i] < far[next] ? i : next;
+                }
+                std::swap(begin[added], begin[next]);
+                std::swap(far[added], far[next]);
+                std::swap(near[added], near[next]);
+                cut = far[added] > far[cut] ? added : cut;
+                for (size_t i = added + 1; i < size; i++) {
+                    const double distance = std::norm(z[begin[i]] - z[begin[added]]);
+                    if (distance < far[i]) {
+                        far[i] = distance;
+                        near[i] = uint32_t(added);
+                    }
+                }
+            }
+
+            if (cut == 0) { // all in one point
+                continue;
+            }
+
+            // The subtree under the cut comes after it in the order, each member following the
+            // one it hangs from. It moves to the back.
+            size_t kept = 0;
+            for (size_t i = 0; i < size; i++) {
+                side[i] = i == cut || (i > cut && side[near[i]]);
+                if (!side[i]) {
+                    order[kept++] = begin[i];
+                }
+            }
+            for (size_t i = 0, moved = kept; i < size; i++) {
+                if (side[i]) {
+                    order[moved++] = begin[i];
+                }
+            }
+            std::copy_n(order.begin(), size, begin);
+            uint32_t* middle = begin + kept;
+            for (uint32_t* bound : { begin, middle, middle, end }) {
+                parts.push_back(uint32_t(bound - members.data()));
+            }
+        }
+    };
+    measure(clusters);
+    size_t used = 0;
+    for (size_t k = 0; k < n; k++) {
+        if (counts[k] < 2 || multipleRoot(centers[k], counts[k], spread[k])) {
+            continue;
+        }
+        parts.push_back(uint32_t(used));
+        for (size_t j = 0; j < n; j++) {
+            if (label[j] == k) {
+                members[used++] = uint32_t(j);
+                cluster[j] = uint32_t(j);
+            }
+        }
+        parts.push_back(uint32_t(used));
+    }
+    split(clusters);
+
+    for (bool merged = true; merged;) {
+        measure(clusters);
+        for (size_t k = 0; k < n; k++) {
+            component[k] = uint32_t(k);
+            reach[k] = 0.0;
+            if (counts[k] == 0 ||
+                (counts[k] > 1 && spread[k] < MathPow(TIGHT, 1.0 / double(counts[k])) *
+                                           RoundingRadius(p, centers[k], counts[k]))) {
+                continue;
+            }
+            reach[k] = ClusterRadius(
+                p, { z.data(), n }, { label.data(), n }, uint32_t(k), centers[k], counts[k]);
+        }
+        // A tight cluster doesn't reach out, but an approximation whose disk covers its center
+        // still joins it, as the one straggler Aberth leaves out of the ring of (x - 2)^90
+        for (size_t i = 0; i < n; i++) {
+            for (size_t j = i + 1; j < n && counts[i] != 0; j++) {
+                const double sum = reach[i] + reach[j];
+                if (counts[j] != 0 && sum != 0.0 &&
+                    std::norm(centers[i] - centers[j]) <= sum * sum) {
+                    component[root(components, uint32_t(i))] = root(components, uint32_t(j));
+                }
+            }
+        }
+
+        // Label the approximations by component, then merge the components that fit. One that
+        // doesn't can still hold a multiple root next to roots of its own, as the ring of
+        // (x - 1)^57 reaches the simple root of (x - 1)^57 (x + 2), it is cut like a disk cluster.
+        for (size_t k = 0; k < n; k++) {
+            component[k] = root(components, label[k]);
+        }
+        measure(components);
+        used = 0;
+        for (size_t k = 0; k < n; k++) {
+            fitted[k] = uint32_t(k);
+        }
+        for (size_t k = 0; k < n; k++) {
+            if (counts[k] < 2) {
+                continue;
+            }
+            const size_t begin = used;
+            for (size_t j = 0; j < n; j++) {
+                if (label[j] == k) {
+                    members[used++] = uint32_t(j);
+                }
+            }
+            if (multipleRoot(centers[k], counts[k], spread[k])) {
+                for (; used != begin; used--) {
+                    fitted[members[used - 1]] = uint32_t(k);
+                }
+            } else {
+                parts.push_back(uint32_t(begin));
+                parts.push_back(uint32_t(used));
+            }
+        }
+        split({ fitted.data(), n });
+        merged = false;
+        for (size_t j = 0; j < n; j++) {
+            const uint32_t from = root(clusters, uint32_t(j));
+            const uint32_t to = root(clusters, fitted[j]);
+            if (from != to) {
+                cluster[from] = to;
+                merged = true;
+            }
+        }
+    }
+
+    // The polished center of a cluster is accurate even when its members are not, it is real if
+    // the disk that rounding leaves around it reaches the real axis. A single approximation
+    // whose conjugate is nearer another one than itself is half of a complex pair instead, and
+    // one whose disk holds others too doesn't pin down a root.
+    measure(clusters);
+    auto ambiguous = [&](size_t k) {
+        const Complex mirror = std::conj(z[k]);
+        const double gap = std::min(std::norm(z[k] - mirror), radii[k] * radii[k]);
+        for (size_t j = 0; j < n; j++) {
+            if (j != k && std::min(std::norm(z[j] - mirror), std::norm(z[j] - z[k])) < gap) {
+                return true;
+            }
+        }
+        return false;
+    };
+    // A single approximation as close to the axis as rounding can move it, with another single
+    // one within that distance too, may stand for a real root or for half of a complex pair. The
+    // expansion of (x + 1)^100 - 1 has its root -2 there. One next to a cluster is left out of
+    // the multiple root.
+    auto lost = [&](size_t k) {
+        const double noise = RoundingRadius(p, z[k], 1);
+        if (!(MathAbs(z[k].imag()) <= noise)) {
+            return false;
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (j != k && counts[label[j]] == 1 && !(std::norm(z[j] - z[k]) > noise * noise)) {
+                return true;
+            }
+        }
+        return false;
+    };
+    const size_t first = roots.size();
+    for (size_t k = 0; k < n; k++) {
+        if (counts[k] == 1 && lost(k)) {
+            roots.resize(first);
+            return ErrorCode::IllConditioned;
+        }
+        const double reach = counts[k] > 1 ? RoundingRadius(p, centers[k], counts[k]) : radii[k];
+        if (counts[k] != 0 && MathAbs(centers[k].imag()) <= reach &&
+            (counts[k] > 1 || !ambiguous(k))) {
+            roots.push_back(centers[k].real());
+        }
+    }
+    std::sort(roots.begin() + first, roots.end());
+    return std::nullopt;
+}
+
+// Appends the real roots of the polynomial (or sets IsNone/IsInfinite). Leading coefficients
+// under EPS don't count. Up to degree 2 the closed forms are used, above that the roots come in
+// ascending order with multiple roots reported once, or FindRootsAberth()'s IllConditioned or
+// Timeout.
+constexpr std::optional<ErrorCode> FindRoots(std::span<const double> p, ArenaAllocator* arena,
+    Solutions& solutions, const SolveBudget* budget = nullptr) {
+    size_t n = p.size() - 1;
+    while (n > 0 && MathAbs(p[n]) < EPS) {
+        n--;
+    }
+
+    if (n == 0) {
+        if (MathAbs(p[0]) < EPS) {
+            solutions.IsInfinite = true;
+        } else {
+            solutions.IsNone = true;
+        }
+    } else if (n == 1) {
+        solutions.Values.emplace_back(-p[0] / p[1]);
+    } else if (n == 2) {
+        const double a = p[2];
+        const double b = p[1];
+        const double c = p[0];
+        double delta = b * b - 4 * a * c;
+
+        if (delta < 0) { // no solution
+            solutions.IsNone = true;
+        } else if (delta < EPS) { // 1 solution
+            solutions.Values.emplace_back(-b / (2 * a));
+        } else { // 2 solutions
+            double sqrtDelta = MathSqrt(delta);
+            solutions.Values.emplace_back((-b + sqrtDelta) / (2 * a));
+            solutions.Values.emplace_back((-b - sqrtDelta) / (2 * a));
+        }
+    } else {
+        // x^k factors give the root 0, the rest goes to the iteration
+        size_t zeros = 0;
+        while (p[zeros] == 0.0) {
+            zeros++;
+        }
+        if (zeros < n) {
+            if (const auto code = FindRootsAberth(p.subspan(zeros, n + 1 - zeros), arena,
+                    solutions.Values, budget)) {
+                return code;
+            }
+        }
+        if (zeros > 0) {
+            auto& values = solutions.Values;
+            values.insert(std::lower_bound(values.begin(), values.end(), 0.0), 0.0);
+        }
+        solutions.IsNone = solutions.Values.empty();
+    }
+    return std::nullopt;
+}
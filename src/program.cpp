@@ -0,0 +1,332 @@
+#include "program.h"
+#include "simd.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numbers>
+
+static std::expected<double, ErrorCode> EvaluateBinary(OpCode op, double lhs, double rhs) {
+    switch (op) {
+        case OpCode::Add: return lhs + rhs;
+        case OpCode::Sub: return lhs - rhs;
+        case OpCode::Mul: return lhs * rhs;
+        case OpCode::Div:
+            if (rhs == 0.0) {
+                return std::unexpected(ErrorCode::DivisionByZero);
+            }
+            return lhs / rhs;
+        case OpCode::Pow: return ConstantPower(lhs, rhs); // the analysis folds it the same way
+        default: return std::unexpected(ErrorCode::UnexpectedToken);
+    }
+}
+
+uint32_t ProgramBuilder::Emit(OpCode op, uint32_t lhs, uint32_t rhs, size_t offset, FunctionType fn) {
+    m_Program.Code.push_back({ op, fn, lhs, rhs, uint32_t(offset) });
+    m_Folded.emplace_back();
+    return uint32_t(m_Program.Code.size() - 1);
+}
+
+uint32_t ProgramBuilder::Constant(double value) {
+    auto [it, inserted] = m_ConstantRegs.try_emplace(value, 0);
+    if (inserted) {
+        m_Program.Constants.push_back(value);
+        it->second = Emit(OpCode::Const, uint32_t(m_Program.Constants.size() - 1));
+        m_Folded.back() = value;
+    }
+    return it->second;
+}
+
+uint32_t ProgramBuilder::Param(uint32_t index) {
+    auto [it, inserted] = m_ParamRegs.try_emplace(index, 0);
+    if (inserted) {
+        it->second = Emit(OpCode::Param, index);
+    }
+    return it->second;
+}
+
+uint32_t ProgramBuilder::Var() {
+    if (!m_VarReg) {
+        m_VarReg = Emit(OpCode::Var, 0);
+    }
+    return *m_VarReg;
+}
+
+std::optional<double> ProgramBuilder::ConstantValue(uint32_t reg) const {
+    return m_Folded[reg];
+}
+
+bool ProgramBuilder::IsConstant(uint32_t reg, double value) const {
+    return m_Folded[reg] && *m_Folded[reg] == value;
+}
+
+uint32_t ProgramBuilder::Neg(uint32_t operand) {
+    if (m_Folded[operand]) {
+        return Constant(-*m_Folded[operand]);
+    }
+    return Emit(OpCode::Neg, operand);
+}
+
+std::expected<uint32_t, SolveError> ProgramBuilder::Call(
+    FunctionType fn, uint32_t operand, size_t offset) {
+    if (m_Folded[operand]) {
+        const auto value = ApplyFunction(fn, *m_Folded[operand]);
+        if (!value) {
+            return std::unexpected(SolveError{ value.error(), offset });
+        }
+        return Constant(*value);
+    }
+    return Emit(OpCode::Call, operand, 0, offset, fn);
+}
+
+std::expected<uint32_t, SolveError> ProgramBuilder::Binary(
+    OpCode op, uint32_t lhs, uint32_t rhs, size_t offset) {
+    if (m_Folded[lhs] && m_Folded[rhs]) {
+        const auto value = EvaluateBinary(op, *m_Folded[lhs], *m_Folded[rhs]);
+        if (!value) {
+            return std::unexpected(SolveError{ value.error(), offset });
+        }
+        return Constant(*value);
+    }
+
+    // Identities, 0 / p is kept so a zero parameter still reports the division
+    switch (op) {
+        case OpCode::Add:
+            if (IsConstant(lhs, 0.0)) {
+                return rhs;
+            } else if (IsConstant(rhs, 0.0)) {
+                return lhs;
+            }
+            break;
+        case OpCode::Sub:
+            if (IsConstant(rhs, 0.0)) {
+                return lhs;
+            } else if (IsConstant(lhs, 0.0)) {
+                return Neg(rhs);
+            }
+            break;
+        case OpCode::Mul:
+            if (IsConstant(lhs, 0.0) || IsConstant(rhs, 0.0)) {
+                return Constant(0.0);
+            } else if (IsConstant(lhs, 1.0)) {
+                return rhs;
+            } else if (IsConstant(rhs, 1.0)) {
+                return lhs;
+            }
+            break;
+        case OpCode::Div:
+            if (IsConstant(rhs, 0.0)) {
+                return std::unexpected(SolveError{ ErrorCode::DivisionByZero, offset });
+            } else if (IsConstant(rhs, 1.0)) {
+                return lhs;
+            }
+            break;
+        case OpCode::Pow:
+            if (IsConstant(rhs, 0.0)) {
+                return Constant(1.0);
+            } else if (IsConstant(rhs, 1.0)) {
+                return lhs;
+            }
+            break;
+        default: break;
+    }
+
+    return Emit(op, lhs, rhs, offset);
+}
+
+Program ProgramBuilder::Finish(std::span<const uint32_t> outputs) {
+    const std::vector<Instruction>& code = m_Program.Code;
+
+    std::vector<bool> live(code.size(), false);
+    for (uint32_t reg : outputs) {
+        live[reg] = true;
+    }
+    for (size_t i = code.size(); i-- > 0;) {
+        if (!live[i]) {
+            continue;
+        }
+        switch (code[i].Op) {
+            case OpCode::Const:
+            case OpCode::Param:
+            case OpCode::Var: break;
+            case OpCode::Neg:
+            case OpCode::Call: live[code[i].Lhs] = true; break;
+            default:
+                live[code[i].Lhs] = true;
+                live[code[i].Rhs] = true;
+                break;
+        }
+    }
+
+    Program result;
+    result.ParamCount = m_Program.ParamCount;
+    std::vector<uint32_t> remap(code.size(), 0);
+    for (size_t i = 0; i < code.size(); i++) {
+        if (!live[i]) {
+            continue;
+        }
+
+        Instruction ins = code[i];
+        switch (ins.Op) {
+            case OpCode::Const:
+                ins.Lhs = uint32_t(result.Constants.size());
+                result.Constants.push_back(m_Program.Constants[code[i].Lhs]);
+                break;
+            case OpCode::Param:
+            case OpCode::Var: break;
+            case OpCode::Neg:
+            case OpCode::Call: ins.Lhs = remap[ins.Lhs]; break;
+            default:
+                ins.Lhs = remap[ins.Lhs];
+                ins.Rhs = remap[ins.Rhs];
+                break;
+        }
+
+        remap[i] = uint32_t(result.Code.size());
+        result.Code.push_back(ins);
+    }
+
+    for (uint32_t reg : outputs) {
+        result.Outputs.push_back(remap[reg]);
+    }
+    return result;
+}
+
+std::expected<void, SolveError> Execute(
+    const Program& program, std::span<const double> params, double x, std::span<double> registers) {
+    const Instruction* code = program.Code.data();
+    double* r = registers.data();
+
+    for (size_t i = 0; i < program.Code.size(); i++) {
+        const Instruction& ins = code[i];
+        switch (ins.Op) {
+            case OpCode::Const: r[i] = program.Constants[ins.Lhs]; break;
+            case OpCode::Param: r[i] = params[ins.Lhs]; break;
+            case OpCode::Var: r[i] = x; break;
+            case OpCode::Add: r[i] = r[ins.Lhs] + r[ins.Rhs]; break;
+            case OpCode::Sub: r[i] = r[ins.Lhs] - r[ins.Rhs]; break;
+            case OpCode::Mul: r[i] = r[ins.Lhs] * r[ins.Rhs]; break;
+            case OpCode::Div:
+                if (r[ins.Rhs] == 0.0) {
+                    return std::unexpected(SolveError{ ErrorCode::DivisionByZero, ins.Offset });
+                }
+                r[i] = r[ins.Lhs] / r[ins.Rhs];
+                break;
+            case OpCode::Pow: r[i] = std::pow(r[ins.Lhs], r[ins.Rhs]); break;
+            case OpCode::Neg: r[i] = -r[ins.Lhs]; break;
+            case OpCode::Call: {
+                const auto value = ApplyFunction(ins.Fn, r[ins.Lhs]);
+                if (!value) {
+                    return std::unexpected(SolveError{ value.error(), ins.Offset });
+                }
+                r[i] = *value;
+                break;
+            }
+        }
+    }
+
+    return {};
+}
+
+const double* ExecuteBlock(const Program& program, std::span<const double> params, const double* x,
+    size_t n, double* registers, MathTier tier) {
+    const Instruction* code = program.Code.data();
+
+    for (size_t i = 0; i < program.Code.size(); i++) {
+        const Instruction& ins = code[i];
+        double* r = registers + i * BLOCK_SIZE;
+        const double* lhs = registers + size_t(ins.Lhs) * BLOCK_SIZE;
+        const double* rhs = registers + size_t(ins.Rhs) * BLOCK_SIZE;
+
+        switch (ins.Op) {
+            case OpCode::Const: std::fill_n(r, n, program.Constants[ins.Lhs]); break;
+            case OpCode::Param: std::fill_n(r, n, params[ins.Lhs]); break;
+            case OpCode::Var: std::copy_n(x, n, r); break;
+            case OpCode::Add:
+            case OpCode::Sub:
+            case OpCode::Mul:
+            case OpCode::Div: BinaryArray(ins.Op, lhs, rhs, r, n); break;
+            case OpCode::Pow:
+                for (size_t j = 0; j < n; j++) {
+                    r[j] = std::pow(lhs[j], rhs[j]);
+                }
+                break;
+            case OpCode::Neg: NegateArray(lhs, r, n); break;
+            case OpCode::Call: ApplyFunctionArray(ins.Fn, lhs, r, n, tier); break;
+        }
+    }
+
+    return registers + size_t(program.Outputs[0]) * BLOCK_SIZE;
+}
+
+// d/du of the built-in functions, trigonometry works in degrees so the chain rule picks up pi/180
+static double FunctionDerivative(FunctionType fn, double u, double value) {
+    constexpr double RADIANS_PER_DEGREE = std::numbers::pi / 180.0;
+    switch (fn) {
+        case FunctionType::Sin: return std::cos(DegToRadians(u)) * RADIANS_PER_DEGREE;
+        case FunctionType::Cos: return -std::sin(DegToRadians(u)) * RADIANS_PER_DEGREE;
+        case FunctionType::Tan: return (1.0 + value * value) * RADIANS_PER_DEGREE;
+        case FunctionType::Asin: return 1.0 / (std::sqrt(1.0 - u * u) * RADIANS_PER_DEGREE);
+        case FunctionType::Acos: return -1.0 / (std::sqrt(1.0 - u * u) * RADIANS_PER_DEGREE);
+        case FunctionType::Atan: return 1.0 / ((1.0 + u * u) * RADIANS_PER_DEGREE);
+        case FunctionType::Log: return 1.0 / (u * std::numbers::ln10);
+        case FunctionType::Ln: return 1.0 / u;
+        case FunctionType::Sqrt: return 0.5 / value;
+        case FunctionType::Floor:
+        case FunctionType::Ceil: return 0.0;
+        case FunctionType::Abs: return u > 0.0 ? 1.0 : u < 0.0 ? -1.0 : 0.0;
+        default: return std::numeric_limits<double>::quiet_NaN();
+    }
+}
+
+static Dual PowDual(Dual base, Dual exponent) {
+    const double value = std::pow(base.Value, exponent.Value);
+    double derivative = 0.0;
+    if (exponent.Derivative == 0.0) { // u^c, also defined for a negative base
+        if (base.Derivative != 0.0) {
+            derivative =
+                exponent.Value * std::pow(base.Value, exponent.Value - 1.0) * base.Derivative;
+        }
+    } else { // u^v = e^(v ln u)
+        derivative = value * (exponent.Derivative * std::log(base.Value) +
+                                 exponent.Value * base.Derivative / base.Value);
+    }
+    return { value, derivative };
+}
+
+Dual ExecuteDual(
+    const Program& program, std::span<const double> params, double x, std::span<Dual> registers) {
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+    const Instruction* code = program.Code.data();
+    Dual* r = registers.data();
+
+    for (size_t i = 0; i < program.Code.size(); i++) {
+        const Instruction& ins = code[i];
+        const Dual& a = r[ins.Lhs]; // only read by the operations that take registers
+        const Dual& b = r[ins.Rhs];
+
+        switch (ins.Op) {
+            case OpCode::Const: r[i] = { program.Constants[ins.Lhs], 0.0 }; break;
+            case OpCode::Param: r[i] = { params[ins.Lhs], 0.0 }; break;
+            case OpCode::Var: r[i] = { x, 1.0 }; break;
+            case OpCode::Add: r[i] = { a.Value + b.Value, a.Derivative + b.Derivative }; break;
+            case OpCode::Sub: r[i] = { a.Value - b.Value, a.Derivative - b.Derivative }; break;
+            case OpCode::Mul:
+                r[i] = { a.Value * b.Value, a.Derivative * b.Value + a.Value * b.Derivative };
+                break;
+            case OpCode::Div: {
+                const double value = a.Value / b.Value;
+                r[i] = { value, (a.Derivative - value * b.Derivative) / b.Value };
+                break;
+            }
+            case OpCode::Pow: r[i] = PowDual(a, b); break;
+            case OpCode::Neg: r[i] = { -a.Value, -a.Derivative }; break;
+            case OpCode::Call: {
+                const double value = ApplyFunction(ins.Fn, a.Value).value_or(NaN);
+                r[i] = { value, FunctionDerivative(ins.Fn, a.Value, value) * a.Derivative };
+                break;
+            }
+        }
+    }
+
+    return r[program.Outputs[0]];
+}
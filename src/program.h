@@ -0,0 +1,82 @@
+#pragma once
+
+#include "builtins.h"
+#include "error.h"
+#include <expected>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+enum class OpCode : uint8_t { Const, Param, Var, Add, Sub, Mul, Div, Pow, Neg, Call };
+
+// Straight-line code in SSA form: instruction i writes register i and only reads earlier registers
+struct Instruction {
+    OpCode Op;
+    FunctionType Fn; // Call only
+    uint32_t Lhs;    // Const: index into Constants, Param: parameter index, otherwise a register
+    uint32_t Rhs;
+    uint32_t Offset; // source offset reported when the instruction fails
+};
+
+struct Program {
+    std::vector<Instruction> Code;
+    std::vector<double> Constants;
+    std::vector<uint32_t> Outputs; // registers holding the results
+    uint32_t ParamCount = 0;
+};
+
+// Emits instructions while folding everything that only depends on constants
+class ProgramBuilder {
+  public:
+    explicit ProgramBuilder(uint32_t paramCount) { m_Program.ParamCount = paramCount; }
+
+    uint32_t Constant(double value);
+    uint32_t Param(uint32_t index);
+    uint32_t Var();
+
+    uint32_t Neg(uint32_t operand);
+    std::expected<uint32_t, SolveError> Call(FunctionType fn, uint32_t operand, size_t offset);
+    std::expected<uint32_t, SolveError> Binary(OpCode op, uint32_t lhs, uint32_t rhs, size_t offset);
+
+    std::optional<double> ConstantValue(uint32_t reg) const;
+    bool IsConstant(uint32_t reg, double value) const;
+
+    // Drops the instructions the outputs don't depend on
+    Program Finish(std::span<const uint32_t> outputs);
+
+  private:
+    uint32_t Emit(OpCode op, uint32_t lhs, uint32_t rhs = 0, size_t offset = 0,
+        FunctionType fn = FunctionType::Sin);
+
+    Program m_Program;
+    std::vector<std::optional<double>> m_Folded; // value of every register known while building
+    std::unordered_map<double, uint32_t> m_ConstantRegs;
+    std::unordered_map<uint32_t, uint32_t> m_ParamRegs;
+    std::optional<uint32_t> m_VarReg;
+};
+
+constexpr size_t BLOCK_SIZE = 256;
+
+// Runs the program for n <= BLOCK_SIZE values of the variable at once. registers needs room for
+// Code.size() * BLOCK_SIZE values. Failing lanes (domain errors, division by zero) become NaN or
+// infinity instead of stopping the block. Returns the lanes of Outputs[0]. tier is passed on to
+// ApplyFunctionArray() for the calls.
+const double* ExecuteBlock(const Program& program, std::span<const double> params, const double* x,
+    size_t n, double* registers, MathTier tier = MathTier::Accurate);
+
+// Runs the program for one value of the variable, registers needs room for Code.size() values
+std::expected<void, SolveError> Execute(
+    const Program& program, std::span<const double> params, double x, std::span<double> registers);
+
+// A value and its derivative with respect to the variable
+struct Dual {
+    double Value;
+    double Derivative;
+};
+
+// Runs the program on dual numbers (forward-mode differentiation) for one value of the variable
+// and returns Outputs[0]. registers needs room for Code.size() values. Like ExecuteBlock, failing
+// operations give NaN or infinity instead of an error.
+Dual ExecuteDual(
+    const Program& program, std::span<const double> params, double x, std::span<Dual> registers);
@@ -0,0 +1,277 @@
+#include "result_cache.h"
+#include "analysis.h"
+#include "numeric.h"
+#include "stats.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+// Keys start with their kind, so the text "P..." can't collide with a coefficient key
+static constexpr char TEXT_KEY = 'T';
+static constexpr char POLYNOMIAL_KEY = 'P';
+
+// Map node, bucket and bookkeeping per entry, on top of the key and the roots
+static constexpr size_t ENTRY_OVERHEAD = 64;
+
+struct ResultCache::Entry {
+    std::string Key;
+    std::vector<double> Values;
+    SolveError Error{};
+    bool IsError = false;
+    bool IsInfinite = false;
+    bool IsNone = false;
+    bool Used = false;                             // the slot holds an entry
+    mutable std::atomic<bool> Referenced{ false }; // set by hits, cleared by the clock hand
+    size_t Bytes = 0;
+};
+
+struct KeyHash {
+    size_t operator()(std::string_view key) const { return size_t(HashString(key)); }
+};
+
+struct alignas(64) ResultCache::Shard {
+    mutable std::shared_mutex Mutex;
+    std::unordered_map<std::string_view, uint32_t, KeyHash> Index; // views into the entry keys
+    std::deque<Entry> Slots; // a deque never moves its elements, so the views stay valid
+    std::vector<uint32_t> FreeSlots;
+    size_t Hand = 0;
+    size_t Bytes = 0;
+
+    mutable std::atomic<uint64_t> TextHits{ 0 };
+    mutable std::atomic<uint64_t> PolynomialHits{ 0 };
+    std::atomic<uint64_t> Misses{ 0 };
+    std::atomic<uint64_t> Evictions{ 0 };
+};
+
+ResultCache::ResultCache(size_t memoryLimit, size_t shardCount)
+    : m_Shards(std::make_unique<Shard[]>(std::max<size_t>(shardCount, 1))),
+      m_ShardCount(std::max<size_t>(shardCount, 1)),
+      m_ShardLimit(memoryLimit / m_ShardCount) {}
+
+ResultCache::~ResultCache() = default;
+
+ResultCache::Shard& ResultCache::ShardOf(uint64_t hash) const {
+    // The maps bucket by the low bits, pick the shard with the high ones
+    return m_Shards[(hash >> 40) % m_ShardCount];
+}
+
+static void AppendBytes(const void* data, size_t size, std::string& key) {
+    key.append(static_cast<const char*>(data), size);
+}
+
+// The numeric fallback depends on the options, so they are part of the text key
+static void MakeTextKey(
+    std::string_view equation, const NumericOptions& numeric, std::string& key) {
+    key.clear();
+    key += TEXT_KEY;
+    AppendBytes(&numeric.Lo, sizeof(numeric.Lo), key);
+    AppendBytes(&numeric.Hi, sizeof(numeric.Hi), key);
+    AppendBytes(&numeric.Samples, sizeof(numeric.Samples), key);
+    key += equation;
+}
+
+// The exact coefficients, without the leading ones FindRoots() ignores. Scaling to a monic
+// polynomial would merge more equations, but the EPS tests in FindRoots() are absolute and the
+// order of the quadratic roots follows the sign of x^2, so the results could differ.
+static void MakePolynomialKey(std::span<const double> p, std::string& key) {
+    size_t n = p.size() - 1;
+    while (n > 0 && MathAbs(p[n]) < EPS) {
+        n--;
+    }
+    key.clear();
+    key += POLYNOMIAL_KEY;
+    AppendBytes(p.data(), (n + 1) * sizeof(double), key);
+}
+
+bool ResultCache::Find(std::string_view key, uint64_t hash,
+    std::expected<void, SolveError>& result, Solutions& solutions) const {
+    Shard& shard = ShardOf(hash);
+    std::shared_lock lock(shard.Mutex);
+
+    const auto it = shard.Index.find(key);
+    if (it == shard.Index.end()) {
+        return false;
+    }
+    const Entry& entry = shard.Slots[it->second];
+    entry.Referenced.store(true, std::memory_order_relaxed);
+
+    if (entry.IsError) {
+        result = std::unexpected(entry.Error);
+    } else {
+        result = {};
+        solutions.Values.assign(entry.Values.begin(), entry.Values.end());
+        solutions.IsInfinite = entry.IsInfinite;
+        solutions.IsNone = entry.IsNone;
+    }
+    (key[0] == TEXT_KEY ? shard.TextHits : shard.PolynomialHits)
+        .fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+void ResultCache::Insert(std::string_view key, uint64_t hash,
+    const std::expected<void, SolveError>& result, const Solutions& solutions) {
+    const size_t values = result ? solutions.Values.size() : 0;
+    const size_t bytes = sizeof(Entry) + ENTRY_OVERHEAD + key.size() + values * sizeof(double);
+    if (bytes > m_ShardLimit) {
+        return;
+    } else if (!result && IsLimitError(result.error().Code)) {
+        return; // says nothing about the equation, a Timeout not even about the next solve
+    }
+
+    Shard& shard = ShardOf(hash);
+    std::unique_lock lock(shard.Mutex);
+    if (shard.Index.contains(key)) { // another thread solved it meanwhile
+        return;
+    }
+
+    // CLOCK: entries hit since the hand last passed get another round, the first one that
+    // wasn't goes
+    while (shard.Bytes + bytes > m_ShardLimit) {
+        const size_t index = shard.Hand;
+        Entry& victim = shard.Slots[index];
+        shard.Hand = (index + 1) % shard.Slots.size();
+        if (!victim.Used) {
+            continue;
+        } else if (victim.Referenced.exchange(false, std::memory_order_relaxed)) {
+            continue;
+        }
+        shard.Index.erase(victim.Key);
+        shard.Bytes -= victim.Bytes;
+        victim.Used = false;
+        shard.FreeSlots.push_back(uint32_t(index));
+        shard.Evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    uint32_t slot = 0;
+    if (shard.FreeSlots.empty()) {
+        slot = uint32_t(shard.Slots.size());
+        shard.Slots.emplace_back();
+    } else {
+        slot = shard.FreeSlots.back();
+        shard.FreeSlots.pop_back();
+    }
+
+    Entry& entry = shard.Slots[slot];
+    entry.Key.assign(key);
+    entry.IsError = !result;
+    if (result) {
+        entry.Values.assign(solutions.Values.begin(), solutions.Values.end());
+        entry.IsInfinite = solutions.IsInfinite;
+        entry.IsNone = solutions.IsNone;
+    } else {
+        entry.Values.clear();
+        entry.Error = result.error();
+    }
+    entry.Used = true;
+    entry.Referenced.store(false, std::memory_order_relaxed);
+    entry.Bytes = bytes;
+
+    shard.Index.emplace(entry.Key, slot);
+    shard.Bytes += bytes;
+}
+
+std::expected<void, SolveError> ResultCache::Solve(std::string_view equation,
+    Solutions& solutions, const NumericOptions& numeric, const SolveLimits& limits) {
+    // Reused by every solve on this thread, a hit does not allocate
+    thread_local std::string textKey;
+    thread_local std::string polynomialKey;
+    thread_local ArenaAllocator arena;
+
+    std::expected<void, SolveError> result;
+    if (limits.MaxInputBytes && equation.size() > limits.MaxInputBytes) { // before it is copied
+        result = std::unexpected(SolveError{ ErrorCode::InputTooLong, limits.MaxInputBytes });
+        RecordError(result.error().Code);
+        return result;
+    }
+    MakeTextKey(equation, numeric, textKey);
+    const uint64_t textHash = HashString(textKey);
+    if (Find(textKey, textHash, result, solutions)) {
+        if (!result) {
+            RecordError(result.error().Code);
+        }
+        return result;
+    }
+
+    arena.Reset();
+    solutions.Values.clear();
+    solutions.IsInfinite = false;
+    solutions.IsNone = false;
+
+    std::optional<SolveBudget> budget;
+    if (limits.Any()) {
+        budget.emplace(limits, &arena);
+    }
+    Analyzer analyzer(&arena);
+    const AnalyzeResult poly =
+        AnalyzeEquation(equation, &arena, analyzer, budget ? &*budget : nullptr);
+    if (!poly) {
+        // Errors and numeric roots only have the text to go by
+        if (HasNumericFallback(poly.error().Code)) {
+            result = MeasurePhase(StatsPhase::Numeric, [&] {
+                return SolveNumeric(equation, numeric, solutions, budget ? &*budget : nullptr);
+            });
+        } else {
+            result = std::unexpected(poly.error());
+        }
+        ShardOf(textHash).Misses.fetch_add(1, std::memory_order_relaxed);
+        if (StatsEnabled()) {
+            RecordSolve(arena.BytesUsed(), arena.BytesReserved());
+            if (!result) {
+                RecordError(result.error().Code);
+            }
+        }
+        Insert(textKey, textHash, result, solutions);
+        return result;
+    }
+
+    const std::span<const double> coefficients = analyzer.Coefficients(*poly);
+    MakePolynomialKey(coefficients, polynomialKey);
+    const uint64_t polynomialHash = HashString(polynomialKey);
+    if (!Find(polynomialKey, polynomialHash, result, solutions)) {
+        const std::optional<ErrorCode> code = MeasurePhase(StatsPhase::Roots, [&] {
+            return FindRoots(coefficients, &arena, solutions, budget ? &*budget : nullptr);
+        });
+        // Roots lost in the rounding are found on the text, they aren't the polynomial's to share
+        const bool numericRoots =
+            code ? !IsLimitError(*code)
+                 : poly->Degree > 2 && !ResidualsVanish(equation, solutions.Values);
+        if (code && IsLimitError(*code)) {
+            solutions.Values.clear();
+            result = std::unexpected(SolveError{ *code, equation.size() });
+        } else if (numericRoots) {
+            result = MeasurePhase(StatsPhase::Numeric, [&] {
+                return SolveNumeric(equation, numeric, solutions, budget ? &*budget : nullptr);
+            });
+        }
+        ShardOf(textHash).Misses.fetch_add(1, std::memory_order_relaxed);
+        if (StatsEnabled()) {
+            RecordSolve(arena.BytesUsed(), arena.BytesReserved());
+            if (!result) {
+                RecordError(result.error().Code);
+            }
+        }
+        if (!numericRoots) {
+            Insert(polynomialKey, polynomialHash, result, solutions);
+        }
+    }
+    Insert(textKey, textHash, result, solutions);
+    return result;
+}
+
+ResultCacheStats ResultCache::Stats() const {
+    ResultCacheStats stats;
+    for (size_t i = 0; i < m_ShardCount; i++) {
+        Shard& shard = m_Shards[i];
+        stats.TextHits += shard.TextHits.load(std::memory_order_relaxed);
+        stats.PolynomialHits += shard.PolynomialHits.load(std::memory_order_relaxed);
+        stats.Misses += shard.Misses.load(std::memory_order_relaxed);
+        stats.Evictions += shard.Evictions.load(std::memory_order_relaxed);
+
+        std::shared_lock lock(shard.Mutex);
+        stats.Entries += shard.Index.size();
+        stats.Bytes += shard.Bytes;
+    }
+    return stats;
+}
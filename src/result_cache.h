@@ -0,0 +1,49 @@
+#pragma once
+
+#include "solver.h"
+#include <cstdint>
+#include <memory>
+
+struct ResultCacheStats {
+    uint64_t TextHits = 0;       // the same text was solved before
+    uint64_t PolynomialHits = 0; // other text reduced to the same coefficients
+    uint64_t Misses = 0;
+    uint64_t Evictions = 0;
+    size_t Entries = 0;
+    size_t Bytes = 0;
+};
+
+// Remembers the results of Solve(). Results are keyed on the equation text and on the
+// coefficients of its polynomial, so equations written differently (2x+4=0, 4 + 2*x = 0) share
+// the root finding. The keys are spread over shards, each behind its own lock, and a shard that
+// holds more than its share of memoryLimit evicts with the CLOCK algorithm. Hits only take the
+// shard's lock shared.
+class ResultCache {
+  public:
+    explicit ResultCache(size_t memoryLimit, size_t shardCount = 64);
+    ~ResultCache();
+
+    ResultCache(const ResultCache&) = delete;
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    // Same results as ::Solve(equation, solutions, numeric, limits). Limit errors are not kept,
+    // and a hit is only checked against the input size.
+    std::expected<void, SolveError> Solve(std::string_view equation, Solutions& solutions,
+        const NumericOptions& numeric = {}, const SolveLimits& limits = {});
+
+    ResultCacheStats Stats() const;
+
+  private:
+    struct Entry;
+    struct Shard;
+
+    Shard& ShardOf(uint64_t hash) const;
+    bool Find(std::string_view key, uint64_t hash, std::expected<void, SolveError>& result,
+        Solutions& solutions) const;
+    void Insert(std::string_view key, uint64_t hash, const std::expected<void, SolveError>& result,
+        const Solutions& solutions);
+
+    std::unique_ptr<Shard[]> m_Shards;
+    size_t m_ShardCount;
+    size_t m_ShardLimit; // bytes per shard
+};
@@ -0,0 +1,472 @@
+#include "server.h"
+
+#include <iostream>
+
+#ifdef __linux__
+    #include "batch.h"
+    #include "result_cache.h"
+    #include "stats.h"
+    #include "thread_pool.h"
+    #include <arpa/inet.h>
+    #include <cerrno>
+    #include <chrono>
+    #include <csignal>
+    #include <cstdint>
+    #include <cstring>
+    #include <memory>
+    #include <mutex>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+    #include <sys/signalfd.h>
+    #include <sys/socket.h>
+    #include <sys/stat.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+    #include <unordered_map>
+    #define HAS_EPOLL 1
+#endif
+
+#ifdef HAS_EPOLL
+
+constexpr size_t READ_SIZE = 64 * 1024;
+constexpr size_t LINES_PER_TASK = 64;  // requests solved by one pool task
+constexpr size_t MAX_IN_FLIGHT = 4096; // unanswered requests before a connection stops being read
+constexpr size_t MAX_LINE = 1 << 20;   // a longer request closes the connection
+constexpr int MAX_EVENTS = 64;
+constexpr auto METRICS_INTERVAL = std::chrono::seconds(10);
+
+struct Connection {
+    int Fd = -1;
+
+    // Loop thread only
+    std::string Input;  // the start of a request whose line break hasn't arrived yet
+    std::string Output; // responses being sent
+    size_t Sent = 0;
+    uint32_t Events = 0; // registered with epoll
+    bool PeerClosed = false;
+    bool Closed = false;
+
+    // Shared with the workers
+    std::mutex Mutex;
+    std::string Finished; // responses not yet handed to the loop
+    size_t InFlight = 0;
+    bool Notified = false; // queued for the loop
+};
+
+class Server {
+  public:
+    explicit Server(const ServeOptions& options)
+        : m_Numeric(options.Numeric), m_Limits(options.Limits), m_Format(options.Format),
+          m_MetricsPath(options.MetricsPath), m_Pool(options.Threads) {
+        m_Numeric.Pool = nullptr;
+        if (options.CacheBytes > 0) {
+            m_Cache = std::make_unique<ResultCache>(options.CacheBytes);
+        }
+    }
+
+    ~Server() {
+        m_Pool.WaitIdle(); // tasks still refer to the connections and the wake-up fd
+        for (auto& [fd, connection] : m_Connections) {
+            close(fd);
+        }
+        for (int fd : { m_Listener, m_Epoll, m_Wake, m_Signals }) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        if (!m_SocketPath.empty()) {
+            unlink(m_SocketPath.c_str());
+        }
+    }
+
+    bool Listen(const std::string& address);
+    int Run();
+
+  private:
+    bool Watch(int fd, uint32_t events);
+    void Accept();
+    void Read(const std::shared_ptr<Connection>& connection);
+    void Dispatch(
+        const std::shared_ptr<Connection>& connection, std::string requests, size_t count);
+    void Solve(Connection& connection, std::string_view requests, size_t count);
+    void Notify(const std::shared_ptr<Connection>& connection);
+    void Flush(const std::shared_ptr<Connection>& connection);
+    void Close(Connection& connection);
+
+    NumericOptions m_Numeric;
+    SolveLimits m_Limits;
+    FormatOptions m_Format;
+    std::unique_ptr<ResultCache> m_Cache;
+    std::string m_MetricsPath;
+
+    int m_Listener = -1;
+    int m_Epoll = -1;
+    int m_Wake = -1; // eventfd the workers write when responses are ready
+    int m_Signals = -1;
+    std::string m_SocketPath; // removed again on exit
+    std::unordered_map<int, std::shared_ptr<Connection>> m_Connections;
+
+    std::mutex m_ReadyMutex;
+    std::vector<std::shared_ptr<Connection>> m_Ready; // have finished responses
+
+    ThreadPool m_Pool; // last, so the workers stop before the rest goes away
+};
+
+static bool IsPort(const std::string& address) {
+    return !address.empty() && address.size() <= 5 &&
+           address.find_first_not_of("0123456789") == std::string::npos;
+}
+
+bool Server::Listen(const std::string& address) {
+    if (IsPort(address)) {
+        const unsigned long port = std::stoul(address);
+        if (port > UINT16_MAX) {
+            errno = EINVAL;
+            return false;
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(uint16_t(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        m_Listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        const int on = 1;
+        if (m_Listener < 0 ||
+            setsockopt(m_Listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) < 0 ||
+            bind(m_Listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            return false;
+        }
+
+        socklen_t length = sizeof(addr);
+        getsockname(m_Listener, reinterpret_cast<sockaddr*>(&addr), &length);
+        std::cerr << "Listening on 127.0.0.1:" << ntohs(addr.sin_port) << "\n";
+    } else {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (address.size() >= sizeof(addr.sun_path)) {
+            errno = ENAMETOOLONG;
+            return false;
+        }
+        std::memcpy(addr.sun_path, address.c_str(), address.size() + 1);
+
+        // A socket left behind by an earlier run would make bind fail, other files are kept
+        struct stat info;
+        if (stat(address.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+            unlink(address.c_str());
+        }
+
+        m_Listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (m_Listener < 0 ||
+            bind(m_Listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            return false;
+        }
+        m_SocketPath = address;
+        std::cerr << "Listening on " << address << "\n";
+    }
+    return listen(m_Listener, SOMAXCONN) == 0;
+}
+
+bool Server::Watch(int fd, uint32_t events) {
+    epoll_event event{};
+    event.events = events;
+    event.data.fd = fd;
+    return epoll_ctl(m_Epoll, EPOLL_CTL_ADD, fd, &event) == 0;
+}
+
+static sigset_t ShutdownSignals() {
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    return signals;
+}
+
+int Server::Run() {
+    const sigset_t signals = ShutdownSignals();
+    m_Epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_Wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    m_Signals = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (m_Epoll < 0 || m_Wake < 0 || m_Signals < 0 || !Watch(m_Listener, EPOLLIN) ||
+        !Watch(m_Wake, EPOLLIN) || !Watch(m_Signals, EPOLLIN)) {
+        std::cerr << "Error: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    const int timeout = m_MetricsPath.empty()
+                            ? -1
+                            : int(std::chrono::milliseconds(METRICS_INTERVAL).count());
+    auto metricsWritten = std::chrono::steady_clock::now();
+
+    epoll_event events[MAX_EVENTS];
+    while (true) {
+        const int count = epoll_wait(m_Epoll, events, MAX_EVENTS, timeout);
+        if (count < 0 && errno != EINTR) {
+            std::cerr << "Error: " << std::strerror(errno) << "\n";
+            return 1;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (!m_MetricsPath.empty() && now - metricsWritten >= METRICS_INTERVAL) {
+            WritePrometheusFile(m_MetricsPath);
+            metricsWritten = now;
+        }
+
+        for (int i = 0; i < count; i++) {
+            const int fd = events[i].data.fd;
+            if (fd == m_Signals) {
+                return 0;
+            } else if (fd == m_Listener) {
+                Accept();
+            } else if (fd == m_Wake) {
+                uint64_t value;
+                [[maybe_unused]] const auto ignored = read(m_Wake, &value, sizeof(value));
+
+                std::vector<std::shared_ptr<Connection>> ready;
+                {
+                    std::lock_guard lock(m_ReadyMutex);
+                    ready.swap(m_Ready);
+                }
+                for (const auto& connection : ready) {
+                    Flush(connection);
+                }
+            } else if (const auto it = m_Connections.find(fd); it != m_Connections.end()) {
+                const std::shared_ptr<Connection> connection = it->second;
+                if (events[i].events & (EPOLLHUP | EPOLLERR)) {
+                    Close(*connection); // nothing can be sent anymore
+                    continue;
+                }
+                if (events[i].events & EPOLLIN) {
+                    Read(connection);
+                }
+                if (events[i].events & EPOLLOUT) {
+                    Flush(connection);
+                }
+            }
+        }
+    }
+}
+
+void Server::Accept() {
+    while (true) {
+        const int fd = accept4(m_Listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            return; // EAGAIN once the backlog is empty
+        }
+
+        // Responses are small and latency bound, don't let Nagle hold them back
+        const int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on)); // a no-op on Unix sockets
+
+        auto connection = std::make_shared<Connection>();
+        connection->Fd = fd;
+        connection->Events = EPOLLIN;
+        if (!Watch(fd, EPOLLIN)) {
+            close(fd);
+            continue;
+        }
+        m_Connections.emplace(fd, std::move(connection));
+    }
+}
+
+void Server::Read(const std::shared_ptr<Connection>& connection) {
+    Connection& c = *connection;
+    char buffer[READ_SIZE];
+    const ssize_t received = read(c.Fd, buffer, sizeof(buffer));
+    if (received < 0) {
+        if (errno != EAGAIN && errno != EINTR) {
+            Close(c);
+        }
+        return;
+    } else if (received == 0) {
+        // The client is done sending, a last line without its line break is a request too.
+        // Answer what is in flight and close.
+        c.PeerClosed = true;
+        if (c.Input.find_first_not_of(" \t\r") != std::string::npos) {
+            Dispatch(connection, std::move(c.Input) + '\n', 1);
+        }
+        c.Input.clear();
+        Flush(connection);
+        return;
+    }
+
+    // Whole lines go to the pool in groups, the unfinished one waits for more input
+    c.Input.append(buffer, size_t(received));
+    const size_t end = c.Input.rfind('\n');
+    if (end == std::string::npos) {
+        if (c.Input.size() > MAX_LINE) {
+            Close(c);
+        }
+        return;
+    }
+
+    std::string_view lines(c.Input.data(), end + 1);
+    std::string group;
+    size_t count = 0;
+    while (!lines.empty()) {
+        const size_t lineEnd = lines.find('\n');
+        const std::string_view line = lines.substr(0, lineEnd + 1);
+        lines.remove_prefix(lineEnd + 1);
+        if (line.find_first_not_of(" \t\r\n") == std::string_view::npos) {
+            continue;
+        }
+
+        group += line;
+        if (++count == LINES_PER_TASK) {
+            Dispatch(connection, std::move(group), count);
+            group.clear();
+            count = 0;
+        }
+    }
+    if (count > 0) {
+        Dispatch(connection, std::move(group), count);
+    }
+    c.Input.erase(0, end + 1);
+    Flush(connection); // pauses reading if too much is in flight
+}
+
+void Server::Dispatch(
+    const std::shared_ptr<Connection>& connection, std::string requests, size_t count) {
+    {
+        std::lock_guard lock(connection->Mutex);
+        connection->InFlight += count;
+    }
+    m_Pool.Submit([this, connection, requests = std::move(requests), count] {
+        Solve(*connection, requests, count);
+        Notify(connection);
+    });
+}
+
+void Server::Solve(Connection& connection, std::string_view requests, size_t count) {
+    thread_local Solutions solutions;
+    thread_local std::string out;
+    out.clear();
+
+    while (!requests.empty()) {
+        const size_t end = requests.find('\n');
+        std::string_view line = requests.substr(0, end);
+        requests.remove_prefix(end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+
+        line.remove_prefix(line.find_first_not_of(" \t"));
+        const size_t space = std::min(line.find_first_of(" \t"), line.size());
+        const std::string_view id = line.substr(0, space);
+        const std::string_view equation = line.substr(std::min(space + 1, line.size()));
+
+        const auto result = m_Cache ? m_Cache->Solve(equation, solutions, m_Numeric, m_Limits)
+                                    : ::Solve(equation, solutions, m_Numeric, m_Limits);
+        out += id;
+        out += ' ';
+        AppendResult(result, solutions, m_Format, out);
+    }
+
+    std::lock_guard lock(connection.Mutex);
+    connection.Finished += out;
+    connection.InFlight -= count;
+}
+
+void Server::Notify(const std::shared_ptr<Connection>& connection) {
+    {
+        std::lock_guard lock(connection->Mutex);
+        if (connection->Notified) {
+            return;
+        }
+        connection->Notified = true;
+    }
+    {
+        std::lock_guard lock(m_ReadyMutex);
+        m_Ready.push_back(connection);
+    }
+    const uint64_t one = 1;
+    [[maybe_unused]] const auto ignored = write(m_Wake, &one, sizeof(one));
+}
+
+// Sends what the workers finished and updates what epoll watches for
+void Server::Flush(const std::shared_ptr<Connection>& connection) {
+    Connection& c = *connection;
+    if (c.Closed) {
+        return;
+    }
+
+    size_t inFlight = 0;
+    {
+        std::lock_guard lock(c.Mutex);
+        c.Output += c.Finished;
+        c.Finished.clear();
+        c.Notified = false;
+        inFlight = c.InFlight;
+    }
+
+    while (c.Sent < c.Output.size()) {
+        const ssize_t sent =
+            send(c.Fd, c.Output.data() + c.Sent, c.Output.size() - c.Sent, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            } else if (errno != EAGAIN) {
+                Close(c);
+                return;
+            }
+            break;
+        }
+        c.Sent += size_t(sent);
+    }
+    if (c.Sent == c.Output.size()) {
+        c.Output.clear();
+        c.Sent = 0;
+    }
+
+    if (c.PeerClosed && inFlight == 0 && c.Output.empty()) {
+        Close(c);
+        return;
+    }
+
+    uint32_t events = 0;
+    if (!c.PeerClosed && inFlight < MAX_IN_FLIGHT) {
+        events |= EPOLLIN;
+    }
+    if (!c.Output.empty()) {
+        events |= EPOLLOUT;
+    }
+    if (events != c.Events) {
+        epoll_event event{};
+        event.events = events;
+        event.data.fd = c.Fd;
+        epoll_ctl(m_Epoll, EPOLL_CTL_MOD, c.Fd, &event);
+        c.Events = events;
+    }
+}
+
+// Workers may still hold the connection, their responses are dropped
+void Server::Close(Connection& connection) {
+    epoll_ctl(m_Epoll, EPOLL_CTL_DEL, connection.Fd, nullptr);
+    close(connection.Fd);
+    connection.Closed = true;
+    m_Connections.erase(connection.Fd);
+}
+
+int RunServer(const ServeOptions& options) {
+    // Blocked before the workers start, which inherit the mask, so only the signalfd sees them
+    const sigset_t signals = ShutdownSignals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    Server server(options);
+    if (!server.Listen(options.Address)) {
+        std::cerr << "Error: cannot listen on " << options.Address << ": " << std::strerror(errno)
+                  << "\n";
+        return 1;
+    }
+    return server.Run();
+}
+
+#else
+
+int RunServer(const ServeOptions&) {
+    std::cerr << "Error: --serve is only supported on Linux\n";
+    return 1;
+}
+
+#endif
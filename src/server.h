@@ -0,0 +1,21 @@
+#pragma once
+
+#include "solver.h"
+#include "utils.h"
+#include <string>
+
+struct ServeOptions {
+    std::string Address;    // a port number listens on 127.0.0.1, anything else is a socket path
+    size_t Threads = 0;     // 0 = hardware concurrency
+    NumericOptions Numeric; // the requests are already spread over threads, Pool is not used
+    SolveLimits Limits;     // per request, so one request can't hold a thread for long
+    size_t CacheBytes = 0;  // memory for a ResultCache shared by all connections, 0 = no cache
+    FormatOptions Format;
+    std::string MetricsPath; // rewritten with the Prometheus dump every few seconds when set
+};
+
+// Serves requests until SIGINT or SIGTERM. A request is a line "<id> <equation>", the response is
+// "<id> <result>" with the result as in batch mode. Clients can pipeline any number of requests,
+// they are solved in parallel and answered as they finish, so the ids match responses to requests.
+// Linux only, the connections are multiplexed with epoll.
+int RunServer(const ServeOptions& options);
@@ -0,0 +1,385 @@
+#include "session.h"
+#include "analysis.h"
+#include "numeric.h"
+#include <algorithm>
+#include <bit>
+#include <unordered_map>
+
+// left + sign * right, trimmed like Analyzer's sums
+static void AddPolynomials(std::span<const double> left, std::span<const double> right, double sign,
+    std::vector<double>& out) {
+    out.resize(std::max(left.size(), right.size()));
+    for (size_t k = 0; k < out.size(); k++) {
+        const double l = k < left.size() ? left[k] : 0.0;
+        const double r = k < right.size() ? right[k] : 0.0;
+        out[k] = sign > 0 ? l + r : l - r;
+    }
+    while (out.size() > 1 && out.back() == 0.0) {
+        out.pop_back();
+    }
+}
+
+EditSession::EditSession(std::string_view text) : m_Text(text) {
+    Rebuild();
+}
+
+template <typename Stop>
+bool EditSession::Split(size_t start, bool negated, Stop&& stop, std::vector<Term>& terms) const {
+    Tokenizer tokenizer(std::string_view(m_Text).substr(start));
+    size_t termStart = start;
+    int depth = 0;
+    bool operand = false; // the last token ends an operand, so a '+' or '-' after it is binary
+
+    while (true) {
+        const auto token = tokenizer.Next();
+        if (!token) {
+            return false;
+        }
+        const TokenType type = token->Type;
+        const bool binary = operand && (type == TokenType::PLUS || type == TokenType::MINUS);
+        const bool separator =
+            type == TokenType::END_OF_FILE ||
+            (depth == 0 && (type == TokenType::EQUAL || type == TokenType::RPAREN || binary));
+        if (!separator) {
+            depth += type == TokenType::LPAREN ? 1 : type == TokenType::RPAREN ? -1 : 0;
+            operand = type == TokenType::NUMBER || type == TokenType::IDENTIFIER ||
+                      type == TokenType::RPAREN;
+            continue;
+        }
+
+        const size_t end = start + token->Offset;
+        Term& term = terms.emplace_back();
+        term.BodySize = end - termStart;
+        term.Separator = type;
+        term.Negated = negated;
+        term.Body.assign(m_Text, termStart, end - termStart);
+        if (type == TokenType::END_OF_FILE) {
+            return true;
+        }
+
+        termStart = end + 1; // every separator is one character
+        negated = type == TokenType::MINUS;
+        operand = false;
+        if (stop(termStart)) {
+            return true;
+        }
+    }
+}
+
+void EditSession::Edit(size_t offset, size_t removed, std::string_view inserted) {
+    offset = std::min(offset, m_Text.size());
+    removed = std::min(removed, m_Text.size() - offset);
+    m_Text.replace(offset, removed, inserted);
+    if (!m_Lexed) {
+        Rebuild();
+        return;
+    }
+
+    // The first damaged term holds offset, its separator included. The old terms from the first
+    // one that starts where the relexed ones do, past the edit, are still valid.
+    const ptrdiff_t delta = ptrdiff_t(inserted.size()) - ptrdiff_t(removed);
+    const size_t first = TermAt(offset);
+    const size_t editEnd = offset + inserted.size();
+    size_t last = first + 1;
+    size_t lastStart = StartOf(first) + m_Terms[first].Size(); // before the edit
+    std::vector<Term> fresh;
+    const bool lexed = Split(StartOf(first), m_Terms[first].Negated,
+        [&](size_t next) {
+            if (next <= editEnd) { // the separator before next was edited
+                return false;
+            }
+            const size_t oldStart = size_t(ptrdiff_t(next) - delta);
+            while (last < m_Terms.size() && lastStart < oldStart) {
+                lastStart += m_Terms[last++].Size();
+            }
+            return last < m_Terms.size() && lastStart == oldStart;
+        },
+        fresh);
+    if (!lexed) {
+        m_Lexed = false;
+        return;
+    }
+    if (fresh.back().Separator == TokenType::END_OF_FILE) {
+        last = m_Terms.size();
+    }
+
+    for (size_t i = first; i < last; i++) {
+        Count(m_Terms[i], -1);
+    }
+    Reuse(fresh, std::span(m_Terms).subspan(first, last - first));
+    for (const Term& term : fresh) {
+        Count(term, 1);
+    }
+
+    // With the same separators the sides keep their terms and only the sums above the new
+    // terms change
+    bool sameShape = fresh.size() == last - first;
+    for (size_t i = 0; sameShape && i < fresh.size(); i++) {
+        sameShape = fresh[i].Separator == m_Terms[first + i].Separator;
+    }
+    if (sameShape) {
+        for (size_t i = 0; i < fresh.size(); i++) {
+            ResizeTerm(
+                first + i, ptrdiff_t(fresh[i].BodySize) - ptrdiff_t(m_Terms[first + i].BodySize));
+            m_Terms[first + i] = std::move(fresh[i]);
+            UpdateSum(first + i);
+        }
+    } else {
+        m_Terms.erase(m_Terms.begin() + ptrdiff_t(first), m_Terms.begin() + ptrdiff_t(last));
+        m_Terms.insert(m_Terms.begin() + ptrdiff_t(first), std::make_move_iterator(fresh.begin()),
+            std::make_move_iterator(fresh.end()));
+        RebuildStarts();
+        RebuildSums();
+    }
+}
+
+void EditSession::Rebuild() {
+    std::vector<Term> fresh;
+    m_Lexed = Split(0, false, [](size_t) { return false; }, fresh);
+    if (!m_Lexed) {
+        return; // the old terms stay around for their analyses
+    }
+    Reuse(fresh, m_Terms);
+    m_Terms = std::move(fresh);
+
+    m_ParseErrors = m_AnalyzeErrors = m_Equals = m_StrayParens = 0;
+    m_Variables.clear();
+    for (const Term& term : m_Terms) {
+        Count(term, 1);
+    }
+    RebuildStarts();
+    RebuildSums();
+}
+
+// Takes the analysis of an old term with the same body, analyzes the terms without one
+void EditSession::Reuse(std::span<Term> fresh, std::span<Term> old) {
+    std::unordered_map<std::string_view, Term*> bodies;
+    if (old.size() > 4) {
+        for (Term& term : old) {
+            bodies.emplace(term.Body, &term);
+        }
+    }
+
+    for (Term& term : fresh) {
+        Term* match = nullptr;
+        if (old.size() > 4) {
+            const auto found = bodies.find(term.Body);
+            match = found == bodies.end() ? nullptr : found->second;
+        } else {
+            const auto found = std::find_if(
+                old.begin(), old.end(), [&](const Term& t) { return t.Body == term.Body; });
+            match = found == old.end() ? nullptr : &*found;
+        }
+
+        if (match && !match->Coefficients.empty()) {
+            term.Variable = std::move(match->Variable);
+            term.ParseError = match->ParseError;
+            term.AnalyzeError = match->AnalyzeError;
+            term.Coefficients = std::move(match->Coefficients);
+            match->Coefficients.clear(); // taken, a second equal term analyzes again
+        } else {
+            Analyze(term);
+        }
+    }
+}
+
+void EditSession::Analyze(Term& term) {
+    m_Arena.Reset();
+    term.Coefficients.assign(1, 0.0);
+
+    Tokenizer tokenizer(term.Body);
+    Parser parser(tokenizer, &m_Arena);
+    parser.SetFoldConstants(true);
+    const auto ast = parser.ParseExpression();
+    term.Variable = parser.VariableName();
+    if (!ast) {
+        term.ParseError = ast.error();
+        return;
+    }
+
+    Analyzer analyzer(&m_Arena);
+    const AnalyzeResult poly = analyzer.Analyze(**ast);
+    if (!poly) {
+        term.AnalyzeError = poly.error();
+        return;
+    }
+    const auto coefficients = analyzer.Coefficients(*poly);
+    term.Coefficients.assign(coefficients.begin(), coefficients.end());
+}
+
+// The first parse error of the term starting at start, when variable is already the variable of
+// the equation. Alone the body ends in END_OF_FILE where the whole equation has its separator.
+SolveError EditSession::FirstParseError(const Term& term, size_t start, std::string_view variable) {
+    SolveError error = term.ParseError.value_or(SolveError{});
+    if (!term.Variable.empty() && !variable.empty() && term.Variable != variable) {
+        m_Arena.Reset();
+        Tokenizer tokenizer(term.Body);
+        Parser parser(tokenizer, &m_Arena);
+        parser.SetFoldConstants(true);
+        parser.SetVariable(variable);
+        if (const auto ast = parser.ParseExpression(); !ast) {
+            error = ast.error();
+        }
+    }
+
+    const bool atSeparator =
+        term.Separator == TokenType::EQUAL || term.Separator == TokenType::RPAREN;
+    if (atSeparator && error.Code == ErrorCode::ExpectedPrimary && error.Offset == term.BodySize) {
+        error.Code = ErrorCode::UnexpectedToken;
+    }
+    error.Offset += start;
+    return error;
+}
+
+void EditSession::Count(const Term& term, int sign) {
+    m_ParseErrors += size_t(sign * term.ParseError.has_value());
+    m_AnalyzeErrors += size_t(sign * term.AnalyzeError.has_value());
+    m_Equals += size_t(sign * (term.Separator == TokenType::EQUAL));
+    m_StrayParens += size_t(sign * (term.Separator == TokenType::RPAREN));
+    if (!term.Variable.empty()) {
+        const auto it = m_Variables.try_emplace(term.Variable, 0).first;
+        if ((it->second += size_t(sign)) == 0) {
+            m_Variables.erase(it);
+        }
+    }
+}
+
+std::expected<void, SolveError> EditSession::Solve(
+    Solutions& solutions, const NumericOptions& numeric) {
+    if (!m_Lexed) {
+        return m_Context.Solve(m_Text, solutions, numeric);
+    }
+    solutions.Values.clear();
+    solutions.IsInfinite = false;
+    solutions.IsNone = false;
+
+    // The errors come in the order the parser would meet them, then the analysis errors
+    const bool valid = m_ParseErrors == 0 && m_AnalyzeErrors == 0 && m_Equals == 1 &&
+                       m_StrayParens == 0 && m_Variables.size() <= 1;
+    if (!valid) {
+        std::string_view variable;
+        size_t equals = 0;
+        size_t start = 0;
+        for (const Term& term : m_Terms) {
+            const bool otherVariable =
+                !term.Variable.empty() && !variable.empty() && term.Variable != variable;
+            if (term.ParseError || otherVariable) {
+                return std::unexpected(FirstParseError(term, start, variable));
+            }
+            if (variable.empty()) {
+                variable = term.Variable;
+            }
+
+            const size_t end = start + term.BodySize;
+            if (term.Separator == TokenType::EQUAL && ++equals == 2) {
+                return std::unexpected(SolveError{ ErrorCode::TrailingInput, end });
+            } else if (term.Separator == TokenType::RPAREN) {
+                return std::unexpected(SolveError{
+                    equals == 0 ? ErrorCode::ExpectedEqual : ErrorCode::TrailingInput, end });
+            } else if (term.Separator == TokenType::END_OF_FILE && equals == 0) {
+                return std::unexpected(SolveError{ ErrorCode::ExpectedEqual, end });
+            }
+            start += term.Size();
+        }
+
+        start = 0;
+        for (const Term& term : m_Terms) {
+            if (term.AnalyzeError) {
+                if (HasNumericFallback(term.AnalyzeError->Code)) {
+                    return m_Context.Solve(m_Text, solutions, numeric);
+                }
+                return std::unexpected(
+                    SolveError{ term.AnalyzeError->Code, start + term.AnalyzeError->Offset });
+            }
+            start += term.Size();
+        }
+    }
+
+    std::vector<double> coefficients;
+    AddPolynomials(m_Sums[0][1], m_Sums[1][1], -1.0, coefficients);
+    m_Arena.Reset();
+    // Roots the rounding hides, or that the text as written doesn't have, are the whole text's
+    // to find
+    if (FindRoots(coefficients, &m_Arena, solutions) ||
+        (coefficients.size() > 3 && !ResidualsVanish(m_Text, solutions.Values))) {
+        return m_Context.Solve(m_Text, solutions, numeric);
+    }
+    return {};
+}
+
+void EditSession::RebuildStarts() {
+    m_Starts.assign(m_Terms.size() + 1, 0);
+    for (size_t i = 1; i <= m_Terms.size(); i++) {
+        m_Starts[i] += m_Terms[i - 1].Size();
+        if (const size_t parent = i + (i & -i); parent <= m_Terms.size()) {
+            m_Starts[parent] += m_Starts[i];
+        }
+    }
+}
+
+void EditSession::ResizeTerm(size_t index, ptrdiff_t delta) {
+    for (size_t i = index + 1; i < m_Starts.size(); i += i & -i) {
+        m_Starts[i] = size_t(ptrdiff_t(m_Starts[i]) + delta);
+    }
+}
+
+size_t EditSession::StartOf(size_t index) const {
+    size_t start = 0;
+    for (size_t i = index; i > 0; i -= i & -i) {
+        start += m_Starts[i];
+    }
+    return start;
+}
+
+// The last term that starts at or before offset
+size_t EditSession::TermAt(size_t offset) const {
+    size_t index = 0;
+    for (size_t step = std::bit_floor(m_Terms.size()); step > 0; step /= 2) {
+        if (index + step <= m_Terms.size() && m_Starts[index + step] <= offset) {
+            index += step;
+            offset -= m_Starts[index];
+        }
+    }
+    return std::min(index, m_Terms.size() - 1);
+}
+
+void EditSession::RebuildSums() {
+    m_RhsStart = m_Terms.size();
+    for (size_t i = 0; i < m_Terms.size(); i++) {
+        if (m_Terms[i].Separator == TokenType::EQUAL) {
+            m_RhsStart = i + 1;
+            break;
+        }
+    }
+
+    const size_t counts[2] = { m_RhsStart, m_Terms.size() - m_RhsStart };
+    for (size_t side = 0; side < 2; side++) {
+        m_Leaves[side] = std::bit_ceil(std::max<size_t>(1, counts[side]));
+        m_Sums[side].resize(2 * m_Leaves[side]); // the old vectors are reused for their memory
+        for (size_t leaf = m_Leaves[side]; leaf < 2 * m_Leaves[side]; leaf++) {
+            const size_t i = leaf - m_Leaves[side] + (side == 0 ? 0 : m_RhsStart);
+            if (leaf - m_Leaves[side] < counts[side]) {
+                AddPolynomials({}, m_Terms[i].Coefficients, m_Terms[i].Negated ? -1.0 : 1.0,
+                    m_Sums[side][leaf]);
+            } else {
+                m_Sums[side][leaf].assign(1, 0.0);
+            }
+        }
+    }
+    for (auto& sums : m_Sums) {
+        for (size_t node = sums.size() / 2; node-- > 1;) {
+            AddPolynomials(sums[2 * node], sums[2 * node + 1], 1.0, sums[node]);
+        }
+    }
+}
+
+void EditSession::UpdateSum(size_t index) {
+    const size_t side = index < m_RhsStart ? 0 : 1;
+    auto& sums = m_Sums[side];
+    size_t node = m_Leaves[side] + index - (side == 0 ? 0 : m_RhsStart);
+    const Term& term = m_Terms[index];
+    AddPolynomials({}, term.Coefficients, term.Negated ? -1.0 : 1.0, sums[node]);
+    for (node /= 2; node >= 1; node /= 2) {
+        AddPolynomials(sums[2 * node], sums[2 * node + 1], 1.0, sums[node]);
+    }
+}
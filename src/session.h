@@ -0,0 +1,91 @@
+#pragma once
+
+#include "context.h"
+#include "tokenizer.h"
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// An equation that is edited in place and re-solved after every change, for editors that solve as
+// the user types. The equation is kept as its top-level terms, the operands of the '+' and '-'
+// outside parentheses on either side. An edit relexes the terms it touches until the token
+// boundaries line up with the old ones again, the other terms keep their polynomials. The terms of
+// a side are added up in a tree of partial sums, so a changed term only redoes the sums on its
+// path to the root. Adding or removing a top-level term rebuilds the sums, without parsing.
+//
+// Solve() gives the same results and errors as ::Solve() on Text(). The sums are grouped
+// pairwise rather than left to right though, so the coefficients can differ in the last bits.
+// Equations the lexer rejects and the ones that need the numeric fallback are solved whole.
+class EditSession {
+  public:
+    explicit EditSession(std::string_view text = {});
+
+    EditSession(const EditSession&) = delete;
+    EditSession& operator=(const EditSession&) = delete;
+
+    // Replaces removed bytes at offset with inserted, both are clamped to the text
+    void Edit(size_t offset, size_t removed, std::string_view inserted);
+
+    std::expected<void, SolveError> Solve(Solutions& solutions, const NumericOptions& numeric = {});
+
+    const std::string& Text() const { return m_Text; }
+
+  private:
+    struct Term {
+        size_t BodySize = 0; // up to the separator, spaces included
+        TokenType Separator = TokenType::END_OF_FILE; // PLUS, MINUS, EQUAL, RPAREN (unmatched)
+        bool Negated = false;                         // comes after a binary '-'
+
+        // Analysis of the body alone, error offsets are relative to the start of the term
+        std::string Body;
+        std::string Variable; // empty when the body has none
+        std::optional<SolveError> ParseError;
+        std::optional<SolveError> AnalyzeError;
+        std::vector<double> Coefficients; // { 0 } after an error
+
+        size_t Size() const { return BodySize + (Separator == TokenType::END_OF_FILE ? 0 : 1); }
+    };
+
+    // Lexes from start, which begins a term, and appends the terms found until stop(start of the
+    // next term) is true or the text ends. False on a lexer error.
+    template <typename Stop>
+    bool Split(size_t start, bool negated, Stop&& stop, std::vector<Term>& terms) const;
+
+    void Rebuild();
+    void Reuse(std::span<Term> fresh, std::span<Term> old);
+    void Analyze(Term& term);
+    SolveError FirstParseError(const Term& term, size_t start, std::string_view variable);
+    void Count(const Term& term, int sign);
+
+    void RebuildStarts();
+    void ResizeTerm(size_t index, ptrdiff_t delta);
+    size_t StartOf(size_t index) const;
+    size_t TermAt(size_t offset) const;
+
+    void RebuildSums();
+    void UpdateSum(size_t index);
+
+    std::string m_Text;
+    std::vector<Term> m_Terms;
+    bool m_Lexed = false; // false after a lexer error, until an edit lexes again
+
+    // Fenwick tree over the term sizes, so finding a term and moving the ones after it is
+    // logarithmic
+    std::vector<size_t> m_Starts;
+
+    // Over all terms, Solve() only looks for the first error when one of them says there is one
+    size_t m_ParseErrors = 0;
+    size_t m_AnalyzeErrors = 0;
+    size_t m_Equals = 0;
+    size_t m_StrayParens = 0;
+    std::unordered_map<std::string, size_t> m_Variables; // terms using each variable
+
+    // Per side, a complete binary tree over the terms of the side, node i adds 2i and 2i + 1
+    std::vector<std::vector<double>> m_Sums[2];
+    size_t m_Leaves[2] = { 1, 1 };
+    size_t m_RhsStart = 0; // first term of the right side, the terms count if there is no '='
+
+    ArenaAllocator m_Arena; // parse and analysis of one term at a time, root finding
+    SolveContext m_Context; // whole solves
+};
@@ -0,0 +1,1031 @@
+#include "simd.h"
+#include "solver.h"
+#include "utils.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numbers>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #include <immintrin.h>
+    #define HAS_X86_SIMD 1
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define TARGET_AVX2
+        #define TARGET_AVX512
+    #else
+        #define TARGET_AVX2 __attribute__((target("avx2")))
+        #define TARGET_AVX512 __attribute__((target("avx512f")))
+    #endif
+#endif
+
+static SimdLevel Detect() {
+#ifdef HAS_X86_SIMD
+    #if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuidex(info, 7, 0);
+    const bool avx512 = (info[1] & (1 << 16)) != 0; // AVX-512F
+    const bool avx2 = (info[1] & (1 << 5)) != 0;
+    // The OS also has to save the wide registers
+    const unsigned long long xcr0 = _xgetbv(0);
+    if (avx512 && (xcr0 & 0xe6) == 0xe6) {
+        return SimdLevel::Avx512;
+    } else if (avx2 && (xcr0 & 0x6) == 0x6) {
+        return SimdLevel::Avx2;
+    }
+    #else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::Avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::Avx2;
+    }
+    #endif
+    return SimdLevel::Sse2; // baseline of x86-64
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel DetectSimdLevel() {
+    static const SimdLevel level = Detect();
+    return level;
+}
+
+const char* SimdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Sse2: return "sse2";
+        case SimdLevel::Avx2: return "avx2";
+        case SimdLevel::Avx512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+static void BinaryScalar(OpCode op, const double* a, const double* b, double* out, size_t i, size_t n) {
+    switch (op) {
+        case OpCode::Add:
+            for (; i < n; i++) {
+                out[i] = a[i] + b[i];
+            }
+            break;
+        case OpCode::Sub:
+            for (; i < n; i++) {
+                out[i] = a[i] - b[i];
+            }
+            break;
+        case OpCode::Mul:
+            for (; i < n; i++) {
+                out[i] = a[i] * b[i];
+            }
+            break;
+        case OpCode::Div:
+            for (; i < n; i++) {
+                out[i] = a[i] / b[i];
+            }
+            break;
+        default: break;
+    }
+}
+
+#ifdef HAS_X86_SIMD
+template <OpCode Op>
+static size_t BinarySse2(const double* a, const double* b, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        const __m128d x = _mm_loadu_pd(a + i);
+        const __m128d y = _mm_loadu_pd(b + i);
+        if constexpr (Op == OpCode::Add) {
+            _mm_storeu_pd(out + i, _mm_add_pd(x, y));
+        } else if constexpr (Op == OpCode::Sub) {
+            _mm_storeu_pd(out + i, _mm_sub_pd(x, y));
+        } else if constexpr (Op == OpCode::Mul) {
+            _mm_storeu_pd(out + i, _mm_mul_pd(x, y));
+        } else {
+            _mm_storeu_pd(out + i, _mm_div_pd(x, y));
+        }
+    }
+    return i;
+}
+
+template <OpCode Op>
+TARGET_AVX2 static size_t BinaryAvx2(const double* a, const double* b, double* out, size_t n) {
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d x = _mm256_loadu_pd(a + i);
+        const __m256d y = _mm256_loadu_pd(b + i);
+        if constexpr (Op == OpCode::Add) {
+            _mm256_storeu_pd(out + i, _mm256_add_pd(x, y));
+        } else if constexpr (Op == OpCode::Sub) {
+            _mm256_storeu_pd(out + i, _mm256_sub_pd(x, y));
+        } else if constexpr (Op == OpCode::Mul) {
+            _mm256_storeu_pd(out + i, _mm256_mul_pd(x, y));
+        } else {
+            _mm256_storeu_pd(out + i, _mm256_div_pd(x, y));
+        }
+    }
+    return i;
+}
+
+template <OpCode Op>
+static size_t BinaryVector(const double* a, const double* b, double* out, size_t n) {
+    if (DetectSimdLevel() >= SimdLevel::Avx2) {
+        return BinaryAvx2<Op>(a, b, out, n);
+    }
+    return BinarySse2<Op>(a, b, out, n);
+}
+#endif
+
+void BinaryArray(OpCode op, const double* a, const double* b, double* out, size_t n) {
+    size_t done = 0;
+#ifdef HAS_X86_SIMD
+    switch (op) {
+        case OpCode::Add: done = BinaryVector<OpCode::Add>(a, b, out, n); break;
+        case OpCode::Sub: done = BinaryVector<OpCode::Sub>(a, b, out, n); break;
+        case OpCode::Mul: done = BinaryVector<OpCode::Mul>(a, b, out, n); break;
+        case OpCode::Div: done = BinaryVector<OpCode::Div>(a, b, out, n); break;
+        default: break;
+    }
+#endif
+    BinaryScalar(op, a, b, out, done, n);
+}
+
+void NegateArray(const double* a, double* out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = -a[i];
+    }
+}
+
+// Entries [i, n). The same arithmetic as the vector versions, so every path gives the same bits.
+static void QuadraticScalar(const double* a, const double* b, const double* c, double* root0,
+    double* root1, uint8_t* count, size_t i, size_t n) {
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+    for (; i < n; i++) {
+        root0[i] = NaN;
+        root1[i] = NaN;
+        if (std::abs(a[i]) < EPS) {
+            if (std::abs(b[i]) < EPS) {
+                count[i] = std::abs(c[i]) < EPS ? INFINITE_ROOTS : 0;
+            } else {
+                root0[i] = -c[i] / b[i];
+                count[i] = 1;
+            }
+            continue;
+        }
+
+        const double delta = b[i] * b[i] - 4 * a[i] * c[i];
+        if (delta < 0) {
+            count[i] = 0;
+        } else if (delta < EPS) {
+            root0[i] = -b[i] / (2 * a[i]);
+            count[i] = 1;
+        } else {
+            const double q = -0.5 * (b[i] + std::copysign(std::sqrt(delta), b[i]));
+            // q / a is the root away from zero, on the side opposite to b
+            root0[i] = std::signbit(b[i]) ? q / a[i] : c[i] / q;
+            root1[i] = std::signbit(b[i]) ? c[i] / q : q / a[i];
+            count[i] = 2;
+        }
+    }
+}
+
+#ifdef HAS_X86_SIMD
+TARGET_AVX2 static size_t QuadraticAvx2(const double* a, const double* b, const double* c,
+    double* root0, double* root1, uint8_t* count, size_t n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d eps = _mm256_set1_pd(EPS);
+    const __m256d nan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d infinite = _mm256_set1_pd(INFINITE_ROOTS);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d va = _mm256_loadu_pd(a + i);
+        const __m256d vb = _mm256_loadu_pd(b + i);
+        const __m256d vc = _mm256_loadu_pd(c + i);
+        const __m256d smallA = _mm256_cmp_pd(_mm256_andnot_pd(sign, va), eps, _CMP_LT_OQ);
+        const __m256d smallB = _mm256_cmp_pd(_mm256_andnot_pd(sign, vb), eps, _CMP_LT_OQ);
+        const __m256d smallC = _mm256_cmp_pd(_mm256_andnot_pd(sign, vc), eps, _CMP_LT_OQ);
+
+        const __m256d delta =
+            _mm256_sub_pd(_mm256_mul_pd(vb, vb), _mm256_mul_pd(_mm256_mul_pd(four, va), vc));
+        const __m256d negative = _mm256_cmp_pd(delta, zero, _CMP_LT_OQ);
+        const __m256d single = _mm256_cmp_pd(delta, eps, _CMP_LT_OQ);
+
+        // Two roots, blendv picks by the sign bit of b
+        const __m256d root = _mm256_or_pd(_mm256_sqrt_pd(delta), _mm256_and_pd(sign, vb));
+        const __m256d q = _mm256_mul_pd(_mm256_set1_pd(-0.5), _mm256_add_pd(vb, root));
+        const __m256d qa = _mm256_div_pd(q, va);
+        const __m256d cq = _mm256_div_pd(vc, q);
+        __m256d r0 = _mm256_blendv_pd(cq, qa, vb);
+        __m256d r1 = _mm256_blendv_pd(qa, cq, vb);
+        __m256d k = two;
+
+        const __m256d repeated = _mm256_div_pd(_mm256_xor_pd(vb, sign), _mm256_mul_pd(two, va));
+        r0 = _mm256_blendv_pd(r0, repeated, single);
+        r1 = _mm256_blendv_pd(r1, nan, single);
+        k = _mm256_blendv_pd(k, one, single);
+        r0 = _mm256_blendv_pd(r0, nan, negative);
+        k = _mm256_blendv_pd(k, zero, negative);
+
+        // Linear or constant
+        const __m256d linear = _mm256_div_pd(_mm256_xor_pd(vc, sign), vb);
+        const __m256d constant = _mm256_blendv_pd(zero, infinite, smallC);
+        r0 = _mm256_blendv_pd(r0, _mm256_blendv_pd(linear, nan, smallB), smallA);
+        r1 = _mm256_blendv_pd(r1, nan, smallA);
+        k = _mm256_blendv_pd(k, _mm256_blendv_pd(one, constant, smallB), smallA);
+
+        _mm256_storeu_pd(root0 + i, r0);
+        _mm256_storeu_pd(root1 + i, r1);
+        __m128i counts = _mm256_cvtpd_epi32(k);
+        counts = _mm_packus_epi16(_mm_packs_epi32(counts, counts), counts);
+        const uint32_t packed = uint32_t(_mm_cvtsi128_si32(counts));
+        std::memcpy(count + i, &packed, sizeof(packed));
+    }
+    return i;
+}
+
+// The bitwise operations on doubles need AVX-512DQ, so they go through the integer versions
+TARGET_AVX512 static inline __m512d FlipSign(__m512d x, __m512i sign) {
+    return _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(x), sign));
+}
+
+// The unmasked AVX-512 intrinsics merge into an undefined register, which GCC 12 reports as maybe
+// uninitialized. These zero-masking forms with every lane selected compute the same.
+constexpr __mmask8 ALL_LANES = 0xff;
+constexpr int ROUND_NEAREST = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+
+// AVX-512 brings FMA along, the products go through the rounding mode version so the compiler
+// can't fuse them into the additions, which would round differently from the other paths
+TARGET_AVX512 static inline __m512d Mul512(__m512d a, __m512d b) {
+    return _mm512_maskz_mul_round_pd(ALL_LANES, a, b, ROUND_NEAREST);
+}
+
+TARGET_AVX512 static inline __m512d Sqrt512(__m512d x) {
+    return _mm512_maskz_sqrt_pd(ALL_LANES, x);
+}
+
+template <int Mode>
+TARGET_AVX512 static inline __m512d Round512(__m512d x) {
+    return _mm512_maskz_roundscale_pd(ALL_LANES, x, Mode);
+}
+
+TARGET_AVX512 static size_t QuadraticAvx512(const double* a, const double* b, const double* c,
+    double* root0, double* root1, uint8_t* count, size_t n) {
+    const __m512i sign = _mm512_set1_epi64(INT64_MIN);
+    const __m512d eps = _mm512_set1_pd(EPS);
+    const __m512d nan = _mm512_set1_pd(std::numeric_limits<double>::quiet_NaN());
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512i noCount = _mm512_setzero_si512();
+    const __m512i oneCount = _mm512_set1_epi64(1);
+    const __m512i infinite = _mm512_set1_epi64(INFINITE_ROOTS);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d va = _mm512_loadu_pd(a + i);
+        const __m512d vb = _mm512_loadu_pd(b + i);
+        const __m512d vc = _mm512_loadu_pd(c + i);
+        const __mmask8 smallA = _mm512_cmp_pd_mask(_mm512_abs_pd(va), eps, _CMP_LT_OQ);
+        const __mmask8 smallB = _mm512_cmp_pd_mask(_mm512_abs_pd(vb), eps, _CMP_LT_OQ);
+        const __mmask8 smallC = _mm512_cmp_pd_mask(_mm512_abs_pd(vc), eps, _CMP_LT_OQ);
+        const __mmask8 negativeB =
+            _mm512_cmplt_epi64_mask(_mm512_castpd_si512(vb), _mm512_setzero_si512());
+
+        const __m512d delta =
+            _mm512_sub_pd(Mul512(vb, vb), Mul512(_mm512_mul_pd(four, va), vc));
+        const __mmask8 negative = _mm512_cmp_pd_mask(delta, zero, _CMP_LT_OQ);
+        const __mmask8 single = _mm512_cmp_pd_mask(delta, eps, _CMP_LT_OQ);
+
+        const __m512d root = _mm512_castsi512_pd(_mm512_or_si512(
+            _mm512_castpd_si512(Sqrt512(delta)),
+            _mm512_and_si512(_mm512_castpd_si512(vb), sign)));
+        const __m512d q = _mm512_mul_pd(_mm512_set1_pd(-0.5), _mm512_add_pd(vb, root));
+        const __m512d qa = _mm512_div_pd(q, va);
+        const __m512d cq = _mm512_div_pd(vc, q);
+        __m512d r0 = _mm512_mask_blend_pd(negativeB, cq, qa);
+        __m512d r1 = _mm512_mask_blend_pd(negativeB, qa, cq);
+        __m512i k = _mm512_set1_epi64(2);
+
+        const __m512d repeated = _mm512_div_pd(FlipSign(vb, sign), _mm512_mul_pd(two, va));
+        r0 = _mm512_mask_blend_pd(single, r0, repeated);
+        r1 = _mm512_mask_blend_pd(single, r1, nan);
+        k = _mm512_mask_blend_epi64(single, k, oneCount);
+        r0 = _mm512_mask_blend_pd(negative, r0, nan);
+        k = _mm512_mask_blend_epi64(negative, k, noCount);
+
+        const __m512d linear = _mm512_div_pd(FlipSign(vc, sign), vb);
+        const __m512i constant = _mm512_mask_blend_epi64(smallC, noCount, infinite);
+        r0 = _mm512_mask_blend_pd(smallA, r0, _mm512_mask_blend_pd(smallB, linear, nan));
+        r1 = _mm512_mask_blend_pd(smallA, r1, nan);
+        k = _mm512_mask_blend_epi64(smallA, k, _mm512_mask_blend_epi64(smallB, oneCount, constant));
+
+        _mm512_storeu_pd(root0 + i, r0);
+        _mm512_storeu_pd(root1 + i, r1);
+        _mm_storel_epi64(
+            reinterpret_cast<__m128i*>(count + i), _mm512_maskz_cvtepi64_epi8(ALL_LANES, k));
+    }
+    return i;
+}
+#endif
+
+void QuadraticArray(const double* a, const double* b, const double* c, double* root0,
+    double* root1, uint8_t* count, size_t n) {
+    size_t done = 0;
+#ifdef HAS_X86_SIMD
+    if (DetectSimdLevel() == SimdLevel::Avx512) {
+        done = QuadraticAvx512(a, b, c, root0, root1, count, n);
+    } else if (DetectSimdLevel() == SimdLevel::Avx2) {
+        done = QuadraticAvx2(a, b, c, root0, root1, count, n);
+    }
+#endif
+    QuadraticScalar(a, b, c, root0, root1, count, done, n);
+}
+
+// The built-in functions. Every kernel exists as a scalar version and as AVX2 and AVX-512
+// versions that do the same operations in the same order, so all paths give the same bits and a
+// value doesn't depend on where it falls in the array.
+
+constexpr double RADIANS_PER_DEGREE = std::numbers::pi / 180.0;
+constexpr double DEGREES_PER_RADIAN = 180.0 / std::numbers::pi;
+
+// Below this x - 90 k is exact, larger values are reduced with fmod first
+constexpr double TRIG_HUGE = 0x1p45;
+
+// fdlibm's kernel sin and cos on [-pi/4, pi/4], lowest degree first. The fast tier drops the last
+// two coefficients of each.
+constexpr double SIN_POLY[] = { -1.66666666666666324348e-01, 8.33333333332248946124e-03,
+    -1.98412698298579493134e-04, 2.75573137070700676789e-06, -2.50507602534068634195e-08,
+    1.58969099521155010221e-10 };
+constexpr double COS_POLY[] = { 4.16666666666666019037e-02, -1.38888888888741095749e-03,
+    2.48015872894767294178e-05, -2.75573143513906633035e-07, 2.08757232129817482790e-09,
+    -1.13596475577881948265e-11 };
+
+// Cephes' atan on [-tan(pi/8), tan(pi/8)] as z P(z) / Q(z) with z = x^2, Q is monic
+constexpr double ATAN_P[] = { -6.485021904942025371773e1, -1.228866684490136173410e2,
+    -7.500855792314704667340e1, -1.615753718733365076637e1, -8.750608600031904122785e-1 };
+constexpr double ATAN_Q[] = { 1.945506571482613964425e2, 4.853903996359136964868e2,
+    4.328810604912902668951e2, 1.650270098316988542046e2, 2.485846490142306297962e1, 1.0 };
+constexpr double TAN_3PI_8 = 2.41421356237309504880;
+
+// fdlibm's log(1 + f) kernel in s = f / (2 + f), the fast tier keeps the first four
+constexpr double LOG_POLY[] = { 6.666666666666735130e-01, 3.999999999940941908e-01,
+    2.857142874366239149e-01, 2.222219843214978396e-01, 1.818357216161805012e-01,
+    1.531383769920937332e-01, 1.479819860511658591e-01 };
+constexpr double LN2_HI = 6.93147180369123816490e-01; // e * LN2_HI is exact
+constexpr double LN2_LO = 1.90821492927058770002e-10;
+constexpr double INV_LN10_HI = 4.34294481878168880939e-01;
+constexpr double INV_LN10_LO = 2.50829467116452752298e-11;
+constexpr double LOG10_2_HI = 3.01029995663611771306e-01;
+constexpr double LOG10_2_LO = 3.69423907715893078616e-13;
+constexpr double LOG10_2 = 3.01029995663981195214e-01;
+
+// Added to the bits of x, the exponent field then says how far to scale x to bring it into
+// [sqrt(1/2), sqrt(2))
+constexpr uint64_t LOG_OFFSET = 0x3ff0000000000000 - 0x3fe6a09e667f3bcd;
+constexpr uint64_t EXPONENT_MAGIC = 0x4330000000000000; // 2^52, an integer below 2^52 ORed in adds
+constexpr double SUBNORMAL_SCALE = 0x1p54;
+
+constexpr size_t SIN_TERMS[] = { 6, 4 }; // accurate, fast
+constexpr size_t COS_TERMS[] = { 6, 4 };
+constexpr size_t LOG_TERMS[] = { 7, 4 };
+
+// c[0] + z (c[1] + z (c[2] + ...)) over the first count coefficients
+static double Horner(const double* c, size_t count, double z) {
+    double p = c[count - 1];
+    for (size_t j = count - 1; j-- > 0;) {
+        p = p * z + c[j];
+    }
+    return p;
+}
+
+// sin and cos of x degrees. The remainder from the nearest multiple of 90 degrees is exact, so
+// sin(180) is 0 and tan(45) is 1, the only rounding before the polynomials is the conversion of the
+// remainder to radians.
+static void SinCosDeg(double x, bool fast, double& sin, double& cos) {
+    if (!(std::abs(x) < TRIG_HUGE)) {
+        if (!std::isfinite(x)) {
+            sin = cos = std::numeric_limits<double>::quiet_NaN();
+            return;
+        }
+        x = std::fmod(x, 360.0); // exact
+    }
+    const double k = std::nearbyint(x * (1.0 / 90.0));
+    const double r = k == 0.0 ? x : x - k * 90.0; // x itself keeps the sign of -0
+    const double q = k - 4.0 * std::floor(k * 0.25);
+
+    const double t = r * RADIANS_PER_DEGREE;
+    const double z = t * t;
+    const double s = t + z * t * Horner(SIN_POLY, SIN_TERMS[fast], z);
+    const double hz = 0.5 * z;
+    const double w = 1.0 - hz;
+    const double c = w + (((1.0 - w) - hz) + z * (z * Horner(COS_POLY, COS_TERMS[fast], z)));
+
+    const bool odd = q == 1.0 || q == 3.0;
+    sin = odd ? c : s;
+    cos = odd ? s : c;
+    if (q >= 2.0) {
+        sin = -sin;
+    }
+    if (q == 1.0 || q == 2.0) {
+        cos = -cos;
+    }
+}
+
+// atan(y / x) in degrees for y, x >= 0. The quotient is folded into the argument reduction, so
+// there is one division besides the one of the rational function.
+static double AtanDeg(double y, double x) {
+    const bool big = y > TAN_3PI_8 * x;
+    const bool mid = !big && y > 0.66 * x;
+    const double num = big ? -x : mid ? y - x : y;
+    const double den = big ? y : mid ? y + x : x;
+    const double base = big ? 90.0 : mid ? 45.0 : 0.0;
+    const double w = num / den;
+    const double z = w * w;
+    const double p =
+        z * Horner(ATAN_P, std::size(ATAN_P), z) / Horner(ATAN_Q, std::size(ATAN_Q), z);
+    return base + (w * p + w) * DEGREES_PER_RADIAN;
+}
+
+// ln(x) or log10(x), NaN outside the domain. x is split as 2^e m with m in [sqrt(1/2), sqrt(2)).
+static double LogElement(double x, bool log10, bool fast) {
+    if (!(x > 0.0)) {
+        return std::numeric_limits<double>::quiet_NaN();
+    } else if (x == std::numeric_limits<double>::infinity()) {
+        return x;
+    }
+    const bool tiny = x < std::numeric_limits<double>::min();
+    const uint64_t bits = std::bit_cast<uint64_t>(tiny ? x * SUBNORMAL_SCALE : x);
+    const uint64_t top = (bits + LOG_OFFSET) >> 52;
+    const double m = std::bit_cast<double>(bits - ((top - 1023) << 52));
+    const double e =
+        (std::bit_cast<double>(top | EXPONENT_MAGIC) - 0x1p52) - (tiny ? 1077.0 : 1023.0);
+
+    const double f = m - 1.0;
+    const double s = f / (2.0 + f);
+    const double z = s * s;
+    const double hfsq = 0.5 * f * f;
+    const double sr = s * (hfsq + z * Horner(LOG_POLY, LOG_TERMS[fast], z));
+    if (fast) {
+        const double lnm = f - (hfsq - sr);
+        return log10 ? e * LOG10_2 + lnm * std::numbers::log10e : e * std::numbers::ln2 + lnm;
+    } else if (!log10) {
+        return e * LN2_HI - ((hfsq - (sr + e * LN2_LO)) - f);
+    }
+
+    // f - hfsq split in a head with 21 bits and a tail, as in fdlibm's log10
+    const double hi = std::bit_cast<double>(std::bit_cast<uint64_t>(f - hfsq) & 0xffffffff00000000);
+    const double lo = ((f - hi) - hfsq) + sr;
+    const double y2 = e * LOG10_2_HI;
+    double valLo = (e * LOG10_2_LO + (lo + hi) * INV_LN10_LO) + lo * INV_LN10_HI;
+    const double valHi = hi * INV_LN10_HI;
+    const double w = y2 + valHi;
+    valLo += (y2 - w) + valHi;
+    return valLo + w;
+}
+
+// Entries [i, n)
+static void FunctionScalar(FunctionType fn, bool fast, const double* in, double* out, size_t i,
+    size_t n) {
+    constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+    double sin, cos;
+    switch (fn) {
+        case FunctionType::Sin:
+            for (; i < n; i++) {
+                SinCosDeg(in[i], fast, sin, cos);
+                out[i] = sin;
+            }
+            break;
+        case FunctionType::Cos:
+            for (; i < n; i++) {
+                SinCosDeg(in[i], fast, sin, cos);
+                out[i] = cos;
+            }
+            break;
+        case FunctionType::Tan:
+            for (; i < n; i++) {
+                SinCosDeg(in[i], fast, sin, cos);
+                out[i] = std::abs(cos) < EPS ? NaN : sin / cos;
+            }
+            break;
+        case FunctionType::Asin:
+            for (; i < n; i++) {
+                const double a = std::abs(in[i]);
+                const double angle = AtanDeg(a, std::sqrt((1.0 - a) * (1.0 + a)));
+                out[i] = a > 1.0 ? NaN : std::copysign(angle, in[i]);
+            }
+            break;
+        case FunctionType::Acos:
+            for (; i < n; i++) {
+                const double angle = 2.0 * AtanDeg(std::sqrt(1.0 - in[i]), std::sqrt(1.0 + in[i]));
+                out[i] = std::abs(in[i]) > 1.0 ? NaN : angle;
+            }
+            break;
+        case FunctionType::Atan:
+            for (; i < n; i++) {
+                out[i] = std::copysign(AtanDeg(std::abs(in[i]), 1.0), in[i]);
+            }
+            break;
+        case FunctionType::Log:
+        case FunctionType::Ln:
+            for (; i < n; i++) {
+                out[i] = LogElement(in[i], fn == FunctionType::Log, fast);
+            }
+            break;
+        case FunctionType::Sqrt:
+            for (; i < n; i++) {
+                out[i] = in[i] < 0.0 ? NaN : std::sqrt(in[i]);
+            }
+            break;
+        case FunctionType::Floor:
+            for (; i < n; i++) {
+                out[i] = std::floor(in[i]);
+            }
+            break;
+        case FunctionType::Ceil:
+            for (; i < n; i++) {
+                out[i] = std::ceil(in[i]);
+            }
+            break;
+        case FunctionType::Abs:
+            for (; i < n; i++) {
+                out[i] = std::abs(in[i]);
+            }
+            break;
+    }
+}
+
+#ifdef HAS_X86_SIMD
+TARGET_AVX2 static inline __m256d HornerAvx2(const double* c, size_t count, __m256d z) {
+    __m256d p = _mm256_set1_pd(c[count - 1]);
+    for (size_t j = count - 1; j-- > 0;) {
+        p = _mm256_add_pd(_mm256_mul_pd(p, z), _mm256_set1_pd(c[j]));
+    }
+    return p;
+}
+
+template <FunctionType Fn, bool Fast>
+TARGET_AVX2 static size_t TrigAvx2(const double* in, double* out, size_t n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d huge = _mm256_set1_pd(TRIG_HUGE);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d three = _mm256_set1_pd(3.0);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d x = _mm256_loadu_pd(in + i);
+        // Huge, infinite and NaN lanes are rare, the scalar version takes the whole vector
+        if (_mm256_movemask_pd(_mm256_cmp_pd(_mm256_andnot_pd(sign, x), huge, _CMP_NLT_UQ))) {
+            FunctionScalar(Fn, Fast, in, out, i, i + 4);
+            continue;
+        }
+
+        const __m256d k =
+            _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.0 / 90.0)), ROUND_NEAREST);
+        const __m256d r = _mm256_blendv_pd(_mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(90.0))),
+            x, _mm256_cmp_pd(k, zero, _CMP_EQ_OQ));
+        const __m256d quarter = _mm256_floor_pd(_mm256_mul_pd(k, _mm256_set1_pd(0.25)));
+        const __m256d q = _mm256_sub_pd(k, _mm256_mul_pd(_mm256_set1_pd(4.0), quarter));
+
+        const __m256d t = _mm256_mul_pd(r, _mm256_set1_pd(RADIANS_PER_DEGREE));
+        const __m256d z = _mm256_mul_pd(t, t);
+        const __m256d s = _mm256_add_pd(
+            t, _mm256_mul_pd(_mm256_mul_pd(z, t), HornerAvx2(SIN_POLY, SIN_TERMS[Fast], z)));
+        const __m256d hz = _mm256_mul_pd(half, z);
+        const __m256d w = _mm256_sub_pd(one, hz);
+        const __m256d tail =
+            _mm256_mul_pd(z, _mm256_mul_pd(z, HornerAvx2(COS_POLY, COS_TERMS[Fast], z)));
+        const __m256d c =
+            _mm256_add_pd(w, _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(one, w), hz), tail));
+
+        const __m256d q1 = _mm256_cmp_pd(q, one, _CMP_EQ_OQ);
+        const __m256d q2 = _mm256_cmp_pd(q, two, _CMP_EQ_OQ);
+        const __m256d odd = _mm256_or_pd(q1, _mm256_cmp_pd(q, three, _CMP_EQ_OQ));
+        const __m256d sin = _mm256_xor_pd(
+            _mm256_blendv_pd(s, c, odd), _mm256_and_pd(sign, _mm256_cmp_pd(q, two, _CMP_GE_OQ)));
+        const __m256d cos =
+            _mm256_xor_pd(_mm256_blendv_pd(c, s, odd), _mm256_and_pd(sign, _mm256_or_pd(q1, q2)));
+        if constexpr (Fn == FunctionType::Sin) {
+            _mm256_storeu_pd(out + i, sin);
+        } else if constexpr (Fn == FunctionType::Cos) {
+            _mm256_storeu_pd(out + i, cos);
+        } else {
+            const __m256d undefined =
+                _mm256_cmp_pd(_mm256_andnot_pd(sign, cos), _mm256_set1_pd(EPS), _CMP_LT_OQ);
+            _mm256_storeu_pd(out + i,
+                _mm256_blendv_pd(_mm256_div_pd(sin, cos),
+                    _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN()), undefined));
+        }
+    }
+    return i;
+}
+
+TARGET_AVX2 static inline __m256d AtanDegAvx2(__m256d y, __m256d x) {
+    const __m256d big = _mm256_cmp_pd(y, _mm256_mul_pd(_mm256_set1_pd(TAN_3PI_8), x), _CMP_GT_OQ);
+    const __m256d mid = _mm256_andnot_pd(
+        big, _mm256_cmp_pd(y, _mm256_mul_pd(_mm256_set1_pd(0.66), x), _CMP_GT_OQ));
+    __m256d num = _mm256_blendv_pd(y, _mm256_sub_pd(y, x), mid);
+    num = _mm256_blendv_pd(num, _mm256_xor_pd(x, _mm256_set1_pd(-0.0)), big);
+    __m256d den = _mm256_blendv_pd(x, _mm256_add_pd(y, x), mid);
+    den = _mm256_blendv_pd(den, y, big);
+    __m256d base = _mm256_and_pd(mid, _mm256_set1_pd(45.0));
+    base = _mm256_blendv_pd(base, _mm256_set1_pd(90.0), big);
+
+    const __m256d w = _mm256_div_pd(num, den);
+    const __m256d z = _mm256_mul_pd(w, w);
+    const __m256d p = _mm256_div_pd(_mm256_mul_pd(z, HornerAvx2(ATAN_P, std::size(ATAN_P), z)),
+        HornerAvx2(ATAN_Q, std::size(ATAN_Q), z));
+    return _mm256_add_pd(base, _mm256_mul_pd(_mm256_add_pd(_mm256_mul_pd(w, p), w),
+        _mm256_set1_pd(DEGREES_PER_RADIAN)));
+}
+
+template <FunctionType Fn>
+TARGET_AVX2 static size_t InverseTrigAvx2(const double* in, double* out, size_t n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d nan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d x = _mm256_loadu_pd(in + i);
+        const __m256d a = _mm256_andnot_pd(sign, x);
+        if constexpr (Fn == FunctionType::Atan) {
+            _mm256_storeu_pd(out + i, _mm256_or_pd(AtanDegAvx2(a, one), _mm256_and_pd(sign, x)));
+            continue;
+        }
+
+        __m256d angle;
+        if constexpr (Fn == FunctionType::Asin) {
+            const __m256d cos = _mm256_sqrt_pd(
+                _mm256_mul_pd(_mm256_sub_pd(one, a), _mm256_add_pd(one, a)));
+            angle = _mm256_or_pd(AtanDegAvx2(a, cos), _mm256_and_pd(sign, x));
+        } else {
+            const __m256d sin = _mm256_sqrt_pd(_mm256_sub_pd(one, x));
+            const __m256d cos = _mm256_sqrt_pd(_mm256_add_pd(one, x));
+            angle = _mm256_mul_pd(_mm256_set1_pd(2.0), AtanDegAvx2(sin, cos));
+        }
+        _mm256_storeu_pd(out + i, _mm256_blendv_pd(angle, nan, _mm256_cmp_pd(a, one, _CMP_GT_OQ)));
+    }
+    return i;
+}
+
+template <bool Log10, bool Fast>
+TARGET_AVX2 static size_t LogAvx2(const double* in, double* out, size_t n) {
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d two = _mm256_set1_pd(2.0);
+    const __m256d inf = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+    const __m256d nan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+    const __m256i bias = _mm256_set1_epi64x(1023);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d x = _mm256_loadu_pd(in + i);
+        const __m256d tiny =
+            _mm256_cmp_pd(x, _mm256_set1_pd(std::numeric_limits<double>::min()), _CMP_LT_OQ);
+        const __m256i bits = _mm256_castpd_si256(
+            _mm256_blendv_pd(x, _mm256_mul_pd(x, _mm256_set1_pd(SUBNORMAL_SCALE)), tiny));
+        const __m256i top =
+            _mm256_srli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(LOG_OFFSET)), 52);
+        const __m256d m = _mm256_castsi256_pd(
+            _mm256_sub_epi64(bits, _mm256_slli_epi64(_mm256_sub_epi64(top, bias), 52)));
+        const __m256d exponent =
+            _mm256_castsi256_pd(_mm256_or_si256(top, _mm256_set1_epi64x(EXPONENT_MAGIC)));
+        const __m256d e = _mm256_sub_pd(_mm256_sub_pd(exponent, _mm256_set1_pd(0x1p52)),
+            _mm256_blendv_pd(_mm256_set1_pd(1023.0), _mm256_set1_pd(1077.0), tiny));
+
+        const __m256d f = _mm256_sub_pd(m, one);
+        const __m256d s = _mm256_div_pd(f, _mm256_add_pd(two, f));
+        const __m256d z = _mm256_mul_pd(s, s);
+        const __m256d hfsq = _mm256_mul_pd(_mm256_mul_pd(half, f), f);
+        const __m256d sr = _mm256_mul_pd(
+            s, _mm256_add_pd(hfsq, _mm256_mul_pd(z, HornerAvx2(LOG_POLY, LOG_TERMS[Fast], z))));
+
+        __m256d result;
+        if constexpr (Fast) {
+            const __m256d lnm = _mm256_sub_pd(f, _mm256_sub_pd(hfsq, sr));
+            if constexpr (Log10) {
+                result = _mm256_add_pd(_mm256_mul_pd(e, _mm256_set1_pd(LOG10_2)),
+                    _mm256_mul_pd(lnm, _mm256_set1_pd(std::numbers::log10e)));
+            } else {
+                result = _mm256_add_pd(_mm256_mul_pd(e, _mm256_set1_pd(std::numbers::ln2)), lnm);
+            }
+        } else if constexpr (!Log10) {
+            result = _mm256_sub_pd(_mm256_mul_pd(e, _mm256_set1_pd(LN2_HI)),
+                _mm256_sub_pd(_mm256_sub_pd(hfsq,
+                    _mm256_add_pd(sr, _mm256_mul_pd(e, _mm256_set1_pd(LN2_LO)))), f));
+        } else {
+            const __m256d hi = _mm256_and_pd(_mm256_sub_pd(f, hfsq),
+                _mm256_castsi256_pd(_mm256_set1_epi64x(int64_t(0xffffffff00000000))));
+            const __m256d lo = _mm256_add_pd(_mm256_sub_pd(_mm256_sub_pd(f, hi), hfsq), sr);
+            const __m256d y2 = _mm256_mul_pd(e, _mm256_set1_pd(LOG10_2_HI));
+            const __m256d tail = _mm256_add_pd(_mm256_mul_pd(e, _mm256_set1_pd(LOG10_2_LO)),
+                _mm256_mul_pd(_mm256_add_pd(lo, hi), _mm256_set1_pd(INV_LN10_LO)));
+            __m256d valLo = _mm256_add_pd(tail, _mm256_mul_pd(lo, _mm256_set1_pd(INV_LN10_HI)));
+            const __m256d valHi = _mm256_mul_pd(hi, _mm256_set1_pd(INV_LN10_HI));
+            const __m256d w = _mm256_add_pd(y2, valHi);
+            valLo = _mm256_add_pd(valLo, _mm256_add_pd(_mm256_sub_pd(y2, w), valHi));
+            result = _mm256_add_pd(valLo, w);
+        }
+        result = _mm256_blendv_pd(result, inf, _mm256_cmp_pd(x, inf, _CMP_EQ_OQ));
+        result = _mm256_blendv_pd(result, nan, _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_NGT_UQ));
+        _mm256_storeu_pd(out + i, result);
+    }
+    return i;
+}
+
+template <FunctionType Fn>
+TARGET_AVX2 static size_t InstructionAvx2(const double* in, double* out, size_t n) {
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d nan = _mm256_set1_pd(std::numeric_limits<double>::quiet_NaN());
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m256d x = _mm256_loadu_pd(in + i);
+        if constexpr (Fn == FunctionType::Sqrt) {
+            const __m256d negative = _mm256_cmp_pd(x, _mm256_setzero_pd(), _CMP_LT_OQ);
+            _mm256_storeu_pd(out + i, _mm256_blendv_pd(_mm256_sqrt_pd(x), nan, negative));
+        } else if constexpr (Fn == FunctionType::Floor) {
+            _mm256_storeu_pd(out + i, _mm256_floor_pd(x));
+        } else if constexpr (Fn == FunctionType::Ceil) {
+            _mm256_storeu_pd(out + i, _mm256_ceil_pd(x));
+        } else {
+            _mm256_storeu_pd(out + i, _mm256_andnot_pd(sign, x));
+        }
+    }
+    return i;
+}
+
+// x with the sign flipped in the lanes of mask
+TARGET_AVX512 static inline __m512d FlipSign(__m512d x, __mmask8 mask) {
+    const __m512i bits = _mm512_castpd_si512(x);
+    return _mm512_castsi512_pd(
+        _mm512_mask_xor_epi64(bits, mask, bits, _mm512_set1_epi64(INT64_MIN)));
+}
+
+TARGET_AVX512 static inline __mmask8 NegativeMask(__m512d x) {
+    return _mm512_cmplt_epi64_mask(_mm512_castpd_si512(x), _mm512_setzero_si512());
+}
+
+TARGET_AVX512 static inline __m512d Horner512(const double* c, size_t count, __m512d z) {
+    __m512d p = _mm512_set1_pd(c[count - 1]);
+    for (size_t j = count - 1; j-- > 0;) {
+        p = _mm512_add_pd(Mul512(p, z), _mm512_set1_pd(c[j]));
+    }
+    return p;
+}
+
+template <FunctionType Fn, bool Fast>
+TARGET_AVX512 static size_t TrigAvx512(const double* in, double* out, size_t n) {
+    const __m512d huge = _mm512_set1_pd(TRIG_HUGE);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d three = _mm512_set1_pd(3.0);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d x = _mm512_loadu_pd(in + i);
+        if (_mm512_cmp_pd_mask(_mm512_abs_pd(x), huge, _CMP_NLT_UQ)) {
+            FunctionScalar(Fn, Fast, in, out, i, i + 8);
+            continue;
+        }
+
+        const __m512d k = Round512<ROUND_NEAREST>(Mul512(x, _mm512_set1_pd(1.0 / 90.0)));
+        const __m512d r = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(k, zero, _CMP_EQ_OQ),
+            _mm512_sub_pd(x, Mul512(k, _mm512_set1_pd(90.0))), x);
+        const __m512d quarter = Round512<_MM_FROUND_TO_NEG_INF>(Mul512(k, _mm512_set1_pd(0.25)));
+        const __m512d q = _mm512_sub_pd(k, Mul512(_mm512_set1_pd(4.0), quarter));
+
+        const __m512d t = Mul512(r, _mm512_set1_pd(RADIANS_PER_DEGREE));
+        const __m512d z = Mul512(t, t);
+        const __m512d s =
+            _mm512_add_pd(t, Mul512(Mul512(z, t), Horner512(SIN_POLY, SIN_TERMS[Fast], z)));
+        const __m512d hz = Mul512(half, z);
+        const __m512d w = _mm512_sub_pd(one, hz);
+        const __m512d tail = Mul512(z, Mul512(z, Horner512(COS_POLY, COS_TERMS[Fast], z)));
+        const __m512d c =
+            _mm512_add_pd(w, _mm512_add_pd(_mm512_sub_pd(_mm512_sub_pd(one, w), hz), tail));
+
+        const __mmask8 q1 = _mm512_cmp_pd_mask(q, one, _CMP_EQ_OQ);
+        const __mmask8 q2 = _mm512_cmp_pd_mask(q, two, _CMP_EQ_OQ);
+        const __mmask8 odd = q1 | _mm512_cmp_pd_mask(q, three, _CMP_EQ_OQ);
+        const __m512d sin =
+            FlipSign(_mm512_mask_blend_pd(odd, s, c), _mm512_cmp_pd_mask(q, two, _CMP_GE_OQ));
+        const __m512d cos = FlipSign(_mm512_mask_blend_pd(odd, c, s), q1 | q2);
+        if constexpr (Fn == FunctionType::Sin) {
+            _mm512_storeu_pd(out + i, sin);
+        } else if constexpr (Fn == FunctionType::Cos) {
+            _mm512_storeu_pd(out + i, cos);
+        } else {
+            const __mmask8 undefined =
+                _mm512_cmp_pd_mask(_mm512_abs_pd(cos), _mm512_set1_pd(EPS), _CMP_LT_OQ);
+            _mm512_storeu_pd(out + i, _mm512_mask_blend_pd(undefined, _mm512_div_pd(sin, cos),
+                _mm512_set1_pd(std::numeric_limits<double>::quiet_NaN())));
+        }
+    }
+    return i;
+}
+
+TARGET_AVX512 static inline __m512d AtanDegAvx512(__m512d y, __m512d x) {
+    const __mmask8 big =
+        _mm512_cmp_pd_mask(y, Mul512(_mm512_set1_pd(TAN_3PI_8), x), _CMP_GT_OQ);
+    const __mmask8 mid =
+        ~big & _mm512_cmp_pd_mask(y, Mul512(_mm512_set1_pd(0.66), x), _CMP_GT_OQ);
+    __m512d num = _mm512_mask_blend_pd(mid, y, _mm512_sub_pd(y, x));
+    num = _mm512_mask_blend_pd(big, num, FlipSign(x, 0xff));
+    __m512d den = _mm512_mask_blend_pd(mid, x, _mm512_add_pd(y, x));
+    den = _mm512_mask_blend_pd(big, den, y);
+    __m512d base = _mm512_maskz_mov_pd(mid, _mm512_set1_pd(45.0));
+    base = _mm512_mask_blend_pd(big, base, _mm512_set1_pd(90.0));
+
+    const __m512d w = _mm512_div_pd(num, den);
+    const __m512d z = Mul512(w, w);
+    const __m512d p = _mm512_div_pd(Mul512(z, Horner512(ATAN_P, std::size(ATAN_P), z)),
+        Horner512(ATAN_Q, std::size(ATAN_Q), z));
+    return _mm512_add_pd(
+        base, Mul512(_mm512_add_pd(Mul512(w, p), w), _mm512_set1_pd(DEGREES_PER_RADIAN)));
+}
+
+template <FunctionType Fn>
+TARGET_AVX512 static size_t InverseTrigAvx512(const double* in, double* out, size_t n) {
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d nan = _mm512_set1_pd(std::numeric_limits<double>::quiet_NaN());
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d x = _mm512_loadu_pd(in + i);
+        const __m512d a = _mm512_abs_pd(x);
+        if constexpr (Fn == FunctionType::Atan) {
+            _mm512_storeu_pd(out + i, FlipSign(AtanDegAvx512(a, one), NegativeMask(x)));
+            continue;
+        }
+
+        __m512d angle;
+        if constexpr (Fn == FunctionType::Asin) {
+            const __m512d cos =
+                Sqrt512(Mul512(_mm512_sub_pd(one, a), _mm512_add_pd(one, a)));
+            angle = FlipSign(AtanDegAvx512(a, cos), NegativeMask(x));
+        } else {
+            const __m512d sin = Sqrt512(_mm512_sub_pd(one, x));
+            const __m512d cos = Sqrt512(_mm512_add_pd(one, x));
+            angle = Mul512(_mm512_set1_pd(2.0), AtanDegAvx512(sin, cos));
+        }
+        _mm512_storeu_pd(out + i,
+            _mm512_mask_blend_pd(_mm512_cmp_pd_mask(a, one, _CMP_GT_OQ), angle, nan));
+    }
+    return i;
+}
+
+template <bool Log10, bool Fast>
+TARGET_AVX512 static size_t LogAvx512(const double* in, double* out, size_t n) {
+    const __m512d half = _mm512_set1_pd(0.5);
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d two = _mm512_set1_pd(2.0);
+    const __m512d inf = _mm512_set1_pd(std::numeric_limits<double>::infinity());
+    const __m512d nan = _mm512_set1_pd(std::numeric_limits<double>::quiet_NaN());
+    const __m512i bias = _mm512_set1_epi64(1023);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d x = _mm512_loadu_pd(in + i);
+        const __mmask8 tiny =
+            _mm512_cmp_pd_mask(x, _mm512_set1_pd(std::numeric_limits<double>::min()), _CMP_LT_OQ);
+        const __m512i bits = _mm512_castpd_si512(
+            _mm512_mask_blend_pd(tiny, x, Mul512(x, _mm512_set1_pd(SUBNORMAL_SCALE))));
+        const __m512i top = _mm512_maskz_srli_epi64(
+            ALL_LANES, _mm512_add_epi64(bits, _mm512_set1_epi64(LOG_OFFSET)), 52);
+        const __m512d m = _mm512_castsi512_pd(_mm512_sub_epi64(
+            bits, _mm512_maskz_slli_epi64(ALL_LANES, _mm512_sub_epi64(top, bias), 52)));
+        const __m512d exponent =
+            _mm512_castsi512_pd(_mm512_or_si512(top, _mm512_set1_epi64(EXPONENT_MAGIC)));
+        const __m512d e = _mm512_sub_pd(_mm512_sub_pd(exponent, _mm512_set1_pd(0x1p52)),
+            _mm512_mask_blend_pd(tiny, _mm512_set1_pd(1023.0), _mm512_set1_pd(1077.0)));
+
+        const __m512d f = _mm512_sub_pd(m, one);
+        const __m512d s = _mm512_div_pd(f, _mm512_add_pd(two, f));
+        const __m512d z = Mul512(s, s);
+        const __m512d hfsq = Mul512(Mul512(half, f), f);
+        const __m512d sr = Mul512(
+            s, _mm512_add_pd(hfsq, Mul512(z, Horner512(LOG_POLY, LOG_TERMS[Fast], z))));
+
+        __m512d result;
+        if constexpr (Fast) {
+            const __m512d lnm = _mm512_sub_pd(f, _mm512_sub_pd(hfsq, sr));
+            if constexpr (Log10) {
+                result = _mm512_add_pd(Mul512(e, _mm512_set1_pd(LOG10_2)),
+                    Mul512(lnm, _mm512_set1_pd(std::numbers::log10e)));
+            } else {
+                result = _mm512_add_pd(Mul512(e, _mm512_set1_pd(std::numbers::ln2)), lnm);
+            }
+        } else if constexpr (!Log10) {
+            result = _mm512_sub_pd(Mul512(e, _mm512_set1_pd(LN2_HI)),
+                _mm512_sub_pd(
+                    _mm512_sub_pd(hfsq, _mm512_add_pd(sr, Mul512(e, _mm512_set1_pd(LN2_LO)))), f));
+        } else {
+            const __m512d hi = _mm512_castsi512_pd(_mm512_and_si512(
+                _mm512_castpd_si512(_mm512_sub_pd(f, hfsq)),
+                _mm512_set1_epi64(int64_t(0xffffffff00000000))));
+            const __m512d lo = _mm512_add_pd(_mm512_sub_pd(_mm512_sub_pd(f, hi), hfsq), sr);
+            const __m512d y2 = Mul512(e, _mm512_set1_pd(LOG10_2_HI));
+            const __m512d tail = _mm512_add_pd(Mul512(e, _mm512_set1_pd(LOG10_2_LO)),
+                Mul512(_mm512_add_pd(lo, hi), _mm512_set1_pd(INV_LN10_LO)));
+            __m512d valLo = _mm512_add_pd(tail, Mul512(lo, _mm512_set1_pd(INV_LN10_HI)));
+            const __m512d valHi = Mul512(hi, _mm512_set1_pd(INV_LN10_HI));
+            const __m512d w = _mm512_add_pd(y2, valHi);
+            valLo = _mm512_add_pd(valLo, _mm512_add_pd(_mm512_sub_pd(y2, w), valHi));
+            result = _mm512_add_pd(valLo, w);
+        }
+        result = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, inf, _CMP_EQ_OQ), result, inf);
+        result = _mm512_mask_blend_pd(
+            _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_NGT_UQ), result, nan);
+        _mm512_storeu_pd(out + i, result);
+    }
+    return i;
+}
+
+template <FunctionType Fn>
+TARGET_AVX512 static size_t InstructionAvx512(const double* in, double* out, size_t n) {
+    const __m512d nan = _mm512_set1_pd(std::numeric_limits<double>::quiet_NaN());
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d x = _mm512_loadu_pd(in + i);
+        if constexpr (Fn == FunctionType::Sqrt) {
+            const __mmask8 negative = _mm512_cmp_pd_mask(x, _mm512_setzero_pd(), _CMP_LT_OQ);
+            _mm512_storeu_pd(out + i, _mm512_mask_blend_pd(negative, Sqrt512(x), nan));
+        } else if constexpr (Fn == FunctionType::Floor) {
+            _mm512_storeu_pd(out + i, Round512<_MM_FROUND_TO_NEG_INF>(x));
+        } else if constexpr (Fn == FunctionType::Ceil) {
+            _mm512_storeu_pd(out + i, Round512<_MM_FROUND_TO_POS_INF>(x));
+        } else {
+            _mm512_storeu_pd(out + i, _mm512_abs_pd(x));
+        }
+    }
+    return i;
+}
+
+template <bool Fast>
+static size_t FunctionVector(
+    FunctionType fn, const double* in, double* out, size_t n, SimdLevel level) {
+    using enum FunctionType;
+    if (level == SimdLevel::Avx512) {
+        switch (fn) {
+            case Sin: return TrigAvx512<Sin, Fast>(in, out, n);
+            case Cos: return TrigAvx512<Cos, Fast>(in, out, n);
+            case Tan: return TrigAvx512<Tan, Fast>(in, out, n);
+            case Asin: return InverseTrigAvx512<Asin>(in, out, n);
+            case Acos: return InverseTrigAvx512<Acos>(in, out, n);
+            case Atan: return InverseTrigAvx512<Atan>(in, out, n);
+            case Log: return LogAvx512<true, Fast>(in, out, n);
+            case Ln: return LogAvx512<false, Fast>(in, out, n);
+            case Sqrt: return InstructionAvx512<Sqrt>(in, out, n);
+            case Floor: return InstructionAvx512<Floor>(in, out, n);
+            case Ceil: return InstructionAvx512<Ceil>(in, out, n);
+            case Abs: return InstructionAvx512<Abs>(in, out, n);
+        }
+    } else if (level == SimdLevel::Avx2) {
+        switch (fn) {
+            case Sin: return TrigAvx2<Sin, Fast>(in, out, n);
+            case Cos: return TrigAvx2<Cos, Fast>(in, out, n);
+            case Tan: return TrigAvx2<Tan, Fast>(in, out, n);
+            case Asin: return InverseTrigAvx2<Asin>(in, out, n);
+            case Acos: return InverseTrigAvx2<Acos>(in, out, n);
+            case Atan: return InverseTrigAvx2<Atan>(in, out, n);
+            case Log: return LogAvx2<true, Fast>(in, out, n);
+            case Ln: return LogAvx2<false, Fast>(in, out, n);
+            case Sqrt: return InstructionAvx2<Sqrt>(in, out, n);
+            case Floor: return InstructionAvx2<Floor>(in, out, n);
+            case Ceil: return InstructionAvx2<Ceil>(in, out, n);
+            case Abs: return InstructionAvx2<Abs>(in, out, n);
+        }
+    }
+    return 0;
+}
+#endif
+
+void FunctionArray(FunctionType fn, const double* in, double* out, size_t n, bool fast) {
+    FunctionArray(fn, in, out, n, fast, DetectSimdLevel());
+}
+
+void FunctionArray(
+    FunctionType fn, const double* in, double* out, size_t n, bool fast, SimdLevel level) {
+    size_t done = 0;
+#ifdef HAS_X86_SIMD
+    level = std::min(level, DetectSimdLevel());
+    done = fast ? FunctionVector<true>(fn, in, out, n, level)
+                : FunctionVector<false>(fn, in, out, n, level);
+#else
+    (void)level;
+#endif
+    FunctionScalar(fn, fast, in, out, done, n);
+}
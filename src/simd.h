@@ -0,0 +1,28 @@
+#pragma once
+
+#include "program.h"
+#include <cstddef>
+#include <cstdint>
+
+enum class SimdLevel : uint8_t { Scalar, Sse2, Avx2, Avx512 };
+
+// Widest instruction set the CPU supports, detected once
+SimdLevel DetectSimdLevel();
+const char* SimdLevelName(SimdLevel level);
+
+// out[i] = a[i] op b[i] for Add, Sub, Mul, Div, using the widest available instruction set.
+// out may alias a or b.
+void BinaryArray(OpCode op, const double* a, const double* b, double* out, size_t n);
+void NegateArray(const double* a, double* out, size_t n);
+
+// Roots of a[i] x^2 + b[i] x + c[i] = 0 into root0[i], root1[i] and count[i], see SolveBatch().
+// The lanes take every branch and keep the one that applies, so mixed cases cost nothing extra.
+void QuadraticArray(const double* a, const double* b, const double* c, double* root0,
+    double* root1, uint8_t* count, size_t n);
+
+// The built-in functions over arrays with polynomial kernels, see MathTier. fast picks the shorter
+// polynomials. out may alias in.
+void FunctionArray(FunctionType fn, const double* in, double* out, size_t n, bool fast);
+// Same on the given level, or the widest one below it the CPU supports, to compare the paths
+void FunctionArray(
+    FunctionType fn, const double* in, double* out, size_t n, bool fast, SimdLevel level);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "analysis.h"
+#include <algorithm>
+#include <array>
+
+// Equation text usable as a template argument: SolveStatic<"2x^2 + 4x - 6 = 0">()
+template <size_t N>
+struct FixedString {
+    consteval FixedString(const char (&text)[N]) { std::copy_n(text, N, Data); }
+    constexpr std::string_view View() const { return { Data, N - 1 }; }
+
+    char Data[N];
+};
+
+// Solutions with the roots in a fixed size array, so they can be a constexpr value
+template <size_t N>
+struct StaticSolutions {
+    std::array<double, N> Values{};
+    bool IsInfinite = false;
+    bool IsNone = false;
+};
+
+// Runs the same pipeline as Solve(), without an arena. N = 0 only counts the roots.
+template <size_t N>
+constexpr std::expected<StaticSolutions<N>, SolveError> SolveStaticInto(std::string_view equation,
+    size_t* count = nullptr) {
+    Solutions solutions;
+    if (auto result = SolveEquation(equation, nullptr, solutions); !result) {
+        return std::unexpected(result.error());
+    }
+
+    StaticSolutions<N> out;
+    std::copy_n(solutions.Values.begin(), std::min(N, solutions.Values.size()), out.Values.begin());
+    out.IsInfinite = solutions.IsInfinite;
+    out.IsNone = solutions.IsNone;
+    if (count) {
+        *count = solutions.Values.size();
+    }
+    return out;
+}
+
+// Only instantiated for a malformed equation, the compiler error names the code and offset
+template <ErrorCode Code, size_t Offset>
+constexpr bool EquationIsValid = false;
+
+// The equation is parsed, analyzed and solved by the compiler, a malformed one does not build
+template <FixedString Equation>
+consteval auto SolveStatic() {
+    // The first pass finds the number of roots, which sizes the result
+    constexpr auto count = []() -> std::expected<size_t, SolveError> {
+        size_t n = 0;
+        if (auto result = SolveStaticInto<0>(Equation.View(), &n); !result) {
+            return std::unexpected(result.error());
+        }
+        return n;
+    }();
+
+    if constexpr (!count) {
+        static_assert(EquationIsValid<count.error().Code, count.error().Offset>,
+            "SolveStatic: the equation does not parse or has no polynomial form");
+        return StaticSolutions<0>{};
+    } else {
+        return *SolveStaticInto<*count>(Equation.View());
+    }
+}
@@ -1,12 +1,67 @@
 #pragma once
 
+#include "error.h"
+#include <chrono>
+#include <cstdint>
+#include <expected>
+#include <span>
 #include <string_view>
 #include <vector>
 
+class ThreadPool;
+
 struct Solutions {
     std::vector<double> Values;
     bool IsInfinite = false;
     bool IsNone = false;
 };
 
-Solutions Solve(std::string_view equation);
+// Equations without a polynomial form (e.g. sin(x) = x/2, 2^x = 10) are solved numerically, only
+// the roots inside [Lo, Hi] are found
+struct NumericOptions {
+    double Lo = -100.0;
+    double Hi = 100.0;
+    size_t Samples = 65536;     // points scanned for sign changes
+    ThreadPool* Pool = nullptr; // spreads the scan over threads, nullptr runs it on the caller
+};
+
+// Caps on the work of one solve, so a hostile equation can't hold a thread for long. 0 is no
+// limit. Crossing one is an error of its own, of the "limit" category.
+struct SolveLimits {
+    size_t MaxInputBytes = 0;
+    size_t MaxTokens = 0;     // END_OF_FILE included
+    size_t MaxNodes = 0;      // of the tree, after folding and sharing
+    size_t MaxDepth = 0;      // parentheses, calls and operators waiting for their right operand
+    size_t MaxArenaBytes = 0; // parse, analysis and root finding
+    std::chrono::microseconds Timeout{ 0 };
+
+    bool Any() const {
+        return MaxInputBytes || MaxTokens || MaxNodes || MaxDepth || MaxArenaBytes ||
+               Timeout.count() > 0;
+    }
+};
+
+std::expected<Solutions, SolveError> Solve(std::string_view equation,
+    const NumericOptions& numeric = {}, const SolveLimits& limits = {});
+
+// Reuses the storage already held by solutions, so a loop that keeps one Solutions object around
+// does not touch the heap.
+std::expected<void, SolveError> Solve(std::string_view equation, Solutions& solutions,
+    const NumericOptions& numeric = {}, const SolveLimits& limits = {});
+
+constexpr uint8_t INFINITE_ROOTS = UINT8_MAX; // a RootsSoA count when every x is a solution
+
+// Roots of many quadratics, entry i belongs to the i-th coefficient triple
+struct RootsSoA {
+    std::vector<double> Root0;  // NaN when there is no root
+    std::vector<double> Root1;  // NaN unless there are two roots
+    std::vector<uint8_t> Count; // 0, 1, 2 or INFINITE_ROOTS
+};
+
+// Solves a[i] x^2 + b[i] x + c[i] = 0 for every i with the case split of Solve(): leading
+// coefficients under EPS lower the degree and a discriminant under EPS gives one root. Two roots
+// come in the order Solve() gives them, but as q / a and c / q with q = -(b + sign(b) sqrt(d)) / 2,
+// which doesn't cancel when b^2 is much larger than 4ac. Runs on AVX2 or AVX-512 when the CPU has
+// them and splits long arrays over pool. out is resized to the shortest of the spans.
+void SolveBatch(std::span<const double> a, std::span<const double> b, std::span<const double> c,
+    RootsSoA& out, ThreadPool* pool = nullptr);
@@ -0,0 +1,371 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numbers>
+
+// Math that also works in constant expressions, for SolveStatic(). The Math* functions call
+// <cmath> at run time and the Static* versions during constant evaluation, so run time results do
+// not change. The Static* versions are accurate to a few ulps.
+
+constexpr double DegToRadians(double deg) {
+    return deg * std::numbers::pi / 180.0;
+}
+constexpr double RadiansToDeg(double rad) {
+    return rad * 180.0 / std::numbers::pi;
+}
+
+constexpr double StaticAbs(double x) {
+    return x < 0.0 ? -x : x;
+}
+
+constexpr double StaticFloor(double x) {
+    if (!(StaticAbs(x) < 4503599627370496.0)) { // 2^52, already integral (or inf/NaN)
+        return x;
+    }
+    const double truncated = double(int64_t(x));
+    return truncated > x ? truncated - 1.0 : truncated;
+}
+
+constexpr double StaticCeil(double x) {
+    return -StaticFloor(-x);
+}
+
+// Exact remainder of |x| / y for y > 0, with the sign of x. Each step subtracts y * 2^k from a
+// value less than twice as large, which has no rounding error.
+constexpr double StaticFmod(double x, double y) {
+    double r = StaticAbs(x);
+    double d = y;
+    while (d <= r * 0.5) {
+        d *= 2.0;
+    }
+    while (d >= y) {
+        if (r >= d) {
+            r -= d;
+        }
+        d *= 0.5;
+    }
+    return x < 0.0 ? -r : r;
+}
+
+constexpr double StaticSqrt(double x) {
+    if (x != x || x < 0.0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    } else if (x == 0.0 || x == std::numeric_limits<double>::infinity()) {
+        return x;
+    }
+
+    // Scale into [1, 4) by powers of 4, then Newton
+    double scale = 1.0;
+    while (x >= 4.0) {
+        x *= 0.25;
+        scale *= 2.0;
+    }
+    while (x < 1.0) {
+        x *= 4.0;
+        scale *= 0.5;
+    }
+    double r = 1.5;
+    for (int i = 0; i < 8; i++) {
+        r = 0.5 * (r + x / r);
+    }
+    return r * scale;
+}
+
+constexpr double StaticLog(double x) {
+    if (x != x || x < 0.0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    } else if (x == 0.0) {
+        return -std::numeric_limits<double>::infinity();
+    } else if (x == std::numeric_limits<double>::infinity()) {
+        return x;
+    }
+
+    // x = m * 2^e with m in [sqrt(2)/2, sqrt(2)], then ln(m) = 2 atanh((m - 1) / (m + 1))
+    int e = 0;
+    while (x >= 2.0) {
+        x *= 0.5;
+        e++;
+    }
+    while (x < 1.0) {
+        x *= 2.0;
+        e--;
+    }
+    if (x > std::numbers::sqrt2) {
+        x *= 0.5;
+        e++;
+    }
+
+    const double s = (x - 1.0) / (x + 1.0);
+    const double s2 = s * s;
+    double term = s;
+    double sum = 0.0;
+    for (int n = 1; n < 40; n += 2) {
+        sum += term / n;
+        term *= s2;
+    }
+    return 2.0 * sum + e * std::numbers::ln2;
+}
+
+constexpr double StaticLog10(double x) {
+    // Exact powers of ten give exact results, like log10() does
+    double power = 1.0;
+    for (int k = 0; k <= 22; k++, power *= 10.0) {
+        if (power == x) {
+            return k;
+        }
+    }
+    return StaticLog(x) / std::numbers::ln10;
+}
+
+constexpr double StaticExp(double x) {
+    if (x != x) {
+        return x;
+    } else if (x > 709.8) {
+        return std::numeric_limits<double>::infinity();
+    } else if (x < -745.2) {
+        return 0.0;
+    }
+
+    // x = k ln(2) + r with |r| <= ln(2) / 2, ln(2) split so k ln(2) is exact
+    constexpr double LN2_HI = 6.93147180369123816490e-01;
+    constexpr double LN2_LO = 1.90821492927058770002e-10;
+    const double k = StaticFloor(x / std::numbers::ln2 + 0.5);
+    const double r = (x - k * LN2_HI) - k * LN2_LO;
+
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 30; n++) {
+        term *= r / n;
+        sum += term;
+    }
+
+    for (int i = 0; i < k; i++) {
+        sum *= 2.0;
+    }
+    for (int i = 0; i > k; i--) {
+        sum *= 0.5;
+    }
+    return sum;
+}
+
+constexpr double StaticPow(double base, double exponent) {
+    if (exponent == 0.0) {
+        return 1.0;
+    } else if (StaticFloor(exponent) == exponent && StaticAbs(exponent) < 4.0e18) {
+        // Integer exponent, exponentiation by squaring
+        auto n = uint64_t(StaticAbs(exponent));
+        double result = 1.0;
+        while (n != 0) {
+            if (n & 1) {
+                result *= base;
+            }
+            base *= base;
+            n >>= 1;
+        }
+        return exponent < 0.0 ? 1.0 / result : result;
+    } else if (base < 0.0) {
+        return std::numeric_limits<double>::quiet_NaN();
+    } else if (base == 0.0) {
+        return exponent > 0.0 ? 0.0 : std::numeric_limits<double>::infinity();
+    }
+    return StaticExp(exponent * StaticLog(base));
+}
+
+// Taylor series, |x| <= pi/4
+constexpr double StaticSinSeries(double x) {
+    const double x2 = x * x;
+    double term = x;
+    double sum = x;
+    for (int n = 1; n < 12; n++) {
+        term *= -x2 / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+constexpr double StaticCosSeries(double x) {
+    const double x2 = x * x;
+    double term = 1.0;
+    double sum = 1.0;
+    for (int n = 1; n < 12; n++) {
+        term *= -x2 / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+// The reduction works in degrees, where all the folding steps are exact, so sin(180) is 0
+constexpr double StaticSinDeg(double deg) {
+    if (deg != deg || StaticAbs(deg) == std::numeric_limits<double>::infinity()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    double x = StaticFmod(StaticAbs(deg), 360.0);
+    double sign = deg < 0.0 ? -1.0 : 1.0;
+    if (x >= 180.0) {
+        x -= 180.0;
+        sign = -sign;
+    }
+    if (x > 90.0) {
+        x = 180.0 - x;
+    }
+    return sign * (x > 45.0 ? StaticCosSeries(DegToRadians(90.0 - x))
+                            : StaticSinSeries(DegToRadians(x)));
+}
+
+constexpr double StaticCosDeg(double deg) {
+    if (deg != deg || StaticAbs(deg) == std::numeric_limits<double>::infinity()) {
+        return std::numeric_limits<double>::quiet_NaN();
+    }
+
+    double x = StaticFmod(StaticAbs(deg), 360.0);
+    if (x > 180.0) {
+        x = 360.0 - x;
+    }
+    double sign = 1.0;
+    if (x > 90.0) {
+        x = 180.0 - x;
+        sign = -1.0;
+    }
+    return sign * (x > 45.0 ? StaticSinSeries(DegToRadians(90.0 - x))
+                            : StaticCosSeries(DegToRadians(x)));
+}
+
+constexpr double StaticAtan(double x) {
+    if (x != x) {
+        return x;
+    } else if (x < 0.0) {
+        return -StaticAtan(-x);
+    } else if (x > 1.0) {
+        return std::numbers::pi / 2 - StaticAtan(1.0 / x);
+    }
+
+    // Halve the angle twice, atan(x) = 2 atan(x / (1 + sqrt(1 + x^2))), then the series
+    x = x / (1.0 + StaticSqrt(1.0 + x * x));
+    x = x / (1.0 + StaticSqrt(1.0 + x * x));
+
+    const double x2 = x * x;
+    double power = x;
+    double sum = 0.0;
+    for (int n = 0; n < 16; n++) {
+        sum += (n % 2 ? -power : power) / (2 * n + 1);
+        power *= x2;
+    }
+    return 4.0 * sum;
+}
+
+constexpr double StaticAsin(double x) { // |x| <= 1
+    if (StaticAbs(x) == 1.0) {
+        return x * std::numbers::pi / 2;
+    }
+    return StaticAtan(x / StaticSqrt((1.0 - x) * (1.0 + x)));
+}
+
+constexpr double StaticAcos(double x) { // |x| <= 1
+    return 2.0 * StaticAtan(StaticSqrt((1.0 - x) / (1.0 + x)));
+}
+
+constexpr double MathAbs(double x) {
+    if consteval {
+        return StaticAbs(x);
+    } else {
+        return std::abs(x);
+    }
+}
+
+constexpr double MathFloor(double x) {
+    if consteval {
+        return StaticFloor(x);
+    } else {
+        return std::floor(x);
+    }
+}
+
+constexpr double MathCeil(double x) {
+    if consteval {
+        return StaticCeil(x);
+    } else {
+        return std::ceil(x);
+    }
+}
+
+constexpr double MathSqrt(double x) {
+    if consteval {
+        return StaticSqrt(x);
+    } else {
+        return std::sqrt(x);
+    }
+}
+
+constexpr double MathLog(double x) {
+    if consteval {
+        return StaticLog(x);
+    } else {
+        return std::log(x);
+    }
+}
+
+constexpr double MathLog10(double x) {
+    if consteval {
+        return StaticLog10(x);
+    } else {
+        return std::log10(x);
+    }
+}
+
+constexpr double MathPow(double base, double exponent) {
+    if consteval {
+        return StaticPow(base, exponent);
+    } else {
+        return std::pow(base, exponent);
+    }
+}
+
+constexpr double MathSinDeg(double deg) {
+    if consteval {
+        return StaticSinDeg(deg);
+    } else {
+        return std::sin(DegToRadians(deg));
+    }
+}
+
+constexpr double MathCosDeg(double deg) {
+    if consteval {
+        return StaticCosDeg(deg);
+    } else {
+        return std::cos(DegToRadians(deg));
+    }
+}
+
+constexpr double MathTanDeg(double deg) {
+    if consteval {
+        return StaticSinDeg(deg) / StaticCosDeg(deg);
+    } else {
+        return std::tan(DegToRadians(deg));
+    }
+}
+
+constexpr double MathAsinDeg(double x) {
+    if consteval {
+        return RadiansToDeg(StaticAsin(x));
+    } else {
+        return RadiansToDeg(std::asin(x));
+    }
+}
+
+constexpr double MathAcosDeg(double x) {
+    if consteval {
+        return RadiansToDeg(StaticAcos(x));
+    } else {
+        return RadiansToDeg(std::acos(x));
+    }
+}
+
+constexpr double MathAtanDeg(double x) {
+    if consteval {
+        return RadiansToDeg(StaticAtan(x));
+    } else {
+        return RadiansToDeg(std::atan(x));
+    }
+}
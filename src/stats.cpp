@@ -0,0 +1,260 @@
+#include "stats.h"
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+static const char* PhaseName(StatsPhase phase) {
+    switch (phase) {
+        case StatsPhase::Parse: return "parse";
+        case StatsPhase::Analyze: return "analyze";
+        case StatsPhase::Roots: return "roots";
+        case StatsPhase::Numeric: return "numeric";
+        default: return "unknown";
+    }
+}
+
+#if ALGEBRA_STATS
+
+constexpr size_t PHASE_COUNT = size_t(StatsPhase::STATS_PHASE_NB);
+constexpr size_t ERROR_COUNT = size_t(ErrorCode::ERROR_CODE_NB);
+
+// Written by its own thread only, so a plain load and store adds without a locked instruction.
+// The fields are still atomics because Stats() reads them from another thread.
+struct ThreadStats {
+    using Counter = std::atomic<uint64_t>;
+
+    std::array<std::array<Counter, LatencyHistogram::BUCKET_COUNT>, PHASE_COUNT> Buckets;
+    std::array<Counter, PHASE_COUNT> Counts;
+    std::array<Counter, PHASE_COUNT> SumsNs;
+    Counter Solves;
+    Counter Parses;
+    Counter Tokens;
+    Counter Nodes;
+    Counter ArenaBytesUsed;
+    Counter ArenaBytesReserved; // the last value, not a sum
+    std::array<Counter, ERROR_COUNT> Errors;
+};
+
+static std::atomic<bool> g_Enabled{ false };
+
+// Blocks outlive their threads, so the counts of finished threads are kept
+static std::mutex g_BlocksMutex;
+static std::vector<std::unique_ptr<ThreadStats>> g_Blocks;
+
+static ThreadStats& LocalStats() {
+    thread_local ThreadStats* stats = [] {
+        auto block = std::make_unique<ThreadStats>();
+        ThreadStats* local = block.get();
+        std::lock_guard lock(g_BlocksMutex);
+        g_Blocks.push_back(std::move(block));
+        return local;
+    }();
+    return *stats;
+}
+
+static void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+bool StatsEnabled() {
+    return g_Enabled.load(std::memory_order_relaxed);
+}
+
+void SetStatsEnabled(bool enabled) {
+    g_Enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void RecordPhase(StatsPhase phase, uint64_t ns) {
+    const size_t width = size_t(std::bit_width(ns));
+    const size_t bucket =
+        std::min(width > LatencyHistogram::MIN_BUCKET_SHIFT
+                     ? width - LatencyHistogram::MIN_BUCKET_SHIFT
+                     : 0,
+            LatencyHistogram::BUCKET_COUNT - 1);
+
+    ThreadStats& stats = LocalStats();
+    Add(stats.Buckets[size_t(phase)][bucket], 1);
+    Add(stats.Counts[size_t(phase)], 1);
+    Add(stats.SumsNs[size_t(phase)], ns);
+}
+
+void RecordParse(size_t tokens, size_t nodes) {
+    if (!StatsEnabled()) {
+        return;
+    }
+    ThreadStats& stats = LocalStats();
+    Add(stats.Parses, 1);
+    Add(stats.Tokens, tokens);
+    Add(stats.Nodes, nodes);
+}
+
+void RecordSolve(size_t arenaUsed, size_t arenaReserved) {
+    if (!StatsEnabled()) {
+        return;
+    }
+    ThreadStats& stats = LocalStats();
+    Add(stats.Solves, 1);
+    Add(stats.ArenaBytesUsed, arenaUsed);
+    stats.ArenaBytesReserved.store(arenaReserved, std::memory_order_relaxed);
+}
+
+void RecordError(ErrorCode code) {
+    if (!StatsEnabled()) {
+        return;
+    }
+    Add(LocalStats().Errors[size_t(code)], 1);
+}
+
+StatsSnapshot Stats() {
+    StatsSnapshot snapshot;
+    const auto load = [](const std::atomic<uint64_t>& counter) {
+        return counter.load(std::memory_order_relaxed);
+    };
+
+    std::lock_guard lock(g_BlocksMutex);
+    for (const auto& block : g_Blocks) {
+        for (size_t p = 0; p < PHASE_COUNT; p++) {
+            LatencyHistogram& histogram = snapshot.Phases[p];
+            for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+                histogram.Buckets[b] += load(block->Buckets[p][b]);
+            }
+            histogram.Count += load(block->Counts[p]);
+            histogram.SumNs += load(block->SumsNs[p]);
+        }
+        snapshot.Solves += load(block->Solves);
+        snapshot.Parses += load(block->Parses);
+        snapshot.Tokens += load(block->Tokens);
+        snapshot.Nodes += load(block->Nodes);
+        snapshot.ArenaBytesUsed += load(block->ArenaBytesUsed);
+        snapshot.ArenaBytesReserved += load(block->ArenaBytesReserved);
+        for (size_t e = 0; e < ERROR_COUNT; e++) {
+            snapshot.Errors[e] += load(block->Errors[e]);
+        }
+    }
+    return snapshot;
+}
+
+#else
+
+StatsSnapshot Stats() {
+    return {};
+}
+
+#endif
+
+static uint64_t BucketBoundNs(size_t bucket) {
+    return uint64_t(1) << (bucket + LatencyHistogram::MIN_BUCKET_SHIFT);
+}
+
+// Upper bound of the bucket holding quantile q, 0 without samples
+static uint64_t QuantileNs(const LatencyHistogram& histogram, double q) {
+    const double rank = q * double(histogram.Count);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+        seen += histogram.Buckets[b];
+        if (seen > 0 && double(seen) >= rank) {
+            return BucketBoundNs(b);
+        }
+    }
+    return 0;
+}
+
+void WriteStats(const StatsSnapshot& stats, std::ostream& out) {
+    const auto perParse = [&](uint64_t total) {
+        return stats.Parses ? double(total) / double(stats.Parses) : 0.0;
+    };
+
+    out << "Solves: " << stats.Solves << "\n";
+    out << "Tokens per equation: " << perParse(stats.Tokens)
+        << ", nodes per equation: " << perParse(stats.Nodes) << "\n";
+    out << "Arena bytes per solve: "
+        << (stats.Solves ? double(stats.ArenaBytesUsed) / double(stats.Solves) : 0.0)
+        << ", reserved: " << stats.ArenaBytesReserved << "\n";
+
+    out << "Phase     count     mean ns   p50 ns <=   p99 ns <=\n";
+    for (size_t p = 0; p < stats.Phases.size(); p++) {
+        const LatencyHistogram& histogram = stats.Phases[p];
+        if (histogram.Count == 0) {
+            continue;
+        }
+        char line[128];
+        std::snprintf(line, sizeof(line), "%-8s %6llu %11.0f %11llu %11llu\n",
+            PhaseName(StatsPhase(p)), static_cast<unsigned long long>(histogram.Count),
+            double(histogram.SumNs) / double(histogram.Count),
+            static_cast<unsigned long long>(QuantileNs(histogram, 0.5)),
+            static_cast<unsigned long long>(QuantileNs(histogram, 0.99)));
+        out << line;
+    }
+
+    for (size_t e = 0; e < stats.Errors.size(); e++) {
+        if (stats.Errors[e] > 0) {
+            out << "Error " << ErrorCodeName(ErrorCode(e)) << ": " << stats.Errors[e] << "\n";
+        }
+    }
+}
+
+void WritePrometheus(const StatsSnapshot& stats, std::ostream& out) {
+    out << "# HELP algebra_phase_duration_seconds Time spent in each phase of a solve.\n"
+           "# TYPE algebra_phase_duration_seconds histogram\n";
+    for (size_t p = 0; p < stats.Phases.size(); p++) {
+        const LatencyHistogram& histogram = stats.Phases[p];
+        const char* phase = PhaseName(StatsPhase(p));
+        uint64_t cumulative = 0;
+        for (size_t b = 0; b < LatencyHistogram::BUCKET_COUNT; b++) {
+            cumulative += histogram.Buckets[b];
+            out << "algebra_phase_duration_seconds_bucket{phase=\"" << phase << "\",le=\"";
+            if (b + 1 < LatencyHistogram::BUCKET_COUNT) {
+                // Shortest exact form, 0.001048576 rather than 0.00104858
+                char bound[32];
+                const double seconds = double(BucketBoundNs(b)) * 1e-9;
+                out << std::string_view(bound, std::to_chars(bound, bound + 32, seconds).ptr);
+            } else {
+                out << "+Inf";
+            }
+            out << "\"} " << cumulative << "\n";
+        }
+        out << "algebra_phase_duration_seconds_sum{phase=\"" << phase << "\"} "
+            << double(histogram.SumNs) * 1e-9 << "\n";
+        out << "algebra_phase_duration_seconds_count{phase=\"" << phase << "\"} "
+            << histogram.Count << "\n";
+    }
+
+    const auto counter = [&](const char* name, const char* help, uint64_t value) {
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n"
+            << name << " " << value << "\n";
+    };
+    counter("algebra_solves_total", "Equations solved.", stats.Solves);
+    counter("algebra_parsed_equations_total", "Equations that parsed.", stats.Parses);
+    counter("algebra_tokens_total", "Tokens in the equations that parsed.", stats.Tokens);
+    counter("algebra_nodes_total", "Tree nodes of the equations that parsed.", stats.Nodes);
+    counter("algebra_arena_used_bytes_total", "Arena bytes used by solves.", stats.ArenaBytesUsed);
+
+    out << "# HELP algebra_arena_reserved_bytes Memory held by the solve arenas.\n"
+           "# TYPE algebra_arena_reserved_bytes gauge\n"
+           "algebra_arena_reserved_bytes "
+        << stats.ArenaBytesReserved << "\n";
+
+    out << "# HELP algebra_errors_total Equations rejected, by error.\n"
+           "# TYPE algebra_errors_total counter\n";
+    for (size_t e = 0; e < stats.Errors.size(); e++) {
+        out << "algebra_errors_total{category=\"" << ErrorCategory(ErrorCode(e)) << "\",code=\""
+            << ErrorCodeName(ErrorCode(e)) << "\"} " << stats.Errors[e] << "\n";
+    }
+}
+
+bool WritePrometheusFile(const std::string& path) {
+    const std::string temporary = path + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::trunc);
+        WritePrometheus(Stats(), file);
+        if (!file.flush()) {
+            return false;
+        }
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "error.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <type_traits>
+
+// Counters around Solve(). Built in unless ALGEBRA_STATS is defined to 0, and even then only
+// recorded after SetStatsEnabled(true), a disabled check is one relaxed load. Every thread counts
+// into its own block, Stats() adds the blocks up, so recording never contends.
+#ifndef ALGEBRA_STATS
+    #define ALGEBRA_STATS 1
+#endif
+
+enum class StatsPhase : uint8_t {
+    Parse, // includes tokenizing, the parser pulls the tokens
+    Analyze,
+    Roots,
+    Numeric, // the fallback for equations without a polynomial form
+
+    STATS_PHASE_NB
+};
+
+// Latencies in power of two buckets, bucket i counts durations under 2^(i + MIN_BUCKET_SHIFT) ns
+// and the last one everything longer
+struct LatencyHistogram {
+    static constexpr size_t MIN_BUCKET_SHIFT = 6; // 64 ns
+    static constexpr size_t BUCKET_COUNT = 22;    // up to 2^26 ns = 67 ms, then +Inf
+
+    std::array<uint64_t, BUCKET_COUNT> Buckets{};
+    uint64_t Count = 0;
+    uint64_t SumNs = 0;
+};
+
+struct StatsSnapshot {
+    std::array<LatencyHistogram, size_t(StatsPhase::STATS_PHASE_NB)> Phases;
+    uint64_t Solves = 0;
+    uint64_t Parses = 0; // equations that parsed, the token and node counts are theirs
+    uint64_t Tokens = 0;
+    uint64_t Nodes = 0;
+    uint64_t ArenaBytesUsed = 0;     // summed over solves
+    uint64_t ArenaBytesReserved = 0; // held by the solve arenas of all threads right now
+    std::array<uint64_t, size_t(ErrorCode::ERROR_CODE_NB)> Errors{};
+};
+
+#if ALGEBRA_STATS
+
+bool StatsEnabled();
+void SetStatsEnabled(bool enabled);
+
+void RecordPhase(StatsPhase phase, uint64_t ns);
+void RecordParse(size_t tokens, size_t nodes);
+void RecordSolve(size_t arenaUsed, size_t arenaReserved);
+void RecordError(ErrorCode code);
+
+// Times one phase from construction to Stop(), free when stats are disabled
+class PhaseTimer {
+  public:
+    explicit PhaseTimer(StatsPhase phase) : m_Phase(phase), m_Enabled(StatsEnabled()) {
+        if (m_Enabled) {
+            m_Start = std::chrono::steady_clock::now();
+        }
+    }
+
+    void Stop() {
+        if (m_Enabled) {
+            const auto elapsed = std::chrono::steady_clock::now() - m_Start;
+            RecordPhase(m_Phase,
+                uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+            m_Enabled = false;
+        }
+    }
+
+  private:
+    StatsPhase m_Phase;
+    bool m_Enabled;
+    std::chrono::steady_clock::time_point m_Start;
+};
+
+#else
+
+constexpr bool StatsEnabled() { return false; }
+inline void SetStatsEnabled(bool) {}
+
+inline void RecordPhase(StatsPhase, uint64_t) {}
+inline void RecordParse(size_t, size_t) {}
+inline void RecordSolve(size_t, size_t) {}
+inline void RecordError(ErrorCode) {}
+
+class PhaseTimer {
+  public:
+    explicit PhaseTimer(StatsPhase) {}
+    void Stop() {}
+};
+
+#endif
+
+// Runs f() and records how long it took, except during constant evaluation
+template <typename F>
+constexpr auto MeasurePhase(StatsPhase phase, F&& f) {
+    if consteval {
+        return f();
+    } else {
+        PhaseTimer timer(phase);
+        if constexpr (std::is_void_v<decltype(f())>) {
+            f();
+            timer.Stop();
+        } else {
+            auto result = f();
+            timer.Stop();
+            return result;
+        }
+    }
+}
+
+StatsSnapshot Stats();
+
+// Human readable summary, for --stats
+void WriteStats(const StatsSnapshot& stats, std::ostream& out);
+
+// Prometheus text exposition format
+void WritePrometheus(const StatsSnapshot& stats, std::ostream& out);
+
+// Replaces the file at path with the Prometheus dump of Stats(). It is written to a temporary file
+// first and renamed, so a reader such as node_exporter's textfile collector never sees half of it.
+bool WritePrometheusFile(const std::string& path);
@@ -0,0 +1,276 @@
+#include "system.h"
+#include "linear_solver.h"
+#include "mapped_file.h"
+#include "output_writer.h"
+#include "parser.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+
+struct LinearTerm {
+    uint32_t Variable;
+    double Coefficient;
+};
+
+// Reduces a tree over several variables to lhs - rhs = sum of Terms() + Constant(). A bottom-up
+// pass folds the constant subtrees and checks that the equation is linear, then a top-down pass
+// hands every variable the product of the factors above it. Both are single scans over the
+// post-order nodes, so the cost stays linear in the length of the equation.
+class LinearAnalyzer {
+  public:
+    std::expected<void, SolveError> Analyze(const Ast& ast) {
+        m_Values.resize(ast.Nodes.size());
+        for (size_t i = 0; i < ast.Nodes.size(); i++) {
+            const auto value = AnalyzeNode(ast, ast.Nodes[i]);
+            if (!value) {
+                return std::unexpected(value.error());
+            }
+            m_Values[i] = *value;
+        }
+
+        Distribute(ast);
+        return {};
+    }
+
+    // Sorted by variable, without zero coefficients
+    std::span<const LinearTerm> Terms() const { return m_Terms; }
+    double Constant() const { return m_Constant; }
+
+  private:
+    struct Value {
+        bool Linear;     // depends on a variable
+        double Constant; // the value otherwise
+    };
+
+    static Value Constant(double value) { return { false, value }; }
+
+    std::expected<Value, SolveError> AnalyzeNode(const Ast& ast, const Node& node) const {
+        const auto error = [](ErrorCode code, size_t offset) {
+            return std::unexpected(SolveError{ code, offset });
+        };
+
+        switch (node.Tag) {
+            case NodeTag::Number: return Constant(ast.Literals[node.Lhs]);
+            case NodeTag::Variable: return Value{ true, 0.0 };
+            case NodeTag::Parameter: return Constant(0.0); // not parsed in a system
+            case NodeTag::Neg: {
+                const Value operand = m_Values[node.Lhs];
+                return operand.Linear ? operand : Constant(-operand.Constant);
+            }
+            case NodeTag::Add:
+            case NodeTag::Sub: {
+                const Value left = m_Values[node.Lhs];
+                const Value right = m_Values[node.Rhs];
+                if (left.Linear || right.Linear) {
+                    return Value{ true, 0.0 };
+                }
+                return Constant(node.Tag == NodeTag::Add ? left.Constant + right.Constant
+                                                         : left.Constant - right.Constant);
+            }
+            case NodeTag::Mul: {
+                const Value left = m_Values[node.Lhs];
+                const Value right = m_Values[node.Rhs];
+                if (left.Linear && right.Linear) {
+                    return error(ErrorCode::NotLinear, node.RhsOffset);
+                } else if (left.Linear || right.Linear) {
+                    return Value{ true, 0.0 };
+                }
+                return Constant(left.Constant * right.Constant);
+            }
+            case NodeTag::Div: {
+                const Value divisor = m_Values[node.Rhs];
+                if (divisor.Linear) {
+                    return error(ErrorCode::DivisionByVariable, node.RhsOffset);
+                } else if (divisor.Constant == 0) {
+                    return error(ErrorCode::DivisionByZero, node.RhsOffset);
+                }
+                const Value dividend = m_Values[node.Lhs];
+                return dividend.Linear ? dividend : Constant(dividend.Constant / divisor.Constant);
+            }
+            case NodeTag::Pow: {
+                const Value base = m_Values[node.Lhs];
+                const Value exp = m_Values[node.Rhs];
+                if (exp.Linear) {
+                    return error(ErrorCode::ExponentContainsVariable, node.RhsOffset);
+                } else if (MathAbs(exp.Constant) < EPS) { // x^0
+                    return Constant(1.0);
+                } else if (MathAbs(exp.Constant - 1.0) < EPS) { // x^1
+                    return base;
+                } else if (base.Linear) {
+                    return error(ErrorCode::NotLinear, node.Offset);
+                } else if (MathAbs(exp.Constant - 2.0) < EPS) {
+                    return Constant(base.Constant * base.Constant);
+                }
+                return Constant(MathPow(base.Constant, exp.Constant));
+            }
+            case NodeTag::Call: {
+                const Value arg = m_Values[node.Lhs];
+                if (arg.Linear) {
+                    return error(ErrorCode::VariableInFunction, node.Offset);
+                }
+                const auto value = ApplyFunction(node.Fn, arg.Constant);
+                if (!value) {
+                    return error(value.error(), node.Offset);
+                }
+                return Constant(*value);
+            }
+        }
+        return error(ErrorCode::UnexpectedToken, node.Offset);
+    }
+
+    // Parents come after their children, so scanning backwards sees every weight complete
+    void Distribute(const Ast& ast) {
+        m_Weights.assign(ast.Nodes.size(), 0.0);
+        m_Weights[ast.Lhs] += 1.0;
+        m_Weights[ast.Rhs] -= 1.0;
+        m_Terms.clear();
+        m_Constant = 0.0;
+
+        for (size_t i = ast.Nodes.size(); i-- > 0;) {
+            const Node& node = ast.Nodes[i];
+            const double weight = m_Weights[i];
+            if (weight == 0.0) {
+                continue;
+            } else if (!m_Values[i].Linear) {
+                m_Constant += weight * m_Values[i].Constant;
+                continue;
+            }
+
+            switch (node.Tag) {
+                case NodeTag::Variable: m_Terms.push_back({ node.Lhs, weight }); break;
+                case NodeTag::Neg: m_Weights[node.Lhs] -= weight; break;
+                case NodeTag::Add:
+                    m_Weights[node.Lhs] += weight;
+                    m_Weights[node.Rhs] += weight;
+                    break;
+                case NodeTag::Sub:
+                    m_Weights[node.Lhs] += weight;
+                    m_Weights[node.Rhs] -= weight;
+                    break;
+                case NodeTag::Mul:
+                    if (m_Values[node.Lhs].Linear) {
+                        m_Weights[node.Lhs] += weight * m_Values[node.Rhs].Constant;
+                    } else {
+                        m_Weights[node.Rhs] += weight * m_Values[node.Lhs].Constant;
+                    }
+                    break;
+                case NodeTag::Div: m_Weights[node.Lhs] += weight / m_Values[node.Rhs].Constant; break;
+                case NodeTag::Pow: m_Weights[node.Lhs] += weight; break; // x^1
+                default: break;
+            }
+        }
+
+        // A variable can appear several times, merge them and drop the ones that cancel out
+        std::sort(m_Terms.begin(), m_Terms.end(),
+            [](const LinearTerm& a, const LinearTerm& b) { return a.Variable < b.Variable; });
+        size_t count = 0;
+        for (size_t i = 0; i < m_Terms.size();) {
+            LinearTerm merged = m_Terms[i++];
+            while (i < m_Terms.size() && m_Terms[i].Variable == merged.Variable) {
+                merged.Coefficient += m_Terms[i++].Coefficient;
+            }
+            if (merged.Coefficient != 0.0) {
+                m_Terms[count++] = merged;
+            }
+        }
+        m_Terms.resize(count);
+    }
+
+    std::vector<Value> m_Values;   // per node
+    std::vector<double> m_Weights; // per node, its factor in lhs - rhs
+    std::vector<LinearTerm> m_Terms;
+    double m_Constant = 0.0;
+};
+
+static void AppendNumber(double value, std::string& out) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+int RunSystem(const SystemOptions& options) {
+    MappedFile input;
+    if (!input.Open(options.InputPath)) {
+        std::cerr << "Error: cannot read " << options.InputPath << "\n";
+        return 1;
+    }
+
+    // Names are views into the input, which outlives the table
+    ArenaAllocator tableArena;
+    Interner variables(&tableArena);
+
+    ArenaAllocator lineArena;
+    LinearAnalyzer analyzer;
+    SparseMatrix matrix;
+    std::vector<double> rhs;
+
+    std::string_view text = input.View();
+    for (size_t lineNumber = 1; !text.empty(); lineNumber++) {
+        const size_t end = text.find('\n');
+        std::string_view line = text.substr(0, end);
+        text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.find_first_not_of(" \t") == std::string_view::npos) {
+            continue;
+        }
+
+        lineArena.Reset();
+        Tokenizer tokenizer(line);
+        Parser parser(tokenizer, &lineArena);
+        parser.SetVariableTable(&variables);
+
+        const auto eq = parser.ParseEquation();
+        const auto result = eq ? analyzer.Analyze(**eq) : std::unexpected(eq.error());
+        if (!result) {
+            std::cerr << "Error: line " << lineNumber << ": " << ErrorMessage(result.error().Code)
+                      << " (column " << result.error().Offset + 1 << ")\n";
+            return 1;
+        }
+
+        // a x + c = 0 is the row a x = -c
+        for (const LinearTerm& term : analyzer.Terms()) {
+            matrix.Columns.push_back(term.Variable);
+            matrix.Values.push_back(term.Coefficient);
+        }
+        matrix.RowStart.push_back(matrix.Columns.size());
+        rhs.push_back(-analyzer.Constant());
+    }
+
+    const size_t unknowns = variables.Size();
+    if (rhs.size() != unknowns) {
+        std::cerr << "Error: " << rhs.size() << " equations for " << unknowns << " unknowns\n";
+        return 1;
+    }
+    matrix.Size = unknowns;
+
+    ThreadPool pool(options.Threads);
+    std::vector<double> solution(unknowns);
+    if (SolveLinearSystem(matrix, rhs, solution, pool) == LinearSolveResult::Singular) {
+        std::cerr << "Error: the system is singular\n";
+        return 1;
+    }
+
+    OutputWriter writer;
+    if (!writer.Open(options.OutputPath)) {
+        std::cerr << "Error: cannot write " << options.OutputPath << "\n";
+        return 1;
+    }
+    std::string out;
+    for (uint32_t id = 0; id < unknowns; id++) {
+        out += variables.Name(id);
+        out += ' ';
+        AppendNumber(solution[id], out);
+        out += '\n';
+    }
+    writer.Write(out);
+
+    if (!writer.Flush()) {
+        std::cerr << "Error: failed writing output\n";
+        return 1;
+    }
+    return 0;
+}
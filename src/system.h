@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+struct SystemOptions {
+    std::string InputPath;  // "-" reads stdin
+    std::string OutputPath; // empty writes to stdout
+    size_t Threads = 0;     // 0 = hardware concurrency
+};
+
+// Reads a linear system, one equation per line over any number of variables, and writes one
+// "<variable> <value>" line per unknown, in the order the variables first appear
+int RunSystem(const SystemOptions& options);
@@ -0,0 +1,107 @@
+#include "tabulate.h"
+#include "compile.h"
+#include "output_writer.h"
+#include "thread_pool.h"
+#include <charconv>
+#include <cmath>
+#include <iostream>
+
+constexpr size_t POINTS_PER_CHUNK = 256 * BLOCK_SIZE;
+
+static bool ParseNumber(std::string_view text, double& value) {
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == std::errc{} && result.ptr == text.data() + text.size();
+}
+
+bool ParseGridSpec(std::string_view spec, TabulateOptions& options) {
+    const size_t eq = spec.find('=');
+    const size_t first = spec.find(':', eq);
+    const size_t second = spec.find(':', first + 1);
+    if (eq == 0 || eq == std::string_view::npos || first == std::string_view::npos ||
+        second == std::string_view::npos) {
+        return false;
+    }
+
+    options.Variable = spec.substr(0, eq);
+    return ParseNumber(spec.substr(eq + 1, first - eq - 1), options.Start) &&
+           ParseNumber(spec.substr(first + 1, second - first - 1), options.Stop) &&
+           ParseNumber(spec.substr(second + 1), options.Step) && options.Step != 0.0 &&
+           (options.Stop - options.Start) / options.Step >= 0.0;
+}
+
+bool ParseMathTier(std::string_view name, MathTier& tier) {
+    if (name == "exact") {
+        tier = MathTier::Exact;
+    } else if (name == "accurate") {
+        tier = MathTier::Accurate;
+    } else if (name == "fast") {
+        tier = MathTier::Fast;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+static void AppendNumber(double value, std::string& out) {
+    char buffer[32];
+    const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, result.ptr);
+}
+
+static void TabulateChunk(const Program& program, const TabulateOptions& options, size_t first,
+    size_t count, std::string& out) {
+    thread_local std::vector<double> registers;
+    registers.resize(program.Code.size() * BLOCK_SIZE);
+
+    double x[BLOCK_SIZE];
+    for (size_t block = 0; block < count; block += BLOCK_SIZE) {
+        const size_t n = std::min(BLOCK_SIZE, count - block);
+        for (size_t i = 0; i < n; i++) {
+            // Computed from the index instead of accumulated, so the error doesn't grow
+            x[i] = options.Start + double(first + block + i) * options.Step;
+        }
+
+        const double* values = ExecuteBlock(program, {}, x, n, registers.data(), options.Math);
+        for (size_t i = 0; i < n; i++) {
+            AppendNumber(x[i], out);
+            out += ' ';
+            AppendNumber(values[i], out);
+            out += '\n';
+        }
+    }
+}
+
+int RunTabulate(const TabulateOptions& options) {
+    const auto program = CompileExpression(options.Expression, options.Variable);
+    if (!program) {
+        std::cerr << "Error: " << ErrorMessage(program.error().Code) << " (column "
+                  << program.error().Offset + 1 << ")\n";
+        return 1;
+    }
+
+    OutputWriter writer;
+    if (!writer.Open(options.OutputPath)) {
+        std::cerr << "Error: cannot write " << options.OutputPath << "\n";
+        return 1;
+    }
+
+    // Small slack so a stop value that is a rounded multiple of the step is still included
+    const size_t points =
+        size_t(std::floor((options.Stop - options.Start) / options.Step + 1e-9)) + 1;
+    const size_t chunks = (points + POINTS_PER_CHUNK - 1) / POINTS_PER_CHUNK;
+
+    ThreadPool pool(options.Threads);
+    pool.RunOrdered(
+        chunks,
+        [&](size_t i, std::string& out) {
+            const size_t first = i * POINTS_PER_CHUNK;
+            TabulateChunk(*program, options, first, std::min(POINTS_PER_CHUNK, points - first), out);
+        },
+        [&](std::string& out) { writer.Write(out); });
+
+    if (!writer.Flush()) {
+        std::cerr << "Error: failed writing output\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "builtins.h"
+#include <string>
+#include <string_view>
+
+struct TabulateOptions {
+    std::string Variable;
+    double Start = 0.0;
+    double Stop = 0.0;
+    double Step = 1.0;
+    std::string Expression;
+    std::string OutputPath; // empty writes to stdout
+    size_t Threads = 0;     // 0 = hardware concurrency
+    MathTier Math = MathTier::Accurate;
+};
+
+// Reads a MathTier given as "exact", "accurate" or "fast"
+bool ParseMathTier(std::string_view name, MathTier& tier);
+
+// Reads a grid given as "<variable>=<start>:<stop>:<step>"
+bool ParseGridSpec(std::string_view spec, TabulateOptions& options);
+
+// Evaluates the expression at every grid point and streams "<x> <value>" lines in grid order
+int RunTabulate(const TabulateOptions& options);
@@ -0,0 +1,130 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <memory>
+
+constexpr size_t CHUNKS_IN_FLIGHT_PER_THREAD = 4;
+
+ThreadPool::ThreadPool(size_t threadCount) : m_Pending(0), m_Stop(false) {
+    if (threadCount == 0) {
+        threadCount = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    m_Workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        m_Workers.emplace_back([this] { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Stop = true;
+    }
+    m_WorkCv.notify_all();
+
+    for (auto& worker : m_Workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard lock(m_Mutex);
+        m_Tasks.push_back(std::move(task));
+        m_Pending++;
+    }
+    m_WorkCv.notify_one();
+}
+
+void ThreadPool::WaitIdle() {
+    std::unique_lock lock(m_Mutex);
+    m_IdleCv.wait(lock, [this] { return m_Pending == 0; });
+}
+
+void ThreadPool::RunAll(size_t count, const std::function<void(size_t)>& body) {
+    // Helpers that start after the call returned find no index left, they only keep work alive
+    struct Progress {
+        std::atomic<size_t> Next{ 0 };
+        std::atomic<size_t> Done{ 0 };
+    };
+    const auto progress = std::make_shared<Progress>();
+    auto run = [progress, &body, count] {
+        for (size_t i; (i = progress->Next.fetch_add(1, std::memory_order_relaxed)) < count;) {
+            body(i);
+            if (progress->Done.fetch_add(1, std::memory_order_acq_rel) + 1 == count) {
+                progress->Done.notify_all();
+            }
+        }
+    };
+
+    // The caller takes indices too, so it finishes even when every worker is busy
+    const size_t helpers = count > 1 ? std::min(count - 1, Size()) : 0;
+    for (size_t i = 0; i < helpers; i++) {
+        Submit(run);
+    }
+    run();
+    for (size_t done; (done = progress->Done.load(std::memory_order_acquire)) != count;) {
+        progress->Done.wait(done, std::memory_order_acquire);
+    }
+}
+
+void ThreadPool::RunOrdered(size_t count,
+    const std::function<void(size_t, std::string&)>& produce,
+    const std::function<void(std::string&)>& consume) {
+    struct Slot {
+        std::string Output;
+        std::atomic<bool> Done{ false };
+    };
+
+    // Chunk i lives in slot i % window until consumed
+    const size_t window = std::min(count, Size() * CHUNKS_IN_FLIGHT_PER_THREAD);
+    const auto slots = std::make_unique<Slot[]>(window);
+
+    auto submit = [&](size_t i) {
+        Submit([&, i] {
+            Slot& slot = slots[i % window];
+            produce(i, slot.Output);
+            slot.Done.store(true, std::memory_order_release);
+            slot.Done.notify_one();
+        });
+    };
+
+    for (size_t i = 0; i < window; i++) {
+        submit(i);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        Slot& slot = slots[i % window];
+        slot.Done.wait(false, std::memory_order_acquire);
+        consume(slot.Output);
+        slot.Output.clear();
+        slot.Done.store(false, std::memory_order_relaxed);
+
+        if (i + window < count) {
+            submit(i + window);
+        }
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    std::function<void()> task;
+    while (true) {
+        {
+            std::unique_lock lock(m_Mutex);
+            m_WorkCv.wait(lock, [this] { return m_Stop || !m_Tasks.empty(); });
+            if (m_Tasks.empty()) {
+                return; // stopped and drained
+            }
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop_front();
+        }
+
+        task();
+        task = nullptr;
+
+        std::lock_guard lock(m_Mutex);
+        if (--m_Pending == 0) {
+            m_IdleCv.notify_all();
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// The most threads --threads accepts
+inline constexpr size_t MAX_THREADS = 1024;
+
+// Fixed set of workers taking tasks FIFO from one locked queue
+class ThreadPool {
+  public:
+    explicit ThreadPool(size_t threadCount = 0); // 0 = hardware concurrency
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+    void WaitIdle();
+
+    // Runs body(i) for every i in [0, count) on the workers and the calling thread and returns
+    // once they are done. Only waits for its own tasks, so a task of the pool can call it too.
+    void RunAll(size_t count, const std::function<void(size_t)>& body);
+
+    // Runs produce(i, out) for every i in [0, count) and hands each out to consume in index order.
+    // Only a few chunks per worker run ahead of consume, so finished output can't pile up.
+    void RunOrdered(size_t count, const std::function<void(size_t, std::string&)>& produce,
+        const std::function<void(std::string&)>& consume);
+
+    size_t Size() const { return m_Workers.size(); }
+
+  private:
+    void WorkerLoop();
+
+    std::vector<std::thread> m_Workers;
+
+    std::mutex m_Mutex;
+    std::condition_variable m_WorkCv;
+    std::condition_variable m_IdleCv;
+    std::deque<std::function<void()>> m_Tasks;
+    size_t m_Pending; // queued + running
+    bool m_Stop;
+};
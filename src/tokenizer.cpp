@@ -1,84 +1,43 @@
 #include "tokenizer.h"
-#include "utils.h"
+#include "budget.h"
 #include <charconv>
 
-Tokenizer::Tokenizer(std::string_view src) : m_Src(src), m_Size(src.size()), m_Index(0) {}
-
-std::vector<Token> Tokenizer::Tokenize() {
+std::expected<std::pmr::vector<Token>, SolveError> Tokenizer::Tokenize(
+    std::pmr::memory_resource* resource) {
     m_Index = 0;
-    std::vector<Token> tokens;
-    tokens.reserve(5);
-
-    while (m_Index < m_Size) {
-        const char c = m_Src[m_Index];
-
-        if (IsSpace(c)) {
-            m_Index++;
-            continue;
-        } else if (IsAlpha(c)) {
-            const size_t start = m_Index;
-            while (m_Index < m_Size && IsAlnum(m_Src[m_Index])) {
-                m_Index++;
-            }
-
-            tokens.emplace_back(std::string(m_Src.data() + start, m_Index - start));
-            continue;
-        } else if (IsDigit(c) || c == '.') {
-            const size_t start = m_Index;
-            bool hasDot = false;
-
-            while (m_Index < m_Size && (IsDigit(m_Src[m_Index]) || m_Src[m_Index] == '.')) {
-                if (m_Src[m_Index] == '.') {
-                    if (hasDot) {
-                        Error("Mutiple dots in a number");
-                    }
-                    hasDot = true;
-                }
-                m_Index++;
-            }
-
-            double value = 0.0;
-            auto result = std::from_chars(m_Src.data() + start, m_Src.data() + m_Index, value);
-            if (result.ec != std::errc{}) {
-                Error("Invalid number format");
-            }
-
-            tokens.emplace_back(value);
-            continue;
+    m_Tokens = 0;
+    std::pmr::vector<Token> tokens(resource);
+    tokens.reserve(16);
+
+    while (true) {
+        auto token = Next();
+        if (!token) {
+            return std::unexpected(token.error());
         }
-
-        switch (c) {
-            case '+': tokens.emplace_back(TokenType::PLUS); break;
-            case '-': tokens.emplace_back(TokenType::MINUS); break;
-            case '*': tokens.emplace_back(TokenType::STAR); break;
-            case '/': tokens.emplace_back(TokenType::FSLASH); break;
-            case '^': tokens.emplace_back(TokenType::CARET); break;
-            case '(': tokens.emplace_back(TokenType::LPAREN); break;
-            case ')': tokens.emplace_back(TokenType::RPAREN); break;
-            case '=': tokens.emplace_back(TokenType::EQUAL); break;
-            default: Error(std::string("Invalid symbol '") + c + "'");
+        tokens.push_back(*token);
+        if (token->Type == TokenType::END_OF_FILE) {
+            return tokens;
         }
-
-        m_Index++;
     }
-
-    tokens.emplace_back(TokenType::END_OF_FILE);
-
-    return tokens;
-}
-
-bool Tokenizer::IsAlpha(char c) {
-    return std::isalpha(static_cast<unsigned char>(c));
 }
 
-bool Tokenizer::IsAlnum(char c) {
-    return std::isalnum(static_cast<unsigned char>(c));
-}
-
-bool Tokenizer::IsDigit(char c) {
-    return std::isdigit(static_cast<unsigned char>(c));
+std::optional<double> Tokenizer::ParseNumber(const char* first, const char* last) {
+    double value = 0.0;
+    auto result = std::from_chars(first, last, value);
+    if (result.ec != std::errc{}) {
+        return std::nullopt;
+    }
+    return value;
 }
 
-bool Tokenizer::IsSpace(char c) {
-    return std::isspace(static_cast<unsigned char>(c));
+std::optional<SolveError> Tokenizer::Charge() {
+    const SolveLimits& limits = m_Budget->Limits();
+    if (limits.MaxInputBytes && m_Size > limits.MaxInputBytes) {
+        return SolveError{ ErrorCode::InputTooLong, limits.MaxInputBytes };
+    } else if (limits.MaxTokens && ++m_Tokens > limits.MaxTokens) {
+        return SolveError{ ErrorCode::TooManyTokens, m_Index };
+    } else if (const std::optional<ErrorCode> code = m_Budget->Check()) {
+        return SolveError{ *code, m_Index };
+    }
+    return std::nullopt;
 }
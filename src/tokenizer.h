@@ -1,7 +1,13 @@
 #pragma once
 
-#include <string>
-#include <variant>
+#include "error.h"
+#include <bit>
+#include <cstdint>
+#include <expected>
+#include <limits>
+#include <memory_resource>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 enum class TokenType {
@@ -16,31 +22,316 @@ enum class TokenType {
     RPAREN,
     EQUAL,
     END_OF_FILE,
+    INVALID, // the lexer failed here, never matched by the parser
 
     TOKEN_TYPE_NB
 };
 
 struct Token {
-    explicit Token(double num) : Type(TokenType::NUMBER), Value(num) {}
-    explicit Token(const std::string& s) : Type(TokenType::IDENTIFIER), Value(s) {}
-    explicit Token(TokenType type) : Type(type), Value(std::monostate{}) {}
+    constexpr Token(double num, size_t offset)
+        : Type(TokenType::NUMBER), Offset(offset), Number(num) {}
+    constexpr Token(std::string_view s, size_t offset)
+        : Type(TokenType::IDENTIFIER), Offset(offset), Number(0.0), Text(s) {}
+    constexpr Token(TokenType type, size_t offset) : Type(type), Offset(offset), Number(0.0) {}
 
     TokenType Type;
-    std::variant<std::monostate, double, std::string> Value;
+    size_t Offset;
+    double Number;         // NUMBER only
+    std::string_view Text; // IDENTIFIER only, points into the source
 };
 
+// Unsigned integer of any size for the exact path of ParseDecimal, least significant limb first
+class BigUnsigned {
+  public:
+    constexpr explicit BigUnsigned(uint32_t value) : m_Limbs{ value } {}
+
+    // *this = *this * factor + addend
+    constexpr void MulAdd(uint32_t factor, uint32_t addend) {
+        uint64_t carry = addend;
+        for (uint32_t& limb : m_Limbs) {
+            const uint64_t product = uint64_t(limb) * factor + carry;
+            limb = uint32_t(product);
+            carry = product >> 32;
+        }
+        if (carry != 0) {
+            m_Limbs.push_back(uint32_t(carry));
+        }
+        Trim();
+    }
+
+    constexpr void ShiftLeft(size_t bits) {
+        const unsigned rest = unsigned(bits % 32);
+        if (rest != 0) {
+            uint32_t carry = 0;
+            for (uint32_t& limb : m_Limbs) {
+                const uint32_t next = limb >> (32 - rest);
+                limb = (limb << rest) | carry;
+                carry = next;
+            }
+            if (carry != 0) {
+                m_Limbs.push_back(carry);
+            }
+        }
+        m_Limbs.insert(m_Limbs.begin(), bits / 32, 0);
+        Trim();
+    }
+
+    // *this -= other, which must not be larger
+    constexpr void Subtract(const BigUnsigned& other) {
+        int64_t borrow = 0;
+        for (size_t i = 0; i < m_Limbs.size(); i++) {
+            int64_t difference = int64_t(m_Limbs[i]) - borrow;
+            if (i < other.m_Limbs.size()) {
+                difference -= other.m_Limbs[i];
+            }
+            borrow = difference < 0;
+            m_Limbs[i] = uint32_t(difference + (borrow << 32));
+        }
+        Trim();
+    }
+
+    constexpr int Compare(const BigUnsigned& other) const {
+        if (m_Limbs.size() != other.m_Limbs.size()) {
+            return m_Limbs.size() < other.m_Limbs.size() ? -1 : 1;
+        }
+        for (size_t i = m_Limbs.size(); i-- > 0;) {
+            if (m_Limbs[i] != other.m_Limbs[i]) {
+                return m_Limbs[i] < other.m_Limbs[i] ? -1 : 1;
+            }
+        }
+        return 0;
+    }
+
+    constexpr size_t BitLength() const {
+        return (m_Limbs.size() - 1) * 32 + std::bit_width(m_Limbs.back());
+    }
+
+    constexpr bool IsZero() const { return m_Limbs.size() == 1 && m_Limbs[0] == 0; }
+
+  private:
+    constexpr void Trim() {
+        while (m_Limbs.size() > 1 && m_Limbs.back() == 0) {
+            m_Limbs.pop_back();
+        }
+    }
+
+    std::vector<uint32_t> m_Limbs;
+};
+
+// Correctly rounded value of the literal from the exact quotient of its digits by the power of ten
+// of its decimals, for the literals the fast path of ParseDecimal can't take
+constexpr std::optional<double> ParseDecimalExact(std::string_view text) {
+    BigUnsigned num(0);
+    BigUnsigned den(1);
+    bool afterDot = false;
+    for (char c : text) {
+        if (c == '.') {
+            afterDot = true;
+            continue;
+        }
+        num.MulAdd(10, uint32_t(c - '0'));
+        if (afterDot) {
+            den.MulAdd(10, 0);
+        }
+    }
+    if (num.IsZero()) {
+        return 0.0;
+    }
+
+    // Scale num / den by 2^-exponent into [2^52, 2^53), or lower where the result is subnormal
+    constexpr int MANTISSA_BITS = std::numeric_limits<double>::digits;
+    constexpr int MIN_EXPONENT = std::numeric_limits<double>::min_exponent - MANTISSA_BITS;
+    int exponent = int(num.BitLength()) - int(den.BitLength()) - MANTISSA_BITS;
+    (exponent > 0 ? den : num).ShiftLeft(size_t(exponent > 0 ? exponent : -exponent));
+    BigUnsigned top = den;
+    top.ShiftLeft(MANTISSA_BITS);
+    if (num.Compare(top) >= 0) {
+        den.ShiftLeft(1);
+        exponent++;
+    }
+    if (exponent < MIN_EXPONENT) {
+        den.ShiftLeft(size_t(MIN_EXPONENT - exponent));
+        exponent = MIN_EXPONENT;
+    }
+
+    // Long division for the 53 bits, num keeps the remainder
+    uint64_t mantissa = 0;
+    for (int bit = MANTISSA_BITS; bit-- > 0;) {
+        BigUnsigned part = den;
+        part.ShiftLeft(size_t(bit));
+        if (num.Compare(part) >= 0) {
+            num.Subtract(part);
+            mantissa |= uint64_t(1) << bit;
+        }
+    }
+
+    // Round half to even
+    num.ShiftLeft(1);
+    const int half = num.Compare(den);
+    if (half > 0 || (half == 0 && (mantissa & 1) != 0)) {
+        mantissa++;
+    }
+    if (mantissa == uint64_t(1) << MANTISSA_BITS) {
+        mantissa >>= 1;
+        exponent++;
+    }
+    if (mantissa == 0 || exponent > std::numeric_limits<double>::max_exponent - MANTISSA_BITS) {
+        return std::nullopt; // from_chars reports out of range as well
+    }
+
+    // Every power of two on the way is exact, the result is representable
+    double value = double(mantissa);
+    for (; exponent > 0; exponent--) {
+        value *= 2.0;
+    }
+    for (; exponent < 0; exponent++) {
+        value *= 0.5;
+    }
+    return value;
+}
+
+// Parses the digits and the optional dot of a number literal, nullopt without any digit. Used
+// during constant evaluation where std::from_chars is not available, the result is correctly
+// rounded. Digits that fit in 2^53 with at most 22 decimals or trailing zeros take the fast
+// path of a single rounded multiplication or division, the others are done exactly.
+constexpr std::optional<double> ParseDecimal(std::string_view text) {
+    uint64_t mantissa = 0;
+    int digits = 0;   // significant digits in mantissa
+    int exponent = 0; // power of ten the mantissa is scaled by
+    bool hasDigit = false;
+    bool afterDot = false;
+    bool dropped = false; // a nonzero digit past the 19 kept
+
+    for (char c : text) {
+        if (c == '.') {
+            afterDot = true;
+            continue;
+        }
+        hasDigit = true;
+        if (digits < 19) {
+            if (mantissa != 0 || c != '0') {
+                digits++;
+            }
+            mantissa = mantissa * 10 + uint64_t(c - '0');
+            exponent -= afterDot;
+        } else {
+            dropped |= c != '0';
+            exponent += !afterDot; // digits past the precision only keep their magnitude
+        }
+    }
+    if (!hasDigit) {
+        return std::nullopt;
+    }
+
+    // Both the mantissa and the power of ten are exact doubles
+    constexpr int MAX_EXACT_POWER = 22;
+    if (mantissa != 0 && (dropped || mantissa > uint64_t(1) << 53 || exponent > MAX_EXACT_POWER ||
+                             exponent < -MAX_EXACT_POWER)) {
+        return ParseDecimalExact(text);
+    }
+
+    const double value = double(mantissa);
+    double scale = 1.0;
+    for (int i = 0; i < (exponent < 0 ? -exponent : exponent); i++) {
+        scale *= 10.0;
+    }
+    return exponent < 0 ? value / scale : value * scale;
+}
+
+class SolveBudget;
+
 class Tokenizer {
   public:
-    Tokenizer(std::string_view src);
-    std::vector<Token> Tokenize();
+    constexpr Tokenizer(std::string_view src) : m_Src(src), m_Size(src.size()), m_Index(0) {}
+
+    constexpr size_t Size() const { return m_Size; } // of the source in bytes
+
+    // Every token is counted against budget, which also covers the input size and the time
+    constexpr void SetBudget(SolveBudget* budget) { m_Budget = budget; }
+
+    // Lexes the token at the current position and moves past it, END_OF_FILE is returned
+    // again and again once the source is exhausted
+    constexpr std::expected<Token, SolveError> Next() {
+        while (m_Index < m_Size && IsSpace(m_Src[m_Index])) {
+            m_Index++;
+        }
+        if (m_Budget) {
+            if (const std::optional<SolveError> error = Charge()) {
+                return std::unexpected(*error);
+            }
+        }
+        if (m_Index >= m_Size) {
+            return Token(TokenType::END_OF_FILE, m_Size);
+        }
+
+        const char c = m_Src[m_Index];
+        const size_t start = m_Index;
+
+        if (IsAlpha(c)) {
+            while (m_Index < m_Size && IsAlnum(m_Src[m_Index])) {
+                m_Index++;
+            }
+            return Token(m_Src.substr(start, m_Index - start), start);
+        } else if (IsDigit(c) || c == '.') {
+            bool hasDot = false;
+
+            while (m_Index < m_Size && (IsDigit(m_Src[m_Index]) || m_Src[m_Index] == '.')) {
+                if (m_Src[m_Index] == '.') {
+                    if (hasDot) {
+                        return std::unexpected(SolveError{ ErrorCode::MultipleDots, m_Index });
+                    }
+                    hasDot = true;
+                }
+                m_Index++;
+            }
+
+            std::optional<double> value;
+            if consteval {
+                value = ParseDecimal(m_Src.substr(start, m_Index - start));
+            } else {
+                value = ParseNumber(m_Src.data() + start, m_Src.data() + m_Index);
+            }
+            if (!value) {
+                return std::unexpected(SolveError{ ErrorCode::InvalidNumber, start });
+            }
+            return Token(*value, start);
+        }
+
+        m_Index++;
+        switch (c) {
+            case '+': return Token(TokenType::PLUS, start);
+            case '-': return Token(TokenType::MINUS, start);
+            case '*': return Token(TokenType::STAR, start);
+            case '/': return Token(TokenType::FSLASH, start);
+            case '^': return Token(TokenType::CARET, start);
+            case '(': return Token(TokenType::LPAREN, start);
+            case ')': return Token(TokenType::RPAREN, start);
+            case '=': return Token(TokenType::EQUAL, start);
+            default: return std::unexpected(SolveError{ ErrorCode::InvalidSymbol, start });
+        }
+    }
+
+    // Whole token list at once, ending with END_OF_FILE
+    std::expected<std::pmr::vector<Token>, SolveError> Tokenize(
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
 
   private:
-    static bool IsAlpha(char c);
-    static bool IsAlnum(char c);
-    static bool IsDigit(char c);
-    static bool IsSpace(char c);
+    // ASCII only, same as <cctype> in the "C" locale
+    static constexpr bool IsAlpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+    static constexpr bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+    static constexpr bool IsAlnum(char c) { return IsAlpha(c) || IsDigit(c); }
+    static constexpr bool IsSpace(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
+    static std::optional<double> ParseNumber(const char* first, const char* last); // from_chars
+
+    // The limit error of the token starting at m_Index, if it crosses one
+    std::optional<SolveError> Charge();
 
     const std::string_view m_Src;
     const size_t m_Size;
     size_t m_Index;
-};
\ No newline at end of file
+    SolveBudget* m_Budget = nullptr;
+    size_t m_Tokens = 0; // charged so far
+};
@@ -1,18 +1,115 @@
 #include "utils.h"
-#include <format>
-#include <iostream>
+#include <algorithm>
+#include <charconv>
 
-ArenaAllocator::ArenaAllocator(size_t chunkSize) : m_Size(chunkSize) {
-    m_Buffer = new std::byte[m_Size];
-    m_Offset = m_Buffer;
-}
+ArenaAllocator::ArenaAllocator(size_t chunkSize)
+    : m_ChunkSize(chunkSize), m_Head(nullptr), m_Current(nullptr), m_Offset(nullptr),
+      m_End(nullptr) {}
 
 ArenaAllocator::~ArenaAllocator() {
-    delete[] m_Buffer;
+    FreeChunks();
+}
+
+void ArenaAllocator::FreeChunks() {
+    while (m_Head) {
+        Chunk* next = m_Head->Next;
+        ::operator delete(m_Head);
+        m_Head = next;
+    }
+    m_Current = nullptr;
 }
 
-[[noreturn]] void Error(const std::string& msg) {
-    std::cerr << "Error: " << msg << "\n";
-    std::cin.get();
-    std::exit(1);
+ArenaAllocator::Chunk* ArenaAllocator::NewChunk(size_t size) {
+    Chunk* chunk = static_cast<Chunk*>(::operator new(sizeof(Chunk) + size));
+    chunk->Next = nullptr;
+    chunk->Size = size;
+    return chunk;
+}
+
+void ArenaAllocator::UseChunk(Chunk* chunk) {
+    m_Current = chunk;
+    m_Offset = chunk->Data();
+    m_End = chunk->Data() + chunk->Size;
+}
+
+void* ArenaAllocator::AllocateSlow(size_t bytes, size_t alignment) {
+    // Chunks left over from before the last Reset() come first
+    while (m_Current && m_Current->Next) {
+        UseChunk(m_Current->Next);
+        std::byte* start = AlignUp(m_Offset, alignment);
+        if (bytes <= size_t(m_End - start)) {
+            m_Offset = start + bytes;
+            return start;
+        }
+    }
+
+    // Grow geometrically so a huge input needs few chunks
+    size_t size = m_Current ? std::max(m_ChunkSize, m_Current->Size * 2) : m_ChunkSize;
+    size = std::max(size, bytes + alignment);
+
+    Chunk* chunk = NewChunk(size);
+    if (m_Current) {
+        m_Current->Next = chunk;
+    } else {
+        m_Head = chunk;
+    }
+    UseChunk(chunk);
+
+    std::byte* start = AlignUp(m_Offset, alignment);
+    m_Offset = start + bytes;
+    return start;
+}
+
+void ArenaAllocator::Reset() {
+    if (!m_Head) {
+        return;
+    }
+
+    // The last round needed more than one chunk: merge them so the next rounds fit in one
+    if (m_Head->Next) {
+        const size_t total = BytesReserved();
+        FreeChunks();
+        m_Head = NewChunk(total);
+    }
+    UseChunk(m_Head);
+}
+
+size_t ArenaAllocator::BytesUsed() const {
+    size_t used = 0;
+    for (Chunk* chunk = m_Head; chunk; chunk = chunk->Next) {
+        if (chunk == m_Current) {
+            return used + size_t(m_Offset - chunk->Data());
+        }
+        used += chunk->Size;
+    }
+    return used;
+}
+
+size_t ArenaAllocator::BytesReserved() const {
+    size_t reserved = 0;
+    for (Chunk* chunk = m_Head; chunk; chunk = chunk->Next) {
+        reserved += chunk->Size;
+    }
+    return reserved;
+}
+
+std::string_view FormatDouble(double x, const FormatOptions& options) {
+    // Sign, the 309 integer digits of DBL_MAX, the point and the decimals
+    thread_local char buffer[312 + MAX_FORMAT_PRECISION];
+    char* const end = buffer + sizeof(buffer);
+
+    if (options.Precision == FormatOptions::SHORTEST) {
+        return { buffer, std::to_chars(buffer, end, x).ptr };
+    }
+
+    const int precision = std::clamp(options.Precision, 0, MAX_FORMAT_PRECISION);
+    const auto result = std::to_chars(buffer, end, x, std::chars_format::fixed, precision);
+    std::string_view s(buffer, result.ptr);
+    if (options.TrimZeros && s.find('.') != std::string_view::npos) {
+        s = s.substr(0, s.find_last_not_of('0') + 1);
+        if (s.back() == '.') {
+            s.remove_suffix(1);
+        }
+    }
+    return s;
 }
@@ -1,33 +1,251 @@
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
 #include <new>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
 
-class ArenaAllocator {
+// Bump allocator over a chain of chunks. Memory is only given back by Reset(), which keeps the
+// chunks around so a thread can reuse the same arena for every solve. It is also a pmr resource,
+// which lets std::pmr containers living in the arena allocate their storage from it as well.
+class ArenaAllocator : public std::pmr::memory_resource {
   public:
-    explicit ArenaAllocator(size_t chunkSize);
-    ~ArenaAllocator();
+    explicit ArenaAllocator(size_t chunkSize = 64 * 1024);
+    ~ArenaAllocator() override;
 
     ArenaAllocator(const ArenaAllocator&) = delete;
     ArenaAllocator& operator=(const ArenaAllocator&) = delete;
 
     template <typename T, typename... Args>
     T* alloc(Args&&... args) {
-        if (m_Offset + sizeof(T) > m_Buffer + m_Size) {
-            throw std::bad_alloc();
-        }
+        return new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
 
-        std::byte* start = m_Offset;
-        m_Offset += sizeof(T);
-        return new (start) T(std::forward<Args>(args)...);
+    void* Allocate(size_t bytes, size_t alignment) {
+        std::byte* start = AlignUp(m_Offset, alignment);
+        if (bytes > size_t(m_End - start)) {
+            return AllocateSlow(bytes, alignment);
+        }
+        m_Offset = start + bytes;
+        return start;
     }
 
+    // Makes all memory available again. Objects in the arena are not destroyed.
+    void Reset();
+
+    size_t BytesUsed() const;
+    size_t BytesReserved() const;
+
   private:
-    const size_t m_Size;
+    struct Chunk {
+        Chunk* Next;
+        size_t Size;
+        std::byte* Data() { return reinterpret_cast<std::byte*>(this + 1); }
+    };
+
+    static std::byte* AlignUp(std::byte* p, size_t alignment) {
+        const auto address = reinterpret_cast<std::uintptr_t>(p);
+        return p + ((alignment - address % alignment) % alignment);
+    }
+
+    void* AllocateSlow(size_t bytes, size_t alignment);
+    void UseChunk(Chunk* chunk);
+    void FreeChunks();
+    static Chunk* NewChunk(size_t size);
+
+    void* do_allocate(size_t bytes, size_t alignment) override { return Allocate(bytes, alignment); }
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
 
-    std::byte* m_Buffer;
+    const size_t m_ChunkSize;
+
+    Chunk* m_Head;    // first chunk, chunks before m_Current are full
+    Chunk* m_Current;
     std::byte* m_Offset;
+    std::byte* m_End;
 };
 
-[[noreturn]] void Error(const std::string& msg);
+// Growable array of trivially copyable values whose storage comes from an arena, growing leaves
+// the old block behind. During constant evaluation there is no arena (nullptr) and std::allocator
+// is used instead, which is what lets the parser run inside SolveStatic().
+template <typename T>
+class ArenaVector {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+  public:
+    constexpr explicit ArenaVector(ArenaAllocator* arena) : m_Arena(arena) {}
+    constexpr ~ArenaVector() {
+        if consteval {
+            Release();
+        }
+    }
+
+    ArenaVector(const ArenaVector&) = delete;
+    ArenaVector& operator=(const ArenaVector&) = delete;
+
+    constexpr size_t size() const { return m_Size; }
+    constexpr bool empty() const { return m_Size == 0; }
+
+    constexpr T* data() { return m_Data; }
+    constexpr const T* data() const { return m_Data; }
+    constexpr T* begin() { return m_Data; }
+    constexpr T* end() { return m_Data + m_Size; }
+    constexpr const T* begin() const { return m_Data; }
+    constexpr const T* end() const { return m_Data + m_Size; }
+
+    constexpr T& operator[](size_t i) { return m_Data[i]; }
+    constexpr const T& operator[](size_t i) const { return m_Data[i]; }
+    constexpr T& back() { return m_Data[m_Size - 1]; }
+    constexpr const T& back() const { return m_Data[m_Size - 1]; }
+
+    constexpr void clear() { m_Size = 0; }
+    constexpr void pop_back() { m_Size--; }
+
+    constexpr void reserve(size_t capacity) {
+        if (capacity > m_Capacity) {
+            Reallocate(capacity);
+        }
+    }
+
+    constexpr void push_back(const T& value) {
+        if (m_Size == m_Capacity) {
+            Reallocate(m_Capacity ? m_Capacity * 2 : 16);
+        }
+        std::construct_at(m_Data + m_Size, value);
+        m_Size++;
+    }
+
+    constexpr void assign(size_t count, const T& value) {
+        reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            std::construct_at(m_Data + i, value);
+        }
+        m_Size = count;
+    }
+
+    constexpr void resize(size_t count) { // new elements are value-initialized
+        if (count > m_Capacity) {
+            Reallocate(std::max(count, m_Capacity * 2));
+        }
+        for (size_t i = m_Size; i < count; i++) {
+            std::construct_at(m_Data + i);
+        }
+        m_Size = count;
+    }
+
+  private:
+    constexpr void Reallocate(size_t capacity) {
+        T* data = nullptr;
+        if consteval {
+            data = std::allocator<T>().allocate(capacity);
+        } else {
+            data = static_cast<T*>(m_Arena->Allocate(capacity * sizeof(T), alignof(T)));
+        }
+        for (size_t i = 0; i < m_Size; i++) {
+            std::construct_at(data + i, m_Data[i]);
+        }
+        if consteval {
+            Release();
+        }
+        m_Data = data;
+        m_Capacity = capacity;
+    }
+
+    constexpr void Release() {
+        if (m_Data) {
+            std::destroy_n(m_Data, m_Size);
+            std::allocator<T>().deallocate(m_Data, m_Capacity);
+        }
+    }
+
+    ArenaAllocator* m_Arena;
+    T* m_Data = nullptr;
+    size_t m_Size = 0;
+    size_t m_Capacity = 0;
+};
+
+constexpr uint64_t HashString(std::string_view s) {
+    uint64_t hash = 14695981039346656037ull; // FNV-1a
+    for (char c : s) {
+        hash = (hash ^ uint8_t(c)) * 1099511628211ull;
+    }
+    return hash;
+}
+
+// Maps identifier spellings to dense ids 0, 1, 2, ... The names are not copied, they have to
+// outlive the table.
+class Interner {
+  public:
+    static constexpr uint32_t NO_ID = UINT32_MAX;
+
+    constexpr explicit Interner(ArenaAllocator* arena) : m_Slots(arena), m_Names(arena) {}
+
+    constexpr uint32_t Intern(std::string_view name) {
+        // Keep the load factor under 1/2
+        if ((m_Names.size() + 1) * 2 > m_Slots.size()) {
+            Grow();
+        }
+
+        const size_t slot = Slot(name);
+        if (m_Slots[slot] == NO_ID) {
+            m_Slots[slot] = uint32_t(m_Names.size());
+            m_Names.push_back(name);
+        }
+        return m_Slots[slot];
+    }
+
+    constexpr uint32_t Find(std::string_view name) const { // NO_ID if never interned
+        if (m_Slots.empty()) {
+            return NO_ID;
+        }
+        return m_Slots[Slot(name)];
+    }
+
+    constexpr std::string_view Name(uint32_t id) const { return m_Names[id]; }
+    constexpr size_t Size() const { return m_Names.size(); }
+
+  private:
+    // Slot holding name, or the empty slot where it would go
+    constexpr size_t Slot(std::string_view name) const {
+        const size_t mask = m_Slots.size() - 1;
+        size_t slot = HashString(name) & mask;
+        while (m_Slots[slot] != NO_ID && m_Names[m_Slots[slot]] != name) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    constexpr void Grow() {
+        m_Slots.assign(m_Slots.size() < 16 ? 16 : m_Slots.size() * 2, NO_ID);
+        for (uint32_t id = 0; id < m_Names.size(); id++) {
+            m_Slots[Slot(m_Names[id])] = id;
+        }
+    }
+
+    ArenaVector<uint32_t> m_Slots; // open addressing, ids or NO_ID
+    ArenaVector<std::string_view> m_Names;
+};
+
+// Tolerance used when deciding whether a coefficient or value is zero
+inline constexpr double EPS = 1e-12;
+
+struct FormatOptions {
+    static constexpr int SHORTEST = -1;
+
+    int Precision = 10;    // digits after the point, or SHORTEST for the shortest round-trip form
+    bool TrimZeros = true; // drop trailing zeros after the point, and the point if nothing is left
+};
+
+inline constexpr int MAX_FORMAT_PRECISION = 30;
+
+// Formats x into a thread-local buffer, the view is valid until the next call on the same thread.
+// Never allocates.
+std::string_view FormatDouble(double x, const FormatOptions& options = {});
@@ -0,0 +1,86 @@
+#include "check.h"
+#include <cstdint>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+static bool Aligned(const void* p, size_t alignment) {
+    return reinterpret_cast<std::uintptr_t>(p) % alignment == 0;
+}
+
+// After Reset() the same memory is handed out again, nothing new is reserved
+static void TestReset() {
+    ArenaAllocator arena(4096);
+    CHECK(arena.BytesUsed() == 0 && arena.BytesReserved() == 0);
+
+    void* first = arena.Allocate(100, 8);
+    arena.Allocate(200, 16);
+    CHECK(arena.BytesUsed() >= 300);
+    CHECK(arena.BytesReserved() == 4096);
+
+    arena.Reset();
+    CHECK(arena.BytesUsed() == 0);
+    CHECK(arena.BytesReserved() == 4096);
+    CHECK(arena.Allocate(100, 8) == first);
+}
+
+// A round that needs several chunks leaves one chunk as large as all of them, so the next
+// rounds fit without allocating
+static void TestChunkReuse() {
+    ArenaAllocator arena(4096);
+    for (int i = 0; i < 100; i++) {
+        arena.Allocate(1000, 8);
+    }
+    const size_t reserved = arena.BytesReserved();
+    CHECK(reserved >= 100 * 1000);
+
+    for (int round = 0; round < 3; round++) {
+        arena.Reset();
+        CHECK(arena.BytesReserved() == reserved);
+        const auto* start = static_cast<const std::byte*>(arena.Allocate(1000, 8));
+        for (int i = 1; i < 100; i++) {
+            arena.Allocate(1000, 8);
+        }
+        CHECK(arena.BytesReserved() == reserved);
+        // One chunk, so the blocks follow each other
+        CHECK(static_cast<const std::byte*>(arena.Allocate(8, 8)) == start + 100 * 1000);
+    }
+}
+
+// Blocks larger than a chunk and any alignment are served, the arena grows instead of failing
+static void TestLargeAndAligned() {
+    ArenaAllocator arena(1024);
+    void* large = arena.Allocate(1 << 20, 8);
+    CHECK(large != nullptr && arena.BytesUsed() >= size_t(1 << 20));
+    for (const size_t alignment : { 1, 2, 8, 16, 64, 4096 }) {
+        CHECK(Aligned(arena.Allocate(3, alignment), alignment));
+    }
+
+    std::pmr::vector<double> values(&arena);
+    for (int i = 0; i < 100000; i++) {
+        values.push_back(i);
+    }
+    CHECK(values[99999] == 99999.0);
+
+    int* object = arena.alloc<int>(42);
+    CHECK(*object == 42 && Aligned(object, alignof(int)));
+}
+
+// An equation whose tree is megabytes in size solves, the arena grows for it
+static void TestLongEquation() {
+    std::string equation = "x";
+    for (int i = 0; i < 200000; i++) {
+        equation += " + x";
+    }
+    equation += " = 200001";
+    CHECK_TEXT(SolveText(equation), "1");
+    CHECK_TEXT(SolveText("x + 1 = 3"), "2"); // the thread's arena is reused after it
+}
+
+int main() {
+    TestReset();
+    TestChunkReuse();
+    TestLargeAndAligned();
+    TestLongEquation();
+    return g_Failures;
+}
@@ -0,0 +1,95 @@
+#include "batch.h"
+#include "check.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+static const std::string_view PIECES[] = { "2x+4=0", "x^2=4", "1/0=x", "x^2=-1", "x=x", "",
+    "  \t", "3x^3-x=2", "sqrt(16)x = 2", "x^2 - 5x = -6", "(x+" };
+
+// Lines as --batch reads them, the result of line i is line i of the output. Some end in CRLF.
+static std::string Input(size_t lines, bool finalBreak) {
+    std::string input;
+    for (size_t i = 0; i < lines; i++) {
+        const std::string_view piece = PIECES[i % std::size(PIECES)];
+        const std::string term = std::to_string(i % 13);
+        if (piece.find_first_not_of(" \t") == std::string_view::npos) {
+            input += piece;
+        } else {
+            input += term + " + " + std::string(piece) + " + " + term;
+        }
+        if (i % 5 == 0) {
+            input += '\r';
+        }
+        if (i + 1 < lines || finalBreak) {
+            input += '\n';
+        }
+    }
+    return input;
+}
+
+// What Solve() gives line by line
+static std::string Expected(std::string_view input) {
+    std::string expected;
+    while (!input.empty()) {
+        const size_t end = input.find('\n');
+        std::string_view line = input.substr(0, end);
+        input.remove_prefix(end == std::string_view::npos ? input.size() : end + 1);
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.find_first_not_of(" \t") != std::string_view::npos) {
+            expected += SolveText(line);
+        }
+        expected += '\n';
+    }
+    return expected;
+}
+
+static std::string RunText(const std::string& input, size_t threads, size_t cacheBytes) {
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto in = directory / "algebra_batch_test.in";
+    const auto out = directory / "algebra_batch_test.out";
+    std::ofstream(in, std::ios::binary) << input;
+
+    BatchOptions options;
+    options.InputPath = in.string();
+    options.OutputPath = out.string();
+    options.Threads = threads;
+    options.CacheBytes = cacheBytes;
+    CHECK(RunBatch(options) == 0);
+
+    std::stringstream read;
+    read << std::ifstream(out, std::ios::binary).rdbuf();
+    std::filesystem::remove(in);
+    std::filesystem::remove(out);
+    return read.str();
+}
+
+// Far more than one 64 KiB chunk, solved on several threads and written in input order
+static void TestOrder() {
+    const std::string input = Input(20000, true);
+    CHECK(input.size() > 4 * 64 * 1024);
+    const std::string expected = Expected(input);
+    CHECK(RunText(input, 4, 0) == expected);
+    CHECK(RunText(input, 1, 0) == expected);
+    CHECK(RunText(input, 4, 1 << 20) == expected); // the cache gives the same results
+}
+
+// The last line needs no line break, and the chunks end on line breaks whatever their size
+static void TestEdges() {
+    const std::string input = Input(5000, false);
+    CHECK(RunText(input, 3, 0) == Expected(input));
+    CHECK_TEXT(RunText("", 2, 0), "");
+    CHECK_TEXT(RunText("x=1", 2, 0), "1\n");
+    CHECK_TEXT(RunText("\n\nx=2\n", 2, 0), "\n\n2\n");
+
+    const std::string longLine = "x" + std::string(100 * 1024, ' ') + "= 3\nx=4\n";
+    CHECK_TEXT(RunText(longLine, 2, 0), "3\n4\n");
+}
+
+int main() {
+    TestOrder();
+    TestEdges();
+    return g_Failures;
+}
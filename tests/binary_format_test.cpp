@@ -0,0 +1,191 @@
+#include "batch.h"
+#include "binary_format.h"
+#include "check.h"
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+// Every kind of result: roots, none, infinite, an error with its offset, blank lines and the
+// numeric fallback
+static const std::string_view EQUATIONS[] = { "2x+4=0", "x^2=4", "x^2=-1", "x=x", "1/0=x", "",
+    "   ", "sin(x)=0.5", "x^3-6x^2+11x-6=0" };
+
+static void AppendRecord(std::string_view equation, std::string& out) {
+    const uint32_t length = LittleEndian(uint32_t(equation.size()));
+    out.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    out += equation;
+}
+
+template <typename T>
+static T Read(std::string_view data, size_t offset) {
+    T value;
+    std::memcpy(&value, data.data() + offset, sizeof(value));
+    return LittleEndian(value);
+}
+
+static std::string ReadFile(const std::filesystem::path& path) {
+    std::stringstream read;
+    read << std::ifstream(path, std::ios::binary).rdbuf();
+    return read.str();
+}
+
+// The expected flags, error code and offset and roots of one equation
+struct Expected {
+    uint8_t Flags = 0;
+    uint8_t ErrorCode = 0;
+    uint32_t ErrorOffset = 0;
+    std::vector<double> Roots;
+};
+
+static Expected ExpectedOf(std::string_view equation) {
+    Expected expected;
+    if (equation.find_first_not_of(" \t\r") == std::string_view::npos) {
+        expected.Flags = RESULT_BLANK;
+        return expected;
+    }
+    Solutions solutions;
+    const auto result = Solve(equation, solutions);
+    if (!result) {
+        expected.Flags = RESULT_ERROR;
+        expected.ErrorCode = uint8_t(result.error().Code);
+        expected.ErrorOffset = uint32_t(result.error().Offset);
+    } else if (solutions.IsNone) {
+        expected.Flags = RESULT_NONE;
+    } else if (solutions.IsInfinite) {
+        expected.Flags = RESULT_INFINITE;
+    } else {
+        expected.Roots = solutions.Values;
+    }
+    return expected;
+}
+
+static bool SameRoots(std::string_view data, size_t offset, const std::vector<double>& roots) {
+    for (size_t i = 0; i < roots.size(); i++) {
+        if (std::bit_cast<uint64_t>(Read<double>(data, offset + i * sizeof(double))) !=
+            std::bit_cast<uint64_t>(roots[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void TestNextRecord() {
+    std::string input;
+    AppendRecord("x=1", input);
+    AppendRecord("", input);
+    AppendRecord("x^2=4", input);
+    input.resize(input.size() - 1); // cut inside the last record
+
+    std::string_view rest = input;
+    std::string_view record;
+    CHECK(NextRecord(rest, record) && record == "x=1");
+    CHECK(NextRecord(rest, record) && record.empty());
+    CHECK(!NextRecord(rest, record));
+    CHECK(rest.size() == sizeof(uint32_t) + 4); // left at the cut record
+}
+
+// Runs --batch on record input into both binary outputs and reads them back
+static void TestRoundTrip() {
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto input = directory / "algebra_binary_test.in";
+    const auto records = directory / "algebra_binary_test.records";
+    const auto columns = directory / "algebra_binary_test.columns";
+    {
+        std::string data;
+        for (const std::string_view equation : EQUATIONS) {
+            AppendRecord(equation, data);
+        }
+        std::ofstream(input, std::ios::binary) << data;
+    }
+
+    BatchOptions options;
+    options.InputPath = input.string();
+    options.Input = InputFormat::Records;
+    options.Threads = 2;
+    options.OutputPath = records.string();
+    options.Output = OutputFormat::Records;
+    CHECK(RunBatch(options) == 0);
+    options.OutputPath = columns.string();
+    options.Output = OutputFormat::Columns;
+    CHECK(RunBatch(options) == 0);
+
+    // One record per equation, in input order
+    const std::string out = ReadFile(records);
+    size_t offset = 0;
+    for (const std::string_view equation : EQUATIONS) {
+        const Expected expected = ExpectedOf(equation);
+        CHECK(offset + sizeof(ResultRecord) <= out.size());
+        if (offset + sizeof(ResultRecord) > out.size()) {
+            break;
+        }
+        const uint32_t count = Read<uint32_t>(out, offset);
+        CHECK(count == expected.Roots.size());
+        CHECK(uint8_t(out[offset + 4]) == expected.Flags);
+        CHECK(uint8_t(out[offset + 5]) == expected.ErrorCode);
+        CHECK(Read<uint16_t>(out, offset + 6) == 0);
+        CHECK(Read<uint32_t>(out, offset + 8) == expected.ErrorOffset);
+        CHECK(Read<uint32_t>(out, offset + 12) == 0);
+        offset += sizeof(ResultRecord);
+        CHECK(offset + count * sizeof(double) <= out.size());
+        if (offset + count * sizeof(double) > out.size()) {
+            break;
+        }
+        CHECK(count != expected.Roots.size() || SameRoots(out, offset, expected.Roots));
+        offset += count * sizeof(double);
+    }
+    CHECK(offset == out.size());
+
+    // The columns, found through the trailer
+    const std::string file = ReadFile(columns);
+    CHECK(file.size() >= sizeof(ColumnsTrailer));
+    if (file.size() < sizeof(ColumnsTrailer)) {
+        return;
+    }
+    const size_t trailer = file.size() - sizeof(ColumnsTrailer);
+    CHECK(std::memcmp(file.data() + trailer + 60, COLUMNS_MAGIC, 4) == 0);
+    CHECK(Read<uint32_t>(file, trailer + 56) == COLUMNS_VERSION);
+    const uint64_t equations = Read<uint64_t>(file, trailer);
+    const uint64_t rootCount = Read<uint64_t>(file, trailer + 8);
+    const uint64_t rootsOffset = Read<uint64_t>(file, trailer + 16);
+    const uint64_t indexOffset = Read<uint64_t>(file, trailer + 24);
+    const uint64_t flagsOffset = Read<uint64_t>(file, trailer + 32);
+    const uint64_t codesOffset = Read<uint64_t>(file, trailer + 40);
+    const uint64_t errorOffsetsOffset = Read<uint64_t>(file, trailer + 48);
+    CHECK(equations == std::size(EQUATIONS));
+    CHECK(rootsOffset == 0);
+    for (const uint64_t section : { indexOffset, flagsOffset, codesOffset, errorOffsetsOffset }) {
+        CHECK(section % 8 == 0 && section <= trailer);
+    }
+    CHECK(errorOffsetsOffset + equations * sizeof(uint32_t) <= trailer);
+    if (equations != std::size(EQUATIONS) || errorOffsetsOffset > trailer) {
+        return;
+    }
+
+    uint64_t roots = 0;
+    for (size_t i = 0; i < equations; i++) {
+        const Expected expected = ExpectedOf(EQUATIONS[i]);
+        const uint64_t first = Read<uint64_t>(file, indexOffset + i * sizeof(uint64_t));
+        const uint64_t last = Read<uint64_t>(file, indexOffset + (i + 1) * sizeof(uint64_t));
+        CHECK(first == roots && last - first == expected.Roots.size());
+        CHECK(last != first + expected.Roots.size() ||
+              SameRoots(file, rootsOffset + first * sizeof(double), expected.Roots));
+        CHECK(uint8_t(file[flagsOffset + i]) == expected.Flags);
+        CHECK(uint8_t(file[codesOffset + i]) == expected.ErrorCode);
+        CHECK(Read<uint32_t>(file, errorOffsetsOffset + i * sizeof(uint32_t)) ==
+              expected.ErrorOffset);
+        roots += expected.Roots.size();
+    }
+    CHECK(rootCount == roots);
+
+    for (const auto& path : { input, records, columns }) {
+        std::filesystem::remove(path);
+    }
+}
+
+int main() {
+    TestNextRecord();
+    TestRoundTrip();
+    return g_Failures;
+}
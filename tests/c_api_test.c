@@ -0,0 +1,92 @@
+// Built as C, so algebra.h is checked to be plain C too
+#include "algebra.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static int g_Failures = 0;
+
+#define CHECK(condition)                                                                     \
+    do {                                                                                     \
+        if (!(condition)) {                                                                  \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition);   \
+            g_Failures++;                                                                    \
+        }                                                                                    \
+    } while (0)
+
+static int Solve(AlgebraContext* context, const char* equation) {
+    return AlgebraSolve(context, equation, strlen(equation));
+}
+
+static void TestSolve(AlgebraContext* context) {
+    CHECK(Solve(context, "2x^2 + 4x - 6 = 0") == 0);
+    CHECK(AlgebraRootCount(context) == 2);
+    if (AlgebraRootCount(context) == 2) {
+        CHECK(AlgebraRoots(context)[0] == 1.0 && AlgebraRoots(context)[1] == -3.0);
+    }
+    CHECK(strcmp(AlgebraErrorName(context), "") == 0);
+
+    CHECK(Solve(context, "x^2 + 1 = 0") == 0);
+    CHECK(AlgebraIsNone(context) && !AlgebraIsInfinite(context));
+    CHECK(Solve(context, "x = x") == 0);
+    CHECK(AlgebraIsInfinite(context));
+
+    // The length counts, not a terminator
+    CHECK(AlgebraSolve(context, "x = 4 junk", 5) == 0);
+    CHECK(AlgebraRootCount(context) == 1 && AlgebraRoots(context)[0] == 4.0);
+}
+
+static void TestErrors(AlgebraContext* context) {
+    CHECK(Solve(context, "1/0 + x = 1") == -1);
+    CHECK(strcmp(AlgebraErrorName(context), "DivisionByZero") == 0);
+    CHECK(strcmp(AlgebraErrorCategory(context), "analysis") == 0);
+    CHECK(AlgebraErrorOffset(context) == 2); // at the divisor
+    CHECK(AlgebraRootCount(context) == 0);
+    CHECK(!AlgebraIsNone(context) && !AlgebraIsInfinite(context));
+
+    AlgebraSetLimits(context, 4, 0, 0, 0, 0, 0);
+    CHECK(Solve(context, "x + 1 = 2") == -1);
+    CHECK(strcmp(AlgebraErrorName(context), "InputTooLong") == 0);
+    CHECK(strcmp(AlgebraErrorCategory(context), "limit") == 0);
+    AlgebraSetLimits(context, 0, 0, 0, 0, 0, 0);
+
+    // A success clears the error
+    CHECK(Solve(context, "x + 1 = 2") == 0);
+    CHECK(strcmp(AlgebraErrorName(context), "") == 0 && AlgebraErrorOffset(context) == 0);
+}
+
+static void TestCompiled(AlgebraContext* context) {
+    const char* names[] = { "a", "b" };
+    const char* text = "a x^2 = b";
+    AlgebraEquation* equation = AlgebraCompile(context, text, strlen(text), names, 2);
+    CHECK(equation != NULL);
+    if (equation) {
+        const double params[] = { 2.0, 18.0 };
+        CHECK(AlgebraSolveCompiled(context, equation, params, 2) == 0);
+        CHECK(AlgebraRootCount(context) == 2);
+        if (AlgebraRootCount(context) == 2) {
+            CHECK(fabs(AlgebraRoots(context)[0]) == 3.0 && fabs(AlgebraRoots(context)[1]) == 3.0);
+        }
+        CHECK(AlgebraSolveCompiled(context, equation, params, 1) == -1);
+        CHECK(strcmp(AlgebraErrorName(context), "ParameterCount") == 0);
+        AlgebraDestroyEquation(equation);
+    }
+
+    const char* bad = "a x^ = 1";
+    CHECK(AlgebraCompile(context, bad, strlen(bad), names, 1) == NULL);
+    CHECK(strcmp(AlgebraErrorCategory(context), "parser") == 0);
+}
+
+int main(void) {
+    CHECK(AlgebraAbiVersion() == ALGEBRA_ABI_VERSION);
+    AlgebraContext* context = AlgebraCreateContext();
+    CHECK(context != NULL);
+    if (!context) {
+        return g_Failures;
+    }
+    TestSolve(context);
+    TestErrors(context);
+    TestCompiled(context);
+    AlgebraDestroyContext(context);
+    return g_Failures;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "error.h"
+#include "solver.h"
+#include "utils.h"
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+// The tests are plain executables: every failed check is printed with its line, and main returns
+// the number of failures, which ctest reports
+inline int g_Failures = 0;
+
+inline void CheckThat(bool condition, const char* text, const char* file, int line) {
+    if (!condition) {
+        std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", file, line, text);
+        g_Failures++;
+    }
+}
+
+inline void CheckText(std::string_view got, std::string_view expected, const char* text,
+    const char* file, int line) {
+    if (got != expected) {
+        std::fprintf(stderr, "%s:%d: %s\n  got:      %.*s\n  expected: %.*s\n", file, line, text,
+            int(got.size()), got.data(), int(expected.size()), expected.data());
+        g_Failures++;
+    }
+}
+
+#define CHECK(condition) CheckThat(bool(condition), #condition, __FILE__, __LINE__)
+#define CHECK_TEXT(got, expected) CheckText(got, expected, #got, __FILE__, __LINE__)
+
+// The result as --batch prints it, without the newline
+inline std::string FormatResult(
+    const std::expected<void, SolveError>& result, const Solutions& solutions) {
+    if (!result) {
+        return "Error: " + std::string(ErrorMessage(result.error().Code)) + " (column " +
+               std::to_string(result.error().Offset + 1) + ")";
+    } else if (solutions.IsNone) {
+        return "No solution";
+    } else if (solutions.IsInfinite) {
+        return "Infinite solutions";
+    }
+    std::string out;
+    for (double value : solutions.Values) {
+        if (!out.empty()) {
+            out += ' ';
+        }
+        out += FormatDouble(value);
+    }
+    return out;
+}
+
+inline std::string SolveText(std::string_view equation, const NumericOptions& numeric = {}) {
+    Solutions solutions;
+    const auto result = Solve(equation, solutions, numeric);
+    return FormatResult(result, solutions);
+}
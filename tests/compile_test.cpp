@@ -0,0 +1,104 @@
+#include "check.h"
+#include "compile.h"
+#include <string>
+
+// The equation with the parameters written in as numbers
+static std::string Substitute(std::string_view equation, std::span<const std::string_view> names,
+    std::span<const double> params) {
+    std::string out;
+    for (size_t i = 0; i < equation.size(); i++) {
+        size_t k = 0;
+        while (k < names.size() && equation.substr(i, names[k].size()) != names[k]) {
+            k++;
+        }
+        if (k < names.size()) {
+            out += "(" + std::string(FormatDouble(params[k])) + ")";
+            i += names[k].size() - 1;
+        } else {
+            out += equation[i];
+        }
+    }
+    return out;
+}
+
+static std::string SolveCompiled(const CompiledEquation& equation, std::span<const double> params) {
+    Solutions solutions;
+    const auto result = Solve(equation, params, solutions);
+    return FormatResult(result, solutions);
+}
+
+// Solving a compiled equation gives what solving its text with the values written in gives
+static void CheckSame(std::string_view text, std::span<const std::string_view> names,
+    std::span<const std::vector<double>> paramSets) {
+    const auto equation = Compile(text, names);
+    CHECK(equation.has_value());
+    if (!equation) {
+        return;
+    }
+    for (const std::vector<double>& params : paramSets) {
+        const std::string substituted = Substitute(text, names, params);
+        CheckText(SolveCompiled(*equation, params), SolveText(substituted),
+            substituted.c_str(), __FILE__, __LINE__);
+    }
+}
+
+static void TestQuadratic() {
+    const std::string_view names[] = { "a", "b", "c" };
+    std::vector<std::vector<double>> sets;
+    for (int a = -2; a <= 2; a++) {
+        for (int b = -3; b <= 3; b++) {
+            for (int c = -2; c <= 2; c++) {
+                sets.push_back({ 0.5 * a, double(b), 1.5 * c });
+            }
+        }
+    }
+    CheckSame("a x^2 + b x + c = 0", names, sets); // a = 0 and b = 0 included
+    CheckSame("(x - a)(x - b)(x - c) = 0", names, sets);
+    CheckSame("a*(x + b)^2 = c*x", names, sets);
+}
+
+// Functions and constant powers of the parameters are evaluated on each solve
+static void TestFunctions() {
+    const std::string_view names[] = { "angle", "scale" };
+    const std::vector<std::vector<double>> sets = { { 30, 4 }, { 90, 2.25 }, { 45, 9 } };
+    CheckSame("sqrt(scale) x = sin(angle) + 2^scale", names, sets);
+    CheckSame("x^2 * cos(angle) = scale^3 - 1", names, sets);
+}
+
+static void TestErrors() {
+    const std::string_view names[] = { "a" };
+
+    // The shape of the polynomial can't depend on a parameter
+    const auto exponent = Compile("x^a = 1", names);
+    CHECK(!exponent && exponent.error().Code == ErrorCode::ParametricExponent);
+    const auto syntax = Compile("a x^ = 1", names);
+    CHECK(!syntax && syntax.error().Code == ErrorCode::UnexpectedToken);
+    const std::string_view two[] = { "a", "b" };
+    const auto other = Compile("a x + c = 0", two); // c is a second variable
+    CHECK(!other && other.error().Code == ErrorCode::MoreThanOneVariable);
+
+    // Errors that depend on the values come from the solve, at their column
+    const auto equation = Compile("x = sqrt(a) + 1/(a - 4)", names);
+    CHECK(equation.has_value());
+    if (!equation) {
+        return;
+    }
+    Solutions solutions;
+    const double negative[] = { -1.0 };
+    const auto domain = Solve(*equation, negative, solutions);
+    CHECK(!domain && domain.error().Code == ErrorCode::SqrtDomain && domain.error().Offset == 4);
+    const double four[] = { 4.0 };
+    const auto division = Solve(*equation, four, solutions);
+    CHECK(!division && division.error().Code == ErrorCode::DivisionByZero);
+    const double nine[] = { 9.0 };
+    CHECK_TEXT(SolveCompiled(*equation, nine), "3.2");
+    const auto count = Solve(*equation, std::span<const double>{}, solutions);
+    CHECK(!count && count.error().Code == ErrorCode::ParameterCount);
+}
+
+int main() {
+    TestQuadratic();
+    TestFunctions();
+    TestErrors();
+    return g_Failures;
+}
@@ -0,0 +1,111 @@
+#include "check.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <set>
+#include <string>
+
+// Counts the plain heap allocations, the other forms of new end up here too
+static std::atomic<size_t> g_Allocations{ 0 };
+
+void* operator new(size_t size) {
+    g_Allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(std::max<size_t>(size, 1))) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+// Every code has its own name, a message and one of the categories
+static void TestNames() {
+    const std::set<std::string> categories = { "tokenizer", "parser", "analysis", "domain",
+        "limit", "internal" };
+    std::set<std::string> names;
+    for (size_t i = 0; i < size_t(ErrorCode::ERROR_CODE_NB); i++) {
+        const auto code = ErrorCode(i);
+        CHECK(std::strcmp(ErrorCodeName(code), "Unknown") != 0);
+        CHECK(std::strcmp(ErrorMessage(code), "Unknown error") != 0);
+        CHECK(categories.contains(ErrorCategory(code)));
+        names.insert(ErrorCodeName(code));
+    }
+    CHECK(names.size() == size_t(ErrorCode::ERROR_CODE_NB));
+    CHECK(IsLimitError(ErrorCode::Timeout) && IsLimitError(ErrorCode::InputTooLong));
+    CHECK(!IsLimitError(ErrorCode::SqrtDomain) && !IsLimitError(ErrorCode::InternalError));
+}
+
+struct Case {
+    std::string_view Equation;
+    ErrorCode Code;
+    size_t Offset;
+    const char* Category;
+};
+
+// Each pass reports its own errors at the offending column, and the caller gets them back
+// instead of the process exiting
+static const Case CASES[] = {
+    { "x = 2 $ 1", ErrorCode::InvalidSymbol, 6, "tokenizer" },
+    { "x = 1.2.3", ErrorCode::MultipleDots, 7, "tokenizer" },
+    { "2x+=1", ErrorCode::UnexpectedToken, 3, "parser" },
+    { "(x+1=2", ErrorCode::ExpectedRParen, 4, "parser" },
+    { "x+1", ErrorCode::ExpectedEqual, 3, "parser" },
+    { "x = foo(2)", ErrorCode::UnknownFunction, 4, "parser" },
+    { "x + y = 1", ErrorCode::MoreThanOneVariable, 4, "parser" },
+    { "1/0 + x = 1", ErrorCode::DivisionByZero, 2, "analysis" },
+    { "x = 2/(1-1)", ErrorCode::DivisionByZero, 7, "analysis" },
+    { "sqrt(-1) = x", ErrorCode::SqrtDomain, 0, "domain" },
+    { "ln(0) = x", ErrorCode::LogDomain, 0, "domain" },
+    { "x = tan(90)", ErrorCode::TanUndefined, 4, "domain" },
+    { "x = asin(2)", ErrorCode::AsinDomain, 4, "domain" },
+};
+
+static void TestCategories() {
+    for (const Case& test : CASES) {
+        Solutions solutions;
+        const auto result = Solve(test.Equation, solutions);
+        CHECK(!result);
+        if (result) {
+            continue;
+        }
+        if (result.error().Code != test.Code || result.error().Offset != test.Offset) {
+            CheckText(std::string(ErrorCodeName(result.error().Code)) + " at " +
+                          std::to_string(result.error().Offset),
+                std::string(ErrorCodeName(test.Code)) + " at " + std::to_string(test.Offset),
+                std::string(test.Equation).c_str(), __FILE__, __LINE__);
+        }
+        CHECK_TEXT(ErrorCategory(result.error().Code), test.Category);
+        CHECK(solutions.Values.empty() && !solutions.IsNone && !solutions.IsInfinite);
+    }
+}
+
+// Once the thread's arena and the Solutions are warmed up, an error costs no allocation
+static void TestNoAllocation() {
+    Solutions solutions;
+    solutions.Values.reserve(16);
+    for (const Case& test : CASES) {
+        [[maybe_unused]] const auto warm = Solve(test.Equation, solutions);
+        const size_t before = g_Allocations.load(std::memory_order_relaxed);
+        const auto result = Solve(test.Equation, solutions);
+        const size_t allocations = g_Allocations.load(std::memory_order_relaxed) - before;
+        CHECK(!result);
+        if (allocations != 0) {
+            CheckText(std::to_string(allocations), "0", std::string(test.Equation).c_str(),
+                __FILE__, __LINE__);
+        }
+    }
+}
+
+int main() {
+    TestNames();
+    TestCategories();
+    TestNoAllocation();
+    return g_Failures;
+}
@@ -0,0 +1,100 @@
+#include "batch.h"
+#include "check.h"
+#include <bit>
+#include <cfloat>
+#include <cstdlib>
+#include <random>
+#include <string>
+
+static std::string Format(double x, int precision, bool trimZeros = true) {
+    FormatOptions options;
+    options.Precision = precision;
+    options.TrimZeros = trimZeros;
+    return std::string(FormatDouble(x, options));
+}
+
+static void TestPrecision() {
+    CHECK_TEXT(FormatDouble(2.0), "2");
+    CHECK_TEXT(FormatDouble(-2.5), "-2.5");
+    CHECK_TEXT(FormatDouble(1.0 / 3), "0.3333333333");
+    CHECK_TEXT(FormatDouble(2.0 / 3), "0.6666666667");
+    CHECK_TEXT(FormatDouble(1e-11), "0");
+    CHECK_TEXT(Format(3.14159, 3), "3.142");
+    CHECK_TEXT(Format(-3.14159, 3), "-3.142");
+    CHECK_TEXT(Format(2.6, 0), "3");
+    CHECK_TEXT(Format(1234567.0, 2), "1234567");
+
+    // Keeping the zeros gives exactly Precision decimals
+    CHECK_TEXT(Format(2.0, 3, false), "2.000");
+    CHECK_TEXT(Format(-0.5, 4, false), "-0.5000");
+    CHECK_TEXT(Format(7.0, 0, false), "7");
+
+    // Out of range precisions are clamped instead of overflowing the buffer
+    CHECK_TEXT(Format(0.1, 30, false), "0.100000000000000005551115123126");
+    CHECK_TEXT(Format(0.1, 1000, false), Format(0.1, MAX_FORMAT_PRECISION, false));
+    CHECK_TEXT(Format(2.5, -7, false), Format(2.5, 0, false));
+}
+
+// The shortest form reads back to the same bits
+static void TestShortest() {
+    CHECK_TEXT(Format(0.1, FormatOptions::SHORTEST), "0.1");
+    CHECK_TEXT(Format(2.0, FormatOptions::SHORTEST), "2");
+    CHECK_TEXT(Format(1.0 / 3, FormatOptions::SHORTEST), "0.3333333333333333");
+    CHECK_TEXT(Format(1e300, FormatOptions::SHORTEST), "1e+300");
+    CHECK_TEXT(Format(-5e-324, FormatOptions::SHORTEST), "-5e-324");
+
+    std::mt19937_64 random(7);
+    for (int i = 0; i < 10000; i++) {
+        const double x = std::bit_cast<double>(random());
+        if (!std::isfinite(x)) {
+            continue;
+        }
+        const std::string text = Format(x, FormatOptions::SHORTEST);
+        if (std::bit_cast<uint64_t>(std::strtod(text.c_str(), nullptr)) !=
+            std::bit_cast<uint64_t>(x)) {
+            CHECK_TEXT(Format(std::strtod(text.c_str(), nullptr), FormatOptions::SHORTEST), text);
+            break;
+        }
+    }
+}
+
+// The largest values still fit the buffer with every decimal
+static void TestLarge() {
+    const std::string max = Format(-DBL_MAX, MAX_FORMAT_PRECISION, false);
+    CHECK(max.size() == 1 + 309 + 1 + MAX_FORMAT_PRECISION);
+    CHECK(max.starts_with("-17976931348623157"));
+    CHECK(std::strtod(max.c_str(), nullptr) == -DBL_MAX);
+    CHECK_TEXT(Format(DBL_MAX, 10), max.substr(1, 309));
+    CHECK_TEXT(Format(1e20, 10), "100000000000000000000");
+}
+
+static std::string Result(std::string_view equation, const FormatOptions& format) {
+    Solutions solutions;
+    const auto result = Solve(equation, solutions);
+    std::string out;
+    AppendResult(result, solutions, format, out);
+    return out;
+}
+
+// --precision and --keep-zeros apply to every root of a result, not to the other lines
+static void TestResults() {
+    FormatOptions format;
+    format.Precision = 3;
+    CHECK_TEXT(Result("3x = 1", format), "0.333\n");
+    format.TrimZeros = false;
+    CHECK_TEXT(Result("x^2 = 4", format), "2.000 -2.000\n");
+    CHECK_TEXT(Result("x = x", format), "Infinite solutions\n");
+    CHECK_TEXT(Result("x^2 = -1", format), "No solution\n");
+    CHECK_TEXT(Result("1/0 + x = 1", format),
+        std::string("Error: ") + ErrorMessage(ErrorCode::DivisionByZero) + " (column 3)\n");
+    format.Precision = FormatOptions::SHORTEST;
+    CHECK_TEXT(Result("3x = 1", format), "0.3333333333333333\n");
+}
+
+int main() {
+    TestPrecision();
+    TestShortest();
+    TestLarge();
+    TestResults();
+    return g_Failures;
+}
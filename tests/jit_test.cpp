@@ -0,0 +1,102 @@
+#include "check.h"
+#include "compile.h"
+#include "jit.h"
+#include <bit>
+#include <vector>
+
+// The JIT is only built for x86-64 Linux, elsewhere everything stays interpreted
+#if ALGEBRA_JIT && defined(__linux__) && defined(__x86_64__)
+constexpr bool HAS_JIT = true;
+#else
+constexpr bool HAS_JIT = false;
+#endif
+
+static const std::string_view EXPRESSIONS[] = {
+    "3x^2 - 2x + 1",
+    "x^3 - 2x/(x+1) + 7",
+    "sqrt(abs(x)) + floor(x) - ceil(x/3)",
+    "sin(x)*e^(x/10) - cos(2x) + tan(x/4)",
+    "ln(x^2+1) + log(abs(x)+1) + asin(x/100) + acos(x/100) + atan(x)",
+    "x^0.5 + (x+1)^-2 + 2^x",
+    "-(-x) * -x + x/7",
+};
+
+static const double VALUES[] = { 0.0, -0.0, 1.0, -1.0, 0.5, 3.25, -7.125, 45.0, 90.0, 99.5, -100.0,
+    1e-300, 5e-324, 1e300 };
+
+// Native code gives the same bits as the interpreter, and the same errors
+static void TestBitIdentical() {
+    for (const std::string_view expression : EXPRESSIONS) {
+        const auto program = CompileExpression(expression, "x");
+        CHECK(program.has_value());
+        if (!program) {
+            continue;
+        }
+        const auto code = JitCode::Compile(*program);
+        CHECK(code != nullptr || !HAS_JIT);
+        if (!code) {
+            continue;
+        }
+
+        std::vector<double> interpreted(program->Code.size());
+        std::vector<double> native(program->Code.size());
+        for (const double x : VALUES) {
+            const auto expected = Execute(*program, {}, x, interpreted);
+            const auto got = code->Execute({}, x, native);
+            CHECK(expected.has_value() == got.has_value());
+            if (expected && got) {
+                const uint32_t output = program->Outputs[0];
+                CHECK(std::bit_cast<uint64_t>(interpreted[output]) ==
+                      std::bit_cast<uint64_t>(native[output]));
+            } else if (!expected && !got) {
+                CHECK(expected.error().Code == got.error().Code);
+                CHECK(expected.error().Offset == got.error().Offset);
+            }
+        }
+    }
+}
+
+static void TestErrors() {
+    const auto program = CompileExpression("1 + sqrt(x) + 1/(x-2)", "x");
+    CHECK(program.has_value());
+    const auto code = program ? JitCode::Compile(*program) : nullptr;
+    if (!code) {
+        return;
+    }
+    std::vector<double> registers(program->Code.size());
+    const auto domain = code->Execute({}, -1.0, registers);
+    CHECK(!domain && domain.error().Code == ErrorCode::SqrtDomain && domain.error().Offset == 4);
+    const auto division = code->Execute({}, 2.0, registers); // reported at the divisor
+    CHECK(!division && division.error().Code == ErrorCode::DivisionByZero &&
+          division.error().Offset == 17);
+}
+
+// Past JIT_THRESHOLD solves the compiled equation runs natively, the results don't change
+static void TestTier() {
+    const std::string_view names[] = { "a", "b", "c" };
+    const auto equation = Compile("a x^2 + b x + c = sqrt(c) / a", names);
+    CHECK(equation.has_value());
+    if (!equation) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < 3 * JIT_THRESHOLD; i++) {
+        const double params[] = { double(i % 7) - 3.0, double(i % 11) * 0.5 - 2.0, double(i % 5) };
+        Solutions got;
+        const auto result = Solve(*equation, params, got);
+
+        // A copy counts from zero, so it interprets
+        const CompiledEquation interpreted{ equation->Coefficients };
+        Solutions expected;
+        const auto expectedResult = Solve(interpreted, params, expected);
+        CHECK_TEXT(FormatResult(result, got), FormatResult(expectedResult, expected));
+    }
+    CHECK((equation->Jit.Touch(equation->Coefficients) != nullptr) == HAS_JIT);
+}
+
+int main() {
+    TestBitIdentical();
+    TestErrors();
+    TestTier();
+    return g_Failures;
+}
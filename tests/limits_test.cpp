@@ -0,0 +1,73 @@
+#include "budget.h"
+#include "check.h"
+#include "compile.h"
+#include "context.h"
+#include <cstring>
+
+// Crossing a limit is its own error, of the "limit" category. The equations solve without it.
+static void CheckLimit(std::string_view spec, std::string_view equation, ErrorCode expected) {
+    SolveLimits limits;
+    CHECK(ParseLimits(spec, limits));
+    SolveContext context;
+    Solutions solutions;
+    const auto result = context.Solve(equation, solutions, {}, limits);
+    CHECK(!result && result.error().Code == expected);
+    CHECK(!result && std::strcmp(ErrorCategory(result.error().Code), "limit") == 0);
+    CHECK(context.Solve(equation, solutions).has_value());
+}
+
+static void TestBytes() {
+    CheckLimit("bytes=8", "x^2 + 3x - 4 = 0", ErrorCode::InputTooLong);
+}
+
+static void TestTokens() {
+    CheckLimit("tokens=5", "x^2 + 3x - 4 = 0", ErrorCode::TooManyTokens);
+}
+
+static void TestNodes() {
+    CheckLimit("nodes=4", "x^2 + 3x - 4 = 0", ErrorCode::TooManyNodes);
+}
+
+static void TestDepth() {
+    CheckLimit("depth=3", "((((x)))) = 1", ErrorCode::NestingTooDeep);
+}
+
+static void TestArena() {
+    CheckLimit("arena=4096", "(x+1)^1000 = 1", ErrorCode::ArenaTooLarge);
+}
+
+// The clock is looked at while the powers are expanded and during root finding, compiled
+// equations only find roots
+static void TestTimeout() {
+    CheckLimit("us=1", "(x+1)^1000 = 1", ErrorCode::Timeout);
+
+    const std::string_view names[] = { "a" };
+    const auto equation = Compile("(x+a)^300 = 1", names);
+    CHECK(equation.has_value());
+    if (!equation) {
+        return;
+    }
+    SolveLimits limits;
+    limits.Timeout = std::chrono::microseconds(1);
+    SolveContext context;
+    Solutions solutions;
+    const double params[] = { 1.0 };
+    const auto result = context.Solve(*equation, params, solutions, limits);
+    CHECK(!result && result.error().Code == ErrorCode::Timeout);
+}
+
+// ctest runs one limit at a time, by its name in --limits
+int main(int argc, char** argv) {
+    const std::string_view only = argc > 1 ? argv[1] : "";
+    const struct {
+        std::string_view Name;
+        void (*Run)();
+    } tests[] = { { "bytes", TestBytes }, { "tokens", TestTokens }, { "nodes", TestNodes },
+        { "depth", TestDepth }, { "arena", TestArena }, { "us", TestTimeout } };
+    for (const auto& test : tests) {
+        if (only.empty() || only == test.Name) {
+            test.Run();
+        }
+    }
+    return g_Failures;
+}
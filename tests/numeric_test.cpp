@@ -0,0 +1,70 @@
+#include "check.h"
+#include "thread_pool.h"
+
+// Past degree 1024, or with functions of x, the equation is scanned for sign changes and zeros
+static void TestRoots() {
+    CHECK_TEXT(SolveText("sin(x)=0.5"), "30");
+    CHECK_TEXT(SolveText("sin(x)=2"), "No solution");
+    CHECK_TEXT(SolveText("1/x=0"), "No solution");
+    CHECK_TEXT(SolveText("3(pi/x^27)=abs(x)"), "1.0834163802");
+
+    NumericOptions wide;
+    wide.Lo = -400.0;
+    wide.Hi = 400.0;
+    CHECK_TEXT(SolveText("sin(x)=0.5", wide), "-330 -210 30 150 390");
+}
+
+// A zero is tested relative to the size of the terms, a value that only underflows is not one,
+// and a polynomial in x that vanishes everywhere within rounding is not taken as infinite
+// solutions from a few underflowed samples
+static void TestSmallValues() {
+    CHECK_TEXT(SolveText("x^1025=0"), "0");
+    CHECK_TEXT(SolveText("(x+1)^1025=0"), "-1");
+    CHECK_TEXT(SolveText("(x-3)^1025=0"), "3");
+    CHECK_TEXT(SolveText("x^1027+x^1025=0"), "0");
+    CHECK_TEXT(SolveText("sin(x)*x^2000=0"), "0");
+
+    NumericOptions wide;
+    wide.Lo = -400.0;
+    wide.Hi = 400.0;
+    CHECK_TEXT(SolveText("sin(x)/10000000000=0", wide), "-360 -180 0 180 360");
+}
+
+static void TestInfiniteSolutions() {
+    CHECK_TEXT(SolveText("sin(x)^2+cos(x)^2=1"), "Infinite solutions");
+    CHECK_TEXT(SolveText("abs(x)=x"), "Infinite solutions");
+}
+
+// Spreading the scan over threads gives the same roots
+static void TestPool() {
+    ThreadPool pool(4);
+    NumericOptions numeric;
+    numeric.Lo = -400.0;
+    numeric.Hi = 400.0;
+    numeric.Pool = &pool;
+    CHECK_TEXT(SolveText("sin(x)=0.5", numeric), "-330 -210 30 150 390");
+    CHECK_TEXT(SolveText("(x+1)^1025=0", numeric), "-1");
+    CHECK_TEXT(SolveText("abs(x)=x", numeric), "Infinite solutions");
+}
+
+// A task of the pool can scan on the same pool, it only waits for its own slices
+static void TestNestedPool() {
+    ThreadPool pool(1);
+    NumericOptions numeric;
+    numeric.Lo = -400.0;
+    numeric.Hi = 400.0;
+    numeric.Pool = &pool;
+    std::string roots;
+    pool.Submit([&] { roots = SolveText("sin(x)=0.5", numeric); });
+    pool.WaitIdle();
+    CHECK_TEXT(roots, "-330 -210 30 150 390");
+}
+
+int main() {
+    TestRoots();
+    TestSmallValues();
+    TestInfiniteSolutions();
+    TestPool();
+    TestNestedPool();
+    return g_Failures;
+}
@@ -0,0 +1,72 @@
+#include "check.h"
+#include "parser.h"
+#include "tokenizer.h"
+#include <string>
+
+// Nodes of the tree the solver parses equation into, with folding and sharing
+static size_t NodeCount(std::string_view equation) {
+    ArenaAllocator arena;
+    Tokenizer tokenizer(equation);
+    Parser parser(tokenizer, &arena);
+    parser.SetFoldConstants(true);
+    const auto ast = parser.ParseEquation();
+    return ast ? (*ast)->Nodes.size() : 0;
+}
+
+static std::string Repeat(std::string_view text, size_t count) {
+    std::string out;
+    out.reserve(text.size() * count);
+    for (size_t i = 0; i < count; i++) {
+        out += text;
+    }
+    return out;
+}
+
+// The literals of SolveStatic() are parsed at compile time, they have to round like from_chars
+static_assert(*ParseDecimal("0.1") == 0.1);
+static_assert(*ParseDecimal("9007199254740993") == 9007199254740992.0);
+static_assert(*ParseDecimal("123456789012345678901234567890") == 1.2345678901234568e29);
+static_assert(*ParseDecimal("0.000000000000000000000000000001") == 1e-30);
+static_assert(!ParseDecimal("."));
+
+static void TestSolve() {
+    CHECK_TEXT(SolveText("2x^2+4x-6=0"), "1 -3");
+    CHECK_TEXT(SolveText("x = sin(30)*sqrt(4)"), "1");
+    CHECK_TEXT(SolveText("x^2 = -1"), "No solution");
+    CHECK_TEXT(SolveText("3x - 3x = 0"), "Infinite solutions");
+    CHECK_TEXT(SolveText("-(-x) = --2"), "2");
+    CHECK_TEXT(SolveText("2^3^2 x = 512"), "1"); // right associative
+}
+
+static void TestErrors() {
+    CHECK_TEXT(SolveText("2x+=1"), "Error: Unexpected token in primary (column 4)");
+    CHECK_TEXT(SolveText("(x+1=2"), "Error: Expected ')' (column 5)");
+    CHECK_TEXT(SolveText("x+1"), "Error: Expected '=' (column 4)");
+    CHECK_TEXT(SolveText("x = 1.2.3"), "Error: Multiple dots in a number (column 8)");
+}
+
+// No recursion per level, so depth is only bounded by memory
+static void TestDeepInput() {
+    const size_t depth = 100000;
+    CHECK_TEXT(SolveText(Repeat("(", depth) + "x" + Repeat(")", depth) + " = 1"), "1");
+    CHECK_TEXT(SolveText("x" + Repeat("^1", depth) + " = 2"), "2");
+    CHECK_TEXT(SolveText(Repeat("-", depth) + "x = 3"), "3");
+    CHECK_TEXT(SolveText("x" + Repeat("+x", 199999) + " = 100000"), "0.5");
+}
+
+static void TestFoldingAndSharing() {
+    // Constant subtrees leave a single number behind
+    CHECK(NodeCount("x = sin(30)*sqrt(2)*(3pi + e)") == NodeCount("x = 1"));
+    // Equal subtrees are stored once, only the product is new
+    CHECK(NodeCount("(x+1)*(x+1) = 0") == NodeCount("x+1 = 0") + 1);
+    CHECK(NodeCount("(x^2+3x+1)*(x^2+3x+1) = 0") == NodeCount("x^2+3x+1 = 0") + 1);
+    CHECK_TEXT(SolveText("(x-2)*(x-2) = 0"), "2");
+}
+
+int main() {
+    TestSolve();
+    TestErrors();
+    TestDeepInput();
+    TestFoldingAndSharing();
+    return g_Failures;
+}
@@ -0,0 +1,64 @@
+#include "check.h"
+#include "solve_static.h"
+#include <cmath>
+
+// Degree 3 and up goes through FindRootsAberth, in the compiler too
+constexpr auto STATIC_ROOTS = SolveStatic<"(x-1)^3*(x+2) = 0">();
+static_assert(STATIC_ROOTS.Values.size() == 2);
+static_assert(STATIC_ROOTS.Values[0] == -2.0);
+static_assert(STATIC_ROOTS.Values[1] > 1.0 - 1e-12 && STATIC_ROOTS.Values[1] < 1.0 + 1e-12);
+
+static void TestSimpleRoots() {
+    CHECK_TEXT(SolveText("x^3-6x^2+11x-6=0"), "1 2 3");
+    CHECK_TEXT(
+        SolveText("(x-1)(x-2)(x-3)(x-4)(x-5)(x-6)(x-7)(x-8)(x-9)(x-10)=0"), "1 2 3 4 5 6 7 8 9 10");
+    CHECK_TEXT(SolveText("x^6=64"), "-2 2");
+    CHECK_TEXT(SolveText("x^5+1=0"), "-1");
+    CHECK_TEXT(SolveText("x^4+1=0"), "No solution");
+    CHECK_TEXT(SolveText("(x^2+1)^20*(x-3)=0"), "3");
+
+    // The expanded coefficients reach 1e17 and are rounded, the roots are found on the text
+    Solutions solutions;
+    CHECK(Solve("(x+2)^40=5", solutions) && solutions.Values.size() == 2);
+    if (solutions.Values.size() == 2) {
+        const double offset = std::pow(5.0, 1.0 / 40.0);
+        CHECK(std::abs(solutions.Values[0] - (-2.0 - offset)) < 1e-9);
+        CHECK(std::abs(solutions.Values[1] - (-2.0 + offset)) < 1e-12);
+    }
+}
+
+// Expanded, these are rings of roots around one point that rounding can't tell from a multiple
+// root, or whose real roots it can't tell from complex ones. The roots come from the text.
+static void TestIllConditioned() {
+    CHECK_TEXT(SolveText("(x+1)^100=1"), "-2 0");
+    CHECK_TEXT(SolveText("(x+1)^200=1"), "-2 0");
+    CHECK_TEXT(SolveText("(x+1)^300=1"), "-2 0");
+    CHECK_TEXT(SolveText("(x+1)^1000=1"), "-2 0");
+    CHECK_TEXT(SolveText("(x+1)^100=0.5"), "-1.9930924954 -0.0069075046");
+    CHECK_TEXT(SolveText("(x-3)^30=2"), "1.976626108 4.023373892");
+    CHECK_TEXT(SolveText("(x-3)^30=-2"), "No solution");
+}
+
+// A multiple root is reported once, even when rounding the expanded coefficients spreads it
+// into a ring of approximations
+static void TestMultipleRoots() {
+    CHECK_TEXT(SolveText("x^7=0"), "0");
+    CHECK_TEXT(SolveText("(x+1)^5=0"), "-1");
+    CHECK_TEXT(SolveText("(x-1)^5=0"), "1");
+    CHECK_TEXT(SolveText("(x+1)^50=0"), "-1");
+    CHECK_TEXT(SolveText("(x+1)^100=0"), "-1");
+    CHECK_TEXT(SolveText("(x+1)^1024=0"), "-1");
+    CHECK_TEXT(SolveText("(x-2)^90=0"), "2");
+    CHECK_TEXT(SolveText("(x-1)^2*(x-3)^3=0"), "1 3");
+    CHECK_TEXT(SolveText("(x-0.5)^3*(x+0.25)^2=0"), "-0.25 0.5");
+    CHECK_TEXT(SolveText("(x-1)^40*(x+2)=0"), "-2 1");
+    CHECK_TEXT(SolveText("(x-1)^57*(x+2)=0"), "-2 1");
+    CHECK_TEXT(SolveText("(x-1)^100*(x+2)=0"), "-2 1");
+}
+
+int main() {
+    TestSimpleRoots();
+    TestMultipleRoots();
+    TestIllConditioned();
+    return g_Failures;
+}
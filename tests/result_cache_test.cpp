@@ -0,0 +1,85 @@
+#include "check.h"
+#include "result_cache.h"
+#include <string>
+
+static std::string SolveCached(ResultCache& cache, std::string_view equation,
+    const SolveLimits& limits = {}) {
+    Solutions solutions;
+    const auto result = cache.Solve(equation, solutions, {}, limits);
+    return FormatResult(result, solutions);
+}
+
+// The second solve of a text is a hit on the text key, errors included
+static void TestTextHits() {
+    ResultCache cache(1 << 20);
+    CHECK_TEXT(SolveCached(cache, "x^2 = 4"), "2 -2");
+    CHECK_TEXT(SolveCached(cache, "x^2 = 4"), "2 -2");
+    CHECK_TEXT(SolveCached(cache, "1/0 = x"), SolveText("1/0 = x"));
+    CHECK_TEXT(SolveCached(cache, "1/0 = x"), SolveText("1/0 = x"));
+    CHECK_TEXT(SolveCached(cache, "sin(x) = 0.5"), "30"); // numeric roots only have the text
+    CHECK_TEXT(SolveCached(cache, "sin(x) = 0.5"), "30");
+
+    const ResultCacheStats stats = cache.Stats();
+    CHECK(stats.TextHits == 3);
+    CHECK(stats.PolynomialHits == 0);
+    CHECK(stats.Misses == 3);
+    CHECK(stats.Entries == 4); // the polynomial of x^2 = 4 too
+    CHECK(stats.Evictions == 0);
+    CHECK(stats.Bytes > 0);
+}
+
+// Texts that reduce to the same coefficients share the root finding
+static void TestPolynomialHits() {
+    ResultCache cache(1 << 20);
+    CHECK_TEXT(SolveCached(cache, "2x+4=0"), "-2");
+    CHECK_TEXT(SolveCached(cache, "4 + 2*x = 0"), "-2");
+    CHECK_TEXT(SolveCached(cache, "x^3 - 6x^2 + 11x = 6"), "1 2 3");
+    CHECK_TEXT(SolveCached(cache, "(x-1)(x-2)(x-3) = 0"), "1 2 3");
+    CHECK_TEXT(SolveCached(cache, "4x+8=0"), "-2"); // scaled, a different polynomial
+
+    const ResultCacheStats stats = cache.Stats();
+    CHECK(stats.TextHits == 0);
+    CHECK(stats.PolynomialHits == 2);
+    CHECK(stats.Misses == 3);
+}
+
+// Limit errors say nothing about the equation and aren't kept
+static void TestLimits() {
+    ResultCache cache(1 << 20);
+    SolveLimits limits;
+    limits.MaxTokens = 3;
+    Solutions solutions;
+    const auto expected = Solve("x + 1 = 2", solutions, {}, limits);
+    CHECK(!expected && expected.error().Code == ErrorCode::TooManyTokens);
+    CHECK_TEXT(SolveCached(cache, "x + 1 = 2", limits), FormatResult(expected, solutions));
+    CHECK(cache.Stats().Entries == 0);
+    CHECK_TEXT(SolveCached(cache, "x + 1 = 2"), "1");
+}
+
+// Past its memory the cache evicts, and what it evicted is solved again
+static void TestEviction() {
+    constexpr size_t LIMIT = 16 * 1024;
+    ResultCache cache(LIMIT, 1);
+    for (int i = 0; i < 2000; i++) {
+        const std::string equation = "x = " + std::to_string(i + 1);
+        CHECK_TEXT(SolveCached(cache, equation), std::to_string(i + 1));
+    }
+    ResultCacheStats stats = cache.Stats();
+    CHECK(stats.Evictions > 0);
+    CHECK(stats.Bytes <= LIMIT);
+    CHECK(stats.Entries < 4000);
+    CHECK(stats.Misses == 2000);
+
+    CHECK_TEXT(SolveCached(cache, "x = 1"), "1");
+    stats = cache.Stats();
+    CHECK(stats.Misses == 2001);
+    CHECK(stats.Bytes <= LIMIT);
+}
+
+int main() {
+    TestTextHits();
+    TestPolynomialHits();
+    TestLimits();
+    TestEviction();
+    return g_Failures;
+}
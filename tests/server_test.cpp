@@ -0,0 +1,115 @@
+#include "check.h"
+#include "server.h"
+
+#ifdef __linux__
+    #include <algorithm>
+    #include <csignal>
+    #include <cstring>
+    #include <filesystem>
+    #include <sys/socket.h>
+    #include <sys/un.h>
+    #include <thread>
+    #include <unistd.h>
+    #include <vector>
+
+// Connects to the server's socket, retrying while it starts up
+static int Connect(const std::string& path) {
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    for (int attempt = 0; attempt < 500; attempt++) {
+        const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0) {
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+// Sends requests, half-closes and reads the responses until the server closes. They are
+// answered as they finish, so they come back sorted by line.
+static std::vector<std::string> Exchange(const std::string& path, std::string_view requests) {
+    const int fd = Connect(path);
+    CHECK(fd >= 0);
+    if (fd < 0) {
+        return {};
+    }
+    CHECK(send(fd, requests.data(), requests.size(), MSG_NOSIGNAL) == ssize_t(requests.size()));
+    shutdown(fd, SHUT_WR);
+
+    std::string received;
+    char buffer[4096];
+    for (ssize_t size; (size = read(fd, buffer, sizeof(buffer))) > 0;) {
+        received.append(buffer, size_t(size));
+    }
+    close(fd);
+
+    std::vector<std::string> lines;
+    for (size_t start = 0, end; (end = received.find('\n', start)) != std::string::npos;
+        start = end + 1) {
+        lines.push_back(received.substr(start, end - start));
+    }
+    std::sort(lines.begin(), lines.end());
+    return lines;
+}
+
+static void TestProtocol(const std::string& path) {
+    // Pipelined requests, a blank line, tabs, CRLF and a last line without its line break
+    const std::vector<std::string> responses =
+        Exchange(path, "1 2x+4=0\n2\tx^2=4\r\n\n3 1/0=x\n4 x=5");
+    const std::vector<std::string> expected = { "1 -2", "2 2 -2",
+        "3 Error: Division by zero (column 3)", "4 5" };
+    CHECK(responses == expected);
+
+    // Many requests on one connection, more than one task's worth
+    std::string many;
+    for (int i = 0; i < 300; i++) {
+        many += std::to_string(1000 + i) + " x=" + std::to_string(i + 1) + "\n";
+    }
+    const std::vector<std::string> answers = Exchange(path, many);
+    CHECK(answers.size() == 300);
+    for (size_t i = 0; i < answers.size(); i++) {
+        CHECK_TEXT(answers[i], std::to_string(1000 + i) + " " + std::to_string(i + 1));
+    }
+}
+
+// A port past 65535 is refused rather than wrapped around
+static void TestPort() {
+    ServeOptions options;
+    options.Address = "99999";
+    CHECK(RunServer(options) == 1);
+}
+
+int main() {
+    // The server stops on SIGTERM through its signalfd, every thread must have it blocked
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    TestPort();
+
+    ServeOptions options;
+    options.Address = (std::filesystem::temp_directory_path() /
+                       ("algebra_server_test_" + std::to_string(getpid()) + ".sock"))
+                          .string();
+    options.Threads = 4;
+    int status = -1;
+    std::thread server([&] { status = RunServer(options); });
+    TestProtocol(options.Address);
+    kill(getpid(), SIGTERM);
+    server.join();
+    CHECK(status == 0);
+    return g_Failures;
+}
+
+#else
+
+int main() {
+    return 0; // --serve is Linux only
+}
+
+#endif
@@ -0,0 +1,113 @@
+#include "check.h"
+#include "session.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+
+// The session adds the terms up in another order, the roots can differ in the last bits and a
+// zero in its sign. Otherwise it solves like the whole text, errors included.
+static void CheckSession(EditSession& session, const char* file, int line) {
+    Solutions got;
+    const auto result = session.Solve(got);
+    Solutions expected;
+    const auto expectedResult = Solve(session.Text(), expected);
+
+    bool close = result && expectedResult && got.Values.size() == expected.Values.size() &&
+                 !got.IsNone && !got.IsInfinite && !expected.IsNone && !expected.IsInfinite;
+    for (size_t i = 0; close && i < got.Values.size(); i++) {
+        const double scale = std::max(1.0, std::abs(expected.Values[i]));
+        close = std::abs(got.Values[i] - expected.Values[i]) <= 1e-9 * scale;
+    }
+    if (!close) {
+        CheckText(FormatResult(result, got), FormatResult(expectedResult, expected),
+            session.Text().c_str(), file, line);
+    }
+}
+
+#define CHECK_SESSION(session) CheckSession(session, __FILE__, __LINE__)
+
+static std::string SolveSession(EditSession& session) {
+    Solutions solutions;
+    const auto result = session.Solve(solutions);
+    return FormatResult(result, solutions);
+}
+
+static void TestEdits() {
+    EditSession session("2x^2 + 4x - 6 = 0");
+    CHECK_TEXT(SolveSession(session), "1 -3");
+
+    session.Edit(0, 1, "3"); // replace
+    CHECK_TEXT(session.Text(), "3x^2 + 4x - 6 = 0");
+    CHECK_SESSION(session);
+
+    session.Edit(9, 0, " + 5x^3"); // insert a term
+    CHECK_TEXT(session.Text(), "3x^2 + 4x + 5x^3 - 6 = 0");
+    CHECK_SESSION(session);
+
+    session.Edit(9, 7, ""); // delete it again
+    CHECK_TEXT(session.Text(), "3x^2 + 4x - 6 = 0");
+    CHECK_SESSION(session);
+
+    session.Edit(16, 1, "x^2 - (x + 1)"); // the right side
+    CHECK_SESSION(session);
+
+    session.Edit(1000, 5, " + 1"); // clamped to the end
+    CHECK_TEXT(session.Text(), "3x^2 + 4x - 6 = x^2 - (x + 1) + 1");
+    CHECK_SESSION(session);
+
+    session.Edit(0, 1000, "sin(x) = 0.5"); // everything, numeric
+    CHECK_TEXT(SolveSession(session), "30");
+}
+
+static void TestErrors() {
+    EditSession session("x + 1 = 2");
+    CHECK_TEXT(SolveSession(session), "1");
+
+    session.Edit(4, 0, "*"); // parse error inside a term
+    CHECK_SESSION(session);
+    session.Edit(4, 1, "("); // unbalanced parenthesis
+    CHECK_SESSION(session);
+    session.Edit(4, 1, "");
+    CHECK_TEXT(SolveSession(session), "1");
+
+    session.Edit(6, 1, "$"); // lexer error
+    CHECK_SESSION(session);
+    session.Edit(6, 1, "=");
+    CHECK_TEXT(SolveSession(session), "1");
+
+    session.Edit(0, 1, "y"); // mixed variables
+    session.Edit(session.Text().size(), 0, " + x");
+    CHECK_SESSION(session);
+
+    session.Edit(0, 0, "1/0 + "); // analysis error
+    CHECK_SESSION(session);
+}
+
+// Random edits of random pieces of equations, typing included
+static void TestRandomEdits() {
+    static const std::string_view PIECES[] = { "x", "2", "3.5", "+", "-", "*", "/", "^", "(", ")",
+        "=", " ", "x^2", "sin(", "2x", " + x", " - 1", "0" };
+    std::mt19937 random(12345);
+    EditSession session("x^2 - 1 = 0");
+    for (int step = 0; step < 2000; step++) {
+        const size_t size = session.Text().size();
+        const size_t offset = random() % (size + 1);
+        const size_t removed = random() % 3 == 0 ? random() % 4 : 0;
+        const std::string_view inserted = removed != 0 && random() % 2 == 0
+                                              ? std::string_view{}
+                                              : PIECES[random() % std::size(PIECES)];
+        session.Edit(offset, removed, inserted);
+        CHECK_SESSION(session);
+        if (session.Text().size() > 60) {
+            session.Edit(0, session.Text().size(), "x^2 - 1 = 0");
+        }
+    }
+}
+
+int main() {
+    TestEdits();
+    TestErrors();
+    TestRandomEdits();
+    return g_Failures;
+}
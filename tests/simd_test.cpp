@@ -0,0 +1,140 @@
+#include "check.h"
+#include "simd.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+// Inputs where the kernels take their special paths: signed zeros, subnormals, exact multiples of
+// 90 degrees, values past TRIG_HUGE that are reduced with fmod, and the non-finite ones
+static std::vector<double> Inputs() {
+    constexpr double INF = std::numeric_limits<double>::infinity();
+    std::vector<double> in = { 0.0, -0.0, 5e-324, -5e-324, 1e-310, -1e-310, 2.2250738585072009e-308,
+        0x1p45, -0x1p45, 0x1p45 + 90.0, 0x1p52, 0x1p53 + 2.0, 1e15, 1e300, -1e300,
+        std::numeric_limits<double>::max(), INF, -INF, std::numeric_limits<double>::quiet_NaN(),
+        0.5, -0.5, 1.0, -1.0, 1.0 + 0x1p-52, 1.0 - 0x1p-53, 0.1, 10.0, 1e-5 };
+    for (int k = -40; k <= 40; k++) {
+        in.push_back(90.0 * k);
+        in.push_back(std::nextafter(90.0 * k, INF));
+        in.push_back(std::nextafter(90.0 * k, -INF));
+        in.push_back(90.0 * k * 0x1p30);
+        in.push_back(45.0 * k);
+    }
+    std::mt19937_64 random(2024);
+    std::uniform_real_distribution<double> degrees(-1000.0, 1000.0);
+    std::uniform_real_distribution<double> unit(-1.2, 1.2);
+    std::uniform_int_distribution<int> exponent(-1074, 1023);
+    for (int i = 0; i < 4000; i++) {
+        in.push_back(degrees(random));
+        in.push_back(unit(random));
+        in.push_back(std::ldexp(unit(random), exponent(random)));
+    }
+    in.push_back(3.0); // a tail the vector loops leave to the scalar code
+    return in;
+}
+
+static bool SameBits(double a, double b) {
+    return std::bit_cast<uint64_t>(a) == std::bit_cast<uint64_t>(b) ||
+           (std::isnan(a) && std::isnan(b));
+}
+
+// Every level gives the bits of the scalar code, for every function and both tiers. Levels the
+// CPU lacks run the widest one it has, so they pass trivially.
+static void TestLevels() {
+    using enum FunctionType;
+    const std::vector<double> in = Inputs();
+    std::vector<double> expected(in.size());
+    std::vector<double> got(in.size());
+    for (const FunctionType fn :
+        { Sin, Cos, Tan, Asin, Acos, Atan, Log, Ln, Sqrt, Floor, Ceil, Abs }) {
+        for (const bool fast : { false, true }) {
+            FunctionArray(fn, in.data(), expected.data(), in.size(), fast, SimdLevel::Scalar);
+            for (const SimdLevel level : { SimdLevel::Sse2, SimdLevel::Avx2, SimdLevel::Avx512 }) {
+                FunctionArray(fn, in.data(), got.data(), in.size(), fast, level);
+                size_t mismatches = 0;
+                for (size_t i = 0; i < in.size(); i++) {
+                    if (!SameBits(got[i], expected[i]) && mismatches++ == 0) {
+                        std::fprintf(stderr, "fn %d fast %d %s: f(%a) = %a, scalar %a\n", int(fn),
+                            int(fast), SimdLevelName(level), in[i], got[i], expected[i]);
+                    }
+                }
+                CHECK(mismatches == 0);
+            }
+        }
+    }
+}
+
+// The default entry point runs the widest level
+static void TestDefault() {
+    const std::vector<double> in = Inputs();
+    std::vector<double> expected(in.size());
+    std::vector<double> got(in.size());
+    FunctionArray(FunctionType::Sin, in.data(), expected.data(), in.size(), false,
+        DetectSimdLevel());
+    FunctionArray(FunctionType::Sin, in.data(), got.data(), in.size(), false);
+    CHECK(std::equal(got.begin(), got.end(), expected.begin(), SameBits));
+}
+
+// Over several pool chunks SolveBatch gives the bits it gives on one thread, and the roots of
+// Solve(): the same count, in the same order, within rounding since two roots are computed
+// without cancellation. Small halves make a = 0 and d = 0 common.
+static void TestBatch() {
+    constexpr size_t COUNT = 40000;
+    std::mt19937_64 random(7);
+    std::uniform_int_distribution<int> halves(-8, 8);
+    std::vector<double> a(COUNT);
+    std::vector<double> b(COUNT);
+    std::vector<double> c(COUNT);
+    for (size_t i = 0; i < COUNT; i++) {
+        a[i] = 0.5 * halves(random);
+        b[i] = 0.5 * halves(random);
+        c[i] = 0.5 * halves(random);
+    }
+
+    ThreadPool pool(4);
+    RootsSoA pooled;
+    RootsSoA single;
+    SolveBatch(a, b, c, pooled, &pool);
+    SolveBatch(a, b, c, single);
+    CHECK(pooled.Count == single.Count);
+    CHECK(std::equal(pooled.Root0.begin(), pooled.Root0.end(), single.Root0.begin(), SameBits));
+    CHECK(std::equal(pooled.Root1.begin(), pooled.Root1.end(), single.Root1.begin(), SameBits));
+
+    auto close = [](double got, double expected) {
+        return std::abs(got - expected) <= 1e-12 * std::max(1.0, std::abs(expected));
+    };
+    size_t mismatches = 0;
+    for (size_t i = 0; i < COUNT; i++) {
+        char equation[96];
+        std::snprintf(equation, sizeof(equation), "%g*x^2 + %g*x + %g = 0", a[i], b[i], c[i]);
+        Solutions expected;
+        CHECK(Solve(equation, expected).has_value());
+
+        const uint8_t count = pooled.Count[i];
+        bool same = expected.IsInfinite ? count == INFINITE_ROOTS
+                                        : count == expected.Values.size();
+        if (same && count >= 1 && count != INFINITE_ROOTS) {
+            same = close(pooled.Root0[i], expected.Values[0]);
+        }
+        if (same && count == 2) {
+            same = close(pooled.Root1[i], expected.Values[1]);
+        }
+        if (!same && mismatches++ == 0) {
+            std::fprintf(stderr, "%s: count %d, roots %.17g %.17g\n", equation, int(count),
+                pooled.Root0[i], pooled.Root1[i]);
+        }
+    }
+    CHECK(mismatches == 0);
+}
+
+int main() {
+    std::printf("SIMD level: %s\n", SimdLevelName(DetectSimdLevel()));
+    TestLevels();
+    TestDefault();
+    TestBatch();
+    return g_Failures;
+}
@@ -0,0 +1,160 @@
+#include "check.h"
+#include "stats.h"
+#include <filesystem>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+#include <thread>
+
+// Without the stats built in, Stats() stays empty whatever is solved
+constexpr uint64_t BUILT = ALGEBRA_STATS ? 1 : 0;
+
+static const std::string_view GOOD[] = { "2x+4=0", "x^2=4", "x^3-6x^2+11x-6=0", "x=x",
+    "x^2=-1" };
+
+static void SolveAll(std::span<const std::string_view> equations) {
+    Solutions solutions;
+    for (const std::string_view equation : equations) {
+        [[maybe_unused]] const auto result = Solve(equation, solutions);
+    }
+}
+
+static uint64_t ErrorsOf(const StatsSnapshot& stats, ErrorCode code) {
+    return stats.Errors[size_t(code)];
+}
+
+// Nothing is recorded until the stats are turned on
+static void TestDisabled() {
+    CHECK(!StatsEnabled());
+    SolveAll(GOOD);
+    SolveAll(std::array<std::string_view, 1>{ "1/0=x" });
+    const StatsSnapshot stats = Stats();
+    CHECK(stats.Solves == 0 && stats.Parses == 0 && stats.Tokens == 0);
+    CHECK(ErrorsOf(stats, ErrorCode::DivisionByZero) == 0);
+}
+
+// Solves, parses and errors by code, including those of threads that have exited
+static void TestCounters() {
+    SetStatsEnabled(true);
+    CHECK(StatsEnabled() == bool(BUILT));
+    const StatsSnapshot before = Stats();
+
+    SolveAll(GOOD);
+    std::thread([] {
+        const std::string_view errors[] = { "1/0=x", "x=2/(1-1)", "sqrt(-1)=x", "x = 2 $ 1" };
+        SolveAll(errors);
+    }).join();
+
+    const StatsSnapshot after = Stats();
+    CHECK(after.Solves - before.Solves == 9 * BUILT);
+    CHECK(after.Parses - before.Parses == 8 * BUILT); // the tokenizer error never parsed
+    CHECK(after.Tokens - before.Tokens >= 8 * 3 * BUILT);
+    CHECK(after.Nodes - before.Nodes >= 8 * 3 * BUILT);
+    CHECK(after.ArenaBytesUsed >= before.ArenaBytesUsed);
+    CHECK(ErrorsOf(after, ErrorCode::DivisionByZero) - ErrorsOf(before, ErrorCode::DivisionByZero) ==
+          2 * BUILT);
+    CHECK(ErrorsOf(after, ErrorCode::SqrtDomain) - ErrorsOf(before, ErrorCode::SqrtDomain) == BUILT);
+    CHECK(ErrorsOf(after, ErrorCode::InvalidSymbol) - ErrorsOf(before, ErrorCode::InvalidSymbol) ==
+          BUILT);
+    CHECK(ErrorsOf(after, ErrorCode::AsinDomain) == ErrorsOf(before, ErrorCode::AsinDomain));
+
+    // Every timed phase lands in exactly one bucket
+    for (const LatencyHistogram& histogram : after.Phases) {
+        CHECK(std::accumulate(histogram.Buckets.begin(), histogram.Buckets.end(), uint64_t(0)) ==
+              histogram.Count);
+    }
+    const LatencyHistogram& parse = after.Phases[size_t(StatsPhase::Parse)];
+    CHECK(parse.Count - before.Phases[size_t(StatsPhase::Parse)].Count >= 8 * BUILT);
+
+    std::ostringstream summary;
+    WriteStats(after, summary);
+    CHECK(summary.str().starts_with("Solves: " + std::to_string(after.Solves) + "\n"));
+    CHECK(!BUILT || summary.str().find("Error DivisionByZero: 2\n") != std::string::npos);
+
+    SetStatsEnabled(false);
+    SolveAll(GOOD);
+    CHECK(Stats().Solves == after.Solves);
+}
+
+static bool HasLine(const std::string& text, const std::string& line) {
+    return text.starts_with(line + "\n") || text.find("\n" + line + "\n") != std::string::npos;
+}
+
+// The exposition format, checked on a snapshot with known counts
+static void TestPrometheus() {
+    StatsSnapshot stats;
+    LatencyHistogram& roots = stats.Phases[size_t(StatsPhase::Roots)];
+    roots.Buckets[0] = 2;
+    roots.Buckets[3] = 1;
+    roots.Buckets[LatencyHistogram::BUCKET_COUNT - 1] = 1;
+    roots.Count = 4;
+    roots.SumNs = 2'500'000'000;
+    stats.Solves = 7;
+    stats.Tokens = 40;
+    stats.ArenaBytesReserved = 4096;
+    stats.Errors[size_t(ErrorCode::DivisionByZero)] = 3;
+
+    std::ostringstream out;
+    WritePrometheus(stats, out);
+    const std::string text = out.str();
+    CHECK(HasLine(text, "# TYPE algebra_phase_duration_seconds histogram"));
+    CHECK(HasLine(text, "algebra_phase_duration_seconds_bucket{phase=\"roots\",le=\"+Inf\"} 4"));
+    CHECK(HasLine(text, "algebra_phase_duration_seconds_sum{phase=\"roots\"} 2.5"));
+    CHECK(HasLine(text, "algebra_phase_duration_seconds_count{phase=\"roots\"} 4"));
+    CHECK(HasLine(text, "algebra_phase_duration_seconds_count{phase=\"parse\"} 0"));
+    CHECK(HasLine(text, "# TYPE algebra_solves_total counter"));
+    CHECK(HasLine(text, "algebra_solves_total 7"));
+    CHECK(HasLine(text, "algebra_tokens_total 40"));
+    CHECK(HasLine(text, "# TYPE algebra_arena_reserved_bytes gauge"));
+    CHECK(HasLine(text, "algebra_arena_reserved_bytes 4096"));
+    CHECK(HasLine(text,
+        "algebra_errors_total{category=\"analysis\",code=\"DivisionByZero\"} 3"));
+    CHECK(HasLine(text, "algebra_errors_total{category=\"domain\",code=\"SqrtDomain\"} 0"));
+
+    // The buckets are cumulative with growing bounds, the first one is 64 ns
+    std::istringstream lines(text);
+    std::string line;
+    const std::string prefix = "algebra_phase_duration_seconds_bucket{phase=\"roots\",le=\"";
+    std::vector<std::pair<double, uint64_t>> buckets;
+    while (std::getline(lines, line)) {
+        if (line.starts_with(prefix) && !line.contains("+Inf")) {
+            const size_t quote = line.find('"', prefix.size());
+            buckets.emplace_back(std::stod(line.substr(prefix.size(), quote - prefix.size())),
+                std::stoull(line.substr(line.rfind(' ') + 1)));
+        }
+    }
+    CHECK(buckets.size() == LatencyHistogram::BUCKET_COUNT - 1);
+    if (buckets.size() != LatencyHistogram::BUCKET_COUNT - 1) {
+        return;
+    }
+    CHECK(buckets[0].first == 64e-9 && buckets[0].second == 2);
+    CHECK(buckets[2].second == 2 && buckets[3].second == 3 && buckets.back().second == 3);
+    for (size_t b = 1; b < buckets.size(); b++) {
+        CHECK(buckets[b].first == 2 * buckets[b - 1].first);
+    }
+}
+
+// The dump replaces the file whole and leaves no temporary file behind
+static void TestPrometheusFile() {
+    const auto path = std::filesystem::temp_directory_path() / "algebra_stats_test.prom";
+    std::ofstream(path) << "old\n";
+    CHECK(WritePrometheusFile(path.string()));
+    CHECK(!std::filesystem::exists(path.string() + ".tmp"));
+
+    std::stringstream read;
+    read << std::ifstream(path).rdbuf();
+    std::ostringstream expected;
+    WritePrometheus(Stats(), expected);
+    CHECK(read.str() == expected.str());
+    std::filesystem::remove(path);
+
+    CHECK(!WritePrometheusFile((path / "missing" / "stats.prom").string()));
+}
+
+int main() {
+    TestDisabled();
+    TestCounters();
+    TestPrometheus();
+    TestPrometheusFile();
+    return g_Failures;
+}
@@ -0,0 +1,137 @@
+#include "check.h"
+#include "linear_solver.h"
+#include "system.h"
+#include "thread_pool.h"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+// The nonzeros of a row-major n x n matrix
+static SparseMatrix FromDense(size_t n, const std::vector<double>& dense) {
+    SparseMatrix a;
+    a.Size = n;
+    for (size_t i = 0; i < n; i++) {
+        for (size_t j = 0; j < n; j++) {
+            if (dense[i * n + j] != 0.0) {
+                a.Columns.push_back(uint32_t(j));
+                a.Values.push_back(dense[i * n + j]);
+            }
+        }
+        a.RowStart.push_back(a.Columns.size());
+    }
+    return a;
+}
+
+// b = a x, so x is the solution
+static std::vector<double> Multiply(const SparseMatrix& a, const std::vector<double>& x) {
+    std::vector<double> b(a.Size);
+    for (size_t i = 0; i < a.Size; i++) {
+        for (size_t k = a.RowStart[i]; k < a.RowStart[i + 1]; k++) {
+            b[i] += a.Values[k] * x[a.Columns[k]];
+        }
+    }
+    return b;
+}
+
+static double MaxError(const std::vector<double>& got, const std::vector<double>& expected) {
+    double error = 0.0;
+    for (size_t i = 0; i < got.size(); i++) {
+        error = std::max(error, std::abs(got[i] - expected[i]));
+    }
+    return error;
+}
+
+// Runs RunSystem() on text and returns its exit code and output
+static int RunText(const std::string& text, std::string& output) {
+    const auto directory = std::filesystem::temp_directory_path();
+    const auto input = directory / "algebra_system_test.in";
+    const auto result = directory / "algebra_system_test.out";
+    std::ofstream(input) << text;
+
+    SystemOptions options;
+    options.InputPath = input.string();
+    options.OutputPath = result.string();
+    options.Threads = 2;
+    const int code = RunSystem(options);
+
+    std::stringstream read;
+    read << std::ifstream(result).rdbuf();
+    output = read.str();
+    std::filesystem::remove(input);
+    std::filesystem::remove(result);
+    return code;
+}
+
+static void TestSmallDense() {
+    std::string output;
+    CHECK(RunText("x + y + z = 6\n2x - y + 3z = 9\n-x + 4y - z = 4\n", output) == 0);
+    CHECK_TEXT(output, "x 1\ny 2\nz 3\n");
+
+    // Large enough for the blocked LU and its updates on the pool
+    constexpr size_t N = 300;
+    std::mt19937_64 random(11);
+    std::uniform_real_distribution<double> entry(-1.0, 1.0);
+    std::vector<double> dense(N * N);
+    std::vector<double> x(N);
+    for (size_t i = 0; i < N; i++) {
+        for (size_t j = 0; j < N; j++) {
+            dense[i * N + j] = entry(random);
+        }
+        x[i] = entry(random);
+    }
+    const SparseMatrix a = FromDense(N, dense);
+    const std::vector<double> b = Multiply(a, x);
+    std::vector<double> got(N);
+    ThreadPool pool(4);
+    CHECK(SolveLinearSystem(a, b, got, pool) == LinearSolveResult::Solved);
+    CHECK(MaxError(got, x) < 1e-9);
+}
+
+// -x[i-1] + 2 x[i] - x[i+1] = b[i], which the sparse LU factors without fill-in
+static void TestTridiagonal() {
+    constexpr size_t N = 3000;
+    SparseMatrix a;
+    a.Size = N;
+    std::vector<double> x(N);
+    for (size_t i = 0; i < N; i++) {
+        if (i > 0) {
+            a.Columns.push_back(uint32_t(i - 1));
+            a.Values.push_back(-1.0);
+        }
+        a.Columns.push_back(uint32_t(i));
+        a.Values.push_back(2.0);
+        if (i + 1 < N) {
+            a.Columns.push_back(uint32_t(i + 1));
+            a.Values.push_back(-1.0);
+        }
+        a.RowStart.push_back(a.Columns.size());
+        x[i] = std::sin(double(i));
+    }
+    const std::vector<double> b = Multiply(a, x);
+    std::vector<double> got(N);
+    ThreadPool pool(4);
+    CHECK(SolveLinearSystem(a, b, got, pool) == LinearSolveResult::Solved);
+    CHECK(MaxError(got, x) < 1e-6);
+}
+
+static void TestSingular() {
+    const std::vector<double> dense = { 1, 2, 3, 2, 4, 6, 1, 0, 1 };
+    const SparseMatrix a = FromDense(3, dense);
+    const std::vector<double> b = { 1, 2, 3 };
+    std::vector<double> got(3);
+    ThreadPool pool(2);
+    CHECK(SolveLinearSystem(a, b, got, pool) == LinearSolveResult::Singular);
+
+    std::string output;
+    CHECK(RunText("x + y = 1\n2x + 2y = 2\n", output) == 1);
+    CHECK(output.empty());
+}
+
+int main() {
+    TestSmallDense();
+    TestTridiagonal();
+    TestSingular();
+    return g_Failures;
+}
@@ -0,0 +1,121 @@
+#include "check.h"
+#include "tabulate.h"
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <numbers>
+#include <sstream>
+
+static std::string RunText(const TabulateOptions& base, size_t threads) {
+    const auto path = std::filesystem::temp_directory_path() / "algebra_tabulate_test.out";
+    TabulateOptions options = base;
+    options.OutputPath = path.string();
+    options.Threads = threads;
+    CHECK(RunTabulate(options) == 0);
+
+    std::stringstream read;
+    read << std::ifstream(path, std::ios::binary).rdbuf();
+    std::filesystem::remove(path);
+    return read.str();
+}
+
+// The "<x> <value>" lines of a table
+static std::vector<std::pair<double, double>> Rows(const std::string& text) {
+    std::vector<std::pair<double, double>> rows;
+    std::istringstream lines(text);
+    std::string line;
+    while (std::getline(lines, line)) {
+        const size_t space = line.find(' ');
+        CHECK(space != std::string::npos);
+        rows.emplace_back(std::strtod(line.c_str(), nullptr),
+            std::strtod(line.c_str() + space + 1, nullptr));
+    }
+    return rows;
+}
+
+static bool Near(double got, double expected) {
+    return std::abs(got - expected) <= 1e-12 * std::max(1.0, std::abs(expected));
+}
+
+static void TestParse() {
+    TabulateOptions options;
+    CHECK(ParseGridSpec("t=-1.5:2:0.25", options));
+    CHECK(options.Variable == "t" && options.Start == -1.5 && options.Stop == 2.0 &&
+          options.Step == 0.25);
+    CHECK(ParseGridSpec("x=3:1:-0.5", options)); // counting down
+    CHECK(!ParseGridSpec("x=1:3:-1", options));  // never reaches the stop
+    CHECK(!ParseGridSpec("x=0:1:0", options));
+    CHECK(!ParseGridSpec("=0:1:1", options));
+    CHECK(!ParseGridSpec("x=0:1", options));
+    CHECK(!ParseGridSpec("x=0:one:1", options));
+
+    MathTier tier = MathTier::Accurate;
+    CHECK(ParseMathTier("fast", tier) && tier == MathTier::Fast);
+    CHECK(ParseMathTier("exact", tier) && tier == MathTier::Exact);
+    CHECK(!ParseMathTier("quick", tier) && tier == MathTier::Exact);
+}
+
+// Every grid point in order, its value as the expression gives it, NaN outside the domain
+static void TestValues() {
+    TabulateOptions options;
+    CHECK(ParseGridSpec("x=-2:1:0.25", options));
+    options.Expression = "x^3 - 2x + 3 sin(30x) + sqrt(x)";
+    const auto rows = Rows(RunText(options, 2));
+    CHECK(rows.size() == 13); // the stop value is included
+
+    for (size_t i = 0; i < rows.size(); i++) {
+        const double x = -2.0 + double(i) * 0.25;
+        CHECK(rows[i].first == x);
+        const double value = x * x * x - 2 * x + 3 * std::sin(30 * x * std::numbers::pi / 180);
+        if (x < 0) {
+            CHECK(std::isnan(rows[i].second));
+        } else {
+            CHECK(Near(rows[i].second, value + std::sqrt(x)));
+        }
+    }
+
+    // Counting down, and a stop that is only a rounded multiple of the step
+    CHECK(ParseGridSpec("x=1:0:-0.1", options));
+    options.Expression = "10x + 1";
+    const auto down = Rows(RunText(options, 1));
+    CHECK(down.size() == 11);
+    for (size_t i = 0; i < down.size(); i++) {
+        CHECK(down[i].first == 1.0 - double(i) * 0.1);
+        CHECK(Near(down[i].second, 11.0 - double(i)));
+    }
+}
+
+// Many chunks on several threads come out in grid order, the same as on one thread
+static void TestOrder() {
+    TabulateOptions options;
+    CHECK(ParseGridSpec("x=0:1499.99:0.01", options));
+    options.Expression = "x^2 - cos(x)";
+    const std::string single = RunText(options, 1);
+    CHECK(RunText(options, 4) == single);
+
+    const auto rows = Rows(single);
+    CHECK(rows.size() == 150000);
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (rows[i].first != double(i) * 0.01) {
+            CHECK(rows[i].first == double(i) * 0.01);
+            break;
+        }
+    }
+}
+
+static void TestErrors() {
+    TabulateOptions options;
+    CHECK(ParseGridSpec("x=0:1:1", options));
+    options.Expression = "x + y";
+    CHECK(RunTabulate(options) == 1);
+    options.Expression = "x +";
+    CHECK(RunTabulate(options) == 1);
+}
+
+int main() {
+    TestParse();
+    TestValues();
+    TestOrder();
+    TestErrors();
+    return g_Failures;
+}